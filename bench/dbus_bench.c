@@ -0,0 +1,1413 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+
+/* D-Bus test bed: runs monitors against fake BlueZ, NetworkManager and MPRIS
+ * services on a private dbus-daemon and reports what each event costs.
+ *
+ *   dbus_bench [-d DEVICES] [-a APS] [-p PLAYERS] [-e EVENTS] [-r RATE]
+ *              [-f bluez|nm|mpris|all] BINARY...
+ *   dbus_bench -x [-d DEVICES] [-a APS] [-p PLAYERS] [-r RATE]
+ *
+ * Each run starts `dbus-daemon` (or $DBUS_DAEMON) with a permissive config
+ * in a temp dir and points both DBUS_SYSTEM_BUS_ADDRESS and
+ * DBUS_SESSION_BUS_ADDRESS at it. The stand-ins own org.bluez (hci0 plus
+ * DEVICES devices), org.freedesktop.NetworkManager (wlan0 plus APS access
+ * points) and PLAYERS org.mpris.MediaPlayer2.benchN players, each on its own
+ * connection so signal senders stay distinct. They answer Properties
+ * Get/GetAll, GetManagedObjects, GetDeviceByIpIface, GetAccessPoints and
+ * Introspect from one property store.
+ *
+ * Once the monitor has printed its first line and gone quiet, EVENTS
+ * signals are sent at RATE per second (0 = as fast as the monitor keeps up)
+ * from the family the binary's name implies: bluetooth_* gets BlueZ
+ * PropertiesChanged/InterfacesAdded/InterfacesRemoved, wlan_* gets NM
+ * strength, connectivity, state and AccessPointAdded/Removed, mpris_* gets
+ * Seeked, Metadata, PlaybackStatus and Volume changes. Most events are
+ * deliberately invisible (RSSI, LastScan, an unchanged Rate), so a monitor
+ * that re-reads everything on every signal shows up as calls/ev and
+ * cpu_us/ev.
+ *
+ * Reported per binary: method calls the monitor made per event, its CPU
+ * and the bus daemon's CPU per event, signal-to-line latency, time to the
+ * first line and the calls it took, plus the monitor's own latency_us from
+ * its stats file. paint_ms is the time to the first line when the binary is
+ * started a second time, with the snapshot of the first run on disk. Each line is attributed to the latest signal sent before
+ * it, so under overload e2e is a lower bound; latency_us includes the time
+ * signals sat queued in the monitor. -x only starts the bus and services, prints the addresses to
+ * export and keeps sending a mixed storm until SIGINT. */
+
+#define _GNU_SOURCE
+#include <dbus/dbus.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_DEVICES 256
+#define MAX_APS 256
+#define MAX_PLAYERS 32
+#define MAX_OBJECTS (MAX_DEVICES + MAX_APS + MAX_PLAYERS + 8)
+#define MAX_SERVICES (2 + MAX_PLAYERS)
+#define MAX_IFACES 3
+#define MAX_PROPS 16
+#define STARTUP_TIMEOUT_MS 5000
+#define QUIET_MS 300
+#define DRAIN_TIMEOUT_MS 30000
+
+#define BLUEZ_ADAPTER "org.bluez.Adapter1"
+#define BLUEZ_DEVICE "org.bluez.Device1"
+#define BLUEZ_BATTERY "org.bluez.Battery1"
+#define NM_PATH "/org/freedesktop/NetworkManager"
+#define NM_IFACE "org.freedesktop.NetworkManager"
+#define NM_DEVICE "org.freedesktop.NetworkManager.Device"
+#define NM_WIRELESS "org.freedesktop.NetworkManager.Device.Wireless"
+#define NM_ACTIVE "org.freedesktop.NetworkManager.Connection.Active"
+#define NM_AP "org.freedesktop.NetworkManager.AccessPoint"
+#define NM_DEVICE_PATH NM_PATH "/Devices/3"
+#define MPRIS_PATH "/org/mpris/MediaPlayer2"
+#define MPRIS_ROOT "org.mpris.MediaPlayer2"
+#define MPRIS_PLAYER "org.mpris.MediaPlayer2.Player"
+
+enum { SERVICE_BLUEZ, SERVICE_NM, SERVICE_PLAYER0 };
+enum { FAMILY_BLUEZ = 1, FAMILY_NM = 2, FAMILY_MPRIS = 4, FAMILY_ALL = 7 };
+
+// Property types beyond the D-Bus basic ones
+#define PROP_BYTES 'B'    // ay from s (Ssid)
+#define PROP_METADATA 'M' // MPRIS a{sv}: track v.u, title s
+
+typedef struct {
+  const char *name;
+  int type;
+  union {
+    dbus_bool_t b;
+    uint8_t y;
+    int16_t n;
+    int32_t i;
+    uint32_t u;
+    int64_t x;
+    double d;
+  } v;
+  char s[96];
+} Prop;
+
+typedef struct {
+  const char *name;
+  Prop props[MAX_PROPS];
+  int prop_count;
+} Iface;
+
+typedef struct {
+  char path[128];
+  int service;
+  bool present;
+  Iface ifaces[MAX_IFACES];
+  int iface_count;
+} Object;
+
+typedef struct {
+  size_t events;
+  size_t lines;
+  size_t calls;
+  size_t startup_calls;
+  double startup_ms;
+  double paint_ms; // first line on a second start, with a snapshot on disk
+  double cpu_us;
+  double bus_us;
+  double e2e_p50_us;
+  double e2e_p99_us;
+  double e2e_max_us;
+  bool started;
+  int exit_status; // -1 while running at the end of the storm
+  char latency[256];
+} RunResult;
+
+static int device_count = 8;
+static int ap_count = 20;
+static int player_count = 3;
+
+static Object objects[MAX_OBJECTS];
+static int object_count;
+static Object *adapter, *spare_device, *nm, *nm_device, *spare_ap;
+static Object *devices[MAX_DEVICES], *aps[MAX_APS + 1], *players[MAX_PLAYERS];
+static DBusConnection *services[MAX_SERVICES];
+static int service_count;
+static size_t method_calls;
+static uint32_t rng_state;
+static volatile sig_atomic_t stopping;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static uint32_t next_random(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void on_stop(int sig) {
+  (void)sig; // suppress unused paramater warning
+  stopping = 1;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int flag,
+                        struct FTW *ftw) {
+  (void)sb;   // suppress unused paramater warning
+  (void)flag; // suppress unused paramater warning
+  (void)ftw;  // suppress unused paramater warning
+  return remove(path);
+}
+
+// --- Property store ---
+
+static Object *add_object(int service, const char *fmt, ...) {
+  Object *obj = &objects[object_count++];
+  memset(obj, 0, sizeof(*obj));
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(obj->path, sizeof(obj->path), fmt, ap);
+  va_end(ap);
+  obj->service = service;
+  obj->present = true;
+  return obj;
+}
+
+static Iface *add_iface(Object *obj, const char *name) {
+  Iface *iface = &obj->ifaces[obj->iface_count++];
+  iface->name = name;
+  iface->prop_count = 0;
+  return iface;
+}
+
+static Prop *add_prop(Iface *iface, const char *name, int type) {
+  Prop *prop = &iface->props[iface->prop_count++];
+  memset(prop, 0, sizeof(*prop));
+  prop->name = name;
+  prop->type = type;
+  return prop;
+}
+
+static void add_bool(Iface *iface, const char *name, bool value) {
+  add_prop(iface, name, DBUS_TYPE_BOOLEAN)->v.b = value;
+}
+
+static void add_uint(Iface *iface, const char *name, uint32_t value) {
+  add_prop(iface, name, DBUS_TYPE_UINT32)->v.u = value;
+}
+
+static void add_str(Iface *iface, const char *name, int type,
+                    const char *fmt, ...) {
+  Prop *prop = add_prop(iface, name, type);
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(prop->s, sizeof(prop->s), fmt, ap);
+  va_end(ap);
+}
+
+static Object *find_object(int service, const char *path) {
+  for (int i = 0; path && i < object_count; i++) {
+    if (objects[i].service == service && objects[i].present &&
+        strcmp(objects[i].path, path) == 0) {
+      return &objects[i];
+    }
+  }
+  return NULL;
+}
+
+static Iface *find_iface(Object *obj, const char *name) {
+  for (int i = 0; obj && name && i < obj->iface_count; i++) {
+    if (strcmp(obj->ifaces[i].name, name) == 0) {
+      return &obj->ifaces[i];
+    }
+  }
+  return NULL;
+}
+
+static Prop *find_prop(Object *obj, const char *iface_name, const char *name) {
+  Iface *iface = find_iface(obj, iface_name);
+  for (int i = 0; iface && name && i < iface->prop_count; i++) {
+    if (strcmp(iface->props[i].name, name) == 0) {
+      return &iface->props[i];
+    }
+  }
+  return NULL;
+}
+
+// --- Marshalling ---
+
+static void append_entry(DBusMessageIter *dict, const char *key, int type,
+                         const void *value) {
+  DBusMessageIter entry, variant;
+  char sig[2] = {(char)type, '\0'};
+  dbus_message_iter_open_container(dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &key);
+  dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, sig, &variant);
+  dbus_message_iter_append_basic(&variant, type, value);
+  dbus_message_iter_close_container(&entry, &variant);
+  dbus_message_iter_close_container(dict, &entry);
+}
+
+static void append_metadata(DBusMessageIter *iter, const Prop *prop) {
+  DBusMessageIter dict, entry, variant, array;
+  char trackid[64];
+  snprintf(trackid, sizeof(trackid), "/org/mpris/MediaPlayer2/Track/%u",
+           prop->v.u);
+  const char *trackid_ptr = trackid, *title = prop->s;
+  const char *album = "Bench Album", *artist = "Bench Artist";
+  const char *artist_key = "xesam:artist";
+  int64_t length = 180000000;
+
+  dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+  append_entry(&dict, "mpris:trackid", DBUS_TYPE_OBJECT_PATH, &trackid_ptr);
+  append_entry(&dict, "mpris:length", DBUS_TYPE_INT64, &length);
+  append_entry(&dict, "xesam:title", DBUS_TYPE_STRING, &title);
+  append_entry(&dict, "xesam:album", DBUS_TYPE_STRING, &album);
+  dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL, &entry);
+  dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &artist_key);
+  dbus_message_iter_open_container(&entry, DBUS_TYPE_VARIANT, "as", &variant);
+  dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "s", &array);
+  dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING, &artist);
+  dbus_message_iter_close_container(&variant, &array);
+  dbus_message_iter_close_container(&entry, &variant);
+  dbus_message_iter_close_container(&dict, &entry);
+  dbus_message_iter_close_container(iter, &dict);
+}
+
+// Appends the property as a variant
+static void append_value(DBusMessageIter *iter, const Prop *prop) {
+  DBusMessageIter variant, array;
+  if (prop->type == PROP_BYTES) {
+    const char *bytes = prop->s;
+    dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT, "ay", &variant);
+    dbus_message_iter_open_container(&variant, DBUS_TYPE_ARRAY, "y", &array);
+    dbus_message_iter_append_fixed_array(&array, DBUS_TYPE_BYTE, &bytes,
+                                         (int)strlen(prop->s));
+    dbus_message_iter_close_container(&variant, &array);
+  } else if (prop->type == PROP_METADATA) {
+    dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT, "a{sv}",
+                                     &variant);
+    append_metadata(&variant, prop);
+  } else {
+    char sig[2] = {(char)prop->type, '\0'};
+    dbus_message_iter_open_container(iter, DBUS_TYPE_VARIANT, sig, &variant);
+    if (prop->type == DBUS_TYPE_STRING || prop->type == DBUS_TYPE_OBJECT_PATH) {
+      const char *str = prop->s;
+      dbus_message_iter_append_basic(&variant, prop->type, &str);
+    } else {
+      dbus_message_iter_append_basic(&variant, prop->type, &prop->v);
+    }
+  }
+  dbus_message_iter_close_container(iter, &variant);
+}
+
+// Appends a{sv} with every property of the interface, or just ONLY
+static void append_props(DBusMessageIter *iter, const Iface *iface,
+                         const Prop *only) {
+  DBusMessageIter dict, entry;
+  dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sv}", &dict);
+  for (int i = 0; iface && i < iface->prop_count; i++) {
+    const Prop *prop = &iface->props[i];
+    if (only && prop != only) {
+      continue;
+    }
+    dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL,
+                                     &entry);
+    dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING, &prop->name);
+    append_value(&entry, prop);
+    dbus_message_iter_close_container(&dict, &entry);
+  }
+  dbus_message_iter_close_container(iter, &dict);
+}
+
+// Appends a{sa{sv}} with every interface of the object
+static void append_ifaces(DBusMessageIter *iter, const Object *obj) {
+  DBusMessageIter dict, entry;
+  dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "{sa{sv}}", &dict);
+  for (int i = 0; i < obj->iface_count; i++) {
+    dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL,
+                                     &entry);
+    dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING,
+                                   &obj->ifaces[i].name);
+    append_props(&entry, &obj->ifaces[i], NULL);
+    dbus_message_iter_close_container(&dict, &entry);
+  }
+  dbus_message_iter_close_container(iter, &dict);
+}
+
+static void append_paths(DBusMessageIter *iter, Object **list, int count) {
+  DBusMessageIter array;
+  dbus_message_iter_open_container(iter, DBUS_TYPE_ARRAY, "o", &array);
+  for (int i = 0; i < count; i++) {
+    if (list[i] && list[i]->present) {
+      const char *path = list[i]->path;
+      dbus_message_iter_append_basic(&array, DBUS_TYPE_OBJECT_PATH, &path);
+    }
+  }
+  dbus_message_iter_close_container(iter, &array);
+}
+
+// --- Fake world ---
+
+static void build_world(void) {
+  object_count = 0;
+  rng_state = 2463534242u;
+
+  adapter = add_object(SERVICE_BLUEZ, "/org/bluez/hci0");
+  Iface *iface = add_iface(adapter, BLUEZ_ADAPTER);
+  add_str(iface, "Address", DBUS_TYPE_STRING, "00:1A:7D:DA:71:00");
+  add_str(iface, "Name", DBUS_TYPE_STRING, "bench");
+  add_str(iface, "Alias", DBUS_TYPE_STRING, "bench");
+  add_bool(iface, "Powered", true);
+  add_bool(iface, "Pairable", true);
+  add_bool(iface, "Discoverable", false);
+  add_bool(iface, "Discovering", false);
+  for (int i = 0; i <= device_count; i++) {
+    Object *dev = add_object(SERVICE_BLUEZ,
+                             "/org/bluez/hci0/dev_00_1A_7D_DA_%02X_%02X",
+                             i >> 8, i & 0xff);
+    iface = add_iface(dev, BLUEZ_DEVICE);
+    add_str(iface, "Address", DBUS_TYPE_STRING, "00:1A:7D:DA:%02X:%02X",
+            i >> 8, i & 0xff);
+    add_str(iface, "Alias", DBUS_TYPE_STRING, "Device %d", i);
+    add_str(iface, "Icon", DBUS_TYPE_STRING,
+            i % 2 ? "input-mouse" : "audio-headset");
+    add_bool(iface, "Connected", i % 3 == 0);
+    add_bool(iface, "Paired", true);
+    add_bool(iface, "Trusted", true);
+    add_prop(iface, "RSSI", DBUS_TYPE_INT16)->v.n = -60;
+    add_str(iface, "Adapter", DBUS_TYPE_OBJECT_PATH, "%s", adapter->path);
+    iface = add_iface(dev, BLUEZ_BATTERY);
+    add_prop(iface, "Percentage", DBUS_TYPE_BYTE)->v.y = 80;
+    if (i < device_count) {
+      devices[i] = dev;
+    } else {
+      spare_device = dev;
+      dev->present = false;
+    }
+  }
+
+  nm = add_object(SERVICE_NM, NM_PATH);
+  iface = add_iface(nm, NM_IFACE);
+  add_uint(iface, "State", 70);
+  add_uint(iface, "Connectivity", 4);
+  add_str(iface, "PrimaryConnection", DBUS_TYPE_OBJECT_PATH,
+          NM_PATH "/ActiveConnection/1");
+  nm_device = add_object(SERVICE_NM, NM_DEVICE_PATH);
+  iface = add_iface(nm_device, NM_DEVICE);
+  add_str(iface, "Interface", DBUS_TYPE_STRING, "wlan0");
+  add_uint(iface, "State", 100);
+  iface = add_iface(nm_device, NM_WIRELESS);
+  add_str(iface, "ActiveAccessPoint", DBUS_TYPE_OBJECT_PATH,
+          NM_PATH "/AccessPoint/1");
+  add_prop(iface, "LastScan", DBUS_TYPE_INT64)->v.x = 1000;
+  Object *active = add_object(SERVICE_NM, NM_PATH "/ActiveConnection/1");
+  iface = add_iface(active, NM_ACTIVE);
+  add_str(iface, "SpecificObject", DBUS_TYPE_OBJECT_PATH,
+          NM_PATH "/AccessPoint/1");
+  add_uint(iface, "State", 2);
+  for (int i = 0; i <= ap_count; i++) {
+    Object *ap = add_object(SERVICE_NM, NM_PATH "/AccessPoint/%d", i + 1);
+    iface = add_iface(ap, NM_AP);
+    add_str(iface, "Ssid", PROP_BYTES, "bench-%d", i + 1);
+    add_uint(iface, "Frequency", i % 2 ? 5180 : 2437);
+    add_prop(iface, "Strength", DBUS_TYPE_BYTE)->v.y = (uint8_t)(90 - i % 60);
+    add_str(iface, "HwAddress", DBUS_TYPE_STRING, "00:1B:2C:3D:%02X:%02X",
+            i >> 8, i & 0xff);
+    add_uint(iface, "Flags", 1);
+    add_uint(iface, "WpaFlags", 0);
+    add_uint(iface, "RsnFlags", 0x188);
+    add_uint(iface, "Mode", 2);
+    add_uint(iface, "MaxBitrate", 270000);
+    aps[i] = ap;
+    if (i == ap_count) {
+      spare_ap = ap;
+      ap->present = false;
+    }
+  }
+
+  for (int i = 0; i < player_count; i++) {
+    Object *player = add_object(SERVICE_PLAYER0 + i, MPRIS_PATH);
+    iface = add_iface(player, MPRIS_ROOT);
+    add_str(iface, "Identity", DBUS_TYPE_STRING, "Bench Player %d", i);
+    add_str(iface, "DesktopEntry", DBUS_TYPE_STRING, "bench");
+    add_bool(iface, "CanQuit", true);
+    add_bool(iface, "CanRaise", false);
+    add_bool(iface, "HasTrackList", false);
+    iface = add_iface(player, MPRIS_PLAYER);
+    add_str(iface, "PlaybackStatus", DBUS_TYPE_STRING,
+            i == 0 ? "Playing" : "Paused");
+    add_str(iface, "LoopStatus", DBUS_TYPE_STRING, "None");
+    add_prop(iface, "Rate", DBUS_TYPE_DOUBLE)->v.d = 1.0;
+    add_bool(iface, "Shuffle", false);
+    Prop *metadata = add_prop(iface, "Metadata", PROP_METADATA);
+    snprintf(metadata->s, sizeof(metadata->s), "Track 0");
+    add_prop(iface, "Volume", DBUS_TYPE_DOUBLE)->v.d = 0.5;
+    add_prop(iface, "Position", DBUS_TYPE_INT64)->v.x = 0;
+    add_prop(iface, "MinimumRate", DBUS_TYPE_DOUBLE)->v.d = 1.0;
+    add_prop(iface, "MaximumRate", DBUS_TYPE_DOUBLE)->v.d = 1.0;
+    add_bool(iface, "CanGoNext", true);
+    add_bool(iface, "CanGoPrevious", true);
+    add_bool(iface, "CanPlay", true);
+    add_bool(iface, "CanPause", true);
+    add_bool(iface, "CanSeek", true);
+    add_bool(iface, "CanControl", true);
+    players[i] = player;
+  }
+}
+
+// --- Method calls ---
+
+static DBusMessage *reply_introspect(DBusMessage *msg, const Object *obj) {
+  char xml[2048];
+  size_t len = snprintf(xml, sizeof(xml),
+                        "<node><interface "
+                        "name=\"org.freedesktop.DBus.Introspectable\"/>"
+                        "<interface name=\"org.freedesktop.DBus.Properties\"/>");
+  for (int i = 0; obj && i < obj->iface_count && len < sizeof(xml); i++) {
+    len += snprintf(xml + len, sizeof(xml) - len, "<interface name=\"%s\"/>",
+                    obj->ifaces[i].name);
+  }
+  if (len < sizeof(xml)) {
+    snprintf(xml + len, sizeof(xml) - len, "</node>");
+  }
+  const char *xml_ptr = xml;
+  DBusMessage *reply = dbus_message_new_method_return(msg);
+  dbus_message_append_args(reply, DBUS_TYPE_STRING, &xml_ptr,
+                           DBUS_TYPE_INVALID);
+  return reply;
+}
+
+static DBusMessage *reply_properties(DBusMessage *msg, Object *obj,
+                                     const char *member) {
+  const char *iface_name = NULL, *prop_name = NULL;
+  DBusMessageIter iter;
+  if (!obj) {
+    return dbus_message_new_error(msg, DBUS_ERROR_UNKNOWN_OBJECT,
+                                  "No such object");
+  }
+  if (strcmp(member, "Get") == 0) {
+    if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_STRING, &iface_name,
+                               DBUS_TYPE_STRING, &prop_name,
+                               DBUS_TYPE_INVALID)) {
+      return NULL;
+    }
+    Prop *prop = find_prop(obj, iface_name, prop_name);
+    if (!prop) {
+      return dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+                                    "No such property");
+    }
+    DBusMessage *reply = dbus_message_new_method_return(msg);
+    dbus_message_iter_init_append(reply, &iter);
+    append_value(&iter, prop);
+    return reply;
+  }
+  if (strcmp(member, "GetAll") == 0) {
+    if (!dbus_message_get_args(msg, NULL, DBUS_TYPE_STRING, &iface_name,
+                               DBUS_TYPE_INVALID)) {
+      return NULL;
+    }
+    DBusMessage *reply = dbus_message_new_method_return(msg);
+    dbus_message_iter_init_append(reply, &iter);
+    append_props(&iter, find_iface(obj, iface_name), NULL);
+    return reply;
+  }
+  if (strcmp(member, "Set") == 0) {
+    return dbus_message_new_method_return(msg);
+  }
+  return NULL;
+}
+
+static DBusMessage *reply_managed_objects(DBusMessage *msg, int service) {
+  DBusMessageIter iter, dict, entry;
+  DBusMessage *reply = dbus_message_new_method_return(msg);
+  dbus_message_iter_init_append(reply, &iter);
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{oa{sa{sv}}}",
+                                   &dict);
+  for (int i = 0; i < object_count; i++) {
+    const Object *obj = &objects[i];
+    if (obj->service != service || !obj->present) {
+      continue;
+    }
+    const char *path = obj->path;
+    dbus_message_iter_open_container(&dict, DBUS_TYPE_DICT_ENTRY, NULL,
+                                     &entry);
+    dbus_message_iter_append_basic(&entry, DBUS_TYPE_OBJECT_PATH, &path);
+    append_ifaces(&entry, obj);
+    dbus_message_iter_close_container(&dict, &entry);
+  }
+  dbus_message_iter_close_container(&iter, &dict);
+  return reply;
+}
+
+static DBusMessage *handle_call(int service, DBusMessage *msg) {
+  const char *iface = dbus_message_get_interface(msg);
+  const char *member = dbus_message_get_member(msg);
+  Object *obj = find_object(service, dbus_message_get_path(msg));
+  iface = iface ? iface : "";
+  if (!member) {
+    return NULL;
+  }
+
+  if (strcmp(iface, DBUS_INTERFACE_PROPERTIES) == 0) {
+    return reply_properties(msg, obj, member);
+  }
+  if (strcmp(member, "Introspect") == 0) {
+    return reply_introspect(msg, obj);
+  }
+  if (strcmp(member, "Ping") == 0) {
+    return dbus_message_new_method_return(msg);
+  }
+  if (strcmp(member, "GetManagedObjects") == 0 && service == SERVICE_BLUEZ) {
+    return reply_managed_objects(msg, service);
+  }
+
+  DBusMessageIter iter;
+  if (service == SERVICE_NM) {
+    if (strcmp(member, "GetDeviceByIpIface") == 0) {
+      const char *path = NM_DEVICE_PATH;
+      DBusMessage *reply = dbus_message_new_method_return(msg);
+      dbus_message_append_args(reply, DBUS_TYPE_OBJECT_PATH, &path,
+                               DBUS_TYPE_INVALID);
+      return reply;
+    }
+    if (strcmp(member, "GetDevices") == 0 ||
+        strcmp(member, "GetAllDevices") == 0) {
+      DBusMessage *reply = dbus_message_new_method_return(msg);
+      dbus_message_iter_init_append(reply, &iter);
+      append_paths(&iter, &nm_device, 1);
+      return reply;
+    }
+    if (strcmp(member, "GetAccessPoints") == 0 ||
+        strcmp(member, "GetAllAccessPoints") == 0) {
+      DBusMessage *reply = dbus_message_new_method_return(msg);
+      dbus_message_iter_init_append(reply, &iter);
+      append_paths(&iter, aps, ap_count + 1);
+      return reply;
+    }
+    if (strcmp(member, "RequestScan") == 0) {
+      return dbus_message_new_method_return(msg);
+    }
+  }
+  if (service >= SERVICE_PLAYER0 && strcmp(iface, MPRIS_PLAYER) == 0) {
+    // Play, Pause, Next, Seek, ... are accepted and ignored
+    return dbus_message_new_method_return(msg);
+  }
+  return NULL;
+}
+
+// Answers every method call sent to a stand-in and counts it
+static DBusHandlerResult handle_message(DBusConnection *conn, DBusMessage *msg,
+                                        void *user_data) {
+  if (dbus_message_get_type(msg) != DBUS_MESSAGE_TYPE_METHOD_CALL) {
+    return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+  }
+  method_calls++;
+  DBusMessage *reply = handle_call((int)(intptr_t)user_data, msg);
+  if (!reply) {
+    reply = dbus_message_new_error(msg, DBUS_ERROR_UNKNOWN_METHOD,
+                                   dbus_message_get_member(msg));
+  }
+  if (!dbus_message_get_no_reply(msg)) {
+    dbus_connection_send(conn, reply, NULL);
+  }
+  dbus_message_unref(reply);
+  return DBUS_HANDLER_RESULT_HANDLED;
+}
+
+// --- Signals ---
+
+static void send_signal(DBusMessage *signal, int service) {
+  dbus_connection_send(services[service], signal, NULL);
+  dbus_connection_flush(services[service]);
+  dbus_message_unref(signal);
+}
+
+static void emit_changed(Object *obj, const char *iface_name, Prop *prop) {
+  DBusMessageIter iter, invalidated;
+  DBusMessage *signal = dbus_message_new_signal(
+      obj->path, DBUS_INTERFACE_PROPERTIES, "PropertiesChanged");
+  dbus_message_iter_init_append(signal, &iter);
+  dbus_message_iter_append_basic(&iter, DBUS_TYPE_STRING, &iface_name);
+  append_props(&iter, find_iface(obj, iface_name), prop);
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "s", &invalidated);
+  dbus_message_iter_close_container(&iter, &invalidated);
+  send_signal(signal, obj->service);
+}
+
+static void emit_interfaces(Object *obj, bool added) {
+  DBusMessageIter iter, array;
+  const char *path = obj->path;
+  DBusMessage *signal = dbus_message_new_signal(
+      "/", "org.freedesktop.DBus.ObjectManager",
+      added ? "InterfacesAdded" : "InterfacesRemoved");
+  dbus_message_iter_init_append(signal, &iter);
+  dbus_message_iter_append_basic(&iter, DBUS_TYPE_OBJECT_PATH, &path);
+  if (added) {
+    append_ifaces(&iter, obj);
+  } else {
+    dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "s", &array);
+    for (int i = 0; i < obj->iface_count; i++) {
+      dbus_message_iter_append_basic(&array, DBUS_TYPE_STRING,
+                                     &obj->ifaces[i].name);
+    }
+    dbus_message_iter_close_container(&iter, &array);
+  }
+  send_signal(signal, obj->service);
+}
+
+static void toggle(Object *obj, const char *iface_name, const char *name) {
+  Prop *prop = find_prop(obj, iface_name, name);
+  prop->v.b = !prop->v.b;
+  emit_changed(obj, iface_name, prop);
+}
+
+static void bluez_event(uint32_t r) {
+  Object *dev = devices[(r >> 8) % (uint32_t)device_count];
+  uint32_t kind = r % 10;
+  if (kind < 5) {
+    Prop *prop = find_prop(dev, BLUEZ_DEVICE, "RSSI");
+    prop->v.n = (int16_t)(-40 - (int)((r >> 16) % 50));
+    emit_changed(dev, BLUEZ_DEVICE, prop);
+  } else if (kind < 7) {
+    Prop *prop = find_prop(dev, BLUEZ_BATTERY, "Percentage");
+    prop->v.y = prop->v.y ? prop->v.y - 1 : 100;
+    emit_changed(dev, BLUEZ_BATTERY, prop);
+  } else if (kind == 7) {
+    toggle(dev, BLUEZ_DEVICE, "Connected");
+  } else if (kind == 8) {
+    toggle(adapter, BLUEZ_ADAPTER, "Discovering");
+  } else {
+    spare_device->present = !spare_device->present;
+    emit_interfaces(spare_device, spare_device->present);
+  }
+}
+
+static void nm_event(uint32_t r) {
+  uint32_t kind = r % 10;
+  if (kind < 6) {
+    Object *ap = aps[(r >> 8) % (uint32_t)ap_count];
+    Prop *prop = find_prop(ap, NM_AP, "Strength");
+    prop->v.y = (uint8_t)(30 + (r >> 16) % 70);
+    emit_changed(ap, NM_AP, prop);
+  } else if (kind == 6) {
+    const char *path = spare_ap->path;
+    spare_ap->present = !spare_ap->present;
+    DBusMessage *signal = dbus_message_new_signal(
+        nm_device->path, NM_WIRELESS,
+        spare_ap->present ? "AccessPointAdded" : "AccessPointRemoved");
+    dbus_message_append_args(signal, DBUS_TYPE_OBJECT_PATH, &path,
+                             DBUS_TYPE_INVALID);
+    send_signal(signal, SERVICE_NM);
+  } else if (kind == 7) {
+    Prop *prop = find_prop(nm, NM_IFACE, "Connectivity");
+    prop->v.u = prop->v.u == 4 ? 3 : 4;
+    emit_changed(nm, NM_IFACE, prop);
+  } else if (kind == 8) {
+    Prop *prop = find_prop(nm_device, NM_DEVICE, "State");
+    prop->v.u = prop->v.u == 100 ? 70 : 100;
+    emit_changed(nm_device, NM_DEVICE, prop);
+  } else {
+    Prop *prop = find_prop(nm_device, NM_WIRELESS, "LastScan");
+    prop->v.x += 1000;
+    emit_changed(nm_device, NM_WIRELESS, prop);
+  }
+}
+
+static void mpris_event(uint32_t r) {
+  Object *player = players[(r >> 8) % (uint32_t)player_count];
+  uint32_t kind = r % 10;
+  if (kind < 4) {
+    Prop *prop = find_prop(player, MPRIS_PLAYER, "Position");
+    prop->v.x = (int64_t)((r >> 12) % 180) * 1000000;
+    DBusMessage *signal =
+        dbus_message_new_signal(MPRIS_PATH, MPRIS_PLAYER, "Seeked");
+    dbus_message_append_args(signal, DBUS_TYPE_INT64, &prop->v.x,
+                             DBUS_TYPE_INVALID);
+    send_signal(signal, player->service);
+  } else if (kind < 6) {
+    Prop *prop = find_prop(player, MPRIS_PLAYER, "Metadata");
+    prop->v.u++;
+    snprintf(prop->s, sizeof(prop->s), "Track %u", prop->v.u);
+    emit_changed(player, MPRIS_PLAYER, prop);
+  } else if (kind == 6) {
+    Prop *prop = find_prop(player, MPRIS_PLAYER, "PlaybackStatus");
+    snprintf(prop->s, sizeof(prop->s), "%s",
+             strcmp(prop->s, "Playing") == 0 ? "Paused" : "Playing");
+    emit_changed(player, MPRIS_PLAYER, prop);
+  } else if (kind == 7) {
+    Prop *prop = find_prop(player, MPRIS_PLAYER, "Volume");
+    prop->v.d = (double)((r >> 16) % 101) / 100.0;
+    emit_changed(player, MPRIS_PLAYER, prop);
+  } else {
+    emit_changed(player, MPRIS_PLAYER, find_prop(player, MPRIS_PLAYER, "Rate"));
+  }
+}
+
+// Sends event INDEX of the storm, rotating through the families in MASK
+static void send_event(int family, size_t index) {
+  int families[3], count = 0;
+  for (int bit = 0; bit < 3; bit++) {
+    if (family & (1 << bit)) {
+      families[count++] = 1 << bit;
+    }
+  }
+  uint32_t r = next_random();
+  switch (families[index % (size_t)count]) {
+  case FAMILY_BLUEZ:
+    bluez_event(r);
+    break;
+  case FAMILY_NM:
+    nm_event(r);
+    break;
+  default:
+    mpris_event(r);
+    break;
+  }
+}
+
+// --- Bus ---
+
+static pid_t start_bus(const char *dir, char *address, size_t size) {
+  char config[PATH_MAX];
+  snprintf(config, sizeof(config), "%s/bus.conf", dir);
+  FILE *fp = fopen(config, "w");
+  if (!fp) {
+    perror(config);
+    return -1;
+  }
+  fprintf(fp,
+          "<!DOCTYPE busconfig PUBLIC "
+          "\"-//freedesktop//DTD D-Bus Bus Configuration 1.0//EN\" "
+          "\"http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd\">\n"
+          "<busconfig>\n"
+          "  <type>session</type>\n"
+          "  <listen>unix:path=%s/bus</listen>\n"
+          "  <auth>EXTERNAL</auth>\n"
+          "  <policy context=\"default\">\n"
+          "    <allow send_destination=\"*\" eavesdrop=\"true\"/>\n"
+          "    <allow eavesdrop=\"true\"/>\n"
+          "    <allow own=\"*\"/>\n"
+          "  </policy>\n"
+          "</busconfig>\n",
+          dir);
+  fclose(fp);
+
+  int pipe_fd[2];
+  if (pipe(pipe_fd) < 0) {
+    perror("pipe");
+    return -1;
+  }
+  const char *daemon = getenv("DBUS_DAEMON");
+  daemon = daemon ? daemon : "dbus-daemon";
+  pid_t pid = fork();
+  if (pid == 0) {
+    char config_arg[PATH_MAX + 16], print_arg[32];
+    snprintf(config_arg, sizeof(config_arg), "--config-file=%s", config);
+    snprintf(print_arg, sizeof(print_arg), "--print-address=%d", pipe_fd[1]);
+    close(pipe_fd[0]);
+    // It complains about not being allowed to raise its fd limit
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, STDERR_FILENO);
+    execlp(daemon, daemon, config_arg, print_arg, "--nofork", "--nopidfile",
+           (char *)NULL);
+    perror(daemon);
+    _exit(127);
+  }
+  close(pipe_fd[1]);
+
+  size_t len = 0;
+  ssize_t n;
+  while (len + 1 < size &&
+         (n = read(pipe_fd[0], address + len, size - len - 1)) > 0) {
+    len += (size_t)n;
+    if (memchr(address, '\n', len)) {
+      break;
+    }
+  }
+  close(pipe_fd[0]);
+  address[len] = '\0';
+  address[strcspn(address, "\n")] = '\0';
+  if (pid < 0 || address[0] == '\0') {
+    fprintf(stderr, "%s did not start\n", daemon);
+    return -1;
+  }
+  return pid;
+}
+
+static int connect_services(const char *address) {
+  DBusError err;
+  dbus_error_init(&err);
+  service_count = SERVICE_PLAYER0 + player_count;
+  for (int i = 0; i < service_count; i++) {
+    char name[64];
+    if (i == SERVICE_BLUEZ) {
+      snprintf(name, sizeof(name), "org.bluez");
+    } else if (i == SERVICE_NM) {
+      snprintf(name, sizeof(name), "%s", NM_IFACE);
+    } else {
+      snprintf(name, sizeof(name), "%s.bench%d", MPRIS_ROOT,
+               i - SERVICE_PLAYER0);
+    }
+    DBusConnection *conn = dbus_connection_open_private(address, &err);
+    if (!conn || !dbus_bus_register(conn, &err) ||
+        dbus_bus_request_name(conn, name, DBUS_NAME_FLAG_DO_NOT_QUEUE, &err) !=
+            DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER) {
+      fprintf(stderr, "Failed to own %s: %s\n", name,
+              dbus_error_is_set(&err) ? err.message : "not primary owner");
+      dbus_error_free(&err);
+      return -1;
+    }
+    dbus_connection_set_exit_on_disconnect(conn, FALSE);
+    dbus_connection_add_filter(conn, handle_message, (void *)(intptr_t)i, NULL);
+    services[i] = conn;
+  }
+  return 0;
+}
+
+static void disconnect_services(void) {
+  for (int i = 0; i < service_count; i++) {
+    dbus_connection_close(services[i]);
+    dbus_connection_unref(services[i]);
+    services[i] = NULL;
+  }
+  service_count = 0;
+}
+
+// --- Monitor output ---
+
+typedef struct {
+  int fd;
+  char buf[65536];
+  size_t partial;
+  size_t lines;
+  double last_line_ms;
+  bool eof;
+} Output;
+
+// Reads what the monitor printed; returns the number of complete lines
+static size_t read_lines(Output *output) {
+  size_t lines = 0;
+  for (;;) {
+    ssize_t n = read(output->fd, output->buf + output->partial,
+                     sizeof(output->buf) - output->partial - 1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      output->eof = n == 0;
+      break;
+    }
+    size_t len = output->partial + (size_t)n;
+    char *start = output->buf, *nl;
+    while ((nl = memchr(start, '\n', len - (size_t)(start - output->buf)))) {
+      lines++;
+      start = nl + 1;
+    }
+    output->partial = len - (size_t)(start - output->buf);
+    memmove(output->buf, start, output->partial);
+    if (output->partial == sizeof(output->buf) - 1) {
+      output->partial = 0;
+    }
+  }
+  if (lines) {
+    output->lines += lines;
+    output->last_line_ms = now_ms();
+  }
+  return lines;
+}
+
+// Answers everything queued on the connection; flushing the replies can read
+// more messages in, so loop until the queue is empty
+static void dispatch_all(DBusConnection *conn) {
+  do {
+    while (dbus_connection_dispatch(conn) == DBUS_DISPATCH_DATA_REMAINS) {
+    }
+    dbus_connection_flush(conn);
+  } while (dbus_connection_get_dispatch_status(conn) ==
+           DBUS_DISPATCH_DATA_REMAINS);
+}
+
+// Serves the stand-ins and reads the monitor for up to TIMEOUT_MS; returns
+// the number of lines read
+static size_t service(Output *output, int timeout_ms) {
+  struct pollfd pfds[MAX_SERVICES + 1];
+  int count = 0;
+  for (int i = 0; i < service_count; i++) {
+    int fd = -1;
+    dispatch_all(services[i]);
+    dbus_connection_get_unix_fd(services[i], &fd);
+    pfds[count++] = (struct pollfd){.fd = fd, .events = POLLIN};
+  }
+  if (output && !output->eof) {
+    pfds[count++] = (struct pollfd){.fd = output->fd, .events = POLLIN};
+  }
+
+  if (poll(pfds, (nfds_t)count, timeout_ms) <= 0) {
+    return 0;
+  }
+  for (int i = 0; i < service_count; i++) {
+    if (pfds[i].revents) {
+      dbus_connection_read_write(services[i], 0);
+      dispatch_all(services[i]);
+    }
+  }
+  if (output && !output->eof && pfds[count - 1].revents) {
+    return read_lines(output);
+  }
+  return 0;
+}
+
+// Serves until neither lines nor method calls arrived for QUIET_MS
+static void wait_quiet(Output *output, int timeout_ms) {
+  double deadline = now_ms() + timeout_ms;
+  double quiet_since = now_ms();
+  while (!stopping && now_ms() < deadline &&
+         now_ms() - quiet_since < QUIET_MS) {
+    size_t calls = method_calls;
+    if (service(output, 20) || method_calls != calls) {
+      quiet_since = now_ms();
+    }
+  }
+}
+
+// --- Measurements ---
+
+// utime + stime of a live process in microseconds, from /proc
+static double process_cpu_us(pid_t pid) {
+  char path[64], buf[1024];
+  snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    return 0;
+  }
+  size_t len = fread(buf, 1, sizeof(buf) - 1, fp);
+  fclose(fp);
+  buf[len] = '\0';
+  char *p = strrchr(buf, ')');
+  unsigned long utime = 0, stime = 0;
+  if (!p || sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                   &utime, &stime) != 2) {
+    return 0;
+  }
+  return (double)(utime + stime) * 1e6 / (double)sysconf(_SC_CLK_TCK);
+}
+
+static void read_latency(const char *path, char *value, size_t size) {
+  FILE *fp = fopen(path, "r");
+  snprintf(value, size, "-");
+  if (!fp) {
+    return;
+  }
+  char line[4096];
+  while (fgets(line, sizeof(line), fp)) {
+    char *p = strstr(line, "latency_us ");
+    if (p) {
+      p[strcspn(p, "\n")] = '\0';
+      snprintf(value, size, "%s", p + strlen("latency_us "));
+      break;
+    }
+  }
+  fclose(fp);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static char **monitor_env(const char *address, const char *dir) {
+  extern char **environ;
+  static char system_bus[PATH_MAX], session_bus[PATH_MAX], runtime[PATH_MAX];
+  size_t count = 0;
+  while (environ[count]) {
+    count++;
+  }
+  char **env = calloc(count + 4, sizeof(char *));
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    if (strncmp(environ[i], "DBUS_SYSTEM_BUS_ADDRESS=", 24) != 0 &&
+        strncmp(environ[i], "DBUS_SESSION_BUS_ADDRESS=", 25) != 0 &&
+        strncmp(environ[i], "XDG_RUNTIME_DIR=", 16) != 0) {
+      env[n++] = environ[i];
+    }
+  }
+  snprintf(system_bus, sizeof(system_bus), "DBUS_SYSTEM_BUS_ADDRESS=%s",
+           address);
+  snprintf(session_bus, sizeof(session_bus), "DBUS_SESSION_BUS_ADDRESS=%s",
+           address);
+  snprintf(runtime, sizeof(runtime), "XDG_RUNTIME_DIR=%s", dir);
+  env[n++] = system_bus;
+  env[n++] = session_bus;
+  env[n++] = runtime;
+  return env;
+}
+
+static pid_t spawn_monitor(const char *binary, char **env, Output *output) {
+  memset(output, 0, sizeof(*output));
+  output->fd = -1;
+  int pipe_fd[2];
+  if (pipe2(pipe_fd, O_CLOEXEC) < 0) {
+    perror("pipe");
+    output->eof = true;
+    return -1;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(pipe_fd[1], STDOUT_FILENO);
+    execve(binary, (char *[]){(char *)binary, NULL}, env);
+    perror(binary);
+    _exit(127);
+  }
+  close(pipe_fd[1]);
+  output->fd = pipe_fd[0];
+  fcntl(output->fd, F_SETFL, O_NONBLOCK);
+  return pid;
+}
+
+static int run_once(const char *binary, int family, size_t events,
+                    double rate, RunResult *result) {
+  memset(result, 0, sizeof(*result));
+  snprintf(result->latency, sizeof(result->latency), "-");
+  char dir[] = "/tmp/newwbar-dbus.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return -1;
+  }
+  char address[1024];
+  pid_t bus_pid = start_bus(dir, address, sizeof(address));
+  build_world();
+  if (bus_pid < 0 || connect_services(address) < 0) {
+    return -1;
+  }
+
+  char **env = monitor_env(address, dir);
+  method_calls = 0;
+  double start = now_ms();
+  Output output;
+  pid_t pid = spawn_monitor(binary, env, &output);
+  if (pid < 0) {
+    free(env);
+    return -1;
+  }
+
+  // Startup: time to the first line, then let the monitor settle
+  while (!stopping && output.lines == 0 && !output.eof &&
+         now_ms() - start < STARTUP_TIMEOUT_MS) {
+    service(&output, 20);
+  }
+  result->started = output.lines > 0;
+  result->startup_ms = output.last_line_ms - start;
+  wait_quiet(&output, STARTUP_TIMEOUT_MS);
+  result->startup_calls = method_calls;
+
+  // Storm
+  double *samples = calloc(events ? events : 1, sizeof(double));
+  size_t sample_count = 0;
+  double cpu_start = process_cpu_us(pid);
+  double bus_start = process_cpu_us(bus_pid);
+  size_t lines_start = output.lines;
+  method_calls = 0;
+  double storm_start = now_ms(), last_signal = 0;
+  bool answered = true;
+  for (size_t i = 0; result->started && !stopping && i < events; i++) {
+    double due = storm_start + (rate > 0 ? (double)i * 1e3 / rate : 0);
+    while (now_ms() < due) {
+      int wait = (int)(due - now_ms());
+      if (service(&output, wait > 0 ? wait : 0) && !answered) {
+        samples[sample_count++] = (output.last_line_ms - last_signal) * 1e3;
+        answered = true;
+      }
+    }
+    send_event(family, i);
+    last_signal = now_ms();
+    answered = false;
+    result->events++;
+    if (service(&output, 0) && !answered) {
+      samples[sample_count++] = (output.last_line_ms - last_signal) * 1e3;
+      answered = true;
+    }
+  }
+  double deadline = now_ms() + DRAIN_TIMEOUT_MS;
+  double quiet_since = now_ms();
+  while (!stopping && now_ms() < deadline &&
+         now_ms() - quiet_since < QUIET_MS) {
+    size_t calls = method_calls;
+    if (service(&output, 20)) {
+      if (!answered) {
+        samples[sample_count++] = (output.last_line_ms - last_signal) * 1e3;
+        answered = true;
+      }
+      quiet_since = now_ms();
+    } else if (method_calls != calls) {
+      quiet_since = now_ms();
+    }
+  }
+  result->calls = method_calls;
+  result->lines = output.lines - lines_start;
+  result->bus_us = process_cpu_us(bus_pid) - bus_start;
+
+  // Ask for the monitor's own stats, then stop it
+  int status;
+  struct rusage usage;
+  result->exit_status = -1;
+  if (wait4(pid, &status, WNOHANG, &usage) == pid) {
+    result->exit_status = status;
+  }
+  char stats_path[PATH_MAX];
+  const char *name = strrchr(binary, '/');
+  name = name ? name + 1 : binary;
+  snprintf(stats_path, sizeof(stats_path), "%s/newwbar/%s.stats", dir, name);
+  if (result->exit_status < 0) {
+    kill(pid, SIGUSR1);
+    for (int i = 0; i < 100 && access(stats_path, F_OK) != 0; i++) {
+      service(&output, 10);
+    }
+    read_latency(stats_path, result->latency, sizeof(result->latency));
+    kill(pid, SIGTERM);
+    wait4(pid, &status, 0, &usage);
+  }
+  close(output.fd);
+  double cpu_total = (double)usage.ru_utime.tv_sec * 1e6 +
+                     (double)usage.ru_utime.tv_usec +
+                     (double)usage.ru_stime.tv_sec * 1e6 +
+                     (double)usage.ru_stime.tv_usec;
+  result->cpu_us = cpu_total > cpu_start ? cpu_total - cpu_start : 0;
+
+  // Warm start: the snapshot left by the first run should paint at once
+  result->paint_ms = -1;
+  start = now_ms();
+  pid = spawn_monitor(binary, env, &output);
+  while (pid > 0 && !stopping && output.lines == 0 && !output.eof &&
+         now_ms() - start < STARTUP_TIMEOUT_MS) {
+    service(&output, 20);
+  }
+  if (output.lines > 0) {
+    result->paint_ms = output.last_line_ms - start;
+  }
+  if (pid > 0) {
+    wait_quiet(&output, STARTUP_TIMEOUT_MS);
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    close(output.fd);
+  }
+  free(env);
+
+  if (sample_count) {
+    qsort(samples, sample_count, sizeof(double), compare_double);
+    result->e2e_p50_us = samples[sample_count / 2];
+    result->e2e_p99_us = samples[sample_count * 99 / 100];
+    result->e2e_max_us = samples[sample_count - 1];
+  }
+  free(samples);
+
+  disconnect_services();
+  kill(bus_pid, SIGTERM);
+  waitpid(bus_pid, NULL, 0);
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return 0;
+}
+
+// -x: keep the bus and the stand-ins up for manual runs
+static int serve(double rate) {
+  char dir[] = "/tmp/newwbar-dbus.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  char address[1024];
+  pid_t bus_pid = start_bus(dir, address, sizeof(address));
+  build_world();
+  if (bus_pid < 0 || connect_services(address) < 0) {
+    return 1;
+  }
+  printf("export DBUS_SYSTEM_BUS_ADDRESS='%s'\n", address);
+  printf("export DBUS_SESSION_BUS_ADDRESS='%s'\n", address);
+  fflush(stdout);
+
+  rate = rate > 0 ? rate : 10;
+  double start = now_ms();
+  for (size_t i = 0; !stopping; i++) {
+    double due = start + (double)i * 1e3 / rate;
+    while (!stopping && now_ms() < due) {
+      service(NULL, (int)(due - now_ms()) + 1);
+    }
+    send_event(FAMILY_ALL, i);
+  }
+  fprintf(stderr, "%zu method calls served\n", method_calls);
+
+  disconnect_services();
+  kill(bus_pid, SIGTERM);
+  waitpid(bus_pid, NULL, 0);
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return 0;
+}
+
+static int family_for(const char *name) {
+  if (strncmp(name, "bluetooth_", 10) == 0) {
+    return FAMILY_BLUEZ;
+  }
+  if (strncmp(name, "wlan_", 5) == 0) {
+    return FAMILY_NM;
+  }
+  if (strncmp(name, "mpris_", 6) == 0) {
+    return FAMILY_MPRIS;
+  }
+  return FAMILY_ALL;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-d DEVICES] [-a APS] [-p PLAYERS] [-e EVENTS] "
+          "[-r RATE] [-f bluez|nm|mpris|all] BINARY...\n"
+          "       %s -x [-d DEVICES] [-a APS] [-p PLAYERS] [-r RATE]\n",
+          argv0, argv0);
+}
+
+int main(int argc, char *argv[]) {
+  size_t events = 2000;
+  double rate = 500;
+  int family = 0;
+  bool serve_only = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "d:a:p:e:r:f:xh")) != -1) {
+    switch (opt) {
+    case 'd':
+      device_count = atoi(optarg);
+      break;
+    case 'a':
+      ap_count = atoi(optarg);
+      break;
+    case 'p':
+      player_count = atoi(optarg);
+      break;
+    case 'e':
+      events = (size_t)strtoull(optarg, NULL, 10);
+      break;
+    case 'r':
+      rate = atof(optarg);
+      break;
+    case 'f':
+      family = strcmp(optarg, "bluez") == 0   ? FAMILY_BLUEZ
+               : strcmp(optarg, "nm") == 0    ? FAMILY_NM
+               : strcmp(optarg, "mpris") == 0 ? FAMILY_MPRIS
+                                              : FAMILY_ALL;
+      break;
+    case 'x':
+      serve_only = true;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (device_count < 1 || device_count > MAX_DEVICES || ap_count < 1 ||
+      ap_count > MAX_APS || player_count < 1 || player_count > MAX_PLAYERS ||
+      (!serve_only && argc - optind < 1)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_stop);
+  signal(SIGTERM, on_stop);
+  if (serve_only) {
+    return serve(rate);
+  }
+
+  printf("%d devices, %d access points, %d players, %zu events at %g/s%s\n",
+         device_count, ap_count, player_count, events, rate,
+         rate > 0 ? "" : " (burst)");
+  printf("%-18s %6s %6s %8s %9s %9s %10s %10s %10s %11s %8s\n", "binary",
+         "events", "lines", "calls/ev", "cpu_us/ev", "bus_us/ev", "e2e_p50_us",
+         "e2e_p99_us", "startup_ms", "calls@start", "paint_ms");
+
+  int failures = 0;
+  for (int b = optind; b < argc && !stopping; b++) {
+    const char *name = strrchr(argv[b], '/');
+    name = name ? name + 1 : argv[b];
+    RunResult result;
+    if (run_once(argv[b], family ? family : family_for(name), events, rate,
+                 &result) < 0) {
+      return 1;
+    }
+    if (!result.started) {
+      printf("%-18s did not print anything\n", name);
+      failures++;
+      continue;
+    }
+    double per_event = result.events ? 1.0 / (double)result.events : 0;
+    printf("%-18s %6zu %6zu %8.2f %9.1f %9.1f %10.0f %10.0f %10.1f %11zu "
+           "%8.1f\n",
+           name, result.events, result.lines,
+           (double)result.calls * per_event, result.cpu_us * per_event,
+           result.bus_us * per_event, result.e2e_p50_us, result.e2e_p99_us,
+           result.startup_ms, result.startup_calls, result.paint_ms);
+    printf("%-18s e2e_max_us %.0f, latency_us %s\n", "", result.e2e_max_us,
+           result.latency);
+    if (result.exit_status >= 0) {
+      if (WIFSIGNALED(result.exit_status)) {
+        printf("%-18s died during the storm (signal %d)\n", "",
+               WTERMSIG(result.exit_status));
+      } else {
+        printf("%-18s exited during the storm (status %d)\n", "",
+               WEXITSTATUS(result.exit_status));
+      }
+      failures++;
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,569 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Runs socket2 monitors against hypr_fake and reports throughput, CPU time
+ * and whether the last line they printed matches the replayed state.
+ *
+ *   hypr_bench [-s SPEED] [-r RUNS] CAPTURE BINARY...
+ *   hypr_bench -k RESTART [-t DOWN_MS] [-r RUNS] CAPTURE BINARY...
+ *
+ * SPEED is passed to hypr_fake (0 = burst, the default). hypr_fake and the
+ * hyprctl shim are looked up next to this binary, in bin/ and
+ * bin/fakebin/. Each run gets a private XDG_RUNTIME_DIR, so the monitor's
+ * own latency stats (src/stats.c) are collected as well.
+ *
+ * -k restarts Hyprland under the monitor: once CAPTURE is replayed the
+ * fake is killed, and DOWN_MS (default 1000) later a new instance comes
+ * up in the state of the RESTART capture. Reported is the time from its
+ * socket2 appearing to the monitor printing that state, and how many lines
+ * it took. */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RUN_TIMEOUT_MS 30000
+
+typedef struct {
+  size_t events;
+  size_t lines;
+  double wall_ms;
+  double cpu_ms;
+  bool correct;
+  bool timed_out;
+  char latency[256];
+} RunResult;
+
+typedef struct {
+  double restart_ms; // socket2 back to the right line
+  size_t lines_down; // printed while Hyprland was gone
+  size_t lines_up;   // printed after it came back
+  bool correct;
+  bool timed_out;
+} RestartResult;
+
+// Last complete line a monitor printed
+typedef struct {
+  int fd;
+  char buf[65536];
+  size_t partial;
+  char last[4096];
+  size_t lines;
+} LineReader;
+
+static char bin_dir[PATH_MAX - 64];
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int flag,
+                        struct FTW *ftw) {
+  (void)sb;   // suppress unused paramater warning
+  (void)flag; // suppress unused paramater warning
+  (void)ftw;  // suppress unused paramater warning
+  return remove(path);
+}
+
+static bool wait_for_path(const char *path, int timeout_ms) {
+  for (int i = 0; i < timeout_ms; i++) {
+    if (access(path, F_OK) == 0) {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+// Value of "KEY value" in the expected file written by hypr_fake
+static bool read_expected(const char *path, const char *key, char *value,
+                          size_t size) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    return false;
+  }
+  char line[4096];
+  size_t key_len = strlen(key);
+  bool found = false;
+  while (fgets(line, sizeof(line), fp)) {
+    if (strncmp(line, key, key_len) == 0 && line[key_len] == ' ') {
+      line[strcspn(line, "\n")] = '\0';
+      snprintf(value, size, "%s", line + key_len + 1);
+      found = true;
+      break;
+    }
+  }
+  fclose(fp);
+  return found;
+}
+
+static void read_latency(const char *path, char *value, size_t size) {
+  FILE *fp = fopen(path, "r");
+  snprintf(value, size, "-");
+  if (!fp) {
+    return;
+  }
+  char line[4096];
+  while (fgets(line, sizeof(line), fp)) {
+    char *p = strstr(line, "latency_us ");
+    if (p) {
+      p[strcspn(p, "\n")] = '\0';
+      snprintf(value, size, "%s", p + strlen("latency_us "));
+      break;
+    }
+  }
+  fclose(fp);
+}
+
+static pid_t spawn(char *const argv[], char *const envp[], int stdout_fd) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (stdout_fd >= 0) {
+      dup2(stdout_fd, STDOUT_FILENO);
+    }
+    execve(argv[0], argv, envp);
+    perror(argv[0]);
+    _exit(127);
+  }
+  return pid;
+}
+
+// 1 after a read, 0 on timeout, -1 on EOF
+static int read_lines(LineReader *r, int timeout_ms) {
+  for (;;) {
+    struct pollfd pfd = {.fd = r->fd, .events = POLLIN};
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready == 0) {
+      return 0;
+    }
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    ssize_t n =
+        read(r->fd, r->buf + r->partial, sizeof(r->buf) - r->partial - 1);
+    if (n <= 0) {
+      return -1;
+    }
+    size_t len = r->partial + (size_t)n;
+    r->buf[len] = '\0';
+    char *line = r->buf, *nl;
+    while ((nl = strchr(line, '\n'))) {
+      *nl = '\0';
+      snprintf(r->last, sizeof(r->last), "%s", line);
+      r->lines++;
+      line = nl + 1;
+    }
+    r->partial = strlen(line);
+    memmove(r->buf, line, r->partial);
+    if (r->partial == sizeof(r->buf) - 1) {
+      r->partial = 0;
+    }
+    return 1;
+  }
+}
+
+// hypr_fake serving CAPTURE as instance SIGNATURE under DIR, once ready
+static pid_t start_fake(const char *dir, const char *signature,
+                        const char *speed, const char *expected,
+                        const char *capture) {
+  char fake[PATH_MAX], socket2[PATH_MAX];
+  snprintf(fake, sizeof(fake), "%s/hypr_fake", bin_dir);
+  snprintf(socket2, sizeof(socket2), "%s/hypr/%s/.socket2.sock", dir,
+           signature);
+  char *fake_argv[] = {fake,          "-d",     (char *)dir,
+                       "-i",          (char *)signature,
+                       "-s",          (char *)speed,
+                       "-o",          (char *)expected,
+                       (char *)capture, NULL};
+  extern char **environ;
+  pid_t pid = spawn(fake_argv, environ, -1);
+  if (pid < 0 || !wait_for_path(socket2, 2000)) {
+    fprintf(stderr, "hypr_fake did not start\n");
+    return -1;
+  }
+  return pid;
+}
+
+// Environment of a monitor run in DIR; RECONNECT is NEWWBAR_HYPR_RECONNECT_S
+static void monitor_env(const char *dir, const char *reconnect,
+                        char storage[][PATH_MAX * 2], char *env[]) {
+  int n = 0;
+  snprintf(storage[n], PATH_MAX * 2, "XDG_RUNTIME_DIR=%s", dir);
+  env[n] = storage[n];
+  n++;
+  const char *path = getenv("PATH");
+  snprintf(storage[n], PATH_MAX * 2, "PATH=%s/fakebin:%s", bin_dir,
+           path ? path : "/usr/bin:/bin");
+  env[n] = storage[n];
+  n++;
+  // Data dirs without icon themes keep active_window's icons predictable
+  snprintf(storage[n], PATH_MAX * 2, "XDG_DATA_HOME=%s", dir);
+  env[n] = storage[n];
+  n++;
+  snprintf(storage[n], PATH_MAX * 2, "XDG_DATA_DIRS=%s", dir);
+  env[n] = storage[n];
+  n++;
+  snprintf(storage[n], PATH_MAX * 2, "NEWWBAR_HYPR_RECONNECT_S=%s",
+           reconnect);
+  env[n] = storage[n];
+  n++;
+  env[n++] = "HYPRLAND_INSTANCE_SIGNATURE=bench";
+  env[n] = NULL;
+}
+
+static const char *binary_name(const char *binary) {
+  const char *name = strrchr(binary, '/');
+  return name ? name + 1 : binary;
+}
+
+static int run_once(const char *capture, const char *binary,
+                    const char *speed, RunResult *result) {
+  memset(result, 0, sizeof(*result));
+  char dir[] = "/tmp/newwbar-bench.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return -1;
+  }
+
+  char expected[PATH_MAX];
+  snprintf(expected, sizeof(expected), "%s/expected", dir);
+  pid_t fake_pid = start_fake(dir, "bench", speed, expected, capture);
+  if (fake_pid < 0) {
+    return -1;
+  }
+
+  // Exit on socket2 EOF rather than wait for the fake to come back
+  char env_storage[6][PATH_MAX * 2];
+  char *env[8];
+  monitor_env(dir, "0", env_storage, env);
+
+  LineReader *reader = calloc(1, sizeof(*reader));
+  int pipe_fd[2];
+  if (!reader || pipe2(pipe_fd, O_CLOEXEC) < 0) {
+    perror("pipe");
+    return -1;
+  }
+  char *argv[] = {(char *)binary, NULL};
+  double start = now_ms();
+  pid_t pid = spawn(argv, env, pipe_fd[1]);
+  close(pipe_fd[1]);
+
+  // Keep the last complete line; the monitor exits on socket2 EOF
+  reader->fd = pipe_fd[0];
+  int got;
+  while ((got = read_lines(reader, RUN_TIMEOUT_MS)) > 0)
+    ;
+  if (got == 0) {
+    result->timed_out = true;
+    kill(pid, SIGKILL);
+  }
+  close(pipe_fd[0]);
+  result->lines = reader->lines;
+
+  int status;
+  struct rusage usage;
+  wait4(pid, &status, 0, &usage);
+  result->wall_ms = now_ms() - start;
+  result->cpu_ms = (double)usage.ru_utime.tv_sec * 1e3 +
+                   (double)usage.ru_utime.tv_usec / 1e3 +
+                   (double)usage.ru_stime.tv_sec * 1e3 +
+                   (double)usage.ru_stime.tv_usec / 1e3;
+  kill(fake_pid, SIGTERM);
+  waitpid(fake_pid, NULL, 0);
+
+  const char *name = binary_name(binary);
+  char want[4096], events[32];
+  if (read_expected(expected, "events", events, sizeof(events))) {
+    result->events = (size_t)strtoull(events, NULL, 10);
+  }
+  result->correct = read_expected(expected, name, want, sizeof(want)) &&
+                    strcmp(want, reader->last) == 0;
+  if (!result->correct) {
+    fprintf(stderr, "%s: last line %s\n%*s  expected  %s\n", name,
+            reader->last, (int)strlen(name), "",
+            read_expected(expected, name, want, sizeof(want)) ? want : "?");
+  }
+  free(reader);
+
+  char stats_path[PATH_MAX];
+  snprintf(stats_path, sizeof(stats_path), "%s/newwbar/%s.stats", dir, name);
+  read_latency(stats_path, result->latency, sizeof(result->latency));
+
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return 0;
+}
+
+// Reads until the monitor prints the line EXPECTED holds for it (which the
+// fake may still have to write); false on timeout or EOF
+static bool wait_for_line(LineReader *reader, const char *expected,
+                          const char *name, int timeout_ms) {
+  char want[4096] = "";
+  bool known = false;
+  double deadline = now_ms() + timeout_ms;
+  for (;;) {
+    if (!known) {
+      known = read_expected(expected, name, want, sizeof(want));
+    }
+    if (known && strcmp(want, reader->last) == 0) {
+      return true;
+    }
+    double left = deadline - now_ms();
+    if (left <= 0 || read_lines(reader, known ? (int)left + 1 : 1) < 0) {
+      return known && strcmp(want, reader->last) == 0;
+    }
+  }
+}
+
+static int run_restart(const char *capture, const char *restart,
+                       const char *binary, int down_ms,
+                       RestartResult *result) {
+  memset(result, 0, sizeof(*result));
+  char dir[] = "/tmp/newwbar-bench.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return -1;
+  }
+  const char *name = binary_name(binary);
+  char expected[PATH_MAX], expected_after[PATH_MAX];
+  snprintf(expected, sizeof(expected), "%s/expected", dir);
+  snprintf(expected_after, sizeof(expected_after), "%s/expected.restart",
+           dir);
+
+  pid_t fake_pid = start_fake(dir, "bench", "0", expected, capture);
+  if (fake_pid < 0) {
+    return -1;
+  }
+  char env_storage[6][PATH_MAX * 2];
+  char *env[8];
+  monitor_env(dir, "", env_storage, env); // keep trying, as in a session
+
+  LineReader *reader = calloc(1, sizeof(*reader));
+  int pipe_fd[2];
+  if (!reader || pipe2(pipe_fd, O_CLOEXEC) < 0) {
+    perror("pipe");
+    return -1;
+  }
+  char *argv[] = {(char *)binary, NULL};
+  pid_t pid = spawn(argv, env, pipe_fd[1]);
+  close(pipe_fd[1]);
+  reader->fd = pipe_fd[0];
+
+  pid_t restarted_pid = -1;
+  if (!wait_for_line(reader, expected, name, RUN_TIMEOUT_MS)) {
+    fprintf(stderr, "%s: never printed the replayed state\n", name);
+    result->timed_out = true;
+    goto done;
+  }
+
+  // Hyprland goes away, leaving its instance directory behind
+  kill(fake_pid, SIGTERM);
+  waitpid(fake_pid, NULL, 0);
+  fake_pid = -1;
+  size_t before = reader->lines;
+  double down_until = now_ms() + down_ms;
+  while (now_ms() < down_until &&
+         read_lines(reader, (int)(down_until - now_ms()) + 1) >= 0)
+    ;
+  result->lines_down = reader->lines - before;
+
+  restarted_pid = start_fake(dir, "bench-restart", "0", expected_after,
+                             restart);
+  double up = now_ms();
+  if (restarted_pid < 0) {
+    goto done;
+  }
+  before = reader->lines;
+  result->correct =
+      wait_for_line(reader, expected_after, name, RUN_TIMEOUT_MS);
+  result->restart_ms = now_ms() - up;
+  result->timed_out = !result->correct;
+  // Anything else it had to say about the new instance
+  while (read_lines(reader, 200) > 0)
+    ;
+  result->lines_up = reader->lines - before;
+
+done:
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+  close(pipe_fd[0]);
+  free(reader);
+  if (fake_pid > 0) {
+    kill(fake_pid, SIGTERM);
+    waitpid(fake_pid, NULL, 0);
+  }
+  if (restarted_pid > 0) {
+    kill(restarted_pid, SIGTERM);
+    waitpid(restarted_pid, NULL, 0);
+  }
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return 0;
+}
+
+static int restart_bench(const char *capture, const char *restart,
+                         int down_ms, int runs, char *binaries[],
+                         int count) {
+  printf("capture %s, then %d ms without Hyprland and a restart into %s, "
+         "%d runs (worst shown)\n",
+         capture, down_ms, restart, runs);
+  printf("%-18s %10s %10s %8s %s\n", "binary", "restart_ms", "lines_down",
+         "lines_up", "result");
+  int failures = 0;
+  for (int b = 0; b < count; b++) {
+    RestartResult worst;
+    bool all_correct = true;
+    for (int r = 0; r < runs; r++) {
+      RestartResult result;
+      if (run_restart(capture, restart, binaries[b], down_ms, &result) < 0) {
+        return 1;
+      }
+      all_correct = all_correct && result.correct && !result.timed_out &&
+                    result.lines_down == 0;
+      if (r == 0 || result.restart_ms > worst.restart_ms) {
+        worst = result;
+      }
+    }
+    printf("%-18s %10.1f %10zu %8zu %s\n", binary_name(binaries[b]),
+           worst.restart_ms, worst.lines_down, worst.lines_up,
+           worst.timed_out ? "TIMEOUT" : all_correct ? "ok" : "WRONG");
+    failures += !all_correct;
+  }
+  return failures ? 1 : 0;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-s SPEED] [-r RUNS] CAPTURE BINARY...\n"
+          "       %s -k RESTART [-t DOWN_MS] [-r RUNS] CAPTURE BINARY...\n",
+          argv0, argv0);
+}
+
+int main(int argc, char *argv[]) {
+  const char *speed = "0";
+  const char *restart = NULL;
+  int down_ms = 1000;
+  int runs = 3;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:k:t:h")) != -1) {
+    switch (opt) {
+    case 's':
+      speed = optarg;
+      break;
+    case 'r':
+      runs = atoi(optarg);
+      break;
+    case 'k':
+      restart = optarg;
+      break;
+    case 't':
+      down_ms = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (argc - optind < 2 || runs < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  ssize_t len = readlink("/proc/self/exe", bin_dir, sizeof(bin_dir) - 1);
+  if (len < 0) {
+    perror("readlink");
+    return 1;
+  }
+  bin_dir[len] = '\0';
+  *strrchr(bin_dir, '/') = '\0';
+
+  signal(SIGPIPE, SIG_IGN);
+  const char *capture = argv[optind];
+  if (restart) {
+    return restart_bench(capture, restart, down_ms, runs, argv + optind + 1,
+                         argc - optind - 1);
+  }
+  printf("capture %s, speed %s, %d runs (best wall time shown)\n", capture,
+         speed, runs);
+  printf("%-18s %7s %7s %9s %10s %9s %10s %s\n", "binary", "events", "lines",
+         "wall_ms", "events/s", "cpu_ms", "cpu_us/ev", "result");
+
+  int failures = 0;
+  for (int b = optind + 1; b < argc; b++) {
+    RunResult best;
+    bool have_best = false;
+    bool all_correct = true;
+    for (int r = 0; r < runs; r++) {
+      RunResult result;
+      if (run_once(capture, argv[b], speed, &result) < 0) {
+        return 1;
+      }
+      all_correct = all_correct && result.correct && !result.timed_out;
+      if (!have_best || result.wall_ms < best.wall_ms) {
+        best = result;
+        have_best = true;
+      }
+    }
+    printf("%-18s %7zu %7zu %9.1f %10.0f %9.1f %10.2f %s\n",
+           binary_name(argv[b]), best.events, best.lines, best.wall_ms,
+           best.wall_ms > 0 ? (double)best.events * 1e3 / best.wall_ms : 0,
+           best.cpu_ms,
+           best.events ? best.cpu_ms * 1e3 / (double)best.events : 0,
+           best.timed_out ? "TIMEOUT" : all_correct ? "ok" : "WRONG");
+    printf("%-18s latency_us %s\n", "", best.latency);
+    failures += !all_correct;
+  }
+  return failures ? 1 : 0;
+}
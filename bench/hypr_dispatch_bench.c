@@ -0,0 +1,384 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Click-to-switch latency of the workspace buttons: a dispatch sent by
+ * newwbar-ctl through workspace_list's control socket against the hyprctl
+ * process the widget used to spawn.
+ *
+ *   hypr_dispatch_bench [-n CLICKS] [-b BURST] CAPTURE LISTENER
+ *
+ * hypr_fake -l serves the state at the end of CAPTURE, and LISTENER
+ * (bin/workspace_list) binds the control socket. Each click forks and execs
+ * `hyprctl dispatch ...` or `newwbar-ctl dispatch ...` and is timed from
+ * the fork to the workspacev2 event on socket2, when Hyprland has switched.
+ * A burst fires BURST clicks at once, as a fast scroll does, and is timed to
+ * the last switch. cpu_us is what the spawned processes used per click;
+ * the listener's share is not in it. The "datagram" row sends the command
+ * from the bench itself, the floor newwbar-ctl adds its exec to. The "exec"
+ * row sends "dispatch exec BIN/hyprctl dispatch workspace N" the same way;
+ * its switches only happen if the '/' in the path survives the listener's
+ * forwarding, and hypr_fake's two extra processes are not in its cpu_us.
+ *
+ * The hyprctl here is hypr_fake's shim, about as light as newwbar-ctl, so
+ * the two process paths come out close; the real hyprctl's own startup is
+ * what the control socket saves on a desktop. */
+
+#define _GNU_SOURCE
+#include "hypr.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SWITCH_TIMEOUT_MS 2000
+#define BURSTS 20
+#define MAX_BURST 16
+
+typedef struct {
+  const char *name;
+  const char *program; // run through PATH, or from bin_dir; NULL: no process
+  bool from_bin_dir;
+  bool exec; // "exec BIN/hyprctl dispatch ...": a '/' in the arguments
+} ClickPath;
+
+// socket2 lines, split as they arrive
+typedef struct {
+  int fd;
+  char buf[65536];
+  size_t len;
+} EventReader;
+
+static char bin_dir[PATH_MAX - 64];
+static struct sockaddr_un control_addr;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int flag,
+                        struct FTW *ftw) {
+  (void)sb;   // suppress unused paramater warning
+  (void)flag; // suppress unused paramater warning
+  (void)ftw;  // suppress unused paramater warning
+  return remove(path);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double cpu_children_us(void) {
+  struct rusage ru;
+  getrusage(RUSAGE_CHILDREN, &ru);
+  return (double)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 +
+         (double)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+// Waits for COUNT workspace switches; returns how many were seen
+static int wait_switches(EventReader *r, int count) {
+  int seen = 0;
+  double deadline = now_ms() + SWITCH_TIMEOUT_MS;
+  while (seen < count) {
+    char *newline;
+    while (seen < count && (newline = memchr(r->buf, '\n', r->len))) {
+      seen += strncmp(r->buf, "workspacev2>>", 13) == 0;
+      size_t used = (size_t)(newline - r->buf) + 1;
+      memmove(r->buf, newline + 1, r->len - used);
+      r->len -= used;
+    }
+    int wait_ms = (int)(deadline - now_ms());
+    if (seen == count || wait_ms <= 0) {
+      break;
+    }
+    struct pollfd pfd = {.fd = r->fd, .events = POLLIN};
+    if (poll(&pfd, 1, wait_ms) <= 0) {
+      continue;
+    }
+    ssize_t n = read(r->fd, r->buf + r->len, sizeof(r->buf) - r->len);
+    if (n <= 0) {
+      break;
+    }
+    r->len += (size_t)n;
+  }
+  return seen;
+}
+
+// Reads until socket2 has been quiet for QUIET_MS
+static void drain(EventReader *r, int quiet_ms) {
+  struct pollfd pfd = {.fd = r->fd, .events = POLLIN};
+  while (poll(&pfd, 1, quiet_ms) > 0 && read(r->fd, r->buf, sizeof(r->buf)) > 0)
+    ;
+  r->len = 0;
+}
+
+// Returns the process to reap, 0 when none was spawned
+static pid_t click(const ClickPath *path, int workspace) {
+  char program[PATH_MAX], command[PATH_MAX];
+  int len;
+  if (path->exec) {
+    len = snprintf(command, sizeof(command),
+                   "dispatch exec %s/fakebin/hyprctl dispatch workspace %d",
+                   bin_dir, workspace);
+  } else {
+    // As widgets/workspaces.yuck words it
+    len = snprintf(command, sizeof(command),
+                   "dispatch hl.dsp.focus({ workspace = %d })", workspace);
+  }
+  if (!path->program) {
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    sendto(fd, command, (size_t)len, 0, (struct sockaddr *)&control_addr,
+           sizeof(control_addr));
+    close(fd);
+    return 0;
+  }
+  snprintf(program, sizeof(program), "%s%s%s",
+           path->from_bin_dir ? bin_dir : "", path->from_bin_dir ? "/" : "",
+           path->program);
+  pid_t pid = fork();
+  if (pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    execvp(program, (char *[]){program, "dispatch", command + 9, NULL});
+    _exit(127);
+  }
+  return pid;
+}
+
+// Back to workspace 1 without a timed path, so every burst starts alike
+static void reset(EventReader *r) {
+  free(hypr_request("dispatch workspace 1", NULL));
+  wait_switches(r, 1);
+}
+
+static bool run_path(const ClickPath *path, EventReader *r, int clicks,
+                     int burst) {
+  double *samples = calloc((size_t)clicks, sizeof(double));
+  if (!samples) {
+    perror("calloc");
+    exit(1);
+  }
+  int lost = 0;
+  double total = 0;
+  double cpu_start = cpu_children_us();
+  for (int i = 0; i < clicks; i++) {
+    double start = now_ms();
+    pid_t pid = click(path, 2 + i % 2); // workspace 1 starts focused
+    lost += wait_switches(r, 1) != 1;
+    samples[i] = now_ms() - start;
+    total += samples[i];
+    if (pid > 0) {
+      waitpid(pid, NULL, 0);
+    }
+  }
+  double cpu_us = (cpu_children_us() - cpu_start) / clicks;
+
+  // Distinct targets, none shown on the other monitor (6)
+  double burst_total = 0;
+  for (int b = 0; b < BURSTS; b++) {
+    reset(r);
+    pid_t pids[MAX_BURST];
+    double start = now_ms();
+    for (int i = 0; i < burst; i++) {
+      pids[i] = click(path, i < 4 ? 2 + i : 3 + i);
+    }
+    lost += burst - wait_switches(r, burst);
+    burst_total += now_ms() - start;
+    for (int i = 0; i < burst; i++) {
+      if (pids[i] > 0) {
+        waitpid(pids[i], NULL, 0);
+      }
+    }
+  }
+  reset(r);
+
+  qsort(samples, (size_t)clicks, sizeof(double), compare_double);
+  printf("%-12s %7d %9.2f %9.2f %9.2f %12.0f %9.2f ", path->name, clicks,
+         total / clicks, samples[clicks / 2],
+         samples[(size_t)clicks * 99 / 100], cpu_us, burst_total / BURSTS);
+  if (lost) {
+    printf("lost %d\n", lost);
+  } else {
+    printf("ok\n");
+  }
+  free(samples);
+  return lost == 0;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr, "Usage: %s [-n CLICKS] [-b BURST] CAPTURE LISTENER\n",
+          argv0);
+}
+
+int main(int argc, char *argv[]) {
+  int clicks = 200;
+  int burst = 10;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:b:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      clicks = atoi(optarg);
+      break;
+    case 'b':
+      burst = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (argc - optind != 2 || clicks < 1 || burst < 1 || burst > MAX_BURST) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *capture = argv[optind];
+  const char *listener = argv[optind + 1];
+
+  ssize_t len = readlink("/proc/self/exe", bin_dir, sizeof(bin_dir) - 1);
+  if (len < 0) {
+    perror("readlink");
+    return 1;
+  }
+  bin_dir[len] = '\0';
+  *strrchr(bin_dir, '/') = '\0';
+
+  char dir[] = "/tmp/newwbar-dispatch.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  char fake[PATH_MAX], path[PATH_MAX * 2];
+  snprintf(fake, sizeof(fake), "%s/hypr_fake", bin_dir);
+  const char *old_path = getenv("PATH");
+  snprintf(path, sizeof(path), "%s/fakebin:%s", bin_dir,
+           old_path ? old_path : "/usr/bin:/bin");
+  setenv("PATH", path, 1);
+  setenv("XDG_RUNTIME_DIR", dir, 1);
+  setenv("HYPRLAND_INSTANCE_SIGNATURE", "bench", 1);
+  setenv("NEWWBAR_HYPR_RECONNECT_S", "0", 1);
+
+  pid_t fake_pid = fork();
+  if (fake_pid == 0) {
+    execl(fake, fake, "-d", dir, "-s", "0", "-l", capture, (char *)NULL);
+    perror(fake);
+    _exit(127);
+  }
+
+  // The bench reads socket2 first, so the replay starts without waiting
+  // for the listener
+  EventReader reader = {-1, "", 0};
+  for (int i = 0; i < 2000 && reader.fd < 0; i++) {
+    reader.fd = hypr_connect(".socket2.sock");
+    if (reader.fd < 0) {
+      usleep(1000);
+    }
+  }
+  if (reader.fd < 0) {
+    fprintf(stderr, "hypr_fake did not start\n");
+    kill(fake_pid, SIGTERM);
+    return 1;
+  }
+  drain(&reader, 100);
+
+  pid_t listener_pid = fork();
+  if (listener_pid == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    execl(listener, listener, (char *)NULL);
+    perror(listener);
+    _exit(127);
+  }
+  control_addr.sun_family = AF_UNIX;
+  snprintf(control_addr.sun_path, sizeof(control_addr.sun_path),
+           "%s/newwbar/%s", dir, HYPR_CONTROL_SOCKET);
+  const char *control = control_addr.sun_path;
+  bool bound = false;
+  for (int i = 0; i < 2000 && !bound; i++) {
+    bound = access(control, F_OK) == 0;
+    if (!bound) {
+      usleep(1000);
+    }
+  }
+
+  int failures = 0;
+  if (!bound) {
+    fprintf(stderr, "%s did not bind %s\n", listener, control);
+    failures++;
+  } else {
+    static const ClickPath paths[] = {
+        {"hyprctl", "hyprctl", false, false},
+        {"newwbar-ctl", "newwbar-ctl", true, false},
+        {"datagram", NULL, false, false},
+        {"exec", NULL, false, true},
+    };
+    printf("capture %s, %d clicks per path, %d bursts of %d\n", capture,
+           clicks, BURSTS, burst);
+    printf("%-12s %7s %9s %9s %9s %12s %9s %s\n", "path", "clicks",
+           "mean_ms", "p50_ms", "p99_ms", "cpu_us/click", "burst_ms",
+           "result");
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+      failures += !run_path(&paths[i], &reader, clicks, burst);
+    }
+  }
+
+  close(reader.fd);
+  kill(listener_pid, SIGTERM);
+  waitpid(listener_pid, NULL, 0);
+  kill(fake_pid, SIGTERM);
+  waitpid(fake_pid, NULL, 0);
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,1439 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Fake Hyprland for benchmarks: replays a socket2 capture without a
+ * compositor.
+ *
+ *   hypr_fake [-d RUNTIME_DIR] [-i SIGNATURE] [-s SPEED] [-w CLIENTS]
+ *             [-o EXPECTED] [-l] CAPTURE
+ *   hypr_fake -g EVENTS > CAPTURE     synthesize a workspace storm
+ *   hyprctl [-j] COMMAND...           (argv[0] == hyprctl) query the fake
+ *
+ * Creates RUNTIME_DIR/hypr/SIGNATURE/.socket2.sock and .socket.sock. Once
+ * CLIENTS socket2 readers are connected the capture is sent to all of them,
+ * SPEED times faster than recorded (1 = original timing, 0 = one burst).
+ * The request socket answers j/monitors, j/workspaces, j/activeworkspace,
+ * j/activewindow, j/clients and j/devices from the state the replayed events imply, so hyprctl
+ * pipelines in the monitors see a consistent world.
+ *
+ * When the capture is done the socket2 readers are disconnected, the final
+ * state each monitor should print is written to EXPECTED, and the request
+ * socket keeps being served until SIGINT/SIGTERM. Readers that reconnect
+ * are accepted but sent nothing more, like an idle compositor. With -l the
+ * readers stay connected instead.
+ *
+ * "dispatch workspace N" (or "hl.dsp.focus({ workspace = N })") switches the
+ * focused monitor and sends the events Hyprland would, "dispatch exec CMD"
+ * runs CMD through /bin/sh; [[BATCH]] requests run each of their
+ * ';'-separated commands. Other dispatchers just answer ok.
+ *
+ * Capture format, one entry per line:
+ *   # comment
+ *   #monitor NAME ACTIVE_WORKSPACE FOCUSED(0|1)
+ *   #window ADDRESS WORKSPACE CLASS
+ *   #keyboard NAME MAIN(0|1) LAYOUT   layout runs to the end of the line
+ *   DELAY_US<TAB>event>>data        delay since the previous event
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_MONITORS 8
+#define MAX_WORKSPACES 64
+#define MAX_WINDOWS 1024
+#define MAX_CLIENTS 16
+#define MAX_KEYBOARDS 8
+#define NAME_LEN 64
+
+typedef struct {
+  char name[NAME_LEN];
+  int active; // workspace id
+  bool focused;
+} Monitor;
+
+typedef struct {
+  int id;
+  char name[NAME_LEN];
+  int monitor; // index into monitors
+  int windows;
+  bool visible; // a special workspace open on its monitor
+} Workspace;
+
+typedef struct {
+  char address[24];
+  int workspace;
+  char class_name[NAME_LEN];
+  char title[128];
+  bool urgent;
+  bool fullscreen;
+} Window;
+
+typedef struct {
+  char name[NAME_LEN];
+  char layout[NAME_LEN];
+  bool main;
+} Keyboard;
+
+typedef struct {
+  uint64_t delay_us;
+  char *line;
+} Event;
+
+typedef struct {
+  int fd;
+  char *buf;
+  size_t len;
+  size_t cap;
+} Client;
+
+static Monitor monitors[MAX_MONITORS];
+static int monitor_count = 0;
+static Workspace workspaces[MAX_WORKSPACES];
+static int workspace_count = 0;
+static Window windows[MAX_WINDOWS];
+static int window_count = 0;
+static int next_named_id = -100;
+// Focus as the activewindow events describe it
+static char active_address[24] = "";
+static char active_class[NAME_LEN] = "";
+static char active_title[128] = "";
+static Keyboard keyboards[MAX_KEYBOARDS];
+static int keyboard_count = 0;
+static char submap[NAME_LEN] = "";
+
+static Event *events = NULL;
+static size_t event_count = 0;
+
+static volatile sig_atomic_t quit = 0;
+
+// --- World model, advanced by every event before it is sent ---
+
+static void copy_str(char *dst, size_t size, const char *src) {
+  snprintf(dst, size, "%s", src ? src : "");
+}
+
+static int focused_monitor(void) {
+  for (int i = 0; i < monitor_count; i++) {
+    if (monitors[i].focused) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static int find_monitor(const char *name) {
+  for (int i = 0; i < monitor_count; i++) {
+    if (strcmp(monitors[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+static int add_monitor(const char *name) {
+  int idx = find_monitor(name);
+  if (idx >= 0 || monitor_count == MAX_MONITORS) {
+    return idx;
+  }
+  idx = monitor_count++;
+  memset(&monitors[idx], 0, sizeof(monitors[idx]));
+  copy_str(monitors[idx].name, NAME_LEN, name);
+  return idx;
+}
+
+static Keyboard *get_keyboard(const char *name) {
+  for (int i = 0; i < keyboard_count; i++) {
+    if (strcmp(keyboards[i].name, name) == 0) {
+      return &keyboards[i];
+    }
+  }
+  if (keyboard_count == MAX_KEYBOARDS) {
+    return NULL;
+  }
+  Keyboard *kb = &keyboards[keyboard_count++];
+  memset(kb, 0, sizeof(*kb));
+  copy_str(kb->name, NAME_LEN, name);
+  return kb;
+}
+
+static Workspace *find_workspace(int id) {
+  for (int i = 0; i < workspace_count; i++) {
+    if (workspaces[i].id == id) {
+      return &workspaces[i];
+    }
+  }
+  return NULL;
+}
+
+static bool is_number(const char *s) {
+  if (*s == '-') {
+    s++;
+  }
+  if (!*s) {
+    return false;
+  }
+  for (; *s; s++) {
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Numeric names are their own id; named workspaces get negative ids
+static int workspace_id(const char *name) {
+  if (is_number(name)) {
+    return atoi(name);
+  }
+  for (int i = 0; i < workspace_count; i++) {
+    if (strcmp(workspaces[i].name, name) == 0) {
+      return workspaces[i].id;
+    }
+  }
+  return next_named_id--;
+}
+
+static Workspace *get_workspace(const char *name, int monitor) {
+  int id = workspace_id(name);
+  Workspace *ws = find_workspace(id);
+  if (ws || workspace_count == MAX_WORKSPACES) {
+    return ws;
+  }
+  ws = &workspaces[workspace_count++];
+  ws->id = id;
+  copy_str(ws->name, NAME_LEN, name);
+  ws->monitor = monitor;
+  ws->windows = 0;
+  ws->visible = false;
+  return ws;
+}
+
+static void destroy_workspace(int id) {
+  for (int i = 0; i < workspace_count; i++) {
+    if (workspaces[i].id == id) {
+      workspaces[i] = workspaces[--workspace_count];
+      return;
+    }
+  }
+}
+
+static bool workspace_is_active(int id) {
+  for (int i = 0; i < monitor_count; i++) {
+    if (monitors[i].active == id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static Window *find_window(const char *address) {
+  for (int i = 0; i < window_count; i++) {
+    if (strcmp(windows[i].address, address) == 0) {
+      return &windows[i];
+    }
+  }
+  return NULL;
+}
+
+static void add_window(const char *address, const char *ws_name,
+                       const char *class_name, const char *title) {
+  if (find_window(address) || window_count == MAX_WINDOWS) {
+    return;
+  }
+  Workspace *ws = get_workspace(ws_name, focused_monitor());
+  Window *win = &windows[window_count++];
+  copy_str(win->address, sizeof(win->address), address);
+  copy_str(win->class_name, sizeof(win->class_name), class_name);
+  copy_str(win->title, sizeof(win->title), title);
+  win->workspace = ws ? ws->id : 0;
+  win->urgent = false;
+  win->fullscreen = false;
+  if (ws) {
+    ws->windows++;
+  }
+}
+
+static void move_window(Window *win, const char *ws_name) {
+  Workspace *from = find_workspace(win->workspace);
+  Workspace *to = get_workspace(ws_name, focused_monitor());
+  if (from) {
+    from->windows--;
+  }
+  if (to) {
+    to->windows++;
+    win->workspace = to->id;
+  }
+}
+
+static void close_window(const char *address) {
+  Window *win = find_window(address);
+  if (!win) {
+    return;
+  }
+  Workspace *ws = find_workspace(win->workspace);
+  if (ws) {
+    ws->windows--;
+  }
+  *win = windows[--window_count];
+}
+
+static void set_active(int monitor, const char *ws_name) {
+  Workspace *ws = get_workspace(ws_name, monitor);
+  if (ws) {
+    ws->monitor = monitor;
+    monitors[monitor].active = ws->id;
+  }
+}
+
+static void focus_monitor(int monitor) {
+  for (int i = 0; i < monitor_count; i++) {
+    monitors[i].focused = i == monitor;
+  }
+}
+
+// Split data on ',' into at most max fields; the last keeps any commas
+static int split_fields(char *data, char **fields, int max) {
+  int n = 0;
+  fields[n++] = data;
+  while (n < max) {
+    char *comma = strchr(data, ',');
+    if (!comma) {
+      break;
+    }
+    *comma = '\0';
+    data = comma + 1;
+    fields[n++] = data;
+  }
+  return n;
+}
+
+static void apply_event(const char *line) {
+  const char *sep = strstr(line, ">>");
+  if (!sep) {
+    return;
+  }
+  char name[32];
+  size_t name_len = (size_t)(sep - line);
+  if (name_len >= sizeof(name)) {
+    return;
+  }
+  memcpy(name, line, name_len);
+  name[name_len] = '\0';
+
+  char data[512];
+  copy_str(data, sizeof(data), sep + 2);
+  char *f[4] = {NULL, NULL, NULL, NULL};
+  int n = split_fields(data, f, 4);
+
+  if (strcmp(name, "workspace") == 0) {
+    set_active(focused_monitor(), f[0]);
+  } else if (strcmp(name, "focusedmon") == 0 && n >= 2) {
+    int mon = add_monitor(f[0]);
+    if (mon >= 0) {
+      focus_monitor(mon);
+      set_active(mon, f[1]);
+    }
+  } else if (strcmp(name, "openwindow") == 0 && n >= 2) {
+    add_window(f[0], f[1], n > 2 ? f[2] : "", n > 3 ? f[3] : "");
+  } else if (strcmp(name, "closewindow") == 0) {
+    close_window(f[0]);
+  } else if (strcmp(name, "movewindow") == 0 && n >= 2) {
+    Window *win = find_window(f[0]);
+    if (win) {
+      move_window(win, f[1]);
+    }
+  } else if (strcmp(name, "windowtitlev2") == 0 && n >= 2) {
+    Window *win = find_window(f[0]);
+    if (win) {
+      // the title is everything after the address
+      copy_str(win->title, sizeof(win->title), sep + 2 + strlen(f[0]) + 1);
+    }
+    if (strcmp(f[0], active_address) == 0) {
+      copy_str(active_title, sizeof(active_title),
+               sep + 2 + strlen(f[0]) + 1);
+    }
+  } else if (strcmp(name, "activewindow") == 0) {
+    copy_str(active_class, sizeof(active_class), f[0]);
+    copy_str(active_title, sizeof(active_title),
+             n >= 2 ? sep + 2 + strlen(f[0]) + 1 : "");
+  } else if (strcmp(name, "activewindowv2") == 0) {
+    copy_str(active_address, sizeof(active_address), f[0]);
+    Window *win = find_window(f[0]);
+    if (win) {
+      win->urgent = false;
+    }
+  } else if (strcmp(name, "urgent") == 0) {
+    Window *win = find_window(f[0]);
+    if (win) {
+      win->urgent = true;
+    }
+  } else if (strcmp(name, "fullscreen") == 0) {
+    Window *win = find_window(active_address);
+    if (win) {
+      win->fullscreen = strcmp(f[0], "1") == 0;
+    }
+  } else if (strcmp(name, "activespecial") == 0 && n >= 2) {
+    int mon = add_monitor(f[1]);
+    for (int i = 0; i < workspace_count && mon >= 0; i++) {
+      if (workspaces[i].monitor == mon) {
+        workspaces[i].visible = false;
+      }
+    }
+    Workspace *ws = *f[0] && mon >= 0 ? get_workspace(f[0], mon) : NULL;
+    if (ws) {
+      ws->monitor = mon;
+      ws->visible = true;
+    }
+  } else if (strcmp(name, "createworkspace") == 0) {
+    get_workspace(f[0], focused_monitor());
+  } else if (strcmp(name, "destroyworkspace") == 0) {
+    destroy_workspace(workspace_id(f[0]));
+  } else if (strcmp(name, "moveworkspace") == 0 && n >= 2) {
+    Workspace *ws = get_workspace(f[0], focused_monitor());
+    int mon = add_monitor(f[1]);
+    if (ws && mon >= 0) {
+      ws->monitor = mon;
+    }
+  } else if (strcmp(name, "moveworkspacev2") == 0 && n >= 3) {
+    Workspace *ws = find_workspace(atoi(f[0]));
+    int mon = add_monitor(f[2]);
+    if (ws && mon >= 0) {
+      ws->monitor = mon;
+    }
+  } else if (strcmp(name, "renameworkspace") == 0 && n >= 2) {
+    Workspace *ws = find_workspace(atoi(f[0]));
+    if (ws) {
+      copy_str(ws->name, NAME_LEN, f[1]);
+    }
+  } else if (strcmp(name, "activelayout") == 0 && n >= 2) {
+    Keyboard *kb = get_keyboard(f[0]);
+    if (kb) {
+      copy_str(kb->layout, NAME_LEN, sep + 2 + strlen(f[0]) + 1);
+    }
+  } else if (strcmp(name, "submap") == 0) {
+    copy_str(submap, sizeof(submap), sep + 2);
+  } else if (strcmp(name, "monitoradded") == 0) {
+    add_monitor(f[0]);
+  } else if (strcmp(name, "monitorremoved") == 0) {
+    int mon = find_monitor(f[0]);
+    if (mon >= 0) {
+      monitors[mon] = monitors[--monitor_count];
+    }
+  }
+}
+
+// --- Request socket replies, shaped like hyprctl -j ---
+
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+} Str;
+
+static void str_printf(Str *s, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void str_printf(Str *s, const char *fmt, ...) {
+  for (;;) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(s->buf + s->len, s->cap - s->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+      return;
+    }
+    if (s->len + (size_t)n < s->cap) {
+      s->len += (size_t)n;
+      return;
+    }
+    s->cap = (s->cap + (size_t)n + 1) * 2;
+    s->buf = realloc(s->buf, s->cap);
+    if (!s->buf) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+}
+
+// JSON string without escapes we never generate ourselves
+static void str_json(Str *s, const char *value) {
+  str_printf(s, "\"");
+  for (const char *c = value; *c; c++) {
+    if (*c == '"' || *c == '\\') {
+      str_printf(s, "\\%c", *c);
+    } else if ((unsigned char)*c < 0x20) {
+      str_printf(s, "\\u%04x", (unsigned char)*c);
+    } else {
+      str_printf(s, "%c", *c);
+    }
+  }
+  str_printf(s, "\"");
+}
+
+static const char *workspace_name(int id) {
+  Workspace *ws = find_workspace(id);
+  return ws ? ws->name : "";
+}
+
+static bool has_fullscreen(int id) {
+  for (int i = 0; i < window_count; i++) {
+    if (windows[i].workspace == id && windows[i].fullscreen) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool has_urgent(int id) {
+  for (int i = 0; i < window_count; i++) {
+    if (windows[i].workspace == id && windows[i].urgent) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void reply_workspace(Str *s, const Workspace *ws) {
+  const char *mon = ws->monitor < monitor_count ? monitors[ws->monitor].name
+                                                : "";
+  str_printf(s, "{\"id\":%d,\"name\":", ws->id);
+  str_json(s, ws->name);
+  str_printf(s, ",\"monitor\":");
+  str_json(s, mon);
+  str_printf(s,
+             ",\"monitorID\":%d,\"windows\":%d,\"hasfullscreen\":%s,"
+             "\"lastwindow\":\"0x0\",\"lastwindowtitle\":\"\","
+             "\"ispersistent\":false}",
+             ws->monitor, ws->windows,
+             has_fullscreen(ws->id) ? "true" : "false");
+}
+
+static void reply_monitors(Str *s) {
+  str_printf(s, "[");
+  for (int i = 0; i < monitor_count; i++) {
+    const Monitor *m = &monitors[i];
+    str_printf(s, "%s{\"id\":%d,\"name\":", i ? "," : "", i);
+    str_json(s, m->name);
+    str_printf(s,
+               ",\"description\":\"newwbar fake\",\"make\":\"newwbar\","
+               "\"model\":\"fake\",\"serial\":\"\",\"width\":1920,"
+               "\"height\":1080,\"refreshRate\":60.00000,\"x\":%d,\"y\":0,"
+               "\"activeWorkspace\":{\"id\":%d,\"name\":",
+               i * 1920, m->active);
+    str_json(s, workspace_name(m->active));
+    str_printf(s,
+               "},\"specialWorkspace\":{\"id\":0,\"name\":\"\"},"
+               "\"reserved\":[0,0,0,0],\"scale\":1.00,\"transform\":0,"
+               "\"focused\":%s,\"dpmsStatus\":true,\"vrr\":false,"
+               "\"activelyTearing\":false,\"disabled\":false,"
+               "\"currentFormat\":\"XRGB8888\",\"availableModes\":[]}",
+               m->focused ? "true" : "false");
+  }
+  str_printf(s, "]");
+}
+
+static void reply_workspaces(Str *s) {
+  str_printf(s, "[");
+  for (int i = 0; i < workspace_count; i++) {
+    if (i) {
+      str_printf(s, ",");
+    }
+    reply_workspace(s, &workspaces[i]);
+  }
+  str_printf(s, "]");
+}
+
+static void reply_clients(Str *s) {
+  str_printf(s, "[");
+  for (int i = 0; i < window_count; i++) {
+    const Window *w = &windows[i];
+    Workspace *ws = find_workspace(w->workspace);
+    str_printf(s, "%s{\"address\":\"0x%s\",\"mapped\":true,\"hidden\":false,"
+                  "\"at\":[0,0],\"size\":[800,600],\"workspace\":{\"id\":%d,"
+                  "\"name\":",
+               i ? "," : "", w->address, w->workspace);
+    str_json(s, workspace_name(w->workspace));
+    str_printf(s, "},\"floating\":false,\"monitor\":%d,\"class\":",
+               ws ? ws->monitor : 0);
+    str_json(s, w->class_name);
+    str_printf(s, ",\"title\":");
+    str_json(s, w->title);
+    str_printf(s, ",\"initialClass\":");
+    str_json(s, w->class_name);
+    str_printf(s, ",\"initialTitle\":");
+    str_json(s, w->title);
+    // fullscreen is Hyprland's mode: 0 none, 1 maximized, 2 fullscreen
+    str_printf(s, ",\"pid\":0,\"xwayland\":false,\"pinned\":false,"
+                  "\"fullscreen\":%d,\"fullscreenClient\":%d,\"grouped\":[],"
+                  "\"tags\":[],\"swallowing\":\"0x0\",\"focusHistoryID\":%d}",
+               w->fullscreen ? 2 : 0, w->fullscreen ? 2 : 0, i);
+  }
+  str_printf(s, "]");
+}
+
+static void reply_active_window(Str *s) {
+  if (!*active_address) {
+    str_printf(s, "{}");
+    return;
+  }
+  str_printf(s, "{\"address\":\"0x%s\",\"class\":", active_address);
+  str_json(s, active_class);
+  str_printf(s, ",\"title\":");
+  str_json(s, active_title);
+  str_printf(s, "}");
+}
+
+static void reply_devices(Str *s) {
+  str_printf(s, "{\"mice\":[],\"keyboards\":[");
+  for (int i = 0; i < keyboard_count; i++) {
+    const Keyboard *kb = &keyboards[i];
+    str_printf(s, "%s{\"address\":\"0x%x\",\"name\":", i ? "," : "",
+               0x5a000 + i * 0x100);
+    str_json(s, kb->name);
+    str_printf(s,
+               ",\"rules\":\"\",\"model\":\"\",\"layout\":\"us,de\","
+               "\"variant\":\"\",\"options\":\"\",\"active_keymap\":");
+    str_json(s, kb->layout);
+    str_printf(s, ",\"capsLock\":false,\"numLock\":false,\"main\":%s}",
+               kb->main ? "true" : "false");
+  }
+  str_printf(s, "],\"tablets\":[],\"touch\":[],\"switches\":[]}");
+}
+
+static void broadcast(const char *line);
+
+static void emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void emit(const char *fmt, ...) {
+  char line[512];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  apply_event(line);
+  broadcast(line);
+}
+
+// Detached, like Hyprland's exec: the fake never waits for it
+static void spawn(const char *command) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (fork() == 0) {
+      int null = open("/dev/null", O_WRONLY);
+      dup2(null, STDOUT_FILENO);
+      execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+    }
+    _exit(127);
+  }
+  if (pid > 0) {
+    waitpid(pid, NULL, 0);
+  }
+}
+
+static void dispatch(const char *command) {
+  if (strncmp(command, "exec ", 5) == 0) {
+    spawn(command + 5);
+    return;
+  }
+  int id;
+  if (sscanf(command, "workspace %d", &id) != 1 &&
+      sscanf(command, "hl.dsp.focus({ workspace = %d })", &id) != 1) {
+    return;
+  }
+  int mon = focused_monitor();
+  int old = monitors[mon].active;
+  if (id == old || workspace_is_active(id)) {
+    return; // Hyprland would focus the other monitor; not modelled
+  }
+  if (!find_workspace(id)) {
+    emit("createworkspace>>%d", id);
+    emit("createworkspacev2>>%d,%d", id, id);
+  }
+  emit("workspace>>%d", id);
+  emit("workspacev2>>%d,%d", id, id);
+  Workspace *ws = find_workspace(old);
+  if (ws && ws->windows == 0) {
+    emit("destroyworkspace>>%d", old);
+    emit("destroyworkspacev2>>%d,%d", old, old);
+  }
+}
+
+static void build_reply(const char *request, Str *s) {
+  // "flags/command": as in Hyprland, everything up to the first '/' is
+  // flags, so "dispatch exec ~/bin/foo" has to be sent as "/dispatch ..."
+  bool json = false;
+  const char *slash = strchr(request, '/');
+  if (slash && strncmp(request, "[[BATCH]]", 9) != 0) {
+    json = memchr(request, 'j', (size_t)(slash - request)) != NULL;
+    request = slash + 1;
+  }
+
+  if (strcmp(request, "monitors") == 0 && json) {
+    reply_monitors(s);
+  } else if (strcmp(request, "workspaces") == 0 && json) {
+    reply_workspaces(s);
+  } else if (strcmp(request, "activeworkspace") == 0 && json) {
+    Workspace *ws = find_workspace(monitors[focused_monitor()].active);
+    if (ws) {
+      reply_workspace(s, ws);
+    } else {
+      str_printf(s, "{}");
+    }
+  } else if (strcmp(request, "activewindow") == 0 && json) {
+    reply_active_window(s);
+  } else if (strcmp(request, "clients") == 0 && json) {
+    reply_clients(s);
+  } else if (strcmp(request, "devices") == 0 && json) {
+    reply_devices(s);
+  } else if (strncmp(request, "dispatch ", 9) == 0) {
+    dispatch(request + 9);
+    str_printf(s, "ok");
+  } else if (strncmp(request, "[[BATCH]]", 9) == 0) {
+    char batch[8192];
+    copy_str(batch, sizeof(batch), request + 9);
+    for (char *command = strtok(batch, ";"); command;
+         command = strtok(NULL, ";")) {
+      build_reply(command, s);
+      str_printf(s, "\n\n\n");
+    }
+  } else {
+    str_printf(s, "unknown request");
+  }
+}
+
+static void write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+static void serve_request(int listen_fd) {
+  int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+  if (fd < 0) {
+    return;
+  }
+  char request[8192];
+  ssize_t n = read(fd, request, sizeof(request) - 1);
+  if (n > 0) {
+    request[n] = '\0';
+    request[strcspn(request, "\n")] = '\0';
+    Str reply = {NULL, 0, 0};
+    build_reply(request, &reply);
+    write_all(fd, reply.buf, reply.len);
+    free(reply.buf);
+  }
+  close(fd);
+}
+
+// --- socket2 readers ---
+
+static Client clients[MAX_CLIENTS];
+static int client_count = 0;
+
+static void client_flush(Client *c) {
+  while (c->len > 0) {
+    ssize_t n = write(c->fd, c->buf, c->len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EAGAIN) {
+        c->len = 0; // reader went away; drop its backlog
+      }
+      return;
+    }
+    memmove(c->buf, c->buf + n, c->len - (size_t)n);
+    c->len -= (size_t)n;
+  }
+}
+
+static void broadcast(const char *line) {
+  size_t len = strlen(line);
+  for (int i = 0; i < client_count; i++) {
+    Client *c = &clients[i];
+    if (c->len + len + 1 > c->cap) {
+      c->cap = (c->len + len + 1) * 2;
+      c->buf = realloc(c->buf, c->cap);
+      if (!c->buf) {
+        perror("realloc");
+        exit(1);
+      }
+    }
+    memcpy(c->buf + c->len, line, len);
+    c->buf[c->len + len] = '\n';
+    c->len += len + 1;
+    client_flush(c);
+  }
+}
+
+static bool clients_pending(void) {
+  for (int i = 0; i < client_count; i++) {
+    if (clients[i].len > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// --- Capture loading and synthesis ---
+
+static int load_capture(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror(path);
+    return -1;
+  }
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  size_t events_cap = 0;
+  while ((len = getline(&line, &cap, fp)) >= 0) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) {
+      line[--len] = '\0';
+    }
+    if (strncmp(line, "#monitor ", 9) == 0) {
+      char name[NAME_LEN], active[NAME_LEN];
+      int focused = 0;
+      if (sscanf(line + 9, "%63s %63s %d", name, active, &focused) >= 2) {
+        int mon = add_monitor(name);
+        if (mon >= 0) {
+          set_active(mon, active);
+          if (focused) {
+            focus_monitor(mon);
+          }
+        }
+      }
+      continue;
+    }
+    if (strncmp(line, "#window ", 8) == 0) {
+      char address[24], ws[NAME_LEN], class_name[NAME_LEN] = "";
+      if (sscanf(line + 8, "%23s %63s %63s", address, ws, class_name) >= 2) {
+        add_window(address, ws, class_name, "");
+      }
+      continue;
+    }
+    if (strncmp(line, "#keyboard ", 10) == 0) {
+      char name[NAME_LEN];
+      int main_kb = 0, layout_at = 0;
+      if (sscanf(line + 10, "%63s %d %n", name, &main_kb, &layout_at) >= 2 &&
+          layout_at > 0) {
+        Keyboard *kb = get_keyboard(name);
+        if (kb) {
+          copy_str(kb->layout, NAME_LEN, line + 10 + layout_at);
+          kb->main = main_kb != 0;
+        }
+      }
+      continue;
+    }
+    char *tab = strchr(line, '\t');
+    if (line[0] == '#' || !tab) {
+      continue;
+    }
+    if (event_count == events_cap) {
+      events_cap = events_cap ? events_cap * 2 : 1024;
+      events = realloc(events, events_cap * sizeof(Event));
+      if (!events) {
+        perror("realloc");
+        exit(1);
+      }
+    }
+    events[event_count].delay_us = strtoull(line, NULL, 10);
+    events[event_count].line = strdup(tab + 1);
+    event_count++;
+  }
+  free(line);
+  fclose(fp);
+  if (monitor_count == 0) {
+    add_monitor("DP-1");
+    set_active(0, "1");
+    focus_monitor(0);
+  }
+  return 0;
+}
+
+static uint32_t rng_state = 0x6e657777; // fixed seed: captures are stable
+
+static uint32_t rng(uint32_t bound) {
+  rng_state = rng_state * 1664525u + 1013904223u;
+  return (rng_state >> 8) % bound;
+}
+
+static size_t emitted = 0;
+
+static void synth(uint64_t delay_us, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void synth(uint64_t delay_us, const char *fmt, ...) {
+  char line[512];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  apply_event(line);
+  printf("%llu\t%s\n", (unsigned long long)delay_us, line);
+  emitted++;
+}
+
+static void synth_workspace_gone(int id) {
+  Workspace *ws = find_workspace(id);
+  if (ws && ws->windows == 0 && !workspace_is_active(id)) {
+    synth(40, "destroyworkspace>>%d", id);
+    synth(5, "destroyworkspacev2>>%d,%d", id, id);
+  }
+}
+
+static void synth_workspace_needed(int id) {
+  if (!find_workspace(id)) {
+    synth(60, "createworkspace>>%d", id);
+    synth(5, "createworkspacev2>>%d,%d", id, id);
+  }
+}
+
+// Workspace 1-6 storm on two monitors: switches, focus changes, window
+// open/close/move, title churn, the odd urgent or fullscreen window, layout
+// switch, submap or scratchpad toggle, with Hyprland's event ordering
+static void synthesize(size_t count) {
+  static const char *classes[] = {"kitty", "firefox", "org.gnome.Nautilus",
+                                  "Spotify", "code", "mpv"};
+  static const char *layouts[] = {"English (US)", "German", "Russian"};
+  printf("# hypr_fake -g %zu: synthetic workspace storm\n", count);
+  printf("#monitor DP-1 1 1\n#monitor HDMI-A-1 6 0\n");
+  printf("#keyboard at-translated-set-2-keyboard 1 English (US)\n"
+         "#keyboard fcitx5-virtual-keyboard 0 English (US)\n");
+  add_monitor("DP-1");
+  set_active(0, "1");
+  focus_monitor(0);
+  add_monitor("HDMI-A-1");
+  set_active(1, "6");
+  for (int i = 0; i < 2; i++) {
+    Keyboard *kb = get_keyboard(i ? "fcitx5-virtual-keyboard"
+                                  : "at-translated-set-2-keyboard");
+    copy_str(kb->layout, NAME_LEN, layouts[0]);
+    kb->main = i == 0;
+  }
+
+  unsigned next_address = 0x55d0a000;
+  while (emitted < count) {
+    uint32_t action = rng(100);
+    int mon = focused_monitor();
+    int other = 1 - mon;
+    if (action < 45) {
+      int target = 1 + (int)rng(6);
+      if (target == monitors[other].active || target == monitors[mon].active) {
+        continue;
+      }
+      int old = monitors[mon].active;
+      synth_workspace_needed(target);
+      synth(20000 + rng(30000), "workspace>>%d", target);
+      synth(5, "workspacev2>>%d,%d", target, target);
+      synth_workspace_gone(old);
+    } else if (action < 55) {
+      synth(30000 + rng(40000), "focusedmon>>%s,%d", monitors[other].name,
+            monitors[other].active);
+    } else if (action < 72) {
+      const char *cls = classes[rng(6)];
+      int ws = monitors[mon].active;
+      unsigned address = next_address;
+      next_address += 0x10 + rng(0x100);
+      synth(15000 + rng(20000), "openwindow>>%x,%d,%s,%s ~ %u", address, ws,
+            cls, cls, rng(1000));
+      synth(5, "activewindow>>%s,%s ~", cls, cls);
+      synth(5, "activewindowv2>>%x", address);
+    } else if (action < 84 && window_count > 0) {
+      Window win = windows[rng((uint32_t)window_count)];
+      synth(15000 + rng(20000), "closewindow>>%s", win.address);
+      synth_workspace_gone(win.workspace);
+    } else if (action < 94 && window_count > 0) {
+      Window *win = &windows[rng((uint32_t)window_count)];
+      int from = win->workspace;
+      int target = 1 + (int)rng(6);
+      if (target == from) {
+        continue;
+      }
+      char address[24];
+      copy_str(address, sizeof(address), win->address);
+      synth_workspace_needed(target);
+      synth(10000 + rng(20000), "movewindow>>%s,%d", address, target);
+      synth(5, "movewindowv2>>%s,%d,%d", address, target, target);
+      synth_workspace_gone(from);
+    } else if (action < 96 && window_count > 0) {
+      Window *win = &windows[rng((uint32_t)window_count)];
+      char address[24];
+      copy_str(address, sizeof(address), win->address);
+      unsigned n = rng(1000);
+      synth(500 + rng(2000), "windowtitle>>%s", address);
+      synth(5, "windowtitlev2>>%s,%s ~ %u", address, win->class_name, n);
+    } else if (action < 97 && window_count > 0) {
+      Window *win = &windows[rng((uint32_t)window_count)];
+      if (strcmp(win->address, active_address) == 0) {
+        continue;
+      }
+      synth(20000 + rng(40000), "urgent>>%s", win->address);
+    } else if (action < 98) {
+      Window *win = find_window(active_address);
+      if (!win) {
+        continue;
+      }
+      synth(10000 + rng(20000), "fullscreen>>%d", win->fullscreen ? 0 : 1);
+    } else if (action < 99) {
+      // switchxkblayout all, or just the virtual keyboard
+      const char *layout = layouts[rng(3)];
+      for (int i = (int)rng(2); i < keyboard_count; i++) {
+        synth(40000 + rng(40000), "activelayout>>%s,%s", keyboards[i].name,
+              layout);
+      }
+    } else if (rng(2)) {
+      synth(60000 + rng(60000), "submap>>%s", *submap ? "" : "resize");
+    } else {
+      // togglespecialworkspace scratch; Hyprland drops it again when it is
+      // hidden and empty
+      Workspace *ws = NULL;
+      for (int i = 0; i < workspace_count; i++) {
+        if (strcmp(workspaces[i].name, "special:scratch") == 0) {
+          ws = &workspaces[i];
+        }
+      }
+      if (ws) {
+        int id = ws->id;
+        synth(40000 + rng(40000), "activespecial>>,%s",
+              monitors[ws->monitor].name);
+        synth(5, "destroyworkspace>>special:scratch");
+        synth(5, "destroyworkspacev2>>%d,special:scratch", id);
+      } else {
+        synth(40000 + rng(40000), "createworkspace>>special:scratch");
+        ws = get_workspace("special:scratch", mon);
+        synth(5, "createworkspacev2>>%d,special:scratch", ws ? ws->id : 0);
+        synth(5, "activespecial>>special:scratch,%s", monitors[mon].name);
+      }
+    }
+  }
+}
+
+// --- Expected output of each monitor for the final state ---
+
+static int compare_class(const void *a, const void *b) {
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+// [{"class":"kitty","count":2},...] by class, as workspace_list keeps them
+static void write_apps(FILE *fp, int id) {
+  const char *classes[MAX_WINDOWS];
+  int count = 0;
+  for (int i = 0; i < window_count; i++) {
+    if (windows[i].workspace == id && *windows[i].class_name) {
+      classes[count++] = windows[i].class_name;
+    }
+  }
+  qsort(classes, (size_t)count, sizeof(*classes), compare_class);
+  fprintf(fp, "[");
+  for (int i = 0; i < count;) {
+    int run = 1;
+    while (i + run < count && strcmp(classes[i], classes[i + run]) == 0) {
+      run++;
+    }
+    fprintf(fp, "%s{\"class\":\"%s\",\"count\":%d}", i ? "," : "",
+            classes[i], run);
+    i += run;
+  }
+  fprintf(fp, "]");
+}
+
+static int write_expected(const char *path) {
+  FILE *fp = fopen(path, "w");
+  if (!fp) {
+    perror(path);
+    return -1;
+  }
+  fprintf(fp, "events %zu\n", event_count);
+  fprintf(fp, "workspace_focus %s\n",
+          workspace_name(monitors[focused_monitor()].active));
+  fprintf(fp, "workspace_list [");
+  for (int m = 0; m < monitor_count; m++) {
+    fprintf(fp, "%s{\"monitor\":\"%s\",\"monitorID\":%d,\"workspaces\":[",
+            m ? "," : "", monitors[m].name, m);
+    // by id, as workspace_list keeps them
+    int last = INT_MIN;
+    bool first = true;
+    for (;;) {
+      Workspace *next = NULL;
+      for (int i = 0; i < workspace_count; i++) {
+        Workspace *ws = &workspaces[i];
+        if (ws->monitor == m && ws->id > last && (!next || ws->id < next->id)) {
+          next = ws;
+        }
+      }
+      if (!next) {
+        break;
+      }
+      fprintf(fp,
+              "%s{\"WorkspaceID\":%d,\"name\":\"%s\",\"hasWindows\":%s,"
+              "\"special\":%s,\"urgent\":%s,\"fullscreen\":%s,"
+              "\"visible\":%s,\"apps\":",
+              first ? "" : ",", next->id, next->name,
+              next->windows > 0 ? "true" : "false",
+              strncmp(next->name, "special", 7) == 0 ? "true" : "false",
+              has_urgent(next->id) ? "true" : "false",
+              has_fullscreen(next->id) ? "true" : "false",
+              next->visible ? "true" : "false");
+      write_apps(fp, next->id);
+      fprintf(fp, "}");
+      last = next->id;
+      first = false;
+    }
+    fprintf(fp, "]}");
+  }
+  fprintf(fp, "]\n");
+  // No icon themes in the bench environment, so no icons
+  Str active = {NULL, 0, 0};
+  str_printf(&active, "{\"class\":");
+  str_json(&active, active_class);
+  str_printf(&active, ",\"title\":");
+  str_json(&active, active_title);
+  str_printf(&active, ",\"icon\":\"\"}");
+  fprintf(fp, "active_window %s\n", active.buf);
+  free(active.buf);
+  const Keyboard *shown = NULL;
+  for (int i = 0; i < keyboard_count; i++) {
+    if (keyboards[i].main) {
+      shown = &keyboards[i];
+    }
+  }
+  fprintf(fp, "keyboard_layout {\"layout\":\"%s\",\"keyboard\":\"%s\","
+          "\"submap\":\"%s\"}\n",
+          shown ? shown->layout : "", shown ? shown->name : "", submap);
+  fprintf(fp, "monitor_list [");
+  for (int m = 0; m < monitor_count; m++) {
+    fprintf(fp,
+            "%s{\"name\":\"%s\",\"id\":%d,\"focused\":%s,\"scale\":1,"
+            "\"activeWorkspace\":%d}",
+            m ? "," : "", monitors[m].name, m,
+            monitors[m].focused ? "true" : "false", monitors[m].active);
+  }
+  fprintf(fp, "]\n");
+  return fclose(fp);
+}
+
+// --- hyprctl stand-in ---
+
+static int hyprctl_main(int argc, char *argv[]) {
+  char flags[8] = "";
+  char command[1024] = "";
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 || strcmp(argv[i], "--json") == 0) {
+      strcpy(flags, "j");
+    } else {
+      size_t len = strlen(command);
+      snprintf(command + len, sizeof(command) - len, "%s%s", len ? " " : "",
+               argv[i]);
+    }
+  }
+
+  const char *runtime = getenv("XDG_RUNTIME_DIR");
+  const char *signature = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  if (!runtime || !signature) {
+    fprintf(stderr, "HYPRLAND_INSTANCE_SIGNATURE not set\n");
+    return 1;
+  }
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/hypr/%s/.socket.sock",
+           runtime, signature);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror(addr.sun_path);
+    return 1;
+  }
+  char request[1040];
+  int len = snprintf(request, sizeof(request), "%s/%s", flags, command);
+  write_all(fd, request, (size_t)len);
+
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    fwrite(buf, 1, (size_t)n, stdout);
+  }
+  printf("\n");
+  close(fd);
+  return 0;
+}
+
+// --- Server ---
+
+static int listen_unix(const char *path) {
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+  // Bound under a temporary name and moved into place once listening, so
+  // a client that sees the path never gets ECONNREFUSED
+  if (snprintf(addr.sun_path, sizeof(addr.sun_path), "%s.new", path) >=
+      (int)sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+  unlink(addr.sun_path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+      listen(fd, 16) < 0 || rename(addr.sun_path, path) < 0) {
+    perror(path);
+    return -1;
+  }
+  return fd;
+}
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static void on_quit(int sig) {
+  (void)sig; // suppress unused paramater warning
+  quit = 1;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-d RUNTIME_DIR] [-i SIGNATURE] [-s SPEED] [-w CLIENTS]"
+          " [-o EXPECTED] [-l] CAPTURE\n"
+          "       %s -g EVENTS > CAPTURE\n",
+          argv0, argv0);
+}
+
+int main(int argc, char *argv[]) {
+  const char *base = strrchr(argv[0], '/');
+  if (strcmp(base ? base + 1 : argv[0], "hyprctl") == 0) {
+    return hyprctl_main(argc, argv);
+  }
+
+  const char *runtime = getenv("XDG_RUNTIME_DIR");
+  const char *signature = "bench";
+  const char *expected = NULL;
+  double speed = 1.0;
+  int wait_clients = 1;
+  bool live = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "d:i:s:w:o:lg:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      runtime = optarg;
+      break;
+    case 'i':
+      signature = optarg;
+      break;
+    case 's':
+      speed = atof(optarg);
+      break;
+    case 'w':
+      wait_clients = atoi(optarg);
+      break;
+    case 'o':
+      expected = optarg;
+      break;
+    case 'l':
+      live = true;
+      break;
+    case 'g':
+      synthesize((size_t)atol(optarg));
+      return 0;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (optind != argc - 1 || !runtime) {
+    usage(argv[0]);
+    return 1;
+  }
+  if (load_capture(argv[optind]) < 0) {
+    return 1;
+  }
+
+  char dir[512], socket2_path[600], request_path[600];
+  snprintf(dir, sizeof(dir), "%s/hypr", runtime);
+  mkdir(dir, 0700);
+  snprintf(dir, sizeof(dir), "%s/hypr/%s", runtime, signature);
+  mkdir(dir, 0700);
+  snprintf(request_path, sizeof(request_path), "%s/.socket.sock", dir);
+  snprintf(socket2_path, sizeof(socket2_path), "%s/.socket2.sock", dir);
+
+  signal(SIGPIPE, SIG_IGN);
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_quit;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  // Only delivered inside ppoll(), so a stop request that lands between the
+  // quit check and the wait cannot be lost
+  sigset_t blocked, wait_mask;
+  sigemptyset(&blocked);
+  sigaddset(&blocked, SIGINT);
+  sigaddset(&blocked, SIGTERM);
+  sigprocmask(SIG_BLOCK, &blocked, &wait_mask);
+
+  // The request socket first: socket2 appearing means the fake is ready
+  int request_fd = listen_unix(request_path);
+  int socket2_fd = request_fd < 0 ? -1 : listen_unix(socket2_path);
+  if (socket2_fd < 0) {
+    return 1;
+  }
+
+  size_t next = 0;
+  uint64_t start = 0;
+  uint64_t due_us = 0; // capture time of the next event
+  bool finished = false;
+
+  while (!quit) {
+    if (start && !finished) {
+      uint64_t elapsed = now_us() - start;
+      while (next < event_count) {
+        uint64_t due = due_us + events[next].delay_us;
+        if (speed > 0 && (double)due > (double)elapsed * speed) {
+          break;
+        }
+        due_us = due;
+        apply_event(events[next].line);
+        broadcast(events[next].line);
+        next++;
+      }
+      if (next == event_count && !clients_pending()) {
+        // Readers see EOF once the whole capture is delivered
+        for (int i = 0; i < client_count && !live; i++) {
+          close(clients[i].fd);
+          free(clients[i].buf);
+        }
+        client_count = live ? client_count : 0;
+        finished = true;
+        if (expected && write_expected(expected) < 0) {
+          return 1;
+        }
+      }
+    }
+
+    struct pollfd fds[MAX_CLIENTS + 2];
+    int nfds = 0;
+    fds[nfds++] = (struct pollfd){.fd = request_fd, .events = POLLIN};
+    fds[nfds++] = (struct pollfd){.fd = socket2_fd, .events = POLLIN};
+    for (int i = 0; i < client_count; i++) {
+      // Once finished, readers are watched for hangup
+      fds[nfds++] = (struct pollfd){
+          .fd = clients[i].fd,
+          .events = (short)((finished ? POLLIN : 0) |
+                            (clients[i].len ? POLLOUT : 0))};
+    }
+
+    struct timespec timeout, *wait = NULL;
+    if (start && !finished && next < event_count && speed > 0) {
+      double wait_us =
+          (double)(due_us + events[next].delay_us) / speed -
+          (double)(now_us() - start);
+      int wait_ms = wait_us <= 0 ? 0 : (int)(wait_us / 1000.0) + 1;
+      timeout.tv_sec = wait_ms / 1000;
+      timeout.tv_nsec = (long)(wait_ms % 1000) * 1000000;
+      wait = &timeout;
+    }
+    if (ppoll(fds, (nfds_t)nfds, wait, &wait_mask) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("poll");
+      return 1;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      serve_request(request_fd);
+    }
+    if (fds[1].revents & POLLIN) {
+      int fd = accept4(socket2_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK);
+      if (fd >= 0 && client_count < MAX_CLIENTS) {
+        clients[client_count++] = (Client){fd, NULL, 0, 0};
+        if (!start && client_count >= wait_clients) {
+          start = now_us();
+        }
+      } else if (fd >= 0) {
+        close(fd);
+      }
+    }
+    for (int i = nfds - 3; i >= 0; i--) {
+      short revents = fds[i + 2].revents;
+      char byte;
+      if (finished && revents & (POLLIN | POLLERR | POLLHUP) &&
+          read(clients[i].fd, &byte, 1) <= 0) {
+        close(clients[i].fd);
+        free(clients[i].buf);
+        clients[i] = clients[--client_count];
+      } else if (revents & (POLLOUT | POLLERR | POLLHUP)) {
+        client_flush(&clients[i]);
+      }
+    }
+  }
+
+  unlink(socket2_path);
+  unlink(request_path);
+  return 0;
+}
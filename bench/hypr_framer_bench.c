@@ -0,0 +1,304 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Pushes a socket2 capture through the line framer at a fixed event rate
+ * and checks that every line comes out whole and in order.
+ *
+ *   hypr_framer_bench [-r RATE] [-n EVENTS] CAPTURE
+ *
+ * A writer process loops the capture's events up to EVENTS and sends them
+ * over a socketpair in 1 ms batches at RATE events/s (default 10000, 0 =
+ * as fast as possible), with write sizes that split lines anywhere. The
+ * reader frames them with HyprFramer, looks each name up with
+ * hypr_event() and hashes what it got; lost, split or reordered lines show
+ * up as a hash mismatch. The same stream is then read the way
+ * workspace_list used to, 64 bytes at a time checking only the start of
+ * each read, to count the window events that loop would have caught. */
+
+#define _GNU_SOURCE
+#include "change.h"
+#include "hypr.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  char **lines;
+  size_t count;
+} Capture;
+
+static double cpu_us(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (double)usage.ru_utime.tv_sec * 1e6 + (double)usage.ru_utime.tv_usec +
+         (double)usage.ru_stime.tv_sec * 1e6 + (double)usage.ru_stime.tv_usec;
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int load_capture(const char *path, Capture *capture) {
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    perror(path);
+    return -1;
+  }
+  char line[4096];
+  size_t cap = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    line[strcspn(line, "\n")] = '\0';
+    char *tab = strchr(line, '\t');
+    if (line[0] == '#' || !tab) {
+      continue;
+    }
+    if (capture->count == cap) {
+      cap = cap ? cap * 2 : 1024;
+      capture->lines = realloc(capture->lines, cap * sizeof(char *));
+      if (!capture->lines) {
+        perror("realloc");
+        exit(1);
+      }
+    }
+    capture->lines[capture->count++] = strdup(tab + 1);
+  }
+  fclose(fp);
+  return capture->count ? 0 : -1;
+}
+
+static uint32_t rng_state = 0x9e3779b9;
+
+static uint32_t next_random(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void write_all(int fd, const char *buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, buf, len);
+    if (n <= 0) {
+      exit(0); // reader is gone
+    }
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+// Child: sends EVENTS lines at RATE/s, writes cut at random sizes
+static void writer(int fd, const Capture *capture, size_t events,
+                   double rate) {
+  size_t batch = rate > 0 ? (size_t)(rate / 1000) : events;
+  if (batch == 0) {
+    batch = 1;
+  }
+  char *buf = malloc(batch * 4096);
+  if (!buf) {
+    exit(1);
+  }
+  double start = now_us();
+  for (size_t sent = 0; sent < events;) {
+    size_t len = 0;
+    for (size_t i = 0; i < batch && sent < events; i++, sent++) {
+      const char *line = capture->lines[sent % capture->count];
+      size_t n = strlen(line);
+      memcpy(buf + len, line, n);
+      buf[len + n] = '\n';
+      len += n + 1;
+    }
+    for (size_t done = 0; done < len;) {
+      size_t chunk = 1 + next_random() % 512;
+      if (chunk > len - done) {
+        chunk = len - done;
+      }
+      write_all(fd, buf + done, chunk);
+      done += chunk;
+    }
+    if (rate > 0) {
+      double due = start + (double)sent * 1e6 / rate;
+      double wait = due - now_us();
+      if (wait > 0) {
+        usleep((useconds_t)wait);
+      }
+    }
+  }
+  close(fd);
+  exit(0);
+}
+
+static pid_t start_writer(const Capture *capture, size_t events, double rate,
+                          int *fd) {
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+    perror("socketpair");
+    exit(1);
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(pair[0]);
+    writer(pair[1], capture, events, rate);
+  }
+  close(pair[1]);
+  *fd = pair[0];
+  return pid;
+}
+
+static uint64_t expected_hash(const Capture *capture, size_t events,
+                              size_t *known) {
+  ChangeHash h;
+  change_hash_init(&h);
+  *known = 0;
+  for (size_t i = 0; i < events; i++) {
+    const char *line = capture->lines[i % capture->count];
+    const char *data;
+    size_t data_len;
+    *known += hypr_event(line, strlen(line), &data, &data_len) != HYPR_UNKNOWN;
+    change_hash_update(&h, line, strlen(line) + 1); // with its NUL
+  }
+  return change_hash_digest(&h);
+}
+
+static bool is_window_event(const char *line) {
+  return strncmp(line, "closewindow>>", 13) == 0 ||
+         strncmp(line, "openwindow>>", 12) == 0 ||
+         strncmp(line, "movewindow>>", 12) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  double rate = 10000;
+  size_t events = 20000;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:n:h")) != -1) {
+    switch (opt) {
+    case 'r':
+      rate = atof(optarg);
+      break;
+    case 'n':
+      events = (size_t)atol(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-r RATE] [-n EVENTS] CAPTURE\n", argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  Capture capture = {NULL, 0};
+  if (argc - optind != 1 || load_capture(argv[optind], &capture) < 0) {
+    fprintf(stderr, "Usage: %s [-r RATE] [-n EVENTS] CAPTURE\n", argv[0]);
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  size_t known;
+  uint64_t want = expected_hash(&capture, events, &known);
+  size_t window_events = 0;
+  for (size_t i = 0; i < events; i++) {
+    window_events += is_window_event(capture.lines[i % capture.count]);
+  }
+
+  // --- HyprFramer ---
+  HyprFramer framer;
+  if (hypr_framer_init(&framer) < 0) {
+    perror("hypr_framer_init");
+    return 1;
+  }
+  int fd;
+  pid_t pid = start_writer(&capture, events, rate, &fd);
+  double cpu_start = cpu_us(), wall_start = now_us();
+  size_t lines = 0, dispatched = 0;
+  size_t reads = 0;
+  ChangeHash h;
+  change_hash_init(&h);
+  while (hypr_framer_read(&framer, fd) > 0) {
+    reads++;
+    const char *line, *data;
+    size_t len, data_len;
+    while (hypr_framer_next(&framer, &line, &len)) {
+      lines++;
+      dispatched += hypr_event(line, len, &data, &data_len) != HYPR_UNKNOWN;
+      change_hash_update(&h, line, len);
+      change_hash_update(&h, "", 1);
+    }
+  }
+  double cpu = cpu_us() - cpu_start, wall = now_us() - wall_start;
+  close(fd);
+  waitpid(pid, NULL, 0);
+  bool intact = lines == events && change_hash_digest(&h) == want &&
+                dispatched == known && framer.dropped == 0;
+  hypr_framer_free(&framer);
+
+  // --- The old 64-byte read loop ---
+  pid = start_writer(&capture, events, rate, &fd);
+  size_t caught = 0;
+  char buffer[64];
+  ssize_t bytes;
+  while ((bytes = read(fd, buffer, sizeof(buffer) - 1)) > 0) {
+    buffer[bytes] = '\0';
+    caught += is_window_event(buffer);
+  }
+  close(fd);
+  waitpid(pid, NULL, 0);
+
+  printf("capture %s, %zu events at %s\n", argv[optind], events,
+         rate > 0 ? "fixed rate" : "full speed");
+  if (rate > 0) {
+    printf("rate %.0f events/s\n", rate);
+  }
+  printf("%-14s %8s %8s %8s %10s %9s %s\n", "reader", "events", "lines",
+         "reads", "wall_ms", "cpu_ns/ev", "result");
+  printf("%-14s %8zu %8zu %8zu %10.1f %9.1f %s (%zu named, %zu dropped)\n",
+         "HyprFramer", events, lines, reads, wall / 1e3,
+         cpu * 1e3 / (double)events, intact ? "intact" : "CORRUPT",
+         dispatched, framer.dropped);
+  printf("%-14s %8zu %8s %8s %10s %9s caught %zu of %zu window events\n",
+         "read(64)", events, "-", "-", "-", "-", caught, window_events);
+  return intact ? 0 : 1;
+}
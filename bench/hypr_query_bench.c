@@ -0,0 +1,303 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Times the Hyprland queries the workspace monitors make at startup and on
+ * resync: the request-socket client in src/hypr.c against the
+ * hyprctl | jq pipelines it replaced.
+ *
+ *   hypr_query_bench [-n QUERIES] CAPTURE
+ *
+ * hypr_fake replays CAPTURE into a throwaway socket2 reader first, so the
+ * queries see the world as it is at the end of the capture. Both paths
+ * must come back with the same answer. hypr_fake and the hyprctl shim are
+ * looked up next to this binary, like hypr_bench does. */
+
+#define _GNU_SOURCE
+#include "hypr.h"
+
+#include <ftw.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+} Answer;
+
+typedef struct {
+  const char *name;
+  const char *pipeline;
+  void (*native)(Answer *answer);
+} Query;
+
+static char bin_dir[PATH_MAX - 64];
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static int remove_entry(const char *path, const struct stat *sb, int flag,
+                        struct FTW *ftw) {
+  (void)sb;   // suppress unused paramater warning
+  (void)flag; // suppress unused paramater warning
+  (void)ftw;  // suppress unused paramater warning
+  return remove(path);
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void answer_printf(Answer *a, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void answer_printf(Answer *a, const char *fmt, ...) {
+  char line[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  if (n < 0) {
+    return;
+  }
+  if (a->len + (size_t)n + 1 > a->cap) {
+    a->cap = (a->len + (size_t)n + 1) * 2;
+    a->buf = realloc(a->buf, a->cap);
+    if (!a->buf) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  memcpy(a->buf + a->len, line, (size_t)n + 1);
+  a->len += (size_t)n;
+}
+
+// --- Native client ---
+
+static void native_monitors(Answer *answer) {
+  int id;
+  if (hypr_focused_workspace(&id) >= 0) {
+    answer_printf(answer, "%d\n", id);
+  }
+}
+
+static void add_workspace(const HyprWorkspace *ws, void *data) {
+  answer_printf(data, "%d:%d\n", ws->id, ws->windows);
+}
+
+static void native_workspaces(Answer *answer) {
+  hypr_workspaces(add_workspace, answer);
+}
+
+static void add_client(const HyprClient *client, void *data) {
+  answer_printf(data, "0x%llx:%d\n", (unsigned long long)client->address,
+                client->workspace);
+}
+
+static void native_clients(Answer *answer) { hypr_clients(add_client, answer); }
+
+// --- popen pipelines, as the monitors ran them ---
+
+static void run_pipeline(const char *command, Answer *answer) {
+  FILE *fp = popen(command, "r");
+  if (!fp) {
+    return;
+  }
+  char line[256];
+  while (fgets(line, sizeof(line), fp)) {
+    answer_printf(answer, "%s", line);
+  }
+  pclose(fp);
+}
+
+static const Query queries[] = {
+    {"monitors",
+     "hyprctl monitors -j | jq '.[] | select(.focused == true ) | "
+     ".activeWorkspace.id'",
+     native_monitors},
+    {"workspaces",
+     "hyprctl workspaces -j | jq -r '.[] | \"\\(.id):\\(.windows)\"'",
+     native_workspaces},
+    {"clients",
+     "hyprctl clients -j | jq -r '.[] | \"\\(.address):\\(.workspace.id)\"'",
+     native_clients},
+};
+
+// Runs one path COUNT times, prints its latency row and keeps the last
+// answer
+static void time_path(const Query *q, bool native, int count, Answer *last) {
+  double *samples = calloc((size_t)count, sizeof(double));
+  if (!samples) {
+    perror("calloc");
+    exit(1);
+  }
+  double total = 0;
+  for (int i = 0; i < count; i++) {
+    last->len = 0;
+    if (last->buf) {
+      last->buf[0] = '\0';
+    }
+    double start = now_us();
+    if (native) {
+      q->native(last);
+    } else {
+      run_pipeline(q->pipeline, last);
+    }
+    samples[i] = now_us() - start;
+    total += samples[i];
+  }
+  qsort(samples, (size_t)count, sizeof(double), compare_double);
+  size_t lines = 0;
+  for (size_t i = 0; i < last->len; i++) {
+    lines += last->buf[i] == '\n';
+  }
+  printf("%-11s %-7s %7d %9.1f %9.1f %9.1f %6zu\n", q->name,
+         native ? "socket" : "popen", count, total / count,
+         samples[count / 2], samples[(size_t)count * 99 / 100], lines);
+  free(samples);
+}
+
+int main(int argc, char *argv[]) {
+  int count = 200;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:h")) != -1) {
+    switch (opt) {
+    case 'n':
+      count = atoi(optarg);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-n QUERIES] CAPTURE\n", argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  if (argc - optind != 1 || count < 1) {
+    fprintf(stderr, "Usage: %s [-n QUERIES] CAPTURE\n", argv[0]);
+    return 1;
+  }
+
+  ssize_t len = readlink("/proc/self/exe", bin_dir, sizeof(bin_dir) - 1);
+  if (len < 0) {
+    perror("readlink");
+    return 1;
+  }
+  bin_dir[len] = '\0';
+  *strrchr(bin_dir, '/') = '\0';
+
+  char dir[] = "/tmp/newwbar-query.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  char fake[PATH_MAX], path[PATH_MAX * 2];
+  snprintf(fake, sizeof(fake), "%s/hypr_fake", bin_dir);
+  const char *old_path = getenv("PATH");
+  snprintf(path, sizeof(path), "%s/fakebin:%s", bin_dir,
+           old_path ? old_path : "/usr/bin:/bin");
+  setenv("PATH", path, 1);
+  setenv("XDG_RUNTIME_DIR", dir, 1);
+  setenv("HYPRLAND_INSTANCE_SIGNATURE", "bench", 1);
+
+  pid_t fake_pid = fork();
+  if (fake_pid == 0) {
+    execl(fake, fake, "-d", dir, "-s", "0", argv[optind], (char *)NULL);
+    perror(fake);
+    _exit(127);
+  }
+
+  // Drain the capture so the world is in its final state
+  int sock = -1;
+  for (int i = 0; i < 2000 && sock < 0; i++) {
+    sock = hypr_connect(".socket2.sock");
+    if (sock < 0) {
+      usleep(1000);
+    }
+  }
+  if (sock < 0) {
+    fprintf(stderr, "hypr_fake did not start\n");
+    return 1;
+  }
+  char buf[65536];
+  while (read(sock, buf, sizeof(buf)) > 0)
+    ;
+  close(sock);
+
+  bool have_jq = system("command -v jq > /dev/null") == 0;
+  printf("capture %s, %d queries per path\n", argv[optind], count);
+  printf("%-11s %-7s %7s %9s %9s %9s %6s\n", "query", "path", "queries",
+         "mean_us", "p50_us", "p99_us", "items");
+  int failures = 0;
+  for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+    Answer native = {NULL, 0, 0}, piped = {NULL, 0, 0};
+    time_path(&queries[i], true, count, &native);
+    if (!have_jq) {
+      printf("%-11s %-7s skipped, jq not installed\n", queries[i].name,
+             "popen");
+      free(native.buf);
+      continue;
+    }
+    time_path(&queries[i], false, count, &piped);
+    if (native.len != piped.len ||
+        (native.len && memcmp(native.buf, piped.buf, native.len) != 0)) {
+      printf("%-11s answers differ:\n%s--- popen:\n%s", queries[i].name,
+             native.buf ? native.buf : "", piped.buf ? piped.buf : "");
+      failures++;
+    }
+    free(native.buf);
+    free(piped.buf);
+  }
+
+  kill(fake_pid, SIGTERM);
+  waitpid(fake_pid, NULL, 0);
+  nftw(dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+  return failures ? 1 : 0;
+}
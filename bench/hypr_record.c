@@ -0,0 +1,252 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Records the live Hyprland socket2 stream for hypr_fake.
+ *
+ *   hypr_record [-o CAPTURE]      stop with Ctrl-C
+ *
+ * The capture starts with #monitor and #window lines describing the state
+ * at the time of recording (from the request socket), followed by one
+ * "DELAY_US<TAB>event>>data" line per event. */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t quit = 0;
+
+static void on_quit(int sig) {
+  (void)sig; // suppress unused paramater warning
+  quit = 1;
+}
+
+static int connect_socket(const char *name) {
+  const char *runtime = getenv("XDG_RUNTIME_DIR");
+  const char *signature = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  if (!runtime || !signature) {
+    fprintf(stderr, "HYPRLAND_INSTANCE_SIGNATURE not set\n");
+    return -1;
+  }
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/hypr/%s/%s", runtime,
+           signature, name);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror(addr.sun_path);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+// One request on .socket.sock; returns the malloc'd reply or NULL
+static char *request(const char *command) {
+  int fd = connect_socket(".socket.sock");
+  if (fd < 0) {
+    return NULL;
+  }
+  if (write(fd, command, strlen(command)) < 0) {
+    close(fd);
+    return NULL;
+  }
+  size_t len = 0, cap = 4096;
+  char *reply = malloc(cap);
+  ssize_t n;
+  while (reply && (n = read(fd, reply + len, cap - len - 1)) > 0) {
+    len += (size_t)n;
+    if (cap - len < 1024) {
+      cap *= 2;
+      char *tmp = realloc(reply, cap);
+      if (!tmp) {
+        free(reply);
+        reply = NULL;
+        break;
+      }
+      reply = tmp;
+    }
+  }
+  close(fd);
+  if (reply) {
+    reply[len] = '\0';
+  }
+  return reply;
+}
+
+// "Monitor NAME (ID n):" blocks with "active workspace:" and "focused:"
+static void write_monitors(FILE *out) {
+  char *reply = request("monitors");
+  if (!reply) {
+    return;
+  }
+  char name[64] = "";
+  int active = 0;
+  for (char *line = strtok(reply, "\n"); line; line = strtok(NULL, "\n")) {
+    while (*line == '\t' || *line == ' ') {
+      line++;
+    }
+    if (sscanf(line, "Monitor %63s", name) == 1) {
+      active = 0;
+    } else if (sscanf(line, "active workspace: %d", &active) == 1) {
+      continue;
+    } else if (strncmp(line, "focused: ", 9) == 0 && name[0]) {
+      fprintf(out, "#monitor %s %d %d\n", name, active,
+              strcmp(line + 9, "yes") == 0);
+    }
+  }
+  free(reply);
+}
+
+// "Window ADDR -> title:" blocks with "workspace:" and "class:"
+static void write_windows(FILE *out) {
+  char *reply = request("clients");
+  if (!reply) {
+    return;
+  }
+  char address[24] = "";
+  int workspace = 0;
+  for (char *line = strtok(reply, "\n"); line; line = strtok(NULL, "\n")) {
+    while (*line == '\t' || *line == ' ') {
+      line++;
+    }
+    if (sscanf(line, "Window %23s", address) == 1) {
+      workspace = 0;
+    } else if (sscanf(line, "workspace: %d", &workspace) == 1) {
+      continue;
+    } else if (strncmp(line, "class: ", 7) == 0 && address[0]) {
+      fprintf(out, "#window %s %d %s\n", address, workspace,
+              line[7] ? line + 7 : "-");
+      address[0] = '\0';
+    }
+  }
+  free(reply);
+}
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+int main(int argc, char *argv[]) {
+  FILE *out = stdout;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:h")) != -1) {
+    switch (opt) {
+    case 'o':
+      out = fopen(optarg, "w");
+      if (!out) {
+        perror(optarg);
+        return 1;
+      }
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-o CAPTURE]\n", argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_quit;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  int sock = connect_socket(".socket2.sock");
+  if (sock < 0) {
+    return 1;
+  }
+  fprintf(out, "# hypr_record capture\n");
+  write_monitors(out);
+  write_windows(out);
+  fflush(out);
+
+  char buffer[8192];
+  size_t len = 0;
+  size_t count = 0;
+  uint64_t last = now_us();
+  while (!quit) {
+    ssize_t n = read(sock, buffer + len, sizeof(buffer) - len - 1);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    uint64_t now = now_us();
+    len += (size_t)n;
+    buffer[len] = '\0';
+
+    // Lines from one read share a timestamp; the first carries the delay
+    char *line = buffer;
+    char *nl;
+    while ((nl = strchr(line, '\n'))) {
+      *nl = '\0';
+      fprintf(out, "%llu\t%s\n", (unsigned long long)(now - last), line);
+      last = now;
+      count++;
+      line = nl + 1;
+    }
+    len = strlen(line);
+    memmove(buffer, line, len + 1);
+    if (len == sizeof(buffer) - 1) {
+      len = 0; // a single line larger than the buffer; drop it
+    }
+    fflush(out);
+  }
+
+  fprintf(stderr, "Recorded %zu events\n", count);
+  close(sock);
+  if (out != stdout) {
+    fclose(out);
+  }
+  return 0;
+}
@@ -0,0 +1,220 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Microbenchmark for the JSON output path.
+ *
+ * Renders an audio_out style sink array with the old fprintf/putc printer
+ * and with JsonWriter, checks both produce the same bytes, then times each
+ * writing to /dev/null.
+ *
+ *   make bench && ./bin/json_bench [iterations]
+ */
+
+#define _GNU_SOURCE
+#include "json.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  int index;
+  const char *name;
+  const char *description;
+  const char *icon;
+  bool muted;
+  int volume;
+  bool is_default;
+} BenchSink;
+
+static const BenchSink sinks[] = {
+    {52, "alsa_output.pci-0000_0c_00.4.analog-stereo",
+     "Starship/Matisse HD Audio Controller Analog Stereo", "audio-card-analog",
+     false, 42, true},
+    {61, "bluez_output.AC_80_0A_2E_81_6A.1",
+     "WH-1000XM4 \"Living Room\" (A2DP Sink, codec LDAC)",
+     "audio-headphones-bluetooth", false, 100, false},
+    {77, "alsa_output.usb-Focusrite_Scarlett_2i2_USB_Y8E4K0Z1A0B2C3-00.pro",
+     "Scarlett 2i2 USB Pro Audio — Kanal 1/2 \\ Monitor Ausgänge",
+     "audio-card-usb", true, 0, false},
+    {83, "alsa_output.pci-0000_0a_00.1.hdmi-stereo-extra3",
+     "GA102 High Definition Audio Controller Digital Stereo (HDMI 4)\t"
+     "Now playing: Sigur Rós – Ára bátur (Live at Alexandra Palace, London "
+     "2008) [Remastered]",
+     "video-display", false, 65, false},
+};
+#define SINK_COUNT (sizeof(sinks) / sizeof(sinks[0]))
+
+// The printer audio_out used before JsonWriter
+static void print_sinks_fprintf(FILE *out) {
+  fprintf(out, "[");
+  for (size_t i = 0; i < SINK_COUNT; ++i) {
+    const BenchSink *sink = &sinks[i];
+    if (i) {
+      fprintf(out, ",");
+    }
+    fprintf(out, "{\"index\":%i", sink->index);
+    fprintf(out, ",\"isMute\":%s", sink->muted ? "true" : "false");
+    fprintf(out, ",\"volume\":%d", sink->volume);
+    fprintf(out, ",\"isDefault\":%s", sink->is_default ? "true" : "false");
+    fprintf(out, ",\"name\":");
+    fprint_json_str(out, sink->name);
+    fprintf(out, ",\"description\":");
+    fprint_json_str(out, sink->description);
+    fprintf(out, ",\"icon\":");
+    fprint_json_str(out, sink->icon);
+    fprintf(out, "}");
+  }
+  fprintf(out, "]\n");
+  fflush(out);
+}
+
+static void build_sinks_writer(JsonWriter *w) {
+  json_begin_array(w);
+  for (size_t i = 0; i < SINK_COUNT; ++i) {
+    const BenchSink *sink = &sinks[i];
+    json_begin_object(w);
+    json_key(w, "index");
+    json_int(w, sink->index);
+    json_key(w, "isMute");
+    json_bool(w, sink->muted);
+    json_key(w, "volume");
+    json_int(w, sink->volume);
+    json_key(w, "isDefault");
+    json_bool(w, sink->is_default);
+    json_key(w, "name");
+    json_string(w, sink->name);
+    json_key(w, "description");
+    json_string(w, sink->description);
+    json_key(w, "icon");
+    json_string(w, sink->icon);
+    json_end_object(w);
+  }
+  json_end_array(w);
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Both printers must agree byte for byte before timing means anything
+static int check_identical(void) {
+  char *expected = NULL;
+  size_t expected_len = 0;
+  FILE *mem = open_memstream(&expected, &expected_len);
+  if (!mem) {
+    perror("open_memstream");
+    return -1;
+  }
+  print_sinks_fprintf(mem);
+  fclose(mem);
+
+  JsonWriter w;
+  json_writer_init(&w);
+  build_sinks_writer(&w);
+  int ok = w.len + 1 == expected_len &&
+           memcmp(w.buf, expected, w.len) == 0 && expected[w.len] == '\n';
+  if (!ok) {
+    fprintf(stderr, "output mismatch\nfprintf: %s\nwriter:  %.*s\n", expected,
+            (int)w.len, w.buf);
+  }
+  json_writer_free(&w);
+  free(expected);
+  return ok ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+  long iterations = argc > 1 ? atol(argv[1]) : 200000;
+  if (iterations <= 0) {
+    fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+  if (check_identical() < 0) {
+    return 1;
+  }
+
+  FILE *devnull = fopen("/dev/null", "w");
+  if (!devnull) {
+    perror("/dev/null");
+    return 1;
+  }
+
+  JsonWriter w;
+  json_writer_init(&w);
+  build_sinks_writer(&w);
+  size_t doc_len = w.len + 1;
+  json_writer_reset(&w);
+
+  double start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    print_sinks_fprintf(devnull);
+  }
+  double fprintf_ns = (now_ns() - start) / (double)iterations;
+
+  start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    build_sinks_writer(&w);
+    json_writer_emit(&w, devnull);
+  }
+  double writer_ns = (now_ns() - start) / (double)iterations;
+
+  // Serialization alone, without the write(2) per document
+  start = now_ns();
+  for (long i = 0; i < iterations; i++) {
+    build_sinks_writer(&w);
+    json_writer_reset(&w);
+  }
+  double build_ns = (now_ns() - start) / (double)iterations;
+
+  printf("document: %zu sinks, %zu bytes, %ld iterations\n", SINK_COUNT,
+         doc_len, iterations);
+  printf("%-22s %10.1f ns/doc %8.1f MB/s\n", "fprintf + putc", fprintf_ns,
+         (double)doc_len * 1e3 / fprintf_ns);
+  printf("%-22s %10.1f ns/doc %8.1f MB/s\n", "JsonWriter + write", writer_ns,
+         (double)doc_len * 1e3 / writer_ns);
+  printf("%-22s %10.1f ns/doc %8.1f MB/s\n", "JsonWriter build only",
+         build_ns, (double)doc_len * 1e3 / build_ns);
+
+  json_writer_free(&w);
+  fclose(devnull);
+  return 0;
+}
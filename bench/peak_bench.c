@@ -0,0 +1,206 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* Benchmark for the audio_peak meter path, without a sound server.
+ *
+ * Stands in for STREAMS PA_STREAM_PEAK_DETECT record streams on null sinks:
+ * each delivers one fragment of PEAK_RATE/hz peak samples per update, the
+ * odd ones silent like an idle null sink, the even ones carrying a noisy
+ * program level. Every fragment goes through peak_feed() and, when a bucket
+ * changed, the audio_peak document and its change check. Each meter setting
+ * is run for SECONDS of simulated audio and reported as CPU and output
+ * lines per stream and second, next to the fragments (server wakeups) a
+ * stream costs each second. The first row meters every peak sample in 100
+ * steps, as an undecimated baseline.
+ *
+ *   make peak_bench && ./bin/peak_bench [-s SECONDS] [-n STREAMS]
+ */
+
+#define _GNU_SOURCE
+#include "change.h"
+#include "json.h"
+#include "peak.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+  const char *label;
+  unsigned int hz;
+  unsigned int steps;
+} MeterSetting;
+
+static const MeterSetting settings[] = {
+    {"every sample", PEAK_RATE, 100},
+    {"20Hz 100 steps", 20, 100},
+    {"20Hz 20 steps", PEAK_DEFAULT_HZ, PEAK_DEFAULT_STEPS},
+    {"10Hz 10 steps", 10, 10},
+};
+
+typedef struct {
+  PeakMeter peak;
+  char name[32];
+  uint32_t seed;
+  unsigned int phase;
+} BenchStream;
+
+static double cpu_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+// Peak samples as a null sink would report them: silence, or a triangle
+// envelope over a second with noise on top
+static void fill_fragment(BenchStream *s, bool silent, float *samples,
+                          unsigned int count) {
+  for (unsigned int i = 0; i < count; i++) {
+    if (silent) {
+      samples[i] = 0;
+      continue;
+    }
+    s->seed = s->seed * 1664525u + 1013904223u;
+    float noise = (float)(s->seed >> 8) / (float)(1u << 24);
+    unsigned int t = s->phase++ % PEAK_RATE;
+    float envelope = (float)(t < PEAK_RATE / 2 ? t : PEAK_RATE - t) /
+                     (float)(PEAK_RATE / 2);
+    samples[i] = envelope * (0.6f + 0.4f * noise);
+  }
+}
+
+static void print_levels(JsonWriter *w, BenchStream *streams, int count) {
+  json_begin_object(w);
+  json_key(w, "sinks");
+  json_begin_object(w);
+  for (int i = 0; i < count; i++) {
+    json_key(w, streams[i].name);
+    json_int(w, peak_percent(&streams[i].peak));
+  }
+  json_end_object(w);
+  json_key(w, "sources");
+  json_begin_object(w);
+  json_end_object(w);
+  json_end_object(w);
+}
+
+static void run(const MeterSetting *setting, int count, unsigned int seconds,
+                FILE *devnull) {
+  BenchStream *streams = calloc((size_t)count, sizeof(*streams));
+  float samples[PEAK_RATE];
+  JsonWriter w;
+  ChangeDetector changes = {0};
+  json_writer_init(&w);
+  for (int i = 0; i < count; i++) {
+    peak_init(&streams[i].peak, setting->hz, setting->steps);
+    snprintf(streams[i].name, sizeof(streams[i].name), "null_sink_%d", i);
+    streams[i].seed = (uint32_t)i + 1;
+  }
+
+  unsigned int window = streams[0].peak.window;
+  unsigned long fragments = (unsigned long)seconds * PEAK_RATE / window;
+  long lines = 0;
+  double start = cpu_us();
+  for (unsigned long f = 0; f < fragments; f++) {
+    for (int i = 0; i < count; i++) {
+      BenchStream *s = &streams[i];
+      fill_fragment(s, i % 2 == 1, samples, window);
+      if (!peak_feed(&s->peak, samples, window)) {
+        continue;
+      }
+      print_levels(&w, streams, count);
+      if (change_check(&changes, w.buf, w.len)) {
+        json_writer_emit(&w, devnull);
+        lines++;
+      } else {
+        json_writer_reset(&w);
+      }
+    }
+  }
+  double used = cpu_us() - start;
+
+  double stream_seconds = (double)seconds * count;
+  printf("%-16s %7d %12.0f %12.2f %14.3f\n", setting->label, count,
+         (double)fragments / seconds, (double)lines / stream_seconds,
+         used / stream_seconds);
+  json_writer_free(&w);
+  change_reset(&changes);
+  free(streams);
+}
+
+int main(int argc, char *argv[]) {
+  unsigned int seconds = 600;
+  int max_streams = 16;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = (unsigned int)atoi(optarg);
+      break;
+    case 'n':
+      max_streams = atoi(optarg);
+      break;
+    default:
+      seconds = 0;
+    }
+  }
+  if (seconds == 0 || max_streams <= 0) {
+    fprintf(stderr, "Usage: %s [-s SECONDS] [-n STREAMS]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *devnull = fopen("/dev/null", "w");
+  if (!devnull) {
+    perror("/dev/null");
+    return 1;
+  }
+  printf("null-sink stand-in, %u s of audio, peak rate %d/s\n", seconds,
+         PEAK_RATE);
+  printf("%-16s %7s %12s %12s %14s\n", "meter", "streams", "fragments/s",
+         "lines/s", "cpu_us/s");
+  for (size_t i = 0; i < sizeof(settings) / sizeof(settings[0]); i++) {
+    for (int count = 1; count <= max_streams; count *= 4) {
+      run(&settings[i], count, seconds, devnull);
+    }
+  }
+  fclose(devnull);
+  return 0;
+}
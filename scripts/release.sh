@@ -0,0 +1,147 @@
+#!/bin/bash
+# Profile-guided, link-time optimized build: make release
+#
+#   1. plain debug build, kept in bin/debug for comparison
+#   2. instrumented build (PROFILE=generate), trained on checked-in workloads:
+#      bench/workloads/hypr_storm.events for the Hyprland listeners, the fake
+#      BlueZ/NetworkManager/MPRIS services of bench/dbus_bench (fixed seed)
+#      for the D-Bus ones
+#   3. rebuild with the profiles (PROFILE=use) into bin/ and report size,
+#      startup and CPU against the debug build
+#
+# Listeners without a replayable workload (audio_*, the hub) are still built
+# with -O2 -flto, just without a profile.
+set -e
+
+targets=("$@")
+pgo_dir="bin/pgo"
+debug_dir="bin/debug"
+hypr_capture="bench/workloads/hypr_storm.events"
+
+binary_of() {
+    case $1 in
+        hub | ctl) echo "newwbar-$1" ;;
+        *) echo "$1" ;;
+    esac
+}
+
+# Built binaries from a list, in DIR
+pick() {
+    local dir=$1 name
+    shift
+    for name in "$@"; do
+        for target in "${targets[@]}"; do
+            if [[ $(binary_of "$target") == "$name" ]]; then
+                echo "$dir/$name"
+            fi
+        done
+    done
+}
+
+hypr_bins=(workspace_focus workspace_list monitor_list active_window
+           keyboard_layout)
+dbus_bins=(bluetooth_devices bluetooth_adapter wlan_monitor wlan_scan
+           mpris_fetch mpris_position)
+
+echo "== debug build"
+make --no-print-directory "${targets[@]}"
+rm -rf "$debug_dir"
+mkdir -p "$debug_dir"
+for target in "${targets[@]}"; do
+    cp "bin/$(binary_of "$target")" "$debug_dir/"
+done
+
+echo "== instrumented build"
+rm -rf "$pgo_dir"
+make --no-print-directory PROFILE=generate "${targets[@]}"
+
+echo "== training"
+runtime_dir=$(mktemp -d)
+trap 'rm -rf "$runtime_dir"' EXIT
+export XDG_RUNTIME_DIR=$runtime_dir
+hypr=($(pick bin "${hypr_bins[@]}"))
+dbus=($(pick bin "${dbus_bins[@]}"))
+if ((${#hypr[@]})); then
+    ./bin/hypr_bench -s 0 -r 3 "$hypr_capture" "${hypr[@]}" ||
+        echo "warning: hypr training run failed" >&2
+    ./bin/hypr_bench -s 20 -r 1 "$hypr_capture" "${hypr[@]}" ||
+        echo "warning: paced hypr training run failed" >&2
+fi
+if ((${#dbus[@]})); then
+    ./bin/dbus_bench -e 2000 "${dbus[@]}" ||
+        echo "warning: dbus training run failed" >&2
+    ./bin/dbus_bench -d 64 -a 128 -p 8 -e 500 "${dbus[@]}" ||
+        echo "warning: large dbus training run failed" >&2
+fi
+if [[ -n $(pick bin date_simple) ]]; then
+    timeout -s TERM 2 ./bin/date_simple > /dev/null || true
+fi
+echo "profiles: $(find "$pgo_dir" -name '*.gcda' | wc -l) files in $pgo_dir"
+
+echo "== optimized build"
+make --no-print-directory PROFILE=use "${targets[@]}"
+
+# --- Report ---
+
+# Joins two bench outputs on the binary column and prints debug -> release
+# for the named columns
+compare() {
+    awk -v columns="$1" '
+        /^binary / {
+            for (i = 1; i <= NF; i++) index_of[$i] = i
+            file++
+            next
+        }
+        file && $2 ~ /^[0-9]+$/ {
+            for (c = 1; c <= count; c++) value[file, $1, c] = $(index_of[name[c]])
+            if (file == 1) order[++rows] = $1
+        }
+        BEGIN { count = split(columns, name, " ") }
+        END {
+            printf "%-18s", "binary"
+            for (c = 1; c <= count; c++) printf " %27s", name[c] " debug>release"
+            printf "\n"
+            for (r = 1; r <= rows; r++) {
+                printf "%-18s", order[r]
+                for (c = 1; c <= count; c++) {
+                    before = value[1, order[r], c]; after = value[2, order[r], c]
+                    delta = before > 0 ? sprintf("%+.0f%%", (after - before) * 100 / before) : "-"
+                    printf " %10s > %-8s %5s", before, after, delta
+                }
+                printf "\n"
+            }
+        }' "$2" "$3"
+}
+
+echo
+echo "== size (text+data bytes)"
+printf "%-18s %10s %10s %7s\n" binary debug release delta
+for target in "${targets[@]}"; do
+    name=$(binary_of "$target")
+    before=$(size "$debug_dir/$name" | awk 'NR == 2 { print $1 + $2 }')
+    after=$(size "bin/$name" | awk 'NR == 2 { print $1 + $2 }')
+    awk -v name="$name" -v before="$before" -v after="$after" 'BEGIN {
+        printf "%-18s %10d %10d %+6.1f%%\n", name, before, after,
+               (after - before) * 100 / before }'
+done
+
+report=$(mktemp -d)
+trap 'rm -rf "$runtime_dir" "$report"' EXIT
+if ((${#hypr[@]})); then
+    echo
+    echo "== $hypr_capture"
+    for dir in "$debug_dir" bin; do
+        ./bin/hypr_bench -s 0 -r 3 "$hypr_capture" \
+            $(pick "$dir" "${hypr_bins[@]}") > "$report/hypr.${dir##*/}" || true
+    done
+    compare "cpu_us/ev wall_ms" "$report/hypr.debug" "$report/hypr.bin"
+fi
+if ((${#dbus[@]})); then
+    echo
+    echo "== dbus_bench"
+    for dir in "$debug_dir" bin; do
+        ./bin/dbus_bench -e 2000 \
+            $(pick "$dir" "${dbus_bins[@]}") > "$report/dbus.${dir##*/}" || true
+    done
+    compare "cpu_us/ev startup_ms paint_ms" "$report/dbus.debug" "$report/dbus.bin"
+fi
@@ -0,0 +1,507 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "hypr.h"
+#include "json.h"
+#include "stats.h"
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* The focused window's class, title and icon. Focus changes print at once;
+ * title changes of the same window go through the coalescer, which here
+ * runs at ACTIVE_WINDOW_HZ so a terminal retitling itself per keystroke
+ * costs eww a few redraws a second. Titles are cut to NEWWBAR_TITLE_WIDTH
+ * columns (default TITLE_WIDTH, 0 for no limit). Icons are looked up once
+ * per class and remembered. */
+
+#define ACTIVE_WINDOW_HZ 4
+#define TITLE_WIDTH 48
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    printf(fmt "\n", ##__VA_ARGS__);                                           \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+typedef struct {
+  uint64_t hash; // of class_name
+  char *class_name;
+  char *icon; // "" when nothing was found
+} IconSlot;
+
+static uint64_t address = 0;
+static char class_name[HYPR_NAME_LEN] = "";
+static char title[HYPR_TITLE_LEN] = "";
+static bool focus_moved = false; // since the last line
+static int title_width = TITLE_WIDTH;
+
+// Open-addressed class -> icon cache; class_name NULL marks a free slot
+static IconSlot *icon_cache = NULL;
+static size_t icon_cap = 0; // power of two
+static size_t icon_count = 0;
+
+static FILE *out;
+static JsonWriter json;
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+enum { WIN_CLASS, WIN_TITLE, WIN_ICON };
+static const char *const window_fields[] = {"class", "title", "icon"};
+static FieldSet fields = FIELD_SET("active_window", window_fields);
+
+// --- Title width ---
+
+// Columns a code point takes: none for combining marks, joiners, variation
+// selectors and skin tones, two for wide East Asian text and emoji
+static int codepoint_width(uint32_t cp) {
+  if ((cp >= 0x0300 && cp <= 0x036F) || (cp >= 0x1AB0 && cp <= 0x1AFF) ||
+      (cp >= 0x20D0 && cp <= 0x20FF) || (cp >= 0xFE00 && cp <= 0xFE0F) ||
+      (cp >= 0xFE20 && cp <= 0xFE2F) || cp == 0x200D ||
+      (cp >= 0x1F3FB && cp <= 0x1F3FF) || (cp >= 0xE0100 && cp <= 0xE01EF)) {
+    return 0;
+  }
+  if ((cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) ||
+      (cp >= 0xAC00 && cp <= 0xD7A3) || (cp >= 0xF900 && cp <= 0xFAFF) ||
+      (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+      (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1FAFF) ||
+      (cp >= 0x20000 && cp <= 0x3FFFD)) {
+    return 2;
+  }
+  return 1;
+}
+
+// Decodes one UTF-8 sequence; a stray byte decodes as itself
+static size_t utf8_next(const unsigned char *s, size_t len, uint32_t *cp) {
+  size_t n = s[0] < 0x80 ? 1 : s[0] >= 0xF0 ? 4 : s[0] >= 0xE0 ? 3
+             : s[0] >= 0xC0 ? 2 : 1;
+  if (n > len) {
+    n = 1;
+  }
+  for (size_t i = 1; i < n; i++) {
+    if ((s[i] & 0xC0) != 0x80) {
+      n = 1;
+    }
+  }
+  static const unsigned char lead_mask[] = {0, 0xFF, 0x1F, 0x0F, 0x07};
+  *cp = s[0] & lead_mask[n];
+  for (size_t i = 1; i < n; i++) {
+    *cp = (*cp << 6) | (s[i] & 0x3F);
+  }
+  return n;
+}
+
+// Cuts TEXT to WIDTH columns, ending in an ellipsis when anything was
+// dropped; marks and joined code points stay with the character before
+static void truncate_title(const char *text, char *dst, size_t size) {
+  size_t len = strlen(text);
+  const unsigned char *s = (const unsigned char *)text;
+  size_t fit = 0, pos = 0; // fit: end of what fits with the ellipsis
+  int columns = 0;
+  bool joined = false, cut = false;
+  while (pos < len) {
+    uint32_t cp;
+    size_t n = utf8_next(s + pos, len - pos, &cp);
+    int w = joined ? 0 : codepoint_width(cp);
+    joined = cp == 0x200D;
+    if (title_width > 0 && columns + w > title_width) {
+      cut = true;
+      break;
+    }
+    columns += w;
+    pos += n;
+    if (columns <= title_width - 1) {
+      fit = pos;
+    }
+  }
+  if (!cut) {
+    fit = len;
+  }
+  if (fit + 4 > size) {
+    fit = size - 4;
+    while (fit > 0 && (s[fit] & 0xC0) == 0x80) {
+      fit--; // back to the start of the sequence that does not fit
+    }
+  }
+  memcpy(dst, text, fit);
+  strcpy(dst + fit, cut ? "\xE2\x80\xA6" : "");
+}
+
+// --- Icon lookup ---
+
+static const char *const icon_sizes[] = {"scalable", "256x256", "128x128",
+                                         "64x64",    "48x48",   "32x32"};
+static const char *const icon_exts[] = {"svg", "png"};
+
+// XDG_DATA_HOME then XDG_DATA_DIRS, ':'-separated
+static void data_dirs(char *dirs, size_t size) {
+  const char *home = getenv("XDG_DATA_HOME");
+  const char *user = getenv("HOME");
+  const char *system = getenv("XDG_DATA_DIRS");
+  if (!system || !*system) {
+    system = "/usr/local/share:/usr/share";
+  }
+  if (home && *home) {
+    snprintf(dirs, size, "%s:%s", home, system);
+  } else if (user && *user) {
+    snprintf(dirs, size, "%s/.local/share:%s", user, system);
+  } else {
+    snprintf(dirs, size, "%s", system);
+  }
+}
+
+static bool readable(const char *path) { return access(path, R_OK) == 0; }
+
+// Icon= of NAME.desktop in any data dir
+static bool desktop_icon(const char *dirs, const char *name, char *icon,
+                         size_t size) {
+  char path[4096];
+  for (const char *dir = dirs; *dir;) {
+    size_t len = strcspn(dir, ":");
+    snprintf(path, sizeof(path), "%.*s/applications/%s.desktop", (int)len,
+             dir, name);
+    FILE *fp = fopen(path, "r");
+    if (fp) {
+      char line[1024];
+      bool found = false;
+      while (!found && fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "Icon=", 5) == 0) {
+          line[strcspn(line, "\r\n")] = '\0';
+          snprintf(icon, size, "%s", line + 5);
+          found = *icon != '\0';
+        }
+      }
+      fclose(fp);
+      if (found) {
+        return true;
+      }
+    }
+    dir += len + (dir[len] == ':');
+  }
+  return false;
+}
+
+static bool find_icon_file(const char *dirs, const char *theme,
+                           const char *name, char *path, size_t size) {
+  if (name[0] == '/') {
+    snprintf(path, size, "%s", name);
+    return readable(path);
+  }
+  for (const char *dir = dirs; *dir;) {
+    size_t len = strcspn(dir, ":");
+    for (size_t i = 0; i < sizeof(icon_sizes) / sizeof(icon_sizes[0]); i++) {
+      for (size_t e = 0; e < 2; e++) {
+        snprintf(path, size, "%.*s/icons/%s/%s/apps/%s.%s", (int)len, dir,
+                 theme, icon_sizes[i], name, icon_exts[e]);
+        if (readable(path)) {
+          return true;
+        }
+      }
+    }
+    for (size_t e = 0; e < 2; e++) {
+      snprintf(path, size, "%.*s/pixmaps/%s.%s", (int)len, dir, name,
+               icon_exts[e]);
+      if (readable(path)) {
+        return true;
+      }
+    }
+    dir += len + (dir[len] == ':');
+  }
+  return false;
+}
+
+// Tries the class, its lowercase form and the Icon= of a desktop entry
+// named after either, in NEWWBAR_ICON_THEME then hicolor
+static char *resolve_icon(const char *name) {
+  char dirs[8192], lower[HYPR_NAME_LEN], names[4][HYPR_NAME_LEN];
+  data_dirs(dirs, sizeof(dirs));
+  size_t i = 0;
+  for (; name[i] && i < sizeof(lower) - 1; i++) {
+    lower[i] = (char)tolower((unsigned char)name[i]);
+  }
+  lower[i] = '\0';
+
+  int count = 0;
+  snprintf(names[count++], HYPR_NAME_LEN, "%s", name);
+  if (strcmp(lower, name) != 0) {
+    snprintf(names[count++], HYPR_NAME_LEN, "%s", lower);
+  }
+  if (desktop_icon(dirs, name, names[count], HYPR_NAME_LEN) ||
+      desktop_icon(dirs, lower, names[count], HYPR_NAME_LEN)) {
+    count++;
+  }
+
+  const char *theme = getenv("NEWWBAR_ICON_THEME");
+  const char *themes[] = {theme && *theme ? theme : "hicolor", "hicolor"};
+  char path[4096];
+  for (int t = 0; t < 2; t++) {
+    if (t == 1 && strcmp(themes[0], themes[1]) == 0) {
+      break;
+    }
+    for (int n = 0; n < count; n++) {
+      if (find_icon_file(dirs, themes[t], names[n], path, sizeof(path))) {
+        return strdup(path);
+      }
+    }
+  }
+  return strdup("");
+}
+
+static bool icon_cache_grow(void) {
+  size_t old_cap = icon_cap;
+  IconSlot *old = icon_cache;
+  size_t cap = old_cap ? old_cap * 2 : 32;
+  IconSlot *grown = calloc(cap, sizeof(*grown));
+  if (!grown) {
+    return false;
+  }
+  icon_cache = grown;
+  icon_cap = cap;
+  for (size_t i = 0; i < old_cap; i++) {
+    if (old[i].class_name) {
+      size_t j = old[i].hash & (icon_cap - 1);
+      while (icon_cache[j].class_name) {
+        j = (j + 1) & (icon_cap - 1);
+      }
+      icon_cache[j] = old[i];
+    }
+  }
+  free(old);
+  return true;
+}
+
+// Icon path for a class, "" if it has none; only the first asks the disk
+static const char *icon_for(const char *name) {
+  size_t len = strlen(name);
+  if (len == 0) {
+    return "";
+  }
+  uint64_t hash = change_hash(name, len);
+  if (icon_cap) {
+    for (size_t i = hash & (icon_cap - 1); icon_cache[i].class_name;
+         i = (i + 1) & (icon_cap - 1)) {
+      if (icon_cache[i].hash == hash &&
+          strcmp(icon_cache[i].class_name, name) == 0) {
+        return icon_cache[i].icon;
+      }
+    }
+  }
+
+  if ((icon_count + 1) * 4 > icon_cap * 3 && !icon_cache_grow()) {
+    return "";
+  }
+  char *icon = resolve_icon(name);
+  char *key = strdup(name);
+  if (!icon || !key) {
+    free(icon);
+    free(key);
+    return "";
+  }
+  size_t i = hash & (icon_cap - 1);
+  while (icon_cache[i].class_name) {
+    i = (i + 1) & (icon_cap - 1);
+  }
+  icon_cache[i] = (IconSlot){hash, key, icon};
+  icon_count++;
+  DEBUG_MSG("icon %s -> %s", name, *icon ? icon : "(none)");
+  return icon;
+}
+
+// --- Output ---
+
+static void publish(void) {
+  json_begin_object(&json);
+  if (field_on(&fields, WIN_CLASS)) {
+    json_key(&json, window_fields[WIN_CLASS]);
+    json_string(&json, class_name);
+  }
+  if (field_on(&fields, WIN_TITLE)) {
+    char shown[HYPR_TITLE_LEN];
+    truncate_title(title, shown, sizeof(shown));
+    json_key(&json, window_fields[WIN_TITLE]);
+    json_string(&json, shown);
+  }
+  if (field_on(&fields, WIN_ICON)) {
+    json_key(&json, window_fields[WIN_ICON]);
+    json_string(&json, icon_for(class_name));
+  }
+  json_end_object(&json);
+
+  if (!change_check(&changes, json.buf, json.len)) {
+    coalesce_suppressed(coalescer);
+  } else if (focus_moved) {
+    coalesce_now(coalescer, json.buf, json.len);
+  } else {
+    coalesce_line(coalescer, json.buf, json.len); // title churn
+  }
+  json_writer_reset(&json);
+  focus_moved = false;
+}
+
+// --- Events ---
+
+// activewindow>>CLASS,TITLE  activewindowv2>>ADDRESS
+// windowtitlev2>>ADDRESS,TITLE
+// Both activewindow events are empty when nothing has focus.
+static void on_event(HyprEvent event, const char *data, size_t len) {
+  DEBUG_MSG("CAUGHT: %.*s", (int)len, data);
+  const char *comma = memchr(data, ',', len);
+  switch (event) {
+  case HYPR_ACTIVEWINDOW: {
+    stats_event(stats);
+    size_t class_len = comma ? (size_t)(comma - data) : len;
+    if (class_len >= sizeof(class_name)) {
+      class_len = sizeof(class_name) - 1;
+    }
+    if (strlen(class_name) != class_len ||
+        memcmp(class_name, data, class_len) != 0) {
+      memcpy(class_name, data, class_len);
+      class_name[class_len] = '\0';
+      focus_moved = true;
+    }
+    size_t title_len = comma ? len - class_len - 1 : 0;
+    snprintf(title, sizeof(title), "%.*s", (int)title_len,
+             comma ? comma + 1 : "");
+    break;
+  }
+  case HYPR_ACTIVEWINDOWV2: {
+    stats_event(stats);
+    uint64_t focused = strtoull(data, NULL, 16);
+    focus_moved = focus_moved || focused != address;
+    address = focused;
+    break;
+  }
+  default: // windowtitlev2: only the focused window's title is shown
+    if (comma && address && strtoull(data, NULL, 16) == address) {
+      stats_event(stats);
+      snprintf(title, sizeof(title), "%.*s",
+               (int)(len - (size_t)(comma + 1 - data)), comma + 1);
+    }
+    break;
+  }
+}
+
+// Focus as Hyprland sees it now; published by the caller
+static void query_focus(void) {
+  HyprWindow win;
+  if (hypr_active_window(&win) < 0) {
+    DEBUG_MSG("activewindow request failed");
+    return;
+  }
+  focus_moved = focus_moved || win.address != address;
+  address = win.address;
+  memcpy(class_name, win.class_name, sizeof(class_name));
+  memcpy(title, win.title, sizeof(title));
+}
+
+static void on_reconnect(void) {
+  query_focus();
+  publish();
+}
+
+static const HyprSubscriber subscriber = {
+    "active_window",
+    HYPR_MASK(HYPR_ACTIVEWINDOW) | HYPR_MASK(HYPR_ACTIVEWINDOWV2) |
+        HYPR_MASK(HYPR_WINDOWTITLEV2),
+    on_event, publish, on_reconnect};
+
+// --- Subscribe to the socket2 bus, which must be open already ---
+int active_window_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return -1;
+  }
+  const char *width = getenv("NEWWBAR_TITLE_WIDTH");
+  if (width && *width) {
+    title_width = atoi(width);
+  }
+  out = stream;
+  stats = stats_stream("active_window");
+  coalescer = coalesce_new("active_window", out, stats, ACTIVE_WINDOW_HZ);
+  if (hypr_bus_subscribe(&subscriber) < 0) {
+    DEBUG_MSG("too many socket2 subscribers");
+    return -1;
+  }
+
+  query_focus();
+  focus_moved = true;
+  publish();
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG("DEBUG enabled.");
+  stats_init("active_window");
+  int sock = hypr_bus_open();
+  if (sock < 0) {
+    DEBUG_MSG("socket2 connect failed");
+    return 1;
+  }
+  if (active_window_start(stdout) < 0) {
+    return 1;
+  }
+
+  do {
+    while (coalesce_poll(sock) > 0 && hypr_bus_dispatch(sock) == 0)
+      ;
+    DEBUG_MSG("Socket closed");
+    close(sock);
+    coalesce_flush_all(); // the last state stands while Hyprland is away
+  } while ((sock = hypr_bus_wait()) >= 0);
+  return 0;
+}
+#endif
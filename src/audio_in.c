@@ -38,7 +38,13 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
 #include "json.h"
+#include "pulse.h"
+#include "stats.h"
 #include <pulse/pulseaudio.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -59,18 +65,37 @@ typedef struct {
 
 // AppContext: holds all application state
 typedef struct {
-  pa_mainloop *pa_mainloop;
-  pa_context *pa_context;
+  PulseConn pulse;
   AudioSource *sources;
   size_t source_count;
   char *default_source;
+  FILE *out;
+  JsonWriter json;
+  StatsStream *stats;
+  Coalescer *coalescer;
+  ChangeDetector changes;
   bool got_server_info;
   bool got_source_info;
   bool want_reprint;
 } AppContext;
 
+// JSON members of a source, in output order
+enum {
+  SOURCE_ID,
+  SOURCE_MUTE,
+  SOURCE_VOLUME,
+  SOURCE_DEFAULT,
+  SOURCE_SOURCE,
+  SOURCE_NAME,
+  SOURCE_ICON,
+  SOURCE_STATE,
+};
+static const char *const source_fields[] = {
+    "id", "mute", "volume", "default", "source", "name", "icon", "state"};
+static FieldSet fields = FIELD_SET("audio_in", source_fields);
+
 // --- Utility: state to string ---
-const char *state_to_string(pa_source_state_t state) {
+static const char *state_to_string(pa_source_state_t state) {
   switch (state) {
   case PA_SOURCE_RUNNING:
     return "running";
@@ -86,7 +111,7 @@ const char *state_to_string(pa_source_state_t state) {
 }
 
 // --- Memory management for AudioSource array ---
-void free_sources(AudioSource *sources, size_t count) {
+static void free_sources(AudioSource *sources, size_t count) {
   if (!sources) {
     return;
   }
@@ -99,37 +124,60 @@ void free_sources(AudioSource *sources, size_t count) {
 }
 
 // --- Print all sources as JSON array ---
-void print_sources(AppContext *app) {
-  printf("[");
+static void print_sources(AppContext *app) {
+  JsonWriter *w = &app->json;
+  json_begin_array(w);
   for (size_t i = 0; i < app->source_count; ++i) {
     AudioSource *src = &app->sources[i];
-    if (i) {
-      printf(",");
+    json_begin_object(w);
+    if (field_on(&fields, SOURCE_ID)) {
+      json_key(w, source_fields[SOURCE_ID]);
+      json_int(w, src->index);
+    }
+    if (field_on(&fields, SOURCE_MUTE)) {
+      json_key(w, source_fields[SOURCE_MUTE]);
+      json_bool(w, src->muted);
+    }
+    if (field_on(&fields, SOURCE_VOLUME)) {
+      json_key(w, source_fields[SOURCE_VOLUME]);
+      json_int(w, src->volume);
+    }
+    if (field_on(&fields, SOURCE_DEFAULT)) {
+      json_key(w, source_fields[SOURCE_DEFAULT]);
+      json_bool(w, src->is_default);
+    }
+    if (field_on(&fields, SOURCE_SOURCE)) {
+      json_key(w, source_fields[SOURCE_SOURCE]);
+      json_string(w, src->name);
+    }
+    if (field_on(&fields, SOURCE_NAME)) {
+      json_key(w, source_fields[SOURCE_NAME]);
+      json_string(w, src->description);
+    }
+    if (field_on(&fields, SOURCE_ICON)) {
+      json_key(w, source_fields[SOURCE_ICON]);
+      json_string(w, src->icon);
+    }
+    if (field_on(&fields, SOURCE_STATE)) {
+      json_key(w, source_fields[SOURCE_STATE]);
+      json_string(w, state_to_string(src->state));
     }
-    printf("{\"id\":%u,", src->index);
-    printf("\"mute\":%s,", src->muted ? "true" : "false");
-    printf("\"volume\":%d,", src->volume);
-    printf("\"default\":%s,", src->is_default ? "true" : "false");
-    printf("\"source\":");
-    print_json_str(src->name);
-    printf(",");
-    printf("\"name\":");
-    print_json_str(src->description);
-    printf(",");
-    printf("\"icon\":");
-    print_json_str(src->icon);
-    printf(",");
-    printf("\"state\":");
-    print_json_str(state_to_string(src->state));
-    printf("}");
+    json_end_object(w);
   }
-  printf("]\n");
-  fflush(stdout);
+  json_end_array(w);
+
+  // A change confined to unselected fields leaves the document as it was
+  if (change_check(&app->changes, w->buf, w->len)) {
+    coalesce_line(app->coalescer, w->buf, w->len);
+  } else {
+    coalesce_suppressed(app->coalescer);
+  }
+  json_writer_reset(w);
 }
 
 // --- Source info callback: collects AudioSource array ---
-void source_info_cb(pa_context *c, const pa_source_info *i, int eol,
-                    void *userdata) {
+static void source_info_cb(pa_context *c, const pa_source_info *i, int eol,
+                           void *userdata) {
   (void)c; // suppress unused paramater warning
   AppContext *app = (AppContext *)userdata;
 
@@ -156,12 +204,18 @@ void source_info_cb(pa_context *c, const pa_source_info *i, int eol,
   AudioSource *src = &app->sources[app->source_count++];
   src->index = i->index;
   src->name = strdup(i->name ? i->name : "");
-  src->description = strdup(i->description ? i->description : "");
-  src->icon = strdup(
-      i->proplist ? pa_proplist_gets(i->proplist, "device.icon_name")
-                        ? pa_proplist_gets(i->proplist, "device.icon_name")
-                        : "audio-input-microphone"
-                  : "audio-input-microphone");
+  src->description = NULL;
+  src->icon = NULL;
+  if (field_on(&fields, SOURCE_NAME)) {
+    src->description = strdup(i->description ? i->description : "");
+  }
+  if (field_on(&fields, SOURCE_ICON)) {
+    src->icon = strdup(
+        i->proplist ? pa_proplist_gets(i->proplist, "device.icon_name")
+                          ? pa_proplist_gets(i->proplist, "device.icon_name")
+                          : "audio-input-microphone"
+                    : "audio-input-microphone");
+  }
   src->muted = i->mute;
   src->volume = (int)((pa_cvolume_avg(&i->volume) * 100) / PA_VOLUME_NORM);
   src->state = i->state;
@@ -170,7 +224,8 @@ void source_info_cb(pa_context *c, const pa_source_info *i, int eol,
 }
 
 // --- Server info callback: gets default source name ---
-void server_info_cb(pa_context *c, const pa_server_info *i, void *userdata) {
+static void server_info_cb(pa_context *c, const pa_server_info *i,
+                           void *userdata) {
   (void)c; // suppress unused paramater warning
   AppContext *app = (AppContext *)userdata;
   if (app->default_source) {
@@ -188,7 +243,7 @@ void server_info_cb(pa_context *c, const pa_server_info *i, void *userdata) {
 }
 
 // --- Ensure both server and source info are fresh after events ---
-void refresh_info(pa_context *c, AppContext *app) {
+static void refresh_info(pa_context *c, AppContext *app) {
   app->got_server_info = app->got_source_info = false;
   pa_operation *op1 = pa_context_get_server_info(c, server_info_cb, app);
   pa_operation *op2 = pa_context_get_source_info_list(c, source_info_cb, app);
@@ -201,22 +256,28 @@ void refresh_info(pa_context *c, AppContext *app) {
 }
 
 // --- Subscription callback: handle all relevant events ---
-void subscription_cb(pa_context *c, pa_subscription_event_type_t t,
-                     uint32_t idx, void *userdata) {
+static void subscription_cb(pa_context *c, pa_subscription_event_type_t t,
+                            uint32_t idx, void *userdata) {
   (void)idx; // suppress unused paramater warning
   AppContext *app = (AppContext *)userdata;
   pa_subscription_event_type_t fac = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
   if (fac == PA_SUBSCRIPTION_EVENT_SOURCE ||
       fac == PA_SUBSCRIPTION_EVENT_SERVER) {
+    stats_event(app->stats);
     refresh_info(c, app);
   }
 }
 
 // --- State callback: initial setup and reconnect handling ---
-void pa_state_cb(pa_context *c, void *userdata) {
+static void pa_state_cb(pa_context *c, void *userdata) {
   AppContext *app = (AppContext *)userdata;
   switch (pa_context_get_state(c)) {
   case PA_CONTEXT_READY: {
+    pulse_ready(&app->pulse);
+    // A list cut short by a lost connection is fetched anew
+    free_sources(app->sources, app->source_count);
+    app->sources = NULL;
+    app->source_count = 0;
     pa_context_set_subscribe_callback(c, subscription_cb, app);
     pa_operation *op = pa_context_subscribe(
         c, PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_SERVER, NULL,
@@ -229,50 +290,72 @@ void pa_state_cb(pa_context *c, void *userdata) {
   }
   case PA_CONTEXT_FAILED:
   case PA_CONTEXT_TERMINATED:
-    pa_mainloop_quit(app->pa_mainloop, 1);
+    pulse_lost(&app->pulse);
     break;
   default:
     break;
   }
 }
 
-int main(void) {
-  AppContext app = {0};
+static AppContext app = {0};
 
-  // Initialize PulseAudio
-  app.pa_mainloop = pa_mainloop_new();
-  if (!app.pa_mainloop) {
-    fprintf(stderr, "Failed to create PulseAudio mainloop\n");
+int audio_in_start(pa_mainloop_api *api, FILE *out) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  app.out = out;
+  app.stats = stats_stream("audio_in");
+  app.coalescer =
+      coalesce_new("audio_in", out, app.stats, COALESCE_DEFAULT_HZ);
+  app.pulse = (PulseConn){
+      .name = "AudioMonitor", .state_cb = pa_state_cb, .userdata = &app};
+  return pulse_connect(&app.pulse, api);
+}
+
+#ifndef NEWWBAR_HUB
+static void on_coalesce_ready(pa_mainloop_api *api, pa_io_event *e, int fd,
+                              pa_io_event_flags_t events, void *userdata) {
+  (void)api;      // suppress unused paramater warning
+  (void)e;        // suppress unused paramater warning
+  (void)fd;       // suppress unused paramater warning
+  (void)events;   // suppress unused paramater warning
+  (void)userdata; // suppress unused paramater warning
+  coalesce_dispatch();
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
     return 1;
   }
-  app.pa_context =
-      pa_context_new(pa_mainloop_get_api(app.pa_mainloop), "AudioMonitor");
-  if (!app.pa_context) {
-    fprintf(stderr, "Failed to create PulseAudio context\n");
-    pa_mainloop_free(app.pa_mainloop);
+  stats_init("audio_in");
+
+  // Initialize PulseAudio
+  pa_mainloop *mainloop = pa_mainloop_new();
+  if (!mainloop) {
+    fprintf(stderr, "Failed to create PulseAudio mainloop\n");
     return 1;
   }
 
   int ret = 0;
-  pa_context_set_state_callback(app.pa_context, pa_state_cb, &app);
-  if (pa_context_connect(app.pa_context, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
-    fprintf(stderr, "PulseAudio connect failed: %s\n",
-            pa_strerror(pa_context_errno(app.pa_context)));
+  pa_mainloop_api *api = pa_mainloop_get_api(mainloop);
+  if (audio_in_start(api, stdout) != 0) {
+    ret = 1;
     goto cleanup;
   }
+  // Trailing writes of the rate-capped output
+  api->io_new(api, coalesce_fd(), PA_IO_EVENT_INPUT, on_coalesce_ready, NULL);
 
-  if (pa_mainloop_run(app.pa_mainloop, &ret) < 0) {
+  if (pa_mainloop_run(mainloop, &ret) < 0) {
     ret = 1;
   }
 
 cleanup:
   free_sources(app.sources, app.source_count);
   free(app.default_source);
-  if (app.pa_context) {
-    pa_context_unref(app.pa_context);
-  }
-  if (app.pa_mainloop) {
-    pa_mainloop_free(app.pa_mainloop);
-  }
+  change_reset(&app.changes);
+  json_writer_free(&app.json);
+  pulse_free(&app.pulse);
+  pa_mainloop_free(mainloop);
   return ret;
 }
+#endif
@@ -38,214 +38,731 @@
  * ____________________________________________________________________________
  */
 
+#include "audio_out.h"
+#include "change.h"
+#include "coalesce.h"
+#include "control.h"
+#include "fields.h"
+#include "hub.h"
 #include "json.h"
+#include "pulse.h"
+#include "stats.h"
 #include <pulse/pulseaudio.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // Structure to hold sink information
 typedef struct {
-  int index;
+  uint32_t index;
   char *name;
   char *description;
   char *icon;
   bool muted;
   int volume;
-  bool is_default;
 } AudioSink;
 
 // Context for storing state, including synchronization flags
 typedef struct {
-  pa_mainloop *pa_mainloop;
-  pa_context *pa_context;
-  AudioSink *sinks;
+  PulseConn pulse;
+  AudioSink *sinks; // sorted by index, kept between events
   size_t sink_count;
+  size_t sink_cap;
   char *default_sink;
+  FILE *out;
+  JsonWriter json;
+  StatsStream *stats;
+  Coalescer *coalescer;
+  ChangeDetector changes;
   bool got_server_info;
   bool got_sink_info;
 } AppContext;
 
-// --- Memory management for AudioSink array ---
-void free_sinks(AudioSink *sinks, size_t count) {
+// JSON members of a sink, in output order
+enum {
+  SINK_INDEX,
+  SINK_MUTE,
+  SINK_VOLUME,
+  SINK_DEFAULT,
+  SINK_NAME,
+  SINK_DESCRIPTION,
+  SINK_ICON,
+};
+static const char *const sink_fields[] = {
+    "index", "isMute", "volume", "isDefault", "name", "description", "icon"};
+static FieldSet fields = FIELD_SET("audio_out", sink_fields);
+
+// --- Sink table ---
+//
+// The server sends the whole list once; after that each sink event fetches
+// just the sink it names and server events just the default sink, so a
+// volume drag costs one small reply per step instead of the full list.
+
+static void free_sink(AudioSink *sink) {
+  free(sink->name);
+  free(sink->description);
+  free(sink->icon);
+}
+
+static void free_sinks(AudioSink *sinks, size_t count) {
   if (!sinks) {
     return;
   }
   for (size_t i = 0; i < count; ++i) {
-    // free(sinks[i].index);
-    free(sinks[i].name);
-    free(sinks[i].description);
-    free(sinks[i].icon);
+    free_sink(&sinks[i]);
   }
   free(sinks);
 }
 
+// Position of index in the table, or where it would go
+static size_t sink_position(const AppContext *app, uint32_t index) {
+  size_t lo = 0, hi = app->sink_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (app->sinks[mid].index < index) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Keeps the old copy when the text is the same; returns true if it changed
+static bool set_string(char **slot, const char *value) {
+  if (*slot && strcmp(*slot, value) == 0) {
+    return false;
+  }
+  char *copy = strdup(value);
+  if (!copy) {
+    fprintf(stderr, "strdup failed\n");
+    exit(1);
+  }
+  free(*slot);
+  *slot = copy;
+  return true;
+}
+
+// Adds or updates a sink; returns true if anything shown changed
+static bool store_sink(AppContext *app, const pa_sink_info *i) {
+  size_t pos = sink_position(app, i->index);
+  bool added = pos == app->sink_count || app->sinks[pos].index != i->index;
+  if (added) {
+    if (app->sink_count == app->sink_cap) {
+      size_t cap = app->sink_cap ? app->sink_cap * 2 : 8;
+      AudioSink *tmp = realloc(app->sinks, cap * sizeof(AudioSink));
+      if (!tmp) {
+        fprintf(stderr, "realloc failed\n");
+        exit(1);
+      }
+      app->sinks = tmp;
+      app->sink_cap = cap;
+    }
+    memmove(&app->sinks[pos + 1], &app->sinks[pos],
+            (app->sink_count - pos) * sizeof(AudioSink));
+    app->sink_count++;
+    memset(&app->sinks[pos], 0, sizeof(AudioSink));
+    app->sinks[pos].index = i->index;
+  }
+  AudioSink *sink = &app->sinks[pos];
+
+  bool changed = added;
+  changed |= set_string(&sink->name, i->name ? i->name : "");
+  if (field_on(&fields, SINK_DESCRIPTION)) {
+    changed |=
+        set_string(&sink->description, i->description ? i->description : "");
+  }
+  if (field_on(&fields, SINK_ICON)) {
+    const char *icon =
+        i->proplist ? pa_proplist_gets(i->proplist, "device.icon_name") : NULL;
+    changed |= set_string(&sink->icon, icon ? icon : "audio-speakers");
+  }
+  double volume_percent =
+      ((double)pa_cvolume_avg(&i->volume) * 100) / PA_VOLUME_NORM;
+  int volume = (int)(volume_percent + 0.5);
+  bool muted = i->mute;
+  changed |= sink->volume != volume || sink->muted != muted;
+  sink->volume = volume;
+  sink->muted = muted;
+  return changed;
+}
+
+static bool remove_sink(AppContext *app, uint32_t index) {
+  size_t pos = sink_position(app, index);
+  if (pos == app->sink_count || app->sinks[pos].index != index) {
+    return false;
+  }
+  free_sink(&app->sinks[pos]);
+  memmove(&app->sinks[pos], &app->sinks[pos + 1],
+          (app->sink_count - pos - 1) * sizeof(AudioSink));
+  app->sink_count--;
+  return true;
+}
+
 // --- Print all sinks as JSON array ---
-void print_sinks(AppContext *app) {
-  printf("[");
+static void print_sinks(AppContext *app) {
+  JsonWriter *w = &app->json;
+  json_begin_array(w);
   for (size_t i = 0; i < app->sink_count; ++i) {
     AudioSink *sink = &app->sinks[i];
-    if (i) {
-      printf(",");
-    }
-    printf("{\"index\":%i", sink->index);
-    printf(",\"isMute\":%s", sink->muted ? "true" : "false");
-    printf(",\"volume\":%d", sink->volume);
-    printf(",\"isDefault\":%s", sink->is_default ? "true" : "false");
-    printf(",\"name\":");
-    print_json_str(sink->name);
-    printf(",\"description\":");
-    print_json_str(sink->description);
-    printf(",\"icon\":");
-    print_json_str(sink->icon);
-    printf("}");
-  }
-  printf("]\n");
-  fflush(stdout);
-}
-
-// --- Sink info callback: collects AudioSink array ---
-void sink_info_cb(pa_context *c, const pa_sink_info *i, int eol,
-                  void *userdata) {
+    json_begin_object(w);
+    if (field_on(&fields, SINK_INDEX)) {
+      json_key(w, sink_fields[SINK_INDEX]);
+      json_int(w, (int)sink->index);
+    }
+    if (field_on(&fields, SINK_MUTE)) {
+      json_key(w, sink_fields[SINK_MUTE]);
+      json_bool(w, sink->muted);
+    }
+    if (field_on(&fields, SINK_VOLUME)) {
+      json_key(w, sink_fields[SINK_VOLUME]);
+      json_int(w, sink->volume);
+    }
+    if (field_on(&fields, SINK_DEFAULT)) {
+      json_key(w, sink_fields[SINK_DEFAULT]);
+      json_bool(w, app->default_sink &&
+                       strcmp(sink->name, app->default_sink) == 0);
+    }
+    if (field_on(&fields, SINK_NAME)) {
+      json_key(w, sink_fields[SINK_NAME]);
+      json_string(w, sink->name);
+    }
+    if (field_on(&fields, SINK_DESCRIPTION)) {
+      json_key(w, sink_fields[SINK_DESCRIPTION]);
+      json_string(w, sink->description);
+    }
+    if (field_on(&fields, SINK_ICON)) {
+      json_key(w, sink_fields[SINK_ICON]);
+      json_string(w, sink->icon);
+    }
+    json_end_object(w);
+  }
+  json_end_array(w);
+
+  // A change confined to unselected fields leaves the document as it was
+  if (change_check(&app->changes, w->buf, w->len)) {
+    coalesce_line(app->coalescer, w->buf, w->len);
+  } else {
+    coalesce_suppressed(app->coalescer);
+  }
+  json_writer_reset(w);
+}
+
+// Prints once the first full list and server info are in
+static void sinks_changed(AppContext *app, bool changed) {
+  if (!app->got_server_info || !app->got_sink_info) {
+    return;
+  }
+  if (changed) {
+    print_sinks(app);
+  } else {
+    coalesce_suppressed(app->coalescer);
+  }
+}
+
+// --- Sink info callbacks: the first full list, then one sink at a time ---
+static void sink_list_cb(pa_context *c, const pa_sink_info *i, int eol,
+                         void *userdata) {
   (void)c; // suppress unused paramater warning
   AppContext *app = (AppContext *)userdata;
-
   if (eol) {
     app->got_sink_info = true;
-    if (app->got_server_info) {
-      print_sinks(app);
-      app->got_server_info = app->got_sink_info = false;
-    }
-    free_sinks(app->sinks, app->sink_count);
-    app->sinks = NULL;
-    app->sink_count = 0;
+    sinks_changed(app, true);
     return;
   }
+  store_sink(app, i);
+}
 
-  AudioSink *tmp =
-      realloc(app->sinks, (app->sink_count + 1) * sizeof(AudioSink));
-  if (!tmp) {
-    fprintf(stderr, "realloc failed\n");
-    exit(1);
+static void sink_info_cb(pa_context *c, const pa_sink_info *i, int eol,
+                         void *userdata) {
+  (void)c; // suppress unused paramater warning
+  AppContext *app = (AppContext *)userdata;
+  // eol < 0: the sink went away before the reply; its REMOVE event follows
+  if (eol) {
+    return;
   }
-  app->sinks = tmp;
-  AudioSink *sink = &app->sinks[app->sink_count++];
-
-  sink->index = i->index;
-  sink->name = strdup(i->name ? i->name : "");
-  sink->description = strdup(i->description ? i->description : "");
-  const char *icon =
-      i->proplist ? pa_proplist_gets(i->proplist, "device.icon_name") : NULL;
-  sink->icon = strdup(icon ? icon : "audio-speakers");
-  sink->muted = i->mute;
-  double volume_percent =
-      ((double)pa_cvolume_avg(&i->volume) * 100) / PA_VOLUME_NORM;
-  sink->volume = (int)(volume_percent + 0.5);
-  sink->is_default =
-      app->default_sink && strcmp(i->name, app->default_sink) == 0;
+  sinks_changed(app, store_sink(app, i));
 }
 
 // --- Server info callback for default sink ---
-void server_info_cb(pa_context *c, const pa_server_info *i, void *userdata) {
+static void server_info_cb(pa_context *c, const pa_server_info *i,
+                           void *userdata) {
   (void)c; // suppress unused paramater warning
   AppContext *app = (AppContext *)userdata;
-  if (app->default_sink) {
-    free(app->default_sink);
+  bool changed = set_string(
+      &app->default_sink, i->default_sink_name ? i->default_sink_name : "");
+  if (!app->got_server_info) {
+    app->got_server_info = changed = true;
   }
-  app->default_sink = strdup(i->default_sink_name ? i->default_sink_name : "");
-  app->got_server_info = true;
-  if (app->got_sink_info) {
-    print_sinks(app);
-    app->got_server_info = app->got_sink_info = false;
+  sinks_changed(app, changed);
+}
+
+static void query_server(pa_context *c, AppContext *app) {
+  pa_operation *op = pa_context_get_server_info(c, server_info_cb, app);
+  if (op) {
+    pa_operation_unref(op);
   }
 }
 
-// --- Ensure both server and sink info are fresh after events ---
-void refresh_info(pa_context *c, AppContext *app) {
-  app->got_server_info = app->got_sink_info = false;
-  pa_operation *op1 = pa_context_get_server_info(c, server_info_cb, app);
-  pa_operation *op2 = pa_context_get_sink_info_list(c, sink_info_cb, app);
-  if (op1) {
-    pa_operation_unref(op1);
+static void query_sink(pa_context *c, AppContext *app, uint32_t index) {
+  pa_operation *op =
+      pa_context_get_sink_info_by_index(c, index, sink_info_cb, app);
+  if (op) {
+    pa_operation_unref(op);
   }
-  if (op2) {
-    pa_operation_unref(op2);
+}
+
+// --- Full fetch on connect ---
+static void refresh_info(pa_context *c, AppContext *app) {
+  app->got_server_info = app->got_sink_info = false;
+  query_server(c, app);
+  pa_operation *op = pa_context_get_sink_info_list(c, sink_list_cb, app);
+  if (op) {
+    pa_operation_unref(op);
   }
 }
 
-// --- Subscription callback: handle all relevant events ---
-void subscription_cb(pa_context *c, pa_subscription_event_type_t t,
-                     uint32_t idx, void *userdata) {
-  (void)idx; // suppress unused paramater warning
+static const AudioPeer *peer = NULL; // audio_out_share()
+
+// --- Subscription callback: apply each event to the table ---
+static void subscription_cb(pa_context *c, pa_subscription_event_type_t t,
+                            uint32_t idx, void *userdata) {
   AppContext *app = (AppContext *)userdata;
+  if (peer && pa_subscription_match_flags(peer->mask, t)) {
+    peer->event(c, t, idx, peer->userdata);
+  }
+  if (!app->out) {
+    return; // shared with a peer only, audio_out itself not started
+  }
   pa_subscription_event_type_t fac = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
-  if (fac == PA_SUBSCRIPTION_EVENT_SINK ||
-      fac == PA_SUBSCRIPTION_EVENT_SERVER) {
-    refresh_info(c, app);
+  pa_subscription_event_type_t type = t & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+  if (fac == PA_SUBSCRIPTION_EVENT_SINK) {
+    stats_event(app->stats);
+    if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+      sinks_changed(app, remove_sink(app, idx));
+    } else {
+      query_sink(c, app, idx);
+    }
+  } else if (fac == PA_SUBSCRIPTION_EVENT_SERVER) {
+    stats_event(app->stats);
+    query_server(c, app);
   }
 }
 
+static void control_serve(bool on);
+
 // --- State callback: initial setup and reconnect handling ---
-void pa_state_cb(pa_context *c, void *userdata) {
+static void pa_state_cb(pa_context *c, void *userdata) {
   AppContext *app = (AppContext *)userdata;
   switch (pa_context_get_state(c)) {
   case PA_CONTEXT_READY: {
+    pulse_ready(&app->pulse);
+    // Indexes are the server's; after a reconnect they are all fetched anew
+    free_sinks(app->sinks, app->sink_count);
+    app->sinks = NULL;
+    app->sink_count = app->sink_cap = 0;
+    pa_subscription_mask_t mask =
+        app->out ? PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SERVER
+                 : PA_SUBSCRIPTION_MASK_NULL;
     pa_context_set_subscribe_callback(c, subscription_cb, app);
     pa_operation *op = pa_context_subscribe(
-        c, PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SERVER, NULL, NULL);
+        c, mask | (peer ? peer->mask : PA_SUBSCRIPTION_MASK_NULL), NULL, NULL);
     if (op) {
       pa_operation_unref(op);
     }
-    refresh_info(c, app);
+    if (app->out) {
+      refresh_info(c, app);
+    }
+    if (peer) {
+      peer->ready(c, peer->userdata);
+    }
+    control_serve(app->out != NULL);
     break;
   }
   case PA_CONTEXT_FAILED:
   case PA_CONTEXT_TERMINATED:
-    pa_mainloop_quit(app->pa_mainloop, 1);
+    control_serve(false);
+    pulse_lost(&app->pulse);
     break;
   default:
     break;
   }
 }
 
-int main(void) {
-  AppContext app = {0};
+static AppContext app = {0};
 
-  // Initialize PulseAudio
-  app.pa_mainloop = pa_mainloop_new();
-  if (!app.pa_mainloop) {
-    fprintf(stderr, "Failed to create PulseAudio mainloop\n");
+// --- Control socket ---
+//
+// audio-control.sock (control.h) runs pactl-style commands on this context.
+// Volumes are latest-wins: each target has at most one operation in flight
+// and keeps only the newest value that arrived meanwhile, so a slider drag
+// costs a handful of round trips rather than one process per tick. The
+// socket is served only while the context is READY; otherwise sending to it
+// fails and newwbar-ctl runs pactl instead.
+
+typedef struct ControlTarget ControlTarget;
+
+// Reply to a lookup: eol as in the info callbacks, info only when eol is 0
+typedef void (*TargetFoundFn)(ControlTarget *t, int eol,
+                              const pa_cvolume *volume, bool mute);
+
+struct ControlTarget {
+  AudioTarget target;
+  char *name; // sink or source
+  uint32_t index;
+  TargetFoundFn found;
+};
+
+typedef struct {
+  ControlTarget t;
+  int pending;      // newest percent not yet sent, -1 if none
+  uint8_t channels; // of the target's volume, 0 until looked up
+  bool busy;        // lookup or set in flight
+} VolumeSlot;
+
+static VolumeSlot **volume_slots;
+static size_t volume_slot_count;
+static size_t volume_slot_cap;
+static int control_fd = -1;
+static pa_io_event *control_event;
+
+static void sink_found(pa_context *c, const pa_sink_info *i, int eol,
+                       void *userdata) {
+  (void)c; // suppress unused paramater warning
+  ControlTarget *t = userdata;
+  t->found(t, eol, eol ? NULL : &i->volume, !eol && i->mute);
+}
+
+static void source_found(pa_context *c, const pa_source_info *i, int eol,
+                         void *userdata) {
+  (void)c; // suppress unused paramater warning
+  ControlTarget *t = userdata;
+  t->found(t, eol, eol ? NULL : &i->volume, !eol && i->mute);
+}
+
+static void input_found(pa_context *c, const pa_sink_input_info *i, int eol,
+                        void *userdata) {
+  (void)c; // suppress unused paramater warning
+  ControlTarget *t = userdata;
+  t->found(t, eol, eol ? NULL : &i->volume, !eol && i->mute);
+}
+
+static void lookup(pa_context *c, ControlTarget *t) {
+  pa_operation *op = NULL;
+  switch (t->target) {
+  case AUDIO_SINK:
+    op = pa_context_get_sink_info_by_name(c, t->name, sink_found, t);
+    break;
+  case AUDIO_SOURCE:
+    op = pa_context_get_source_info_by_name(c, t->name, source_found, t);
+    break;
+  case AUDIO_SINK_INPUT:
+    op = pa_context_get_sink_input_info(c, t->index, input_found, t);
+    break;
+  }
+  if (op) {
+    pa_operation_unref(op);
+  } else {
+    t->found(t, -1, NULL, false);
+  }
+}
+
+static void set_mute(pa_context *c, const ControlTarget *t, bool mute) {
+  pa_operation *op = NULL;
+  switch (t->target) {
+  case AUDIO_SINK:
+    op = pa_context_set_sink_mute_by_name(c, t->name, mute, NULL, NULL);
+    break;
+  case AUDIO_SOURCE:
+    op = pa_context_set_source_mute_by_name(c, t->name, mute, NULL, NULL);
+    break;
+  case AUDIO_SINK_INPUT:
+    op = pa_context_set_sink_input_mute(c, t->index, mute, NULL, NULL);
+    break;
+  }
+  if (op) {
+    pa_operation_unref(op);
+  }
+}
+
+// A toggle needs the current state first; the end of the reply, or its
+// failure, is the last callback and frees the request
+static void mute_found(ControlTarget *t, int eol, const pa_cvolume *volume,
+                       bool mute) {
+  (void)volume; // suppress unused paramater warning
+  if (eol == 0) {
+    set_mute(app.pulse.context, t, !mute);
+    return;
+  }
+  free(t->name);
+  free(t);
+}
+
+static void volume_next(VolumeSlot *slot);
+
+static void volume_done(pa_context *c, int success, void *userdata) {
+  (void)c; // suppress unused paramater warning
+  VolumeSlot *slot = userdata;
+  if (!success) {
+    slot->channels = 0; // look the target up again next time
+  }
+  slot->busy = false;
+  volume_next(slot);
+}
+
+static void volume_found(ControlTarget *t, int eol, const pa_cvolume *volume,
+                         bool mute) {
+  (void)mute; // suppress unused paramater warning
+  VolumeSlot *slot = (VolumeSlot *)t;
+  if (eol > 0) {
+    return;
+  }
+  slot->busy = false;
+  if (eol < 0 || volume->channels == 0) {
+    slot->pending = -1; // gone; drop what was queued for it
+    return;
+  }
+  slot->channels = volume->channels;
+  volume_next(slot);
+}
+
+// Sends the newest pending volume, once nothing is in flight
+static void volume_next(VolumeSlot *slot) {
+  if (slot->busy || slot->pending < 0) {
+    return;
+  }
+  slot->busy = true;
+  pa_context *c = app.pulse.context;
+  if (!slot->channels) {
+    lookup(c, &slot->t);
+    return;
+  }
+  // Every channel at the same level, as pactl does
+  pa_cvolume volume;
+  pa_cvolume_set(&volume, slot->channels,
+                 (pa_volume_t)((uint64_t)slot->pending * PA_VOLUME_NORM / 100));
+  slot->pending = -1;
+  pa_operation *op = NULL;
+  switch (slot->t.target) {
+  case AUDIO_SINK:
+    op = pa_context_set_sink_volume_by_name(c, slot->t.name, &volume,
+                                            volume_done, slot);
+    break;
+  case AUDIO_SOURCE:
+    op = pa_context_set_source_volume_by_name(c, slot->t.name, &volume,
+                                              volume_done, slot);
+    break;
+  case AUDIO_SINK_INPUT:
+    op = pa_context_set_sink_input_volume(c, slot->t.index, &volume,
+                                          volume_done, slot);
+    break;
+  }
+  if (op) {
+    pa_operation_unref(op);
+  } else {
+    slot->busy = false;
+  }
+}
+
+// Slots live until exit; there is one per device or stream ever adjusted
+static VolumeSlot *volume_slot(const AudioCommand *cmd) {
+  for (size_t i = 0; i < volume_slot_count; i++) {
+    VolumeSlot *slot = volume_slots[i];
+    bool same = cmd->target == AUDIO_SINK_INPUT
+                    ? slot->t.index == cmd->index
+                    : strcmp(slot->t.name, cmd->name) == 0;
+    if (slot->t.target == cmd->target && same) {
+      return slot;
+    }
+  }
+  if (volume_slot_count == volume_slot_cap) {
+    size_t cap = volume_slot_cap ? volume_slot_cap * 2 : 8;
+    VolumeSlot **grown = realloc(volume_slots, cap * sizeof(*grown));
+    if (!grown) {
+      return NULL;
+    }
+    volume_slots = grown;
+    volume_slot_cap = cap;
+  }
+  VolumeSlot *slot = calloc(1, sizeof(*slot));
+  if (!slot || !(slot->t.name = strdup(cmd->name))) {
+    free(slot);
+    return NULL;
+  }
+  slot->t.target = cmd->target;
+  slot->t.index = cmd->index;
+  slot->t.found = volume_found;
+  slot->pending = -1;
+  volume_slots[volume_slot_count++] = slot;
+  return slot;
+}
+
+static void run_command(pa_context *c, const AudioCommand *cmd) {
+  pa_operation *op = NULL;
+  switch (cmd->action) {
+  case AUDIO_SET_VOLUME: {
+    VolumeSlot *slot = volume_slot(cmd);
+    if (slot) {
+      slot->pending = cmd->value;
+      volume_next(slot);
+    }
+    return;
+  }
+  case AUDIO_SET_MUTE: {
+    ControlTarget t = {cmd->target, (char *)cmd->name, cmd->index, NULL};
+    if (cmd->value >= 0) {
+      set_mute(c, &t, cmd->value);
+      return;
+    }
+    ControlTarget *toggle = malloc(sizeof(*toggle));
+    if (toggle && (t.name = strdup(cmd->name))) {
+      t.found = mute_found;
+      *toggle = t;
+      lookup(c, toggle);
+    } else {
+      free(toggle);
+    }
+    return;
+  }
+  case AUDIO_SET_DEFAULT:
+    op = cmd->target == AUDIO_SINK
+             ? pa_context_set_default_sink(c, cmd->name, NULL, NULL)
+             : pa_context_set_default_source(c, cmd->name, NULL, NULL);
+    break;
+  case AUDIO_MOVE:
+    op = pa_context_move_sink_input_by_name(c, cmd->index, cmd->sink, NULL,
+                                            NULL);
+    break;
+  }
+  if (op) {
+    pa_operation_unref(op);
+  }
+}
+
+// Everything queued is read before anything is sent, so a burst of slider
+// ticks leaves just its last value pending
+static void on_control_ready(pa_mainloop_api *api, pa_io_event *e, int fd,
+                             pa_io_event_flags_t events, void *userdata) {
+  (void)api;    // suppress unused paramater warning
+  (void)e;      // suppress unused paramater warning
+  (void)events;   // suppress unused paramater warning
+  (void)userdata; // suppress unused paramater warning
+  char command[AUDIO_CONTROL_MAX];
+  AudioCommand cmd;
+  for (;;) {
+    ssize_t n = recv(fd, command, sizeof(command), MSG_TRUNC);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      break; // EAGAIN: drained
+    }
+    if (audio_command_parse(command, (size_t)n, &cmd) == 0) {
+      run_command(app.pulse.context, &cmd);
+    }
+  }
+}
+
+// Operations of a lost context never call back, so nothing stays in flight
+// once it is closed; the next context looks every target up again. Only the
+// first audio_out takes commands; a second one just prints.
+static void control_serve(bool on) {
+  pa_mainloop_api *api = app.pulse.api;
+  if (on && control_fd < 0) {
+    control_fd = control_bind(AUDIO_CONTROL_SOCKET);
+    if (control_fd >= 0) {
+      control_event = api->io_new(api, control_fd, PA_IO_EVENT_INPUT,
+                                  on_control_ready, NULL);
+    }
+  } else if (!on && control_fd >= 0) {
+    api->io_free(control_event);
+    close(control_fd);
+    control_fd = -1;
+    for (size_t i = 0; i < volume_slot_count; i++) {
+      volume_slots[i]->busy = false;
+      volume_slots[i]->channels = 0;
+    }
+  }
+}
+
+static int connect_context(pa_mainloop_api *api) {
+  if (app.pulse.api) {
+    return 0;
+  }
+  app.pulse = (PulseConn){
+      .name = "SinkMonitor", .state_cb = pa_state_cb, .userdata = &app};
+  return pulse_connect(&app.pulse, api);
+}
+
+int audio_out_share(pa_mainloop_api *api, const AudioPeer *shared) {
+  peer = shared;
+  return connect_context(api);
+}
+
+int audio_out_start(pa_mainloop_api *api, FILE *out) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  app.out = out;
+  app.stats = stats_stream("audio_out");
+  app.coalescer =
+      coalesce_new("audio_out", out, app.stats, COALESCE_DEFAULT_HZ);
+  return connect_context(api);
+}
+
+#ifndef NEWWBAR_HUB
+static void on_coalesce_ready(pa_mainloop_api *api, pa_io_event *e, int fd,
+                              pa_io_event_flags_t events, void *userdata) {
+  (void)api;      // suppress unused paramater warning
+  (void)e;        // suppress unused paramater warning
+  (void)fd;       // suppress unused paramater warning
+  (void)events;   // suppress unused paramater warning
+  (void)userdata; // suppress unused paramater warning
+  coalesce_dispatch();
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
     return 1;
   }
-  app.pa_context =
-      pa_context_new(pa_mainloop_get_api(app.pa_mainloop), "SinkMonitor");
-  if (!app.pa_context) {
-    fprintf(stderr, "Failed to create PulseAudio context\n");
-    pa_mainloop_free(app.pa_mainloop);
+  stats_init("audio_out");
+
+  // Initialize PulseAudio
+  pa_mainloop *mainloop = pa_mainloop_new();
+  if (!mainloop) {
+    fprintf(stderr, "Failed to create PulseAudio mainloop\n");
     return 1;
   }
 
   int ret = 0;
-  pa_context_set_state_callback(app.pa_context, pa_state_cb, &app);
-  if (pa_context_connect(app.pa_context, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
-    fprintf(stderr, "PulseAudio connect failed: %s\n",
-            pa_strerror(pa_context_errno(app.pa_context)));
+  pa_mainloop_api *api = pa_mainloop_get_api(mainloop);
+  if (audio_out_start(api, stdout) != 0) {
+    ret = 1;
     goto cleanup;
   }
+  // Trailing writes of the rate-capped output
+  api->io_new(api, coalesce_fd(), PA_IO_EVENT_INPUT, on_coalesce_ready, NULL);
 
-  if (pa_mainloop_run(app.pa_mainloop, &ret) < 0) {
+  if (pa_mainloop_run(mainloop, &ret) < 0) {
     ret = 1;
   }
 
 cleanup:
+  for (size_t i = 0; i < volume_slot_count; i++) {
+    free(volume_slots[i]->t.name);
+    free(volume_slots[i]);
+  }
+  free(volume_slots);
   free_sinks(app.sinks, app.sink_count);
   free(app.default_sink);
-  if (app.pa_context) {
-    pa_context_unref(app.pa_context);
-  }
-  if (app.pa_mainloop) {
-    pa_mainloop_free(app.pa_mainloop);
-  }
+  change_reset(&app.changes);
+  json_writer_free(&app.json);
+  pulse_free(&app.pulse);
+  pa_mainloop_free(mainloop);
   return ret;
 }
+#endif
@@ -0,0 +1,22 @@
+#ifndef AUDIO_OUT_SEEN
+#define AUDIO_OUT_SEEN
+
+#include <pulse/pulseaudio.h>
+
+/* audio_out's PulseAudio context, shared in the hub so that audio_peak's
+ * record streams ride on it instead of a connection of their own. ready
+ * runs each time the context connects; the subscription events matching
+ * mask are passed on to event. The context is connected by whichever of
+ * audio_out_start() and audio_out_share() comes first, so the peer works
+ * without audio_out's own module. One peer, registered before the mainloop
+ * runs. */
+typedef struct {
+  pa_subscription_mask_t mask;
+  void (*ready)(pa_context *c, void *userdata);
+  pa_context_subscribe_cb_t event;
+  void *userdata;
+} AudioPeer;
+
+int audio_out_share(pa_mainloop_api *api, const AudioPeer *peer);
+
+#endif
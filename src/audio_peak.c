@@ -0,0 +1,423 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "audio_out.h"
+#include "change.h"
+#include "coalesce.h"
+#include "hub.h"
+#include "json.h"
+#include "pulse.h"
+#include "peak.h"
+#include "stats.h"
+#include <pulse/pulseaudio.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    fprintf(stderr, fmt "\n", ##__VA_ARGS__);                                  \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+/* Live levels for every sink (through its monitor source) and every real
+ * source: {"sinks": {"<sink name>": 35}, "sources": {"<source name>": 0}},
+ * levels 0-100 in NEWWBAR_PEAK_STEPS steps (default 20), at most
+ * NEWWBAR_PEAK_HZ updates a second (default 20). The record streams ask the
+ * server for peaks only (PA_STREAM_PEAK_DETECT) at PEAK_RATE samples a
+ * second, delivered one update's worth per fragment, so a meter costs hz
+ * wakeups a second rather than a stream of audio. */
+
+typedef struct AppContext AppContext;
+
+typedef struct {
+  AppContext *app;
+  bool is_sink;
+  uint32_t index;
+  char *name; // sink or source name the level is reported under
+  pa_stream *stream;
+  PeakMeter peak;
+} Meter;
+
+struct AppContext {
+  PulseConn pulse;       // standalone only; the hub shares audio_out's
+  pa_context *pa_context; // the one the meters record on
+  Meter **meters; // allocated one by one; streams keep a pointer
+  size_t meter_count;
+  size_t meter_cap;
+  unsigned int hz;
+  unsigned int steps;
+  FILE *out;
+  JsonWriter json;
+  StatsStream *stats;
+  Coalescer *coalescer;
+  ChangeDetector changes;
+};
+
+static unsigned int env_uint(const char *key, unsigned int fallback) {
+  const char *value = getenv(key);
+  if (value && *value) {
+    char *end;
+    unsigned long n = strtoul(value, &end, 10);
+    if (*end == '\0' && n > 0) {
+      return (unsigned int)n;
+    }
+  }
+  return fallback;
+}
+
+// --- Output ---
+
+static void print_kind(AppContext *app, const char *key, bool sinks) {
+  JsonWriter *w = &app->json;
+  json_key(w, key);
+  json_begin_object(w);
+  for (size_t i = 0; i < app->meter_count; i++) {
+    Meter *meter = app->meters[i];
+    if (meter->is_sink == sinks) {
+      json_key(w, meter->name);
+      json_int(w, peak_percent(&meter->peak));
+    }
+  }
+  json_end_object(w);
+}
+
+static void print_levels(AppContext *app) {
+  JsonWriter *w = &app->json;
+  json_begin_object(w);
+  print_kind(app, "sinks", true);
+  print_kind(app, "sources", false);
+  json_end_object(w);
+
+  if (change_check(&app->changes, w->buf, w->len)) {
+    coalesce_line(app->coalescer, w->buf, w->len);
+  } else {
+    coalesce_suppressed(app->coalescer);
+  }
+  json_writer_reset(w);
+}
+
+// --- Meters ---
+
+static void read_cb(pa_stream *s, size_t nbytes, void *userdata) {
+  (void)nbytes; // suppress unused paramater warning
+  Meter *meter = userdata;
+  const void *data;
+  size_t len;
+  if (pa_stream_peek(s, &data, &len) < 0 || len == 0) {
+    return;
+  }
+  stats_event(meter->app->stats);
+  // No data with a length is a hole in the stream; it is dropped all the same
+  bool changed =
+      data && peak_feed(&meter->peak, data, len / sizeof(float));
+  pa_stream_drop(s);
+  if (changed) {
+    print_levels(meter->app);
+  } else {
+    coalesce_suppressed(meter->app->coalescer);
+  }
+}
+
+static size_t find_meter(const AppContext *app, bool is_sink, uint32_t index) {
+  size_t i = 0;
+  while (i < app->meter_count && (app->meters[i]->is_sink != is_sink ||
+                                  app->meters[i]->index != index)) {
+    i++;
+  }
+  return i;
+}
+
+static void free_meter(Meter *meter) {
+  if (meter->stream) {
+    pa_stream_set_state_callback(meter->stream, NULL, NULL);
+    pa_stream_set_read_callback(meter->stream, NULL, NULL);
+    pa_stream_disconnect(meter->stream);
+    pa_stream_unref(meter->stream);
+  }
+  free(meter->name);
+  free(meter);
+}
+
+static void close_meter(AppContext *app, bool is_sink, uint32_t index);
+
+// A stream the server failed or ended, as when its device went away or
+// refused the connect, is dropped rather than left at its last level
+static void stream_state_cb(pa_stream *s, void *userdata) {
+  Meter *meter = userdata;
+  pa_stream_state_t state = pa_stream_get_state(s);
+  if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) {
+    DEBUG_MSG("%s: stream ended", meter->name);
+    close_meter(meter->app, meter->is_sink, meter->index);
+  }
+}
+
+static void open_meter(AppContext *app, bool is_sink, uint32_t index,
+                       const char *name, const char *device) {
+  if (!name || !device || find_meter(app, is_sink, index) < app->meter_count) {
+    return;
+  }
+  if (app->meter_count == app->meter_cap) {
+    size_t cap = app->meter_cap ? app->meter_cap * 2 : 8;
+    Meter **grown = realloc(app->meters, cap * sizeof(*grown));
+    if (!grown) {
+      return;
+    }
+    app->meters = grown;
+    app->meter_cap = cap;
+  }
+  Meter *meter = calloc(1, sizeof(*meter));
+  if (!meter || !(meter->name = strdup(name))) {
+    free(meter);
+    return;
+  }
+  meter->app = app;
+  meter->is_sink = is_sink;
+  meter->index = index;
+  peak_init(&meter->peak, app->hz, app->steps);
+
+  pa_sample_spec spec = {
+      .format = PA_SAMPLE_FLOAT32, .rate = PEAK_RATE, .channels = 1};
+  pa_buffer_attr attr;
+  memset(&attr, 0xff, sizeof(attr)); // (uint32_t)-1: server default
+  attr.fragsize = sizeof(float) * meter->peak.window;
+  meter->stream = pa_stream_new(app->pa_context, "Peak meter", &spec, NULL);
+  if (!meter->stream) {
+    free_meter(meter);
+    return;
+  }
+  pa_stream_set_state_callback(meter->stream, stream_state_cb, meter);
+  pa_stream_set_read_callback(meter->stream, read_cb, meter);
+  // The meter follows its device and never keeps an idle one awake
+  if (pa_stream_connect_record(meter->stream, device, &attr,
+                               PA_STREAM_PEAK_DETECT |
+                                   PA_STREAM_ADJUST_LATENCY |
+                                   PA_STREAM_DONT_MOVE |
+                                   PA_STREAM_DONT_INHIBIT_AUTO_SUSPEND) < 0) {
+    DEBUG_MSG("%s: record failed: %s", name,
+              pa_strerror(pa_context_errno(app->pa_context)));
+    free_meter(meter);
+    return;
+  }
+  DEBUG_MSG("metering %s", device);
+  app->meters[app->meter_count++] = meter;
+}
+
+static void close_meter(AppContext *app, bool is_sink, uint32_t index) {
+  size_t i = find_meter(app, is_sink, index);
+  if (i == app->meter_count) {
+    return;
+  }
+  free_meter(app->meters[i]);
+  memmove(&app->meters[i], &app->meters[i + 1],
+          (app->meter_count - i - 1) * sizeof(*app->meters));
+  app->meter_count--;
+  print_levels(app);
+}
+
+// Streams of a lost context are dead; a new one records on fresh ones
+static void close_meters(AppContext *app) {
+  for (size_t i = 0; i < app->meter_count; i++) {
+    free_meter(app->meters[i]);
+  }
+  app->meter_count = 0;
+}
+
+// --- Device callbacks: one meter per sink monitor and real source ---
+//
+// New meters are printed once their reply is complete, at 0 until the first
+// window closes
+static void sink_info_cb(pa_context *c, const pa_sink_info *i, int eol,
+                         void *userdata) {
+  (void)c; // suppress unused paramater warning
+  if (eol > 0) {
+    print_levels(userdata);
+  } else if (!eol) {
+    open_meter(userdata, true, i->index, i->name, i->monitor_source_name);
+  }
+}
+
+static void source_info_cb(pa_context *c, const pa_source_info *i, int eol,
+                           void *userdata) {
+  (void)c; // suppress unused paramater warning
+  if (eol > 0) {
+    print_levels(userdata);
+  } else if (!eol && i->monitor_of_sink == PA_INVALID_INDEX) {
+    // Monitor sources are already metered as their sink
+    open_meter(userdata, false, i->index, i->name, i->name);
+  }
+}
+
+// --- Subscription callback: follow devices coming and going ---
+static void subscription_cb(pa_context *c, pa_subscription_event_type_t t,
+                            uint32_t idx, void *userdata) {
+  AppContext *app = (AppContext *)userdata;
+  pa_subscription_event_type_t fac = t & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+  pa_subscription_event_type_t type = t & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+  bool is_sink = fac == PA_SUBSCRIPTION_EVENT_SINK;
+  if (!is_sink && fac != PA_SUBSCRIPTION_EVENT_SOURCE) {
+    return;
+  }
+  if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+    close_meter(app, is_sink, idx);
+  } else if (type == PA_SUBSCRIPTION_EVENT_NEW) {
+    pa_operation *op =
+        is_sink ? pa_context_get_sink_info_by_index(c, idx, sink_info_cb, app)
+                : pa_context_get_source_info_by_index(c, idx, source_info_cb,
+                                                      app);
+    if (op) {
+      pa_operation_unref(op);
+    }
+  }
+}
+
+// --- Connected: meter every device there is ---
+static void on_ready(pa_context *c, void *userdata) {
+  AppContext *app = (AppContext *)userdata;
+  close_meters(app);
+  app->pa_context = c;
+  pa_operation *op = pa_context_get_sink_info_list(c, sink_info_cb, app);
+  if (op) {
+    pa_operation_unref(op);
+  }
+  op = pa_context_get_source_info_list(c, source_info_cb, app);
+  if (op) {
+    pa_operation_unref(op);
+  }
+}
+
+static AppContext app = {0};
+
+#ifdef NEWWBAR_HUB
+// The hub already holds audio_out's connection; the streams go on that
+static const AudioPeer peer = {
+    PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE, on_ready,
+    subscription_cb, &app};
+#else
+// --- State callback: initial setup ---
+static void pa_state_cb(pa_context *c, void *userdata) {
+  AppContext *app = (AppContext *)userdata;
+  switch (pa_context_get_state(c)) {
+  case PA_CONTEXT_READY: {
+    pulse_ready(&app->pulse);
+    pa_context_set_subscribe_callback(c, subscription_cb, app);
+    pa_operation *op = pa_context_subscribe(
+        c, PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE, NULL,
+        NULL);
+    if (op) {
+      pa_operation_unref(op);
+    }
+    on_ready(c, app);
+    break;
+  }
+  case PA_CONTEXT_FAILED:
+  case PA_CONTEXT_TERMINATED:
+    pulse_lost(&app->pulse);
+    break;
+  default:
+    break;
+  }
+}
+#endif
+
+int audio_peak_start(pa_mainloop_api *api, FILE *out) {
+  app.out = out;
+  app.hz = env_uint("NEWWBAR_PEAK_HZ", PEAK_DEFAULT_HZ);
+  app.steps = env_uint("NEWWBAR_PEAK_STEPS", PEAK_DEFAULT_STEPS);
+  app.stats = stats_stream("audio_peak");
+  app.coalescer = coalesce_new("audio_peak", out, app.stats, app.hz);
+#ifdef NEWWBAR_HUB
+  return audio_out_share(api, &peer);
+#else
+  app.pulse = (PulseConn){
+      .name = "PeakMeter", .state_cb = pa_state_cb, .userdata = &app};
+  return pulse_connect(&app.pulse, api);
+#endif
+}
+
+#ifndef NEWWBAR_HUB
+static void on_coalesce_ready(pa_mainloop_api *api, pa_io_event *e, int fd,
+                              pa_io_event_flags_t events, void *userdata) {
+  (void)api;      // suppress unused paramater warning
+  (void)e;        // suppress unused paramater warning
+  (void)fd;       // suppress unused paramater warning
+  (void)events;   // suppress unused paramater warning
+  (void)userdata; // suppress unused paramater warning
+  coalesce_dispatch();
+}
+
+int main(void) {
+  stats_init("audio_peak");
+
+  pa_mainloop *mainloop = pa_mainloop_new();
+  if (!mainloop) {
+    fprintf(stderr, "Failed to create PulseAudio mainloop\n");
+    return 1;
+  }
+
+  int ret = 0;
+  pa_mainloop_api *api = pa_mainloop_get_api(mainloop);
+  if (audio_peak_start(api, stdout) != 0) {
+    ret = 1;
+    goto cleanup;
+  }
+  // Trailing writes of the rate-capped output
+  api->io_new(api, coalesce_fd(), PA_IO_EVENT_INPUT, on_coalesce_ready, NULL);
+
+  if (pa_mainloop_run(mainloop, &ret) < 0) {
+    ret = 1;
+  }
+
+cleanup:
+  close_meters(&app);
+  free(app.meters);
+  change_reset(&app.changes);
+  json_writer_free(&app.json);
+  pulse_free(&app.pulse);
+  pa_mainloop_free(mainloop);
+  return ret;
+}
+#endif
@@ -38,10 +38,16 @@
  * ____________________________________________________________________________
  */
 
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "stats.h"
 #include <gio/gio.h>
+#include <glib-unix.h>
 #include <glib.h>
 #include <json-glib/json-glib.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifdef DEBUG
 #define DEBUG_MSG(fmt, ...)                                                    \
@@ -60,11 +66,16 @@
 #define ADAPTER_INTERFACE "org.bluez.Adapter1"
 #define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
 
-// Properties to monitor
-static const char *properties[] = {
+// Properties to monitor, printed under the same names
+static const char *const properties[] = {
     "Powered", "Pairable", "Discovering", "Discoverable"
     // Note: Connectable is not a standard BlueZ Adapter1 property; omitted
 };
+static FieldSet fields = FIELD_SET("bluetooth_adapter", properties);
+
+static FILE *out;
+static StatsStream *stats;
+static Coalescer *coalescer;
 
 // Function to add a variant to JSON builder
 static void variant_to_json(JsonBuilder *builder, const char *prop_name,
@@ -89,6 +100,9 @@ static void create_json_from_properties(GDBusProxy *proxy) {
   json_builder_begin_object(builder);
 
   for (guint i = 0; i < G_N_ELEMENTS(properties); i++) {
+    if (!field_on(&fields, i)) {
+      continue;
+    }
     const char *prop = properties[i];
     GError *error = NULL;
     GVariant *result = g_dbus_proxy_call_sync(
@@ -118,9 +132,8 @@ static void create_json_from_properties(GDBusProxy *proxy) {
   json_generator_set_pretty(generator, FALSE); // Single-line output
   gchar *json_str = json_generator_to_data(generator, NULL);
 
-  // Output JSON as a single line with newline
-  printf("%s\n", json_str);
-  fflush(stdout); // Ensure immediate write to stdout
+  // Output JSON as a single line, at most COALESCE_DEFAULT_HZ times a second
+  coalesce_line(coalescer, json_str, strlen(json_str));
 
   g_free(json_str);
   json_node_free(root);
@@ -156,7 +169,8 @@ static void on_properties_changed(GDBusConnection *connection,
   while (g_variant_iter_next(changed_properties, "{&sv}", &property_name,
                              &property_value)) {
     for (guint i = 0; i < G_N_ELEMENTS(properties); i++) {
-      if (g_strcmp0(property_name, properties[i]) == 0) {
+      if (field_on(&fields, i) &&
+          g_strcmp0(property_name, properties[i]) == 0) {
         relevant_change = TRUE;
         break;
       }
@@ -168,6 +182,7 @@ static void on_properties_changed(GDBusConnection *connection,
   g_variant_iter_free(invalidated_properties);
 
   if (relevant_change) {
+    stats_event(stats);
     create_json_from_properties(proxy);
   }
 }
@@ -186,9 +201,14 @@ static gboolean check_adapter_exists(GDBusConnection *conn, GError **error) {
   return FALSE;
 }
 
-int main(void) {
-  DEBUG_MSG("DEBUG enabled");
-  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+int bluetooth_adapter_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("bluetooth_adapter");
+  coalescer =
+      coalesce_new("bluetooth_adapter", out, stats, COALESCE_DEFAULT_HZ);
   GError *error = NULL;
 
   // Connect to the system bus
@@ -222,7 +242,8 @@ int main(void) {
     return 1;
   }
 
-  // Subscribe to PropertiesChanged signal
+  // Subscribe to PropertiesChanged signal; the proxy and connection live as
+  // long as the main loop does
   g_dbus_connection_signal_subscribe(
       conn, BLUEZ_SERVICE_NAME, PROPERTIES_INTERFACE, "PropertiesChanged",
       ADAPTER_OBJECT_PATH, ADAPTER_INTERFACE, G_DBUS_SIGNAL_FLAGS_NONE,
@@ -230,14 +251,39 @@ int main(void) {
 
   // Generate initial JSON
   create_json_from_properties(proxy);
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+static gboolean on_coalesce_ready(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  coalesce_dispatch();
+  return G_SOURCE_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG("DEBUG enabled");
+  stats_init("bluetooth_adapter");
+  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+  if (bluetooth_adapter_start(stdout) != 0) {
+    g_main_loop_unref(loop);
+    return 1;
+  }
+  g_unix_fd_add(coalesce_fd(), G_IO_IN, on_coalesce_ready, NULL);
 
   // Run the main loop
   g_main_loop_run(loop);
 
   // Cleanup
-  g_object_unref(proxy);
-  g_object_unref(conn);
   g_main_loop_unref(loop);
 
   return 0;
 }
+#endif
@@ -38,6 +38,11 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "stats.h"
 #include <dbus/dbus.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -61,6 +66,16 @@
 #define DEVICE_INTERFACE "org.bluez.Device1"
 #define BATTERY_INTERFACE "org.bluez.Battery1"
 
+// Properties read per device (the last one from Battery1) and the JSON
+// members they are printed as
+static const char *const properties[] = {"Address",   "Alias",  "Icon",
+                                         "Connected", "Paired", "Trusted",
+                                         "Percentage"};
+static const char *const output_keys[] = {"id",        "Name",   "Icon",
+                                          "Connected", "Paired", "Trusted",
+                                          "Battery"};
+static FieldSet fields = FIELD_SET("bluetooth_devices", output_keys);
+
 typedef struct {
   char *key;
   char *value;
@@ -235,9 +250,6 @@ static Device *get_devices(DBusConnection *conn, int *device_count) {
           dbus_message_iter_get_basic(&interface_dict, &interface);
           if (strcmp(interface, DEVICE_INTERFACE) == 0) {
             devices[index].path = strdup(path);
-            const char *properties[] = {"Address",   "Alias",  "Icon",
-                                        "Connected", "Paired", "Trusted",
-                                        "Percentage"};
             devices[index].prop_count = 7; // All properties
 
             devices[index].properties =
@@ -246,6 +258,9 @@ static Device *get_devices(DBusConnection *conn, int *device_count) {
             // Get all properties (Device1 and Battery1)
             for (int i = 0; i < devices[index].prop_count; i++) {
               devices[index].properties[i].key = strdup(properties[i]);
+              if (!field_on(&fields, i)) { // not printed, skip the round trip
+                continue;
+              }
               if (i < 6) { // Device1 properties
                 devices[index].properties[i].value =
                     get_property(conn, path, DEVICE_INTERFACE, properties[i]);
@@ -271,14 +286,48 @@ static Device *get_devices(DBusConnection *conn, int *device_count) {
   return devices;
 }
 
-static char *last_output = NULL; // Store the last printed JSON output
+static FILE *out;
+static Device *devices = NULL;
+static int device_count = 0;
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+// --- Hash of everything the document is built from ---
+static uint64_t hash_devices(void) {
+  ChangeHash h;
+  change_hash_init(&h);
+  change_hash_update(&h, &device_count, sizeof(device_count));
+  for (int i = 0; i < device_count; i++) {
+    for (int j = 0; j < devices[i].prop_count; j++) {
+      if (!field_on(&fields, j)) {
+        continue;
+      }
+      // Length-prefixed, with a distinct length for a missing value
+      const char *value = devices[i].properties[j].value;
+      size_t len = value ? strlen(value) : SIZE_MAX;
+      change_hash_update(&h, &len, sizeof(len));
+      if (value) {
+        change_hash_update(&h, value, len);
+      }
+    }
+  }
+  return change_hash_digest(&h);
+}
+
+static void print_devices(void) {
+  // An unchanged device list is never formatted
+  if (!change_check_hash(&changes, hash_devices())) {
+    coalesce_suppressed(coalescer);
+    return;
+  }
 
-static void print_devices(Device *devices, int device_count) {
   // Build the JSON output into a dynamic buffer
   size_t buffer_size = 1024; // Initial buffer size
   char *buffer = malloc(buffer_size);
   if (!buffer) {
     DEBUG_MSG("Failed to allocate buffer for JSON output");
+    change_reset(&changes); // Nothing was printed for this hash
     return;
   }
   size_t offset = 0;
@@ -290,9 +339,10 @@ static void print_devices(Device *devices, int device_count) {
     }
     offset += snprintf(buffer + offset, buffer_size - offset, "{");
     int first = 1;
-    const char *output_keys[] = {"id",     "Name",    "Icon",   "Connected",
-                                 "Paired", "Trusted", "Battery"};
     for (int j = 0; j < devices[i].prop_count; j++) {
+      if (!field_on(&fields, j)) {
+        continue;
+      }
       if (!first) {
         offset += snprintf(buffer + offset, buffer_size - offset, ",");
       }
@@ -321,6 +371,7 @@ static void print_devices(Device *devices, int device_count) {
         if (!new_buffer) {
           DEBUG_MSG("Failed to reallocate buffer for JSON output");
           free(buffer);
+          change_reset(&changes);
           return;
         }
         buffer = new_buffer;
@@ -330,20 +381,112 @@ static void print_devices(Device *devices, int device_count) {
   }
   offset += snprintf(buffer + offset, buffer_size - offset, "]");
 
-  // Compare with last output
-  if (!last_output || strcmp(buffer, last_output) != 0) {
-    // Print and update last_output
-    printf("%s\n", buffer);
-    fflush(stdout);
-    free(last_output);            // Free previous output
-    last_output = strdup(buffer); // Store new output
+  coalesce_line(coalescer, buffer, offset);
+  free(buffer);
+}
+
+static void free_devices(void) {
+  for (int i = 0; i < device_count; i++) {
+    free_device(&devices[i]);
+  }
+  if (devices) {
+    free(devices);
   }
+  devices = NULL;
+  device_count = 0;
+}
 
-  free(buffer);
+// --- Re-read the device list and print it if it changed ---
+static void refresh_devices(DBusConnection *conn) {
+  // Free previous devices and refresh the list
+  free_devices();
+  devices = get_devices(conn, &device_count);
+  print_devices(); // "[]" when there are none
 }
 
-int main(void) {
-  DEBUG_MSG("Debug enabled");
+// --- True if a signal belongs to an object under /org/bluez ---
+static int is_bluez_signal(DBusMessage *msg) {
+  const char *path = dbus_message_get_path(msg);
+  if (path && strncmp(path, BLUEZ_PATH, strlen(BLUEZ_PATH)) == 0) {
+    return 1;
+  }
+  // ObjectManager signals are emitted on "/" and carry the object path
+  DBusMessageIter args;
+  if (dbus_message_iter_init(msg, &args) &&
+      dbus_message_iter_get_arg_type(&args) == DBUS_TYPE_OBJECT_PATH) {
+    dbus_message_iter_get_basic(&args, &path);
+    return path && strncmp(path, BLUEZ_PATH, strlen(BLUEZ_PATH)) == 0;
+  }
+  return 0;
+}
+
+// --- True unless a PropertiesChanged only touches properties nobody prints ---
+static int changes_selected_property(DBusMessage *msg) {
+  DBusMessageIter args, changed;
+  if (!dbus_message_is_signal(msg, "org.freedesktop.DBus.Properties",
+                              "PropertiesChanged") ||
+      !dbus_message_iter_init(msg, &args) || !dbus_message_iter_next(&args) ||
+      dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_ARRAY) {
+    return 1;
+  }
+  // Changed (a{sv}) then invalidated (as) property names
+  for (int list = 0; list < 2; list++) {
+    dbus_message_iter_recurse(&args, &changed);
+    while (dbus_message_iter_get_arg_type(&changed) != DBUS_TYPE_INVALID) {
+      const char *name = NULL;
+      if (dbus_message_iter_get_arg_type(&changed) == DBUS_TYPE_DICT_ENTRY) {
+        DBusMessageIter entry;
+        dbus_message_iter_recurse(&changed, &entry);
+        dbus_message_iter_get_basic(&entry, &name);
+      } else if (dbus_message_iter_get_arg_type(&changed) ==
+                 DBUS_TYPE_STRING) {
+        dbus_message_iter_get_basic(&changed, &name);
+      }
+      for (size_t i = 0; name && i < fields.count; i++) {
+        if (field_on(&fields, i) && strcmp(name, properties[i]) == 0) {
+          return 1;
+        }
+      }
+      dbus_message_iter_next(&changed);
+    }
+    if (!dbus_message_iter_next(&args) ||
+        dbus_message_iter_get_arg_type(&args) != DBUS_TYPE_ARRAY) {
+      break;
+    }
+  }
+  return 0;
+}
+
+// Filter for DBus signals; the system bus connection may be shared with other
+// monitors, so never claim the message
+static DBusHandlerResult signal_handler(DBusConnection *conn, DBusMessage *msg,
+                                        void *user_data) {
+  (void)user_data; // suppress unused paramater warning
+  if ((dbus_message_is_signal(msg, "org.freedesktop.DBus.Properties",
+                              "PropertiesChanged") ||
+       dbus_message_is_signal(msg, "org.freedesktop.DBus.ObjectManager",
+                              "InterfacesAdded") ||
+       dbus_message_is_signal(msg, "org.freedesktop.DBus.ObjectManager",
+                              "InterfacesRemoved")) &&
+      is_bluez_signal(msg)) {
+    stats_event(stats);
+    if (changes_selected_property(msg)) {
+      refresh_devices(conn);
+    } else {
+      coalesce_suppressed(coalescer);
+    }
+  }
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
+}
+
+int bluetooth_devices_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("bluetooth_devices");
+  coalescer =
+      coalesce_new("bluetooth_devices", out, stats, COALESCE_DEFAULT_HZ);
   DBusError err;
   dbus_error_init(&err);
 
@@ -355,91 +498,63 @@ int main(void) {
   }
 
   // Initial device list
-  int device_count = 0;
-  Device *devices = get_devices(conn, &device_count);
-  if (device_count > 0) {
-    print_devices(devices, device_count);
-  } else {
-    // Handle empty device list
-    if (!last_output || strcmp("[]", last_output) != 0) {
-      printf("[]\n");
-      fflush(stdout);
-      free(last_output);
-      last_output = strdup("[]");
-    }
-  }
+  refresh_devices(conn);
 
   // Add match rules for PropertiesChanged and InterfacesAdded/Removed
   dbus_bus_add_match(conn,
-                     "type='signal',interface='org.freedesktop.DBus.Properties'"
+                     "type='signal',sender='" BLUEZ_SERVICE "',"
+                     "interface='org.freedesktop.DBus.Properties'"
                      ",member='PropertiesChanged'",
                      &err);
   dbus_bus_add_match(conn,
-                     "type='signal',interface='org.freedesktop.DBus."
-                     "ObjectManager',member='InterfacesAdded'",
+                     "type='signal',sender='" BLUEZ_SERVICE "',"
+                     "interface='org.freedesktop.DBus.ObjectManager'"
+                     ",member='InterfacesAdded'",
                      &err);
   dbus_bus_add_match(conn,
-                     "type='signal',interface='org.freedesktop.DBus."
-                     "ObjectManager',member='InterfacesRemoved'",
+                     "type='signal',sender='" BLUEZ_SERVICE "',"
+                     "interface='org.freedesktop.DBus.ObjectManager'"
+                     ",member='InterfacesRemoved'",
                      &err);
   if (dbus_error_is_set(&err)) {
     DEBUG_MSG("Failed to add match rules");
-    for (int i = 0; i < device_count; i++)
-      free_device(&devices[i]);
-    if (devices) {
-      free(devices);
-    }
-    free(last_output); // Clean up last_output
+    free_devices();
+    change_reset(&changes);
     dbus_connection_unref(conn);
     dbus_error_free(&err);
     return 1;
   }
 
-  while (dbus_connection_read_write(conn, -1)) {
-    DBusMessage *msg;
-    while ((msg = dbus_connection_pop_message(conn)) != NULL) {
-      if (dbus_message_is_signal(msg, "org.freedesktop.DBus.Properties",
-                                 "PropertiesChanged") ||
-          dbus_message_is_signal(msg, "org.freedesktop.DBus.ObjectManager",
-                                 "InterfacesAdded") ||
-          dbus_message_is_signal(msg, "org.freedesktop.DBus.ObjectManager",
-                                 "InterfacesRemoved")) {
-
-        // Free previous devices and refresh the list
-        for (int i = 0; i < device_count; i++) {
-          free_device(&devices[i]);
-        }
-        if (devices) {
-          free(devices);
-        }
-
-        devices = get_devices(conn, &device_count);
-        if (device_count > 0) {
-          print_devices(devices, device_count);
-        } else {
-          // Handle empty device list
-          if (!last_output || strcmp("[]", last_output) != 0) {
-            printf("[]\n");
-            fflush(stdout);
-            free(last_output);
-            last_output = strdup("[]");
-          }
-        }
-      }
-      dbus_message_unref(msg);
-    }
+  if (!dbus_connection_add_filter(conn, signal_handler, NULL, NULL)) {
+    DEBUG_MSG("Failed to add filter");
+    free_devices();
+    dbus_connection_unref(conn);
+    return 1;
   }
+  return 0;
+}
 
-  // Cleanup
-  for (int i = 0; i < device_count; i++) {
-    free_device(&devices[i]);
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
   }
-  if (devices) {
-    free(devices);
+  DEBUG_MSG("Debug enabled");
+  stats_init("bluetooth_devices");
+  if (bluetooth_devices_start(stdout) != 0) {
+    return 1;
   }
-  free(last_output); // Clean up last_output
+
+  DBusConnection *conn = dbus_bus_get(DBUS_BUS_SYSTEM, NULL);
+  while (dbus_connection_read_write_dispatch(conn, coalesce_timeout_ms())) {
+    coalesce_dispatch();
+  }
+
+  // Cleanup
+  free_devices();
+  change_reset(&changes);
   dbus_connection_unref(conn);
-  dbus_error_free(&err);
 
   return 0;
 }
+#endif
@@ -0,0 +1,216 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "change.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- XXH64 ---
+
+#define PRIME1 11400714785074694791ull
+#define PRIME2 14029467366897019727ull
+#define PRIME3 1609587929392839161ull
+#define PRIME4 9650029242287828579ull
+#define PRIME5 2870177450012600261ull
+
+static inline uint64_t rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian loads; memcpy keeps them legal on unaligned input
+static inline uint64_t read64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap64(v);
+#endif
+  return v;
+}
+
+static inline uint32_t read32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  v = __builtin_bswap32(v);
+#endif
+  return v;
+}
+
+static inline uint64_t round64(uint64_t acc, uint64_t input) {
+  acc += input * PRIME2;
+  acc = rotl(acc, 31);
+  return acc * PRIME1;
+}
+
+static inline uint64_t merge64(uint64_t acc, uint64_t val) {
+  acc ^= round64(0, val);
+  return acc * PRIME1 + PRIME4;
+}
+
+static const unsigned char *consume_stripes(uint64_t acc[4],
+                                            const unsigned char *p,
+                                            const unsigned char *end) {
+  while (end - p >= 32) {
+    acc[0] = round64(acc[0], read64(p));
+    acc[1] = round64(acc[1], read64(p + 8));
+    acc[2] = round64(acc[2], read64(p + 16));
+    acc[3] = round64(acc[3], read64(p + 24));
+    p += 32;
+  }
+  return p;
+}
+
+void change_hash_init(ChangeHash *h) {
+  h->total_len = 0;
+  h->acc[0] = PRIME1 + PRIME2;
+  h->acc[1] = PRIME2;
+  h->acc[2] = 0;
+  h->acc[3] = -PRIME1;
+  h->mem_len = 0;
+}
+
+void change_hash_update(ChangeHash *h, const void *data, size_t len) {
+  const unsigned char *p = data;
+  const unsigned char *end = p + len;
+  h->total_len += len;
+
+  if (h->mem_len + len < 32) {
+    memcpy(h->mem + h->mem_len, p, len);
+    h->mem_len += len;
+    return;
+  }
+  if (h->mem_len) {
+    size_t fill = 32 - h->mem_len;
+    memcpy(h->mem + h->mem_len, p, fill);
+    consume_stripes(h->acc, h->mem, h->mem + 32);
+    p += fill;
+    h->mem_len = 0;
+  }
+  p = consume_stripes(h->acc, p, end);
+  // Under 32 left; the mask lets the compiler see the bound
+  size_t rest = (size_t)(end - p);
+  if (rest) {
+    memcpy(h->mem, p, rest & 31);
+  }
+  h->mem_len = rest & 31;
+}
+
+uint64_t change_hash_digest(const ChangeHash *h) {
+  uint64_t hash;
+  if (h->total_len >= 32) {
+    hash = rotl(h->acc[0], 1) + rotl(h->acc[1], 7) + rotl(h->acc[2], 12) +
+           rotl(h->acc[3], 18);
+    for (int i = 0; i < 4; i++) {
+      hash = merge64(hash, h->acc[i]);
+    }
+  } else {
+    hash = h->acc[2] + PRIME5; // the seed
+  }
+  hash += h->total_len;
+
+  const unsigned char *p = h->mem;
+  const unsigned char *end = p + h->mem_len;
+  for (; end - p >= 8; p += 8) {
+    hash ^= round64(0, read64(p));
+    hash = rotl(hash, 27) * PRIME1 + PRIME4;
+  }
+  if (end - p >= 4) {
+    hash ^= (uint64_t)read32(p) * PRIME1;
+    hash = rotl(hash, 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    hash ^= *p * PRIME5;
+    hash = rotl(hash, 11) * PRIME1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= PRIME2;
+  hash ^= hash >> 29;
+  hash *= PRIME3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint64_t change_hash(const void *data, size_t len) {
+  ChangeHash h;
+  change_hash_init(&h);
+  change_hash_update(&h, data, len);
+  return change_hash_digest(&h);
+}
+
+// --- Detector ---
+
+bool change_check_hash(ChangeDetector *d, uint64_t hash) {
+  if (d->valid && d->hash == hash) {
+    return false;
+  }
+  d->hash = hash;
+  d->valid = true;
+  return true;
+}
+
+bool change_check(ChangeDetector *d, const void *doc, size_t len) {
+  uint64_t hash = change_hash(doc, len);
+#ifdef NEWWBAR_CHANGE_VERIFY
+  if (d->valid && d->hash == hash &&
+      (d->copy_len != len || memcmp(d->copy, doc, len) != 0)) {
+    fprintf(stderr, "change: hash collision on %016llx\n",
+            (unsigned long long)hash);
+    d->valid = false;
+  }
+  char *copy = realloc(d->copy, len ? len : 1);
+  if (copy) {
+    memcpy(copy, doc, len);
+    d->copy = copy;
+    d->copy_len = len;
+  }
+#endif
+  return change_check_hash(d, hash);
+}
+
+void change_reset(ChangeDetector *d) {
+  d->valid = false;
+  free(d->copy);
+  d->copy = NULL;
+  d->copy_len = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef CHANGE_SEEN
+#define CHANGE_SEEN
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Change detection without keeping the last output. A ChangeDetector
+ * remembers only the 64-bit hash (XXH64) of the previous document, so a
+ * monitor never strdup()s what it printed. Documents built from a few
+ * values can skip formatting entirely: stream the inputs through a
+ * ChangeHash and hand the digest to change_check_hash() first.
+ *
+ * Building with -DNEWWBAR_CHANGE_VERIFY also keeps a copy and compares it
+ * in full whenever change_check() sees a matching hash, reporting any
+ * collision on stderr. */
+
+typedef struct {
+  uint64_t total_len;
+  uint64_t acc[4];
+  unsigned char mem[32];
+  size_t mem_len;
+} ChangeHash;
+
+void change_hash_init(ChangeHash *h);
+void change_hash_update(ChangeHash *h, const void *data, size_t len);
+uint64_t change_hash_digest(const ChangeHash *h);
+uint64_t change_hash(const void *data, size_t len);
+
+typedef struct {
+  uint64_t hash;
+  bool valid;
+  char *copy; // NEWWBAR_CHANGE_VERIFY only
+  size_t copy_len;
+} ChangeDetector;
+
+// True when doc differs from the previous one, which it then replaces
+bool change_check(ChangeDetector *d, const void *doc, size_t len);
+// Same for a hash of the document's inputs
+bool change_check_hash(ChangeDetector *d, uint64_t hash);
+// Forget the previous document so the next check reports a change
+void change_reset(ChangeDetector *d);
+
+#endif
@@ -0,0 +1,334 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "coalesce.h"
+#include "change.h"
+#include "snapshot.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define COALESCE_MAX_STREAMS 16
+
+struct Coalescer {
+  const char *name;
+  FILE *out;
+  StatsStream *stats;
+  uint64_t interval_ns;
+  uint64_t last_emit_ns;
+  uint64_t deadline_ns; // 0 when no line is pending
+  char *pending;
+  size_t pending_len;
+  size_t pending_cap;
+  uint64_t shown_hash; // of the last line written, when shown_len > 0
+  size_t shown_len;
+};
+
+static Coalescer coalescers[COALESCE_MAX_STREAMS];
+static int coalescer_count = 0;
+static int timer_fd = -1;
+static uint64_t armed_ns = 0; // deadline the timerfd is set to, 0 if idle
+
+static unsigned int rate_for(const char *name, unsigned int hz) {
+  char key[128];
+  snprintf(key, sizeof(key), "NEWWBAR_MAX_HZ_%s", name);
+  const char *value = getenv(key);
+  if (!value) {
+    value = getenv("NEWWBAR_MAX_HZ");
+  }
+  if (value && *value) {
+    char *end;
+    unsigned long rate = strtoul(value, &end, 10);
+    if (*end == '\0') {
+      return (unsigned int)rate;
+    }
+  }
+  return hz;
+}
+
+// --- Output ---
+
+static long write_line(FILE *out, const char *line, size_t len) {
+  fflush(out);
+  int fd = fileno(out);
+  if (fd < 0) {
+    // Streams without an fd (newwbar-hub FIFOs) still see one flush
+    if (fwrite(line, 1, len, out) != len || putc('\n', out) == EOF ||
+        fflush(out) != 0) {
+      return -1;
+    }
+    return (long)len + 1;
+  }
+
+  struct iovec iov[2] = {{(void *)line, len}, {(void *)"\n", 1}};
+  struct iovec *v = iov;
+  int count = 2;
+  while (count > 0) {
+    ssize_t n = writev(fd, v, count);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    while (count > 0 && (size_t)n >= v->iov_len) {
+      n -= (ssize_t)v->iov_len;
+      v++;
+      count--;
+    }
+    if (count > 0) {
+      v->iov_base = (char *)v->iov_base + n;
+      v->iov_len -= (size_t)n;
+    }
+  }
+  return (long)len + 1;
+}
+
+static long emit(Coalescer *c, const char *line, size_t len) {
+  long written = write_line(c->out, line, len);
+  stats_emit(c->stats, written > 0 ? (size_t)written : 0);
+  c->last_emit_ns = stats_now_ns();
+  if (written > 0) {
+    snapshot_save(c->name, line, len);
+    c->shown_hash = change_hash(line, len);
+    c->shown_len = len + 1;
+  }
+  return written;
+}
+
+// --- Streams ---
+
+Coalescer *coalesce_new(const char *name, FILE *out, StatsStream *stats,
+                        unsigned int hz) {
+  for (int i = 0; i < coalescer_count; i++) {
+    if (strcmp(coalescers[i].name, name) == 0) {
+      coalescers[i].out = out;
+      return &coalescers[i];
+    }
+  }
+  if (coalescer_count == COALESCE_MAX_STREAMS) {
+    return NULL;
+  }
+  if (coalescer_count == 0) {
+    atexit(coalesce_flush_all);
+  }
+  Coalescer *c = &coalescers[coalescer_count++];
+  c->name = name;
+  c->out = out;
+  c->stats = stats;
+  hz = rate_for(name, hz);
+  c->interval_ns = hz ? 1000000000u / hz : 0;
+
+  // Paint the last known state before the monitor has enumerated anything;
+  // it counts as written, so a first real line that matches it is dropped
+  size_t len;
+  char *snapshot = snapshot_load(name, &len);
+  if (snapshot) {
+    long written = write_line(out, snapshot, len);
+    stats_emit(stats, written > 0 ? (size_t)written : 0);
+    c->last_emit_ns = stats_now_ns();
+    if (written > 0) {
+      c->shown_hash = change_hash(snapshot, len);
+      c->shown_len = len + 1;
+    }
+    free(snapshot);
+  }
+  return c;
+}
+
+// --- Timer ---
+
+static uint64_t next_deadline(void) {
+  uint64_t next = 0;
+  for (int i = 0; i < coalescer_count; i++) {
+    uint64_t deadline = coalescers[i].deadline_ns;
+    if (deadline && (!next || deadline < next)) {
+      next = deadline;
+    }
+  }
+  return next;
+}
+
+static void arm_timer(void) {
+  uint64_t next = next_deadline();
+  if (next == armed_ns || coalesce_fd() < 0) {
+    return;
+  }
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = (time_t)(next / 1000000000u);
+  spec.it_value.tv_nsec = (long)(next % 1000000000u);
+  timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL);
+  armed_ns = next;
+}
+
+int coalesce_fd(void) {
+  if (timer_fd < 0) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  }
+  return timer_fd;
+}
+
+int coalesce_timeout_ms(void) {
+  uint64_t next = next_deadline();
+  if (!next) {
+    return -1;
+  }
+  uint64_t now = stats_now_ns();
+  return next > now ? (int)((next - now + 999999) / 1000000) : 0;
+}
+
+void coalesce_dispatch(void) {
+  if (timer_fd >= 0) {
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) > 0)
+      ;
+  }
+  uint64_t now = stats_now_ns();
+  for (int i = 0; i < coalescer_count; i++) {
+    Coalescer *c = &coalescers[i];
+    if (c->deadline_ns && c->deadline_ns <= now) {
+      c->deadline_ns = 0;
+      emit(c, c->pending, c->pending_len);
+    }
+  }
+  arm_timer();
+}
+
+// Waits for fd to become readable while running trailing writes; returns 1
+// when it is, -1 on error
+int coalesce_poll(int fd) {
+  struct pollfd pfd = {.fd = fd, .events = POLLIN};
+  for (;;) {
+    int ready = poll(&pfd, 1, coalesce_timeout_ms());
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    coalesce_dispatch();
+    if (ready != 0) {
+      return ready > 0 ? 1 : -1;
+    }
+  }
+}
+
+void coalesce_flush_all(void) {
+  for (int i = 0; i < coalescer_count; i++) {
+    Coalescer *c = &coalescers[i];
+    if (c->deadline_ns) {
+      c->deadline_ns = 0;
+      emit(c, c->pending, c->pending_len);
+    }
+  }
+  arm_timer();
+}
+
+// --- Lines ---
+
+long coalesce_line(Coalescer *c, const char *line, size_t len) {
+  if (!c) {
+    return -1;
+  }
+  bool shown =
+      len + 1 == c->shown_len && change_hash(line, len) == c->shown_hash;
+  if (!c->deadline_ns && shown) {
+    stats_suppressed(c->stats); // already on screen, as after the snapshot
+    return 0;
+  }
+  uint64_t now = stats_now_ns();
+  if (!c->deadline_ns && now - c->last_emit_ns >= c->interval_ns) {
+    return emit(c, line, len);
+  }
+
+  if (c->deadline_ns) {
+    stats_coalesced(c->stats);
+    // Back to what is shown before the pending line went out (A, B, A):
+    // drop both rather than write A again
+    if (shown) {
+      stats_suppressed(c->stats);
+      c->deadline_ns = 0;
+      arm_timer();
+      return 0;
+    }
+  } else {
+    c->deadline_ns = c->last_emit_ns + c->interval_ns;
+  }
+  if (len > c->pending_cap) {
+    char *grown = realloc(c->pending, len);
+    if (!grown) {
+      // Out of memory: give up on the cap rather than lose the state
+      c->deadline_ns = 0;
+      arm_timer();
+      return emit(c, line, len);
+    }
+    c->pending = grown;
+    c->pending_cap = len;
+  }
+  memcpy(c->pending, line, len);
+  c->pending_len = len;
+  arm_timer();
+  return 0;
+}
+
+long coalesce_now(Coalescer *c, const char *line, size_t len) {
+  if (!c) {
+    return -1;
+  }
+  if (c->deadline_ns) {
+    c->deadline_ns = 0;
+    stats_coalesced(c->stats);
+    arm_timer();
+  }
+  return emit(c, line, len);
+}
+
+void coalesce_suppressed(Coalescer *c) {
+  if (c && !c->deadline_ns) {
+    stats_suppressed(c->stats);
+  }
+}
+
+bool coalesce_pending(const Coalescer *c) { return c && c->deadline_ns; }
@@ -0,0 +1,51 @@
+#ifndef COALESCE_SEEN
+#define COALESCE_SEEN
+
+#include "stats.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Frame-rate cap for output streams. Every line a monitor prints goes
+ * through coalesce_line(). The first line after a quiet interval is written
+ * at once (leading edge); lines arriving sooner replace each other in a
+ * pending slot (latest state wins) and the survivor is written when the
+ * interval is up (trailing edge), so eww redraws at most hz times a second
+ * and always ends on the newest document. A line that brings the state back
+ * to the last one written cancels the pending write instead, and one that
+ * repeats it with nothing pending is dropped.
+ *
+ * Trailing writes are driven by one timerfd per process: an event loop
+ * watches coalesce_fd() for input and calls coalesce_dispatch(), or blocks
+ * for at most coalesce_timeout_ms() and then dispatches. coalesce_poll()
+ * does the latter for a single fd. Pending lines are flushed at exit.
+ *
+ * The rate passed to coalesce_new() is overridden by NEWWBAR_MAX_HZ_<name>,
+ * then NEWWBAR_MAX_HZ; 0 disables the cap. The coalescer calls
+ * stats_emit() for what it writes and stats_coalesced() for what it drops.
+ * Every written line becomes the stream's snapshot (snapshot.h), which
+ * coalesce_new() prints straight away on the next start and then counts as
+ * the last line written. */
+
+#define COALESCE_DEFAULT_HZ 30
+
+typedef struct Coalescer Coalescer;
+
+Coalescer *coalesce_new(const char *name, FILE *out, StatsStream *stats,
+                        unsigned int hz);
+
+// line excludes the newline; returns bytes written now, 0 when deferred
+long coalesce_line(Coalescer *c, const char *line, size_t len);
+// Writes immediately whatever the rate, replacing any pending line
+long coalesce_now(Coalescer *c, const char *line, size_t len);
+// Dedup dropped a line; a pending trailing write still accounts for it
+void coalesce_suppressed(Coalescer *c);
+bool coalesce_pending(const Coalescer *c);
+
+int coalesce_fd(void);
+int coalesce_timeout_ms(void);
+void coalesce_dispatch(void);
+int coalesce_poll(int fd);
+void coalesce_flush_all(void);
+
+#endif
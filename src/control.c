@@ -0,0 +1,211 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#define _GNU_SOURCE
+#include "control.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Fills addr with $XDG_RUNTIME_DIR/newwbar/NAME; -1 if it does not fit
+static int control_path(struct sockaddr_un *addr, const char *name) {
+  const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
+  if (!xdg_runtime || !*xdg_runtime) {
+    return -1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  int len = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/newwbar/%s",
+                     xdg_runtime, name);
+  return len < 0 || (size_t)len >= sizeof(addr->sun_path) ? -1 : 0;
+}
+
+int control_bind(const char *name) {
+  struct sockaddr_un addr;
+  if (control_path(&addr, name) < 0) {
+    return -1;
+  }
+  char *slash = strrchr(addr.sun_path, '/');
+  *slash = '\0';
+  mkdir(addr.sun_path, 0700);
+  *slash = '/';
+
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    // Left behind by a listener that died, unless a live one answers
+    bool stale = errno == EADDRINUSE;
+    int probe = stale ? socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0) : -1;
+    if (probe >= 0) {
+      stale = connect(probe, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+              errno == ECONNREFUSED;
+      close(probe);
+    }
+    if (!stale || unlink(addr.sun_path) < 0 ||
+        bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+int control_send(const char *name, const char *command, size_t len) {
+  struct sockaddr_un addr;
+  if (control_path(&addr, name) < 0) {
+    return -1;
+  }
+  int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  ssize_t sent = sendto(fd, command, len, 0, (struct sockaddr *)&addr,
+                        sizeof(addr));
+  close(fd);
+  return sent == (ssize_t)len ? 0 : -1;
+}
+
+// --- Audio commands ---
+
+static const struct {
+  const char *verb;
+  AudioAction action;
+  AudioTarget target;
+} audio_verbs[] = {
+    {"set-sink-volume", AUDIO_SET_VOLUME, AUDIO_SINK},
+    {"set-source-volume", AUDIO_SET_VOLUME, AUDIO_SOURCE},
+    {"set-sink-input-volume", AUDIO_SET_VOLUME, AUDIO_SINK_INPUT},
+    {"set-sink-mute", AUDIO_SET_MUTE, AUDIO_SINK},
+    {"set-source-mute", AUDIO_SET_MUTE, AUDIO_SOURCE},
+    {"set-sink-input-mute", AUDIO_SET_MUTE, AUDIO_SINK_INPUT},
+    {"set-default-sink", AUDIO_SET_DEFAULT, AUDIO_SINK},
+    {"set-default-source", AUDIO_SET_DEFAULT, AUDIO_SOURCE},
+    {"move-sink-input", AUDIO_MOVE, AUDIO_SINK_INPUT},
+};
+
+// Whole decimal number below limit, with suffix after the digits
+static int parse_number(const char *text, const char *suffix, long limit) {
+  char *end;
+  if (*text < '0' || *text > '9') {
+    return -1;
+  }
+  long n = strtol(text, &end, 10);
+  return strcmp(end, suffix) == 0 && n < limit ? (int)n : -1;
+}
+
+static int parse_mute(const char *text) {
+  if (strcmp(text, "toggle") == 0) {
+    return -1;
+  }
+  if (strcmp(text, "1") == 0 || strcmp(text, "true") == 0) {
+    return 1;
+  }
+  if (strcmp(text, "0") == 0 || strcmp(text, "false") == 0) {
+    return 0;
+  }
+  return -2;
+}
+
+int audio_command_parse(const char *command, size_t len, AudioCommand *out) {
+  if (len >= sizeof(out->buf) || memchr(command, '\0', len)) {
+    return -1;
+  }
+  memcpy(out->buf, command, len);
+  out->buf[len] = '\0';
+
+  char *words[4];
+  int count = 0;
+  char *save;
+  for (char *word = strtok_r(out->buf, " ", &save); word;
+       word = strtok_r(NULL, " ", &save)) {
+    if (count == 4) {
+      return -1;
+    }
+    words[count++] = word;
+  }
+
+  size_t verb = 0;
+  while (verb < sizeof(audio_verbs) / sizeof(audio_verbs[0]) &&
+         (count == 0 || strcmp(words[0], audio_verbs[verb].verb) != 0)) {
+    verb++;
+  }
+  if (verb == sizeof(audio_verbs) / sizeof(audio_verbs[0])) {
+    return -1;
+  }
+  out->action = audio_verbs[verb].action;
+  out->target = audio_verbs[verb].target;
+  if (count != (out->action == AUDIO_SET_DEFAULT ? 2 : 3)) {
+    return -1;
+  }
+  out->name = words[1];
+  out->sink = NULL;
+  out->value = 0;
+  if (out->target == AUDIO_SINK_INPUT) {
+    int index = parse_number(words[1], "", INT32_MAX);
+    if (index < 0) {
+      return -1;
+    }
+    out->index = (uint32_t)index;
+  }
+
+  switch (out->action) {
+  case AUDIO_SET_VOLUME:
+    out->value = parse_number(words[2], "%", 1000);
+    return out->value < 0 ? -1 : 0;
+  case AUDIO_SET_MUTE:
+    out->value = parse_mute(words[2]);
+    return out->value < -1 ? -1 : 0;
+  case AUDIO_MOVE:
+    out->sink = words[2];
+    return 0;
+  case AUDIO_SET_DEFAULT:
+    return 0;
+  }
+  return -1;
+}
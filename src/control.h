@@ -0,0 +1,61 @@
+#ifndef CONTROL_SEEN
+#define CONTROL_SEEN
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Datagram control sockets in $XDG_RUNTIME_DIR/newwbar/, one command per
+ * datagram, no reply. newwbar-ctl sends them; a listener binds the socket
+ * and runs the commands on the connection it already holds, so a click or
+ * a slider tick costs the bar one datagram instead of a process:
+ *
+ *   hypr-control.sock   workspace_list, "dispatch ARGS" (hypr.h)
+ *   audio-control.sock  audio_out, pactl-style commands (audio_out.c)
+ *
+ * control_bind() returns a non-blocking fd for NAME, taking over a socket
+ * left behind by a listener that died; -1 if it could not be bound or a
+ * live listener serves it. control_send() returns -1 when nothing does. */
+#define AUDIO_CONTROL_SOCKET "audio-control.sock"
+#define AUDIO_CONTROL_MAX 512 // longest command, terminator included
+
+int control_bind(const char *name);
+int control_send(const char *name, const char *command, size_t len);
+
+/* Audio commands use pactl's words, so newwbar-ctl can hand anything
+ * audio_out does not take to pactl unchanged:
+ *
+ *   set-sink-volume SINK N%          set-sink-mute SINK 1|0|toggle
+ *   set-source-volume SOURCE N%      set-source-mute SOURCE 1|0|toggle
+ *   set-sink-input-volume INPUT N%   set-sink-input-mute INPUT 1|0|toggle
+ *   set-default-sink SINK            set-default-source SOURCE
+ *   move-sink-input INPUT SINK
+ *
+ * Names go to the server as they are, so @DEFAULT_SINK@ and
+ * @DEFAULT_SOURCE@ work; relative or dB volumes are left to pactl. */
+typedef enum {
+  AUDIO_SET_VOLUME,
+  AUDIO_SET_MUTE,
+  AUDIO_SET_DEFAULT,
+  AUDIO_MOVE,
+} AudioAction;
+
+typedef enum {
+  AUDIO_SINK,
+  AUDIO_SOURCE,
+  AUDIO_SINK_INPUT,
+} AudioTarget;
+
+typedef struct {
+  AudioAction action;
+  AudioTarget target;
+  const char *name; // sink or source; points into buf
+  uint32_t index;   // sink input
+  int value;        // volume in percent; mute 1, 0 or -1 to toggle
+  const char *sink; // move-sink-input destination
+  char buf[AUDIO_CONTROL_MAX];
+} AudioCommand;
+
+// -1 for anything audio_out does not take
+int audio_command_parse(const char *command, size_t len, AudioCommand *out);
+
+#endif
@@ -38,6 +38,9 @@
  * ____________________________________________________________________________
  */
 
+#include "fields.h"
+#include "hub.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -56,57 +59,99 @@
   } while (0)
 #endif
 
-int main(void) {
-  DEBUG_MSG(stdout, "DEBUG enabled.");
-  const char *days_of_week[] = {"Sunday",   "Monday", "Tuesday", "Wednesday",
-                                "Thursday", "Friday", "Saturday"};
-  const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                          "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+static const char *days_of_week[] = {"Sunday",   "Monday", "Tuesday",
+                                     "Wednesday", "Thursday", "Friday",
+                                     "Saturday"};
+static const char *months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                               "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
 
-  while (1) {
-    time_t rawtime;
-    if (time(&rawtime) == (time_t)-1) {
-      DEBUG_MSG(stderr, "ERROR: Failed to get system time");
-      sleep(1);
-      continue;
-    }
+enum { DATE_DAY_OF_WEEK, DATE_MONTH, DATE_DAY, DATE_YEAR, DATE_H, DATE_M };
+static const char *const date_fields[] = {"DayOfWeek", "Month", "Day",
+                                          "Year",      "H",     "M"};
+static FieldSet fields = FIELD_SET("date_simple", date_fields);
+static StatsStream *stats = NULL;
 
-    struct tm *local_time = localtime(&rawtime);
-    if (local_time == NULL) {
-      DEBUG_MSG(stderr, "ERROR: Failed to convert to local time");
-      sleep(1);
-      continue;
-    }
+int date_simple_start(FILE *out) {
+  (void)out; // suppress unused paramater warning
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  stats = stats_stream("date_simple");
+  return 0;
+}
 
-    struct tm curr_time = *local_time;
+// --- Print the current date; returns seconds until the next minute ---
+unsigned int date_simple_tick(FILE *out) {
+  stats_event(stats);
 
-    // Calculate sleep time to next minute boundary
-    int sleep_seconds = 60 - curr_time.tm_sec;
-    if (sleep_seconds <= 0) {
-      sleep_seconds = 1;
+  time_t rawtime;
+  if (time(&rawtime) == (time_t)-1) {
+    DEBUG_MSG(stderr, "ERROR: Failed to get system time");
+    return 1;
+  }
+
+  struct tm *local_time = localtime(&rawtime);
+  if (local_time == NULL) {
+    DEBUG_MSG(stderr, "ERROR: Failed to convert to local time");
+    return 1;
+  }
+
+  struct tm curr_time = *local_time;
+
+  // Calculate sleep time to next minute boundary
+  int sleep_seconds = 60 - curr_time.tm_sec;
+  if (sleep_seconds <= 0) {
+    sleep_seconds = 1;
+  }
+
+  char values[6][16];
+  snprintf(values[DATE_DAY_OF_WEEK], sizeof(values[0]), "%s",
+           days_of_week[curr_time.tm_wday]);
+  snprintf(values[DATE_MONTH], sizeof(values[0]), "%s",
+           months[curr_time.tm_mon]);
+  snprintf(values[DATE_DAY], sizeof(values[0]), "%02d", curr_time.tm_mday);
+  snprintf(values[DATE_YEAR], sizeof(values[0]), "%04d",
+           curr_time.tm_year + 1900);
+  snprintf(values[DATE_H], sizeof(values[0]), "%02d", curr_time.tm_hour);
+  snprintf(values[DATE_M], sizeof(values[0]), "%02d", curr_time.tm_min);
+
+  char json[JSON_STR_LEN];
+  int len = snprintf(json, sizeof(json), "{");
+  for (unsigned int i = 0; i < fields.count; i++) {
+    if (field_on(&fields, i)) {
+      len += snprintf(json + len, sizeof(json) - len, "%s\"%s\":\"%s\"",
+                      len > 1 ? ", " : "", date_fields[i], values[i]);
     }
+  }
+  int written = fprintf(out, "%s}\n", json);
+  fflush(out);
+  stats_emit(stats, written > 0 ? (size_t)written : 0);
 
-    printf("{"
-            "\"DayOfWeek\":\"%s\", "
-            "\"Month\":\"%s\", "
-            "\"Day\":\"%02d\", "
-            "\"Year\":\"%04d\", "
-            "\"H\":\"%02d\", "
-            "\"M\":\"%02d\""
-           "}\n",
-       days_of_week[curr_time.tm_wday],
-       months[curr_time.tm_mon],
-       curr_time.tm_mday,
-       curr_time.tm_year + 1900,
-       curr_time.tm_hour,
-       curr_time.tm_min);
-    fflush(stdout);
+  return (unsigned int)sleep_seconds;
+}
 
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG(stdout, "DEBUG enabled.");
+  stats_init("date_simple");
+  if (date_simple_start(stdout) != 0) {
+    return 1;
+  }
+
+  while (1) {
+    unsigned int sleep_seconds = date_simple_tick(stdout);
 
     // Sleep until the next minute boundary
-    DEBUG_MSG(stdout, "DEBUG: Sleeping for %d seconds", sleep_seconds);
-    sleep(sleep_seconds);
+    DEBUG_MSG(stdout, "DEBUG: Sleeping for %u seconds", sleep_seconds);
+    // sleep() returns early when SIGUSR1 dumps stats
+    while (sleep_seconds > 0) {
+      sleep_seconds = sleep(sleep_seconds);
+    }
   }
 
   return EXIT_SUCCESS;
 }
+#endif
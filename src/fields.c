@@ -0,0 +1,106 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "fields.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *fields_list = NULL;
+
+int fields_args(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--fields") == 0 && i + 1 < argc) {
+      fields_list = argv[++i];
+    } else if (strncmp(argv[i], "--fields=", 9) == 0) {
+      fields_list = argv[i] + 9;
+    } else {
+      fprintf(stderr, "Usage: %s [--fields NAME[,NAME...]]\n", argv[0]);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int field_index(const FieldSet *set, const char *name, size_t len) {
+  for (size_t i = 0; i < set->count; i++) {
+    if (strlen(set->names[i]) == len && strncmp(set->names[i], name, len) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+int fields_init(FieldSet *set) {
+  const char *list = fields_list;
+  if (!list) {
+    char key[128];
+    snprintf(key, sizeof(key), "NEWWBAR_FIELDS_%s", set->stream);
+    list = getenv(key);
+  }
+  if (!list || !*list) {
+    set->mask = set->count < 64 ? ((uint64_t)1 << set->count) - 1 : ~0ull;
+    return 0;
+  }
+
+  set->mask = 0;
+  for (const char *p = list; *p;) {
+    size_t len = strcspn(p, ",");
+    if (len > 0) {
+      int index = field_index(set, p, len);
+      if (index < 0) {
+        fprintf(stderr, "%s: unknown field '%.*s'; known fields:", set->stream,
+                (int)len, p);
+        for (size_t i = 0; i < set->count; i++) {
+          fprintf(stderr, " %s", set->names[i]);
+        }
+        fprintf(stderr, "\n");
+        return -1;
+      }
+      set->mask |= (uint64_t)1 << index;
+    }
+    p += len;
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return 0;
+}
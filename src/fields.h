@@ -0,0 +1,35 @@
+#ifndef FIELDS_SEEN
+#define FIELDS_SEEN
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Field projection. A monitor lists the JSON members it can print in a
+ * compile-time table and guards each member with field_on(). The selection
+ * comes from `--fields a,b,c` on a standalone binary (fields_args()) or
+ * from NEWWBAR_FIELDS_<stream>, which newwbar-hub modules read too; with
+ * neither, every field is on. Unselected members are not built, so they
+ * never reach change detection either: a change confined to them produces
+ * no line at all. */
+
+typedef struct {
+  const char *stream;
+  const char *const *names; // JSON member names, at most 64
+  size_t count;
+  uint64_t mask;
+} FieldSet;
+
+#define FIELD_SET(stream, names)                                               \
+  { stream, names, sizeof(names) / sizeof(names[0]), 0 }
+
+// Takes --fields from a standalone binary's arguments; -1 on bad usage
+int fields_args(int argc, char **argv);
+// Resolves set->mask; -1 (reported on stderr) for an unknown field name
+int fields_init(FieldSet *set);
+
+static inline bool field_on(const FieldSet *set, unsigned int field) {
+  return (set->mask >> field) & 1;
+}
+
+#endif
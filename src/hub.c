@@ -0,0 +1,564 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#define _GNU_SOURCE
+#include "coalesce.h"
+#include "hub.h"
+#include "hypr.h"
+#include "stats.h"
+#include <dbus/dbus.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <glib.h>
+#include <pulse/glib-mainloop.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    fprintf(stderr, fmt "\n", ##__VA_ARGS__);                                  \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+#define STREAM_BUFFER_SIZE 65536
+
+typedef enum {
+  MODULE_PULSE,  // attaches a pa_context to the shared pulse api
+  MODULE_GLIB,   // adds its own sources to the default main context
+  MODULE_DBUS,   // installs a filter on the shared system bus connection
+  MODULE_HYPR,   // subscribes to the one socket2 connection hub polls
+  MODULE_TIMER,  // started, then tick is rescheduled with the delay it returns
+} ModuleKind;
+
+typedef struct {
+  const char *name;
+  ModuleKind kind;
+  int (*pulse_start)(struct pa_mainloop_api *api, FILE *out);
+  int (*start)(FILE *out);
+  unsigned int (*tick)(FILE *out);
+  FILE *out;
+  int enabled;
+  int opt_in; // only started when named
+} HubModule;
+
+static HubModule modules[] = {
+    {"audio_in", MODULE_PULSE, .pulse_start = audio_in_start},
+    {"audio_out", MODULE_PULSE, .pulse_start = audio_out_start},
+    {"audio_peak", MODULE_PULSE, .pulse_start = audio_peak_start, .opt_in = 1},
+    {"mpris_fetch", MODULE_PULSE, .pulse_start = mpris_fetch_start},
+    {"mpris_position", MODULE_GLIB, .start = mpris_position_start},
+    {"bluetooth_adapter", MODULE_GLIB, .start = bluetooth_adapter_start},
+    {"bluetooth_devices", MODULE_DBUS, .start = bluetooth_devices_start},
+    {"wlan_monitor", MODULE_GLIB, .start = wlan_monitor_start},
+    {"wlan_scan", MODULE_DBUS, .start = wlan_scan_start},
+    {"workspace_focus", MODULE_HYPR, .start = workspace_focus_start},
+    {"workspace_list", MODULE_HYPR, .start = workspace_list_start},
+    {"monitor_list", MODULE_HYPR, .start = monitor_list_start},
+    {"active_window", MODULE_HYPR, .start = active_window_start},
+    {"keyboard_layout", MODULE_HYPR, .start = keyboard_layout_start},
+    {"date_simple", MODULE_TIMER, .start = date_simple_start,
+     .tick = date_simple_tick},
+};
+
+// --- Output streams ---
+
+typedef struct {
+  int fd;
+  int is_fifo;
+  char *line; // documents collected up to their '\n'
+  size_t line_len;
+  size_t line_cap;
+  char *rest; // unwritten end of a document the pipe took only in part
+  size_t rest_len;
+  size_t rest_cap;
+  int queued; // bytes in the pipe after our last write, -1 if unknown
+} HubStream;
+
+static int write_all(int fd, const char *buf, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write(fd, buf + done, size - done);
+    if (n >= 0) {
+      done += (size_t)n;
+    } else if (errno != EINTR) {
+      DEBUG_MSG("stream write failed: %s", strerror(errno));
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Writes as much of buf as the pipe takes now; bytes written, -1 on error
+static ssize_t write_some(int fd, const char *buf, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write(fd, buf + done, size - done);
+    if (n >= 0) {
+      done += (size_t)n;
+    } else if (errno != EINTR) {
+      return errno == EAGAIN ? (ssize_t)done : -1;
+    }
+  }
+  return (ssize_t)done;
+}
+
+static void fifo_drain(int fd) {
+  char junk[4096];
+  while (read(fd, junk, sizeof(junk)) > 0)
+    ;
+}
+
+/* A FIFO is opened O_RDWR so the hub never blocks waiting for eww to open the
+ * read side. The pipe only ever gets whole documents:
+ *   - a document goes in only if the pipe has room for all of it; otherwise
+ *     it is dropped, and the next one carries the newer state anyway
+ *   - when nothing has been read since our last write, no reader is attached
+ *     (one would have taken that write at once), so the backlog is discarded
+ *     and a reader attaching later gets the newest document
+ *   - should the pipe take a document only in part, its end is written before
+ *     anything else; if instead the backlog is discarded, the end goes too,
+ *     so a partial write is never resumed after a drain */
+static void fifo_write(HubStream *stream, const char *doc, size_t len) {
+  int queued = 0;
+  int capacity = fcntl(stream->fd, F_GETPIPE_SZ);
+  if (capacity < 0 || ioctl(stream->fd, FIONREAD, &queued) < 0) {
+    return;
+  }
+  int unread = queued == stream->queued;
+
+  if (stream->rest_len && unread) {
+    fifo_drain(stream->fd);
+    stream->rest_len = 0;
+    queued = 0;
+  } else if (stream->rest_len) {
+    ssize_t n = write_some(stream->fd, stream->rest, stream->rest_len);
+    if (n > 0) {
+      memmove(stream->rest, stream->rest + n, stream->rest_len - (size_t)n);
+      stream->rest_len -= (size_t)n;
+    }
+    if (stream->rest_len || ioctl(stream->fd, FIONREAD, &queued) < 0) {
+      DEBUG_MSG("stream busy, document dropped");
+      return;
+    }
+  }
+
+  if ((size_t)(capacity - queued) < len) {
+    if (!unread || (size_t)capacity < len) {
+      DEBUG_MSG("stream full, document dropped");
+      return;
+    }
+    fifo_drain(stream->fd);
+    DEBUG_MSG("no reader, %d stale bytes discarded", queued);
+  }
+
+  ssize_t n = write_some(stream->fd, doc, len);
+  if (n >= 0 && (size_t)n < len) {
+    size_t left = len - (size_t)n;
+    if (left > stream->rest_cap) {
+      char *grown = realloc(stream->rest, left);
+      if (!grown) {
+        return; // the reader resyncs on the next '\n'
+      }
+      stream->rest = grown;
+      stream->rest_cap = left;
+    }
+    memcpy(stream->rest, doc + n, left);
+    stream->rest_len = left;
+  }
+  if (ioctl(stream->fd, FIONREAD, &stream->queued) < 0) {
+    stream->queued = -1;
+  }
+}
+
+static ssize_t stream_write(void *cookie, const char *buf, size_t size) {
+  HubStream *stream = cookie;
+  if (!stream->is_fifo) {
+    return write_all(stream->fd, buf, size) < 0 ? -1 : (ssize_t)size;
+  }
+
+  if (stream->line_len + size > stream->line_cap) {
+    size_t cap = stream->line_cap ? stream->line_cap : STREAM_BUFFER_SIZE;
+    while (cap < stream->line_len + size) {
+      cap *= 2;
+    }
+    char *grown = realloc(stream->line, cap);
+    if (!grown) {
+      return -1;
+    }
+    stream->line = grown;
+    stream->line_cap = cap;
+  }
+  memcpy(stream->line + stream->line_len, buf, size);
+  stream->line_len += size;
+
+  char *end = memrchr(stream->line, '\n', stream->line_len);
+  if (end) {
+    size_t whole = (size_t)(end - stream->line) + 1;
+    fifo_write(stream, stream->line, whole);
+    stream->line_len -= whole;
+    memmove(stream->line, end + 1, stream->line_len);
+  }
+  return (ssize_t)size;
+}
+
+static int stream_close(void *cookie) {
+  HubStream *stream = cookie;
+  int ret = close(stream->fd);
+  free(stream->line);
+  free(stream->rest);
+  free(stream);
+  return ret;
+}
+
+static FILE *stream_open(int fd, int is_fifo) {
+  HubStream *stream = calloc(1, sizeof(HubStream));
+  if (!stream) {
+    return NULL;
+  }
+  stream->fd = fd;
+  stream->is_fifo = is_fifo;
+  stream->queued = -1;
+
+  cookie_io_functions_t io = {.write = stream_write, .close = stream_close};
+  FILE *out = fopencookie(stream, "w", io);
+  if (!out) {
+    free(stream);
+    return NULL;
+  }
+  // Modules fflush once per document, so each line reaches the fd whole
+  setvbuf(out, NULL, _IOFBF, STREAM_BUFFER_SIZE);
+  return out;
+}
+
+static FILE *stream_open_fifo(const char *dir, const char *name) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  if (mkfifo(path, 0600) < 0 && errno != EEXIST) {
+    fprintf(stderr, "mkfifo %s failed: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    fprintf(stderr, "open %s failed: %s\n", path, strerror(errno));
+    return NULL;
+  }
+  return stream_open(fd, 1);
+}
+
+// --- Loop glue ---
+
+static gboolean on_hypr_ready(gint fd, GIOCondition condition,
+                              gpointer user_data);
+
+// One reconnect attempt; the next is a timeout away, backing off
+static gboolean on_hypr_retry(gpointer user_data) {
+  (void)user_data; // suppress unused paramater warning
+  int fd = hypr_bus_reconnect();
+  if (fd >= 0) {
+    DEBUG_MSG("Hyprland socket2 reconnected");
+    g_unix_fd_add(fd, G_IO_IN | G_IO_HUP | G_IO_ERR, on_hypr_ready, NULL);
+  } else if (hypr_bus_retry_ms() >= 0) {
+    g_timeout_add((guint)hypr_bus_retry_ms(), on_hypr_retry, NULL);
+  } else {
+    fprintf(stderr, "Hyprland socket2 did not come back\n");
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean on_hypr_ready(gint fd, GIOCondition condition,
+                              gpointer user_data) {
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  if (hypr_bus_dispatch(fd) < 0) {
+    fprintf(stderr, "Hyprland socket2 closed, reconnecting\n");
+    close(fd);
+    coalesce_flush_all();
+    on_hypr_retry(NULL);
+    return G_SOURCE_REMOVE;
+  }
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_control_ready(gint fd, GIOCondition condition,
+                                 gpointer user_data) {
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  hypr_control_read(fd);
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_coalesce_ready(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  coalesce_dispatch();
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_tick(gpointer user_data) {
+  HubModule *module = user_data;
+  g_timeout_add_seconds(module->tick(module->out), on_tick, module);
+  return G_SOURCE_REMOVE;
+}
+
+static void dbus_drain(DBusConnection *conn) {
+  while (dbus_connection_dispatch(conn) == DBUS_DISPATCH_DATA_REMAINS)
+    ;
+}
+
+static gboolean on_dbus_ready(gint fd, GIOCondition condition,
+                              gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  DBusConnection *conn = user_data;
+  if (!dbus_connection_read_write(conn, 0)) {
+    fprintf(stderr, "system bus disconnected\n");
+    return G_SOURCE_REMOVE;
+  }
+  dbus_drain(conn);
+  return G_SOURCE_CONTINUE;
+}
+
+// Modules may block on replies during start; flush whatever queued up
+static gboolean on_dbus_idle(gpointer user_data) {
+  dbus_drain(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+static void attach_system_bus(void) {
+  DBusConnection *conn = dbus_bus_get(DBUS_BUS_SYSTEM, NULL);
+  int fd = -1;
+  if (!conn || !dbus_connection_get_unix_fd(conn, &fd)) {
+    fprintf(stderr, "system bus has no pollable fd\n");
+    return;
+  }
+  dbus_connection_set_exit_on_disconnect(conn, FALSE);
+  g_unix_fd_add(fd, G_IO_IN | G_IO_HUP | G_IO_ERR, on_dbus_ready, conn);
+  g_idle_add(on_dbus_idle, conn);
+}
+
+static gboolean on_quit_signal(gpointer user_data) {
+  g_main_loop_quit(user_data);
+  return G_SOURCE_REMOVE;
+}
+
+static HubModule *find_module(const char *name, size_t len) {
+  for (size_t i = 0; i < G_N_ELEMENTS(modules); i++) {
+    if (strlen(modules[i].name) == len &&
+        strncmp(modules[i].name, name, len) == 0) {
+      return &modules[i];
+    }
+  }
+  return NULL;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "Usage: %s [-d DIR] [MODULE[=FD]]...\n"
+          "Runs every monitor on one event loop. Each MODULE writes to the\n"
+          "FIFO DIR/MODULE (default $XDG_RUNTIME_DIR/newwbar), or to FD.\n"
+          "With no MODULE arguments every module but the opt-in ones (*)\n"
+          "is started.\nModules:",
+          argv0);
+  for (size_t i = 0; i < G_N_ELEMENTS(modules); i++) {
+    fprintf(stderr, " %s%s", modules[i].name, modules[i].opt_in ? "*" : "");
+  }
+  fprintf(stderr, "\n");
+}
+
+int main(int argc, char **argv) {
+  const char *dir = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "d:h")) != -1) {
+    switch (opt) {
+    case 'd':
+      dir = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  gchar *default_dir = NULL;
+  if (!dir) {
+    default_dir = g_build_filename(g_get_user_runtime_dir(), "newwbar", NULL);
+    dir = default_dir;
+  }
+  if (g_mkdir_with_parents(dir, 0700) < 0) {
+    fprintf(stderr, "Cannot create %s: %s\n", dir, strerror(errno));
+    return 1;
+  }
+
+  // Streams requested as MODULE=FD are opened before any FIFO
+  int any = optind < argc;
+  for (int i = optind; i < argc; i++) {
+    const char *eq = strchr(argv[i], '=');
+    size_t len = eq ? (size_t)(eq - argv[i]) : strlen(argv[i]);
+    HubModule *module = find_module(argv[i], len);
+    if (!module) {
+      fprintf(stderr, "Unknown module: %s\n", argv[i]);
+      usage(argv[0]);
+      return 1;
+    }
+    module->enabled = 1;
+    if (eq) {
+      module->out = stream_open(atoi(eq + 1), 0);
+      if (!module->out) {
+        fprintf(stderr, "%s: cannot use fd %s\n", module->name, eq + 1);
+        return 1;
+      }
+    }
+  }
+
+  for (size_t i = 0; i < G_N_ELEMENTS(modules); i++) {
+    HubModule *module = &modules[i];
+    if (!any) {
+      module->enabled = !module->opt_in;
+    }
+    if (module->enabled && !module->out) {
+      module->out = stream_open_fifo(dir, module->name);
+      if (!module->out) {
+        module->enabled = 0;
+      }
+    }
+  }
+  g_free(default_dir);
+
+  signal(SIGPIPE, SIG_IGN);
+  stats_init("newwbar-hub");
+  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+  g_unix_signal_add(SIGINT, on_quit_signal, loop);
+  g_unix_signal_add(SIGTERM, on_quit_signal, loop);
+
+  pa_glib_mainloop *pa_loop = pa_glib_mainloop_new(NULL);
+  if (!pa_loop) {
+    fprintf(stderr, "Failed to create PulseAudio GLib mainloop\n");
+    g_main_loop_unref(loop);
+    return 1;
+  }
+  pa_mainloop_api *pa_api = pa_glib_mainloop_get_api(pa_loop);
+
+  int running = 0;
+  int uses_system_bus = 0;
+  int hypr_fd = -1;
+  for (size_t i = 0; i < G_N_ELEMENTS(modules); i++) {
+    HubModule *module = &modules[i];
+    if (!module->enabled) {
+      continue;
+    }
+    int ret = 0;
+    switch (module->kind) {
+    case MODULE_PULSE:
+      ret = module->pulse_start(pa_api, module->out);
+      break;
+    case MODULE_GLIB:
+      ret = module->start(module->out);
+      break;
+    case MODULE_DBUS:
+      ret = module->start(module->out);
+      uses_system_bus |= ret == 0;
+      break;
+    case MODULE_HYPR:
+      // Connected before the first module queries its initial state
+      hypr_fd = hypr_bus_open();
+      ret = hypr_fd < 0 || module->start(module->out) < 0;
+      break;
+    case MODULE_TIMER:
+      ret = module->start(module->out);
+      if (ret == 0) {
+        on_tick(module);
+      }
+      break;
+    }
+    if (ret != 0) {
+      fprintf(stderr, "%s: failed to start\n", module->name);
+      continue;
+    }
+    DEBUG_MSG("%s: started", module->name);
+    running++;
+  }
+
+  if (uses_system_bus) {
+    attach_system_bus();
+  }
+  // Every Hyprland module shares this one socket2 connection
+  if (hypr_fd >= 0) {
+    g_unix_fd_add(hypr_fd, G_IO_IN | G_IO_HUP | G_IO_ERR, on_hypr_ready,
+                  NULL);
+  }
+  // Bound by workspace_list for newwbar-ctl
+  if (hypr_control_fd() >= 0) {
+    g_unix_fd_add(hypr_control_fd(), G_IO_IN, on_control_ready, NULL);
+  }
+  // Trailing writes of every rate-capped module share one timerfd
+  g_unix_fd_add(coalesce_fd(), G_IO_IN, on_coalesce_ready, NULL);
+
+  if (running == 0) {
+    fprintf(stderr, "No module could be started\n");
+    pa_glib_mainloop_free(pa_loop);
+    g_main_loop_unref(loop);
+    return 1;
+  }
+
+  g_main_loop_run(loop);
+
+  coalesce_flush_all();
+  for (size_t i = 0; i < G_N_ELEMENTS(modules); i++) {
+    if (modules[i].out) {
+      fclose(modules[i].out);
+    }
+  }
+  pa_glib_mainloop_free(pa_loop);
+  g_main_loop_unref(loop);
+  return 0;
+}
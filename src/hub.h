@@ -0,0 +1,39 @@
+#ifndef HUB_SEEN
+#define HUB_SEEN
+
+#include <stdio.h>
+
+/* Every monitor in src/ is also a newwbar-hub module. Built on its own it
+ * keeps its main() and writes to stdout; built with -DNEWWBAR_HUB the main()
+ * is dropped and hub.c drives the entry points below on one GLib loop, each
+ * writing to its own stream. */
+
+struct pa_mainloop_api;
+
+// --- PulseAudio modules: attach a context to the given mainloop api ---
+int audio_in_start(struct pa_mainloop_api *api, FILE *out);
+int audio_out_start(struct pa_mainloop_api *api, FILE *out);
+int audio_peak_start(struct pa_mainloop_api *api, FILE *out);
+int mpris_fetch_start(struct pa_mainloop_api *api, FILE *out);
+
+// --- GLib modules: sources are added to the default main context ---
+int bluetooth_adapter_start(FILE *out);
+int mpris_position_start(FILE *out);
+int wlan_monitor_start(FILE *out);
+
+// --- libdbus modules: filters on the shared system bus connection ---
+int bluetooth_devices_start(FILE *out);
+int wlan_scan_start(FILE *out);
+
+// --- Hyprland modules: subscribers on the shared socket2 bus (hypr.h) ---
+int workspace_focus_start(FILE *out);
+int workspace_list_start(FILE *out);
+int monitor_list_start(FILE *out);
+int active_window_start(FILE *out);
+int keyboard_layout_start(FILE *out);
+
+// --- Timer modules: start once, then tick returns seconds to the next ---
+int date_simple_start(FILE *out);
+unsigned int date_simple_tick(FILE *out);
+
+#endif
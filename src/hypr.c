@@ -0,0 +1,803 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#define _GNU_SOURCE
+#include "hypr.h"
+#include "control.h"
+#include "json.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HYPR_REQUEST_TIMEOUT_S 2
+#define HYPR_MAX_INSTANCES 16
+
+int hypr_connect(const char *socket_name) {
+  const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
+  const char *hyprland_instance = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+  if (!xdg_runtime || !hyprland_instance) {
+    return -1;
+  }
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  int len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/hypr/%s/%s",
+                     xdg_runtime, hyprland_instance, socket_name);
+  if (len < 0 || (size_t)len >= sizeof(addr.sun_path)) {
+    return -1;
+  }
+
+  int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sock < 0) {
+    return -1;
+  }
+  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    close(sock);
+    return -1;
+  }
+  return sock;
+}
+
+char *hypr_request(const char *request, size_t *len) {
+  int sock = hypr_connect(".socket.sock");
+  if (sock < 0) {
+    return NULL;
+  }
+  // A wedged compositor must not wedge the bar with it
+  struct timeval timeout = {HYPR_REQUEST_TIMEOUT_S, 0};
+  setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  size_t request_len = strlen(request);
+  for (size_t done = 0; done < request_len;) {
+    ssize_t n = write(sock, request + done, request_len - done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(sock);
+      return NULL;
+    }
+    done += (size_t)n;
+  }
+
+  // Hyprland answers once and closes the connection
+  char *reply = NULL;
+  size_t used = 0, cap = 0;
+  for (;;) {
+    if (cap - used < 4096) {
+      cap = cap ? cap * 2 : 16384;
+      char *grown = realloc(reply, cap);
+      if (!grown) {
+        break;
+      }
+      reply = grown;
+    }
+    ssize_t n = read(sock, reply + used, cap - used - 1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    used += (size_t)n;
+  }
+  close(sock);
+  if (!reply) {
+    return NULL;
+  }
+  reply[used] = '\0';
+  if (len) {
+    *len = used;
+  }
+  return reply;
+}
+
+// --- socket2 framer ---
+
+int hypr_framer_init(HyprFramer *f) {
+  memset(f, 0, sizeof(*f));
+  int fd = memfd_create("newwbar-socket2", MFD_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  if (ftruncate(fd, HYPR_FRAMER_SIZE) < 0) {
+    close(fd);
+    return -1;
+  }
+  // Reserve both halves, then map the same pages into each
+  char *base = mmap(NULL, 2 * HYPR_FRAMER_SIZE, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return -1;
+  }
+  for (int half = 0; half < 2; half++) {
+    if (mmap(base + half * HYPR_FRAMER_SIZE, HYPR_FRAMER_SIZE,
+             PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             0) == MAP_FAILED) {
+      munmap(base, 2 * HYPR_FRAMER_SIZE);
+      close(fd);
+      return -1;
+    }
+  }
+  close(fd);
+  f->buf = base;
+  return 0;
+}
+
+void hypr_framer_free(HyprFramer *f) {
+  if (f->buf) {
+    munmap(f->buf, 2 * HYPR_FRAMER_SIZE);
+  }
+  memset(f, 0, sizeof(*f));
+}
+
+long hypr_framer_read(HyprFramer *f, int fd) {
+  if (f->tail - f->head == HYPR_FRAMER_SIZE) {
+    // Full without a newline: give up on this line
+    f->head = f->scan = f->tail;
+    f->skipping = true;
+    f->dropped++;
+  }
+  size_t space = HYPR_FRAMER_SIZE - (size_t)(f->tail - f->head);
+  ssize_t n;
+  do {
+    n = read(fd, f->buf + f->tail % HYPR_FRAMER_SIZE, space);
+  } while (n < 0 && errno == EINTR);
+  if (n > 0) {
+    f->tail += (uint64_t)n;
+  }
+  return (long)n;
+}
+
+bool hypr_framer_next(HyprFramer *f, const char **line, size_t *len) {
+  for (;;) {
+    const char *start = f->buf + f->head % HYPR_FRAMER_SIZE;
+    const char *from = f->buf + f->scan % HYPR_FRAMER_SIZE;
+    const char *nl = memchr(from, '\n', (size_t)(f->tail - f->scan));
+    if (!nl) {
+      f->scan = f->tail;
+      return false;
+    }
+    *line = start;
+    *len = (size_t)(nl - start);
+    f->head = f->scan = f->scan + (uint64_t)(nl - from) + 1;
+    if (!f->skipping) {
+      return true;
+    }
+    f->skipping = false; // the tail of the overlong line
+  }
+}
+
+// --- Event names ---
+
+typedef struct {
+  const char *name;
+  HyprEvent event;
+} HyprEventName;
+
+// Collision-free for every socket2 event; unknown names still compare
+static size_t event_hash(const char *name, size_t len) {
+  return (len * 2 + (unsigned char)name[0] * 21 +
+          (unsigned char)name[len - 1] * 57 + (unsigned char)name[len - 3]) &
+         127;
+}
+
+static const HyprEventName event_names[128] = {
+    [0] = {"lockgroups", HYPR_LOCKGROUPS},
+    [3] = {"bell", HYPR_BELL},
+    [4] = {"activespecial", HYPR_ACTIVESPECIAL},
+    [6] = {"focusedmonv2", HYPR_FOCUSEDMONV2},
+    [8] = {"openlayer", HYPR_OPENLAYER},
+    [14] = {"closelayer", HYPR_CLOSELAYER},
+    [18] = {"openwindow", HYPR_OPENWINDOW},
+    [19] = {"monitoraddedv2", HYPR_MONITORADDEDV2},
+    [22] = {"moveworkspacev2", HYPR_MOVEWORKSPACEV2},
+    [23] = {"monitorremovedv2", HYPR_MONITORREMOVEDV2},
+    [24] = {"closewindow", HYPR_CLOSEWINDOW},
+    [27] = {"createworkspace", HYPR_CREATEWORKSPACE},
+    [33] = {"activespecialv2", HYPR_ACTIVESPECIALV2},
+    [34] = {"movewindowv2", HYPR_MOVEWINDOWV2},
+    [36] = {"pin", HYPR_PIN},
+    [42] = {"activewindowv2", HYPR_ACTIVEWINDOWV2},
+    [47] = {"changefloatingmode", HYPR_CHANGEFLOATINGMODE},
+    [49] = {"monitoradded", HYPR_MONITORADDED},
+    [50] = {"destroyworkspace", HYPR_DESTROYWORKSPACE},
+    [51] = {"workspace", HYPR_WORKSPACE},
+    [56] = {"screencast", HYPR_SCREENCAST},
+    [65] = {"minimized", HYPR_MINIMIZED},
+    [71] = {"monitorremoved", HYPR_MONITORREMOVED},
+    [72] = {"createworkspacev2", HYPR_CREATEWORKSPACEV2},
+    [74] = {"windowtitle", HYPR_WINDOWTITLE},
+    [80] = {"activelayout", HYPR_ACTIVELAYOUT},
+    [85] = {"fullscreen", HYPR_FULLSCREEN},
+    [86] = {"renameworkspace", HYPR_RENAMEWORKSPACE},
+    [88] = {"submap", HYPR_SUBMAP},
+    [93] = {"focusedmon", HYPR_FOCUSEDMON},
+    [94] = {"urgent", HYPR_URGENT},
+    [95] = {"destroyworkspacev2", HYPR_DESTROYWORKSPACEV2},
+    [96] = {"workspacev2", HYPR_WORKSPACEV2},
+    [99] = {"configreloaded", HYPR_CONFIGRELOADED},
+    [100] = {"windowtitlev2", HYPR_WINDOWTITLEV2},
+    [104] = {"movewindow", HYPR_MOVEWINDOW},
+    [105] = {"moveworkspace", HYPR_MOVEWORKSPACE},
+    [106] = {"moveintogroup", HYPR_MOVEINTOGROUP},
+    [108] = {"moveoutofgroup", HYPR_MOVEOUTOFGROUP},
+    [112] = {"activewindow", HYPR_ACTIVEWINDOW},
+    [121] = {"togglegroup", HYPR_TOGGLEGROUP},
+    [125] = {"ignoregrouplock", HYPR_IGNOREGROUPLOCK},
+};
+
+HyprEvent hypr_event(const char *line, size_t len, const char **data,
+                     size_t *data_len) {
+  // Event names are short, so a plain scan finds ">>" quickest
+  const char *sep = NULL;
+  for (size_t i = 0; i + 1 < len; i++) {
+    if (line[i] == '>' && line[i + 1] == '>') {
+      sep = line + i;
+      break;
+    }
+  }
+  if (!sep) {
+    *data = line + len;
+    *data_len = 0;
+    return HYPR_UNKNOWN;
+  }
+  size_t name_len = (size_t)(sep - line);
+  *data = sep + 2;
+  *data_len = len - name_len - 2;
+  if (name_len < 3) {
+    return HYPR_UNKNOWN;
+  }
+  const HyprEventName *entry = &event_names[event_hash(line, name_len)];
+  if (entry->name && strlen(entry->name) == name_len &&
+      memcmp(entry->name, line, name_len) == 0) {
+    return entry->event;
+  }
+  return HYPR_UNKNOWN;
+}
+
+// --- Event bus ---
+
+static HyprFramer bus_framer;
+static int bus_fd = -1;
+static const HyprSubscriber *subscribers[HYPR_MAX_SUBSCRIBERS];
+static int subscriber_count = 0;
+
+int hypr_bus_open(void) {
+  if (bus_fd >= 0) {
+    return bus_fd;
+  }
+  if (!bus_framer.buf && hypr_framer_init(&bus_framer) < 0) {
+    return -1;
+  }
+  bus_fd = hypr_connect(".socket2.sock");
+  return bus_fd;
+}
+
+// --- Reconnecting ---
+
+typedef struct {
+  char signature[NAME_MAX + 1];
+  struct timespec mtime; // of its socket2
+} HyprInstance;
+
+static int retry_ms = 0;          // 0 until an attempt has failed
+static uint64_t retry_since = 0;  // ms, when socket2 went away
+static long retry_limit_s = -1;   // NEWWBAR_HYPR_RECONNECT_S, -1 forever
+
+static uint64_t monotonic_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static int newest_first(const void *a, const void *b) {
+  const struct timespec *x = &((const HyprInstance *)a)->mtime;
+  const struct timespec *y = &((const HyprInstance *)b)->mtime;
+  if (x->tv_sec != y->tv_sec) {
+    return x->tv_sec < y->tv_sec ? 1 : -1;
+  }
+  return x->tv_nsec < y->tv_nsec ? 1 : x->tv_nsec > y->tv_nsec ? -1 : 0;
+}
+
+// A restarted Hyprland has a new signature; a crashed one leaves its
+// directory behind, so only a socket2 that accepts counts
+static int connect_instance(void) {
+  const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s/hypr", xdg_runtime ? xdg_runtime : "");
+  DIR *dir = xdg_runtime ? opendir(path) : NULL;
+  if (!dir) {
+    return hypr_connect(".socket2.sock");
+  }
+
+  HyprInstance found[HYPR_MAX_INSTANCES];
+  size_t count = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) && count < HYPR_MAX_INSTANCES) {
+    struct stat st;
+    char socket2[PATH_MAX + NAME_MAX + 32];
+    snprintf(socket2, sizeof(socket2), "%s/%s/.socket2.sock", path,
+             entry->d_name);
+    if (entry->d_name[0] == '.' || stat(socket2, &st) < 0 ||
+        !S_ISSOCK(st.st_mode)) {
+      continue;
+    }
+    snprintf(found[count].signature, sizeof(found[count].signature), "%s",
+             entry->d_name);
+    found[count].mtime = st.st_mtim;
+    count++;
+  }
+  closedir(dir);
+  qsort(found, count, sizeof(*found), newest_first);
+
+  for (size_t i = 0; i < count; i++) {
+    setenv("HYPRLAND_INSTANCE_SIGNATURE", found[i].signature, 1);
+    int fd = hypr_connect(".socket2.sock");
+    if (fd >= 0) {
+      return fd;
+    }
+  }
+  return -1;
+}
+
+int hypr_bus_reconnect(void) {
+  if (!retry_ms) {
+    retry_since = monotonic_ms();
+    const char *limit = getenv("NEWWBAR_HYPR_RECONNECT_S");
+    retry_limit_s = limit && *limit ? atol(limit) : -1;
+  }
+  bus_fd = -1;
+  // A line cut off by the old connection is not finished by the new one
+  bus_framer.head = bus_framer.scan = bus_framer.tail;
+  bus_framer.skipping = false;
+  if (hypr_bus_retry_ms() < 0) {
+    return -1;
+  }
+
+  int fd = connect_instance();
+  if (fd < 0) {
+    retry_ms = retry_ms ? retry_ms * 2 : HYPR_RETRY_MIN_MS;
+    if (retry_ms > HYPR_RETRY_MAX_MS) {
+      retry_ms = HYPR_RETRY_MAX_MS;
+    }
+    return -1;
+  }
+  retry_ms = 0;
+  bus_fd = fd;
+  for (int i = 0; i < subscriber_count; i++) {
+    if (subscribers[i]->resync) {
+      subscribers[i]->resync();
+    }
+  }
+  return fd;
+}
+
+int hypr_bus_retry_ms(void) {
+  if (retry_limit_s >= 0 &&
+      monotonic_ms() - retry_since >= (uint64_t)retry_limit_s * 1000u) {
+    return -1;
+  }
+  return retry_ms;
+}
+
+int hypr_bus_wait(void) {
+  int fd;
+  while ((fd = hypr_bus_reconnect()) < 0) {
+    int wait_ms = hypr_bus_retry_ms();
+    if (wait_ms < 0) {
+      return -1;
+    }
+    struct timespec ts = {wait_ms / 1000, (long)(wait_ms % 1000) * 1000000};
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+      ;
+  }
+  return fd;
+}
+
+int hypr_bus_subscribe(const HyprSubscriber *sub) {
+  if (subscriber_count == HYPR_MAX_SUBSCRIBERS) {
+    return -1;
+  }
+  subscribers[subscriber_count++] = sub;
+  return 0;
+}
+
+int hypr_bus_dispatch(int fd) {
+  if (hypr_framer_read(&bus_framer, fd) <= 0) {
+    if (fd == bus_fd) {
+      bus_fd = -1;
+    }
+    return -1;
+  }
+
+  uint64_t wanted = 0;
+  for (int i = 0; i < subscriber_count; i++) {
+    wanted |= subscribers[i]->events;
+  }
+  uint32_t fired = 0; // subscribers that got an event
+  const char *line, *data;
+  size_t len, data_len;
+  while (hypr_framer_next(&bus_framer, &line, &len)) {
+    HyprEvent event = hypr_event(line, len, &data, &data_len);
+    if (!(wanted & HYPR_MASK(event))) {
+      continue;
+    }
+    for (int i = 0; i < subscriber_count; i++) {
+      if (subscribers[i]->events & HYPR_MASK(event)) {
+        subscribers[i]->event(event, data, data_len);
+        fired |= 1u << i;
+      }
+    }
+  }
+  for (int i = 0; i < subscriber_count; i++) {
+    if ((fired >> i) & 1 && subscribers[i]->done) {
+      subscribers[i]->done();
+    }
+  }
+  return 0;
+}
+
+// --- Dispatch control socket ---
+
+#define HYPR_BATCH_MAX 8192
+
+static int control_fd = -1;
+
+int hypr_control_open(void) {
+  if (control_fd < 0) {
+    control_fd = control_bind(HYPR_CONTROL_SOCKET);
+  }
+  return control_fd;
+}
+
+int hypr_control_fd(void) { return control_fd; }
+
+static void send_batch(char *batch, size_t len, int commands) {
+  if (commands == 0) {
+    return;
+  }
+  batch[len] = '\0';
+  // A lone command goes as it is; [[BATCH]] joins the rest with ';'. Each
+  // has an empty flags prefix, as Hyprland reads up to the first '/' as
+  // flags and the arguments may hold one ("exec ~/bin/foo")
+  char *reply = hypr_request(commands == 1 ? batch + 9 : batch, NULL);
+  free(reply);
+}
+
+void hypr_control_read(int fd) {
+  char batch[HYPR_BATCH_MAX + 1] = "[[BATCH]]";
+  size_t len = 9;
+  int commands = 0;
+  char command[HYPR_CONTROL_MAX];
+  for (;;) {
+    ssize_t n = recv(fd, command, sizeof(command), MSG_TRUNC);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      break; // EAGAIN: drained
+    }
+    // Only dispatchers; anything cut off or with a ';' of its own, which
+    // would split it in a batch, is not forwarded
+    size_t command_len = (size_t)n;
+    if (command_len >= sizeof(command) || command_len < 10 ||
+        memcmp(command, "dispatch ", 9) != 0 ||
+        memchr(command, ';', command_len) ||
+        memchr(command, '\0', command_len)) {
+      continue;
+    }
+    if (len + command_len + 2 > HYPR_BATCH_MAX) {
+      send_batch(batch, len, commands);
+      len = 9;
+      commands = 0;
+    }
+    if (commands) {
+      batch[len++] = ';';
+    }
+    batch[len++] = '/';
+    memcpy(batch + len, command, command_len);
+    len += command_len;
+    commands++;
+  }
+  send_batch(batch, len, commands);
+}
+
+// --- Queries ---
+
+int hypr_focused_workspace(int *id) {
+  size_t len;
+  char *reply = hypr_request("j/monitors", &len);
+  if (!reply) {
+    return -1;
+  }
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  int count = 0;
+  bool found = false;
+  if (json_scan_array(&s)) {
+    while (json_scan_next(&s) == JSON_OBJECT) {
+      bool focused = false;
+      int64_t active = 0;
+      while (json_scan_next(&s) == JSON_KEY) {
+        if (json_scan_key_is(&s, "focused")) {
+          json_scan_get_bool(&s, &focused);
+        } else if (json_scan_key_is(&s, "activeWorkspace")) {
+          if (json_scan_object(&s)) {
+            while (json_scan_next(&s) == JSON_KEY) {
+              if (json_scan_key_is(&s, "id")) {
+                json_scan_get_int(&s, &active);
+              } else {
+                json_scan_skip(&s);
+              }
+            }
+          }
+        } else {
+          json_scan_skip(&s);
+        }
+      }
+      count++;
+      if (focused && !found) {
+        *id = (int)active;
+        found = true;
+      }
+    }
+  }
+  free(reply);
+  return found ? count : -1;
+}
+
+int hypr_active_window(HyprWindow *win) {
+  size_t len;
+  char *reply = hypr_request("j/activewindow", &len);
+  if (!reply) {
+    return -1;
+  }
+  memset(win, 0, sizeof(*win));
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  if (json_scan_object(&s)) {
+    while (json_scan_next(&s) == JSON_KEY) {
+      if (json_scan_key_is(&s, "address")) {
+        char address[32] = "";
+        json_scan_get_string(&s, address, sizeof(address));
+        win->address = strtoull(address, NULL, 16);
+      } else if (json_scan_key_is(&s, "class")) {
+        json_scan_get_string(&s, win->class_name, sizeof(win->class_name));
+      } else if (json_scan_key_is(&s, "title")) {
+        json_scan_get_string(&s, win->title, sizeof(win->title));
+      } else {
+        json_scan_skip(&s);
+      }
+    }
+  }
+  free(reply);
+  return 0;
+}
+
+int hypr_monitors(HyprMonitorFn fn, void *data) {
+  size_t len;
+  char *reply = hypr_request("j/monitors", &len);
+  if (!reply) {
+    return -1;
+  }
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  int count = 0;
+  if (json_scan_array(&s)) {
+    while (json_scan_next(&s) == JSON_OBJECT) {
+      char name[HYPR_NAME_LEN] = "";
+      int64_t id = 0, active = 0;
+      bool focused = false;
+      double scale = 1.0;
+      while (json_scan_next(&s) == JSON_KEY) {
+        if (json_scan_key_is(&s, "id")) {
+          json_scan_get_int(&s, &id);
+        } else if (json_scan_key_is(&s, "name")) {
+          json_scan_get_string(&s, name, sizeof(name));
+        } else if (json_scan_key_is(&s, "focused")) {
+          json_scan_get_bool(&s, &focused);
+        } else if (json_scan_key_is(&s, "scale")) {
+          json_scan_get_double(&s, &scale);
+        } else if (json_scan_key_is(&s, "activeWorkspace")) {
+          if (json_scan_object(&s)) {
+            while (json_scan_next(&s) == JSON_KEY) {
+              if (json_scan_key_is(&s, "id")) {
+                json_scan_get_int(&s, &active);
+              } else {
+                json_scan_skip(&s);
+              }
+            }
+          }
+        } else {
+          json_scan_skip(&s);
+        }
+      }
+      HyprMonitor mon = {(int)id, name, focused, scale, (int)active};
+      fn(&mon, data);
+      count++;
+    }
+  }
+  free(reply);
+  return count;
+}
+
+int hypr_workspaces(HyprWorkspaceFn fn, void *data) {
+  size_t len;
+  char *reply = hypr_request("j/workspaces", &len);
+  if (!reply) {
+    return -1;
+  }
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  int count = 0;
+  if (json_scan_array(&s)) {
+    while (json_scan_next(&s) == JSON_OBJECT) {
+      char name[HYPR_NAME_LEN] = "", monitor[HYPR_NAME_LEN] = "";
+      int64_t id = 0, monitor_id = -1, windows = 0;
+      while (json_scan_next(&s) == JSON_KEY) {
+        if (json_scan_key_is(&s, "id")) {
+          json_scan_get_int(&s, &id);
+        } else if (json_scan_key_is(&s, "name")) {
+          json_scan_get_string(&s, name, sizeof(name));
+        } else if (json_scan_key_is(&s, "monitor")) {
+          json_scan_get_string(&s, monitor, sizeof(monitor));
+        } else if (json_scan_key_is(&s, "monitorID")) {
+          json_scan_get_int(&s, &monitor_id);
+        } else if (json_scan_key_is(&s, "windows")) {
+          json_scan_get_int(&s, &windows);
+        } else {
+          json_scan_skip(&s);
+        }
+      }
+      HyprWorkspace ws = {(int)id, name, monitor, (int)monitor_id,
+                          (int)windows};
+      fn(&ws, data);
+      count++;
+    }
+  }
+  free(reply);
+  return count;
+}
+
+int hypr_clients(HyprClientFn fn, void *data) {
+  size_t len;
+  char *reply = hypr_request("j/clients", &len);
+  if (!reply) {
+    return -1;
+  }
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  int count = 0;
+  if (json_scan_array(&s)) {
+    while (json_scan_next(&s) == JSON_OBJECT) {
+      char address[32] = "", class_name[HYPR_NAME_LEN] = "";
+      int64_t workspace = 0;
+      bool fullscreen = false;
+      while (json_scan_next(&s) == JSON_KEY) {
+        if (json_scan_key_is(&s, "address")) {
+          json_scan_get_string(&s, address, sizeof(address));
+        } else if (json_scan_key_is(&s, "class")) {
+          json_scan_get_string(&s, class_name, sizeof(class_name));
+        } else if (json_scan_key_is(&s, "fullscreen")) {
+          // A bool before Hyprland 0.42, the fullscreen mode since
+          JsonToken t = json_scan_next(&s);
+          fullscreen = t == JSON_TRUE || (t == JSON_NUMBER && *s.text != '0');
+        } else if (json_scan_key_is(&s, "workspace")) {
+          if (json_scan_object(&s)) {
+            while (json_scan_next(&s) == JSON_KEY) {
+              if (json_scan_key_is(&s, "id")) {
+                json_scan_get_int(&s, &workspace);
+              } else {
+                json_scan_skip(&s);
+              }
+            }
+          }
+        } else {
+          json_scan_skip(&s);
+        }
+      }
+      // "0x55d0a000"
+      HyprClient client = {strtoull(address, NULL, 16), (int)workspace,
+                           class_name, fullscreen};
+      fn(&client, data);
+      count++;
+    }
+  }
+  free(reply);
+  return count;
+}
+
+int hypr_keyboards(HyprKeyboardFn fn, void *data) {
+  size_t len;
+  char *reply = hypr_request("j/devices", &len);
+  if (!reply) {
+    return -1;
+  }
+  JsonScanner s;
+  json_scan_init(&s, reply, len);
+  int count = 0;
+  if (json_scan_object(&s)) {
+    while (json_scan_next(&s) == JSON_KEY) {
+      if (!json_scan_key_is(&s, "keyboards")) {
+        json_scan_skip(&s); // mice, tablets, touch, switches
+        continue;
+      }
+      if (!json_scan_array(&s)) {
+        continue;
+      }
+      while (json_scan_next(&s) == JSON_OBJECT) {
+        char name[HYPR_NAME_LEN] = "", layout[HYPR_NAME_LEN] = "";
+        bool main = false;
+        while (json_scan_next(&s) == JSON_KEY) {
+          if (json_scan_key_is(&s, "name")) {
+            json_scan_get_string(&s, name, sizeof(name));
+          } else if (json_scan_key_is(&s, "active_keymap")) {
+            json_scan_get_string(&s, layout, sizeof(layout));
+          } else if (json_scan_key_is(&s, "main")) {
+            json_scan_get_bool(&s, &main);
+          } else {
+            json_scan_skip(&s);
+          }
+        }
+        HyprKeyboard kb = {name, layout, main};
+        fn(&kb, data);
+        count++;
+      }
+    }
+  }
+  free(reply);
+  return count;
+}
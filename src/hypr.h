@@ -0,0 +1,215 @@
+#ifndef HYPR_SEEN
+#define HYPR_SEEN
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hyprland IPC without hyprctl. Both sockets live in
+ * $XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/: hypr_connect() opens
+ * one of them (".socket2.sock" for the event stream), hypr_request() sends
+ * a single request such as "j/monitors" to ".socket.sock" and returns the
+ * whole reply, NUL-terminated, for the caller to free.
+ *
+ * The query helpers pick their keys out of the -j replies with JsonScanner
+ * (json.h) and call back once per element; they return the number of
+ * elements, or -1 when Hyprland could not be asked. */
+
+int hypr_connect(const char *socket);
+char *hypr_request(const char *request, size_t *len);
+
+/* socket2 line framer. Reads land in a ring buffer that is mapped twice
+ * back to back, so every line is contiguous however the ring has wrapped
+ * and hypr_framer_next() can hand it out in place: LINE/LEN without the
+ * '\n', which still follows it in memory (strtol-style parsing stops
+ * there). Lines stay valid until the next hypr_framer_read(). A line longer
+ * than the ring is dropped whole and counted in dropped. */
+#define HYPR_FRAMER_SIZE 65536
+
+typedef struct {
+  char *buf;      // HYPR_FRAMER_SIZE bytes, mapped twice
+  uint64_t head;  // first byte not yet handed out
+  uint64_t scan;  // searched for '\n' up to here
+  uint64_t tail;  // end of the data read so far
+  bool skipping;  // inside an overlong line
+  size_t dropped;
+} HyprFramer;
+
+int hypr_framer_init(HyprFramer *f);
+void hypr_framer_free(HyprFramer *f);
+// Bytes read, 0 on EOF, -1 on error (errno set)
+long hypr_framer_read(HyprFramer *f, int fd);
+bool hypr_framer_next(HyprFramer *f, const char **line, size_t *len);
+
+// socket2 event names, looked up through a perfect hash
+typedef enum {
+  HYPR_UNKNOWN,
+  HYPR_WORKSPACE,
+  HYPR_WORKSPACEV2,
+  HYPR_FOCUSEDMON,
+  HYPR_FOCUSEDMONV2,
+  HYPR_ACTIVEWINDOW,
+  HYPR_ACTIVEWINDOWV2,
+  HYPR_FULLSCREEN,
+  HYPR_MONITORREMOVED,
+  HYPR_MONITORREMOVEDV2,
+  HYPR_MONITORADDED,
+  HYPR_MONITORADDEDV2,
+  HYPR_CREATEWORKSPACE,
+  HYPR_CREATEWORKSPACEV2,
+  HYPR_DESTROYWORKSPACE,
+  HYPR_DESTROYWORKSPACEV2,
+  HYPR_MOVEWORKSPACE,
+  HYPR_MOVEWORKSPACEV2,
+  HYPR_RENAMEWORKSPACE,
+  HYPR_ACTIVESPECIAL,
+  HYPR_ACTIVESPECIALV2,
+  HYPR_ACTIVELAYOUT,
+  HYPR_OPENWINDOW,
+  HYPR_CLOSEWINDOW,
+  HYPR_MOVEWINDOW,
+  HYPR_MOVEWINDOWV2,
+  HYPR_OPENLAYER,
+  HYPR_CLOSELAYER,
+  HYPR_SUBMAP,
+  HYPR_CHANGEFLOATINGMODE,
+  HYPR_URGENT,
+  HYPR_SCREENCAST,
+  HYPR_WINDOWTITLE,
+  HYPR_WINDOWTITLEV2,
+  HYPR_TOGGLEGROUP,
+  HYPR_MOVEINTOGROUP,
+  HYPR_MOVEOUTOFGROUP,
+  HYPR_IGNOREGROUPLOCK,
+  HYPR_LOCKGROUPS,
+  HYPR_CONFIGRELOADED,
+  HYPR_PIN,
+  HYPR_MINIMIZED,
+  HYPR_BELL,
+} HyprEvent;
+
+// Splits "name>>data"; DATA/DATA_LEN point into LINE
+HyprEvent hypr_event(const char *line, size_t len, const char **data,
+                     size_t *data_len);
+
+/* socket2 event bus: one connection and one framer for every subscriber.
+ * Each line is framed and named once, then handed to the subscribers whose
+ * mask holds its event; DATA/LEN are as from hypr_event(). After a read has
+ * been framed, done() runs for each subscriber that got an event from it,
+ * so monitors publish once per burst. A standalone monitor runs the bus
+ * with just itself; newwbar-hub runs one for all its Hyprland modules.
+ *
+ * hypr_bus_open() connects before any subscriber queries its initial
+ * state, so events racing those queries are not lost.
+ *
+ * When socket2 goes away (Hyprland restarted or crashed) the bus
+ * reconnects: hypr_bus_reconnect() makes one attempt, trying every instance
+ * under $XDG_RUNTIME_DIR/hypr/ newest first and exporting the signature of
+ * the one that answers, so requests and hyprctl follow it. On success each
+ * subscriber's resync() asks Hyprland for its whole state again and prints
+ * only what differs. Failed attempts back off from HYPR_RETRY_MIN_MS to
+ * HYPR_RETRY_MAX_MS; hypr_bus_retry_ms() is the wait before the next one.
+ * NEWWBAR_HYPR_RECONNECT_S limits how long to keep trying (unset: forever,
+ * 0: exit with socket2 as before). */
+#define HYPR_MAX_SUBSCRIBERS 16
+#define HYPR_MASK(event) (1ull << (event))
+#define HYPR_RETRY_MIN_MS 50
+#define HYPR_RETRY_MAX_MS 500
+
+typedef struct {
+  const char *name;
+  uint64_t events; // HYPR_MASK()s of the events wanted
+  void (*event)(HyprEvent event, const char *data, size_t len);
+  void (*done)(void);
+  void (*resync)(void); // after a reconnect
+} HyprSubscriber;
+
+// The socket2 fd to poll, connecting on first use; -1 on failure
+int hypr_bus_open(void);
+int hypr_bus_subscribe(const HyprSubscriber *sub);
+// Reads once and dispatches; -1 once socket2 is gone
+int hypr_bus_dispatch(int fd);
+// The new socket2 fd, or -1 to try again after hypr_bus_retry_ms()
+int hypr_bus_reconnect(void);
+// -1 once NEWWBAR_HYPR_RECONNECT_S has run out
+int hypr_bus_retry_ms(void);
+// Retries until reconnected; -1 when giving up
+int hypr_bus_wait(void);
+
+/* Dispatch control socket, so a click costs the bar one datagram instead of
+ * a hyprctl process. workspace_list binds $XDG_RUNTIME_DIR/newwbar/
+ * HYPR_CONTROL_SOCKET; each datagram is one "dispatch ARGS" (newwbar-ctl
+ * sends them) and goes on to the request socket. Whatever queued up since
+ * the last read is sent as one [[BATCH]] request, so a fast scroll costs one
+ * round trip. Hyprland closes the request socket after every reply, so
+ * there is no connection to keep; the saving is the process.
+ *
+ * hypr_control_open() returns the fd to poll, or -1 when it could not be
+ * bound or another process serves it already; hypr_control_fd() is that
+ * fd, -1 if never opened. hypr_control_read() forwards what has queued. */
+#define HYPR_CONTROL_SOCKET "hypr-control.sock"
+#define HYPR_CONTROL_MAX 1024 // longest command, terminator included
+
+int hypr_control_open(void);
+int hypr_control_fd(void);
+void hypr_control_read(int fd);
+
+// Active workspace of the focused monitor
+int hypr_focused_workspace(int *id);
+
+// Names longer than HYPR_NAME_LEN - 1 are cut; they last for the callback
+#define HYPR_NAME_LEN 128
+
+#define HYPR_TITLE_LEN 1024
+
+typedef struct {
+  uint64_t address; // 0 when nothing has focus
+  char class_name[HYPR_NAME_LEN];
+  char title[HYPR_TITLE_LEN];
+} HyprWindow;
+
+int hypr_active_window(HyprWindow *win);
+
+typedef struct {
+  int id;
+  const char *name;
+  bool focused;
+  double scale;
+  int active_workspace;
+} HyprMonitor;
+
+typedef void (*HyprMonitorFn)(const HyprMonitor *mon, void *data);
+int hypr_monitors(HyprMonitorFn fn, void *data);
+
+typedef struct {
+  int id;
+  const char *name;
+  const char *monitor;
+  int monitor_id;
+  int windows;
+} HyprWorkspace;
+
+typedef void (*HyprWorkspaceFn)(const HyprWorkspace *ws, void *data);
+int hypr_workspaces(HyprWorkspaceFn fn, void *data);
+
+typedef struct {
+  uint64_t address;
+  int workspace;
+  const char *class_name;
+  bool fullscreen; // in any fullscreen mode, maximized included
+} HyprClient;
+
+typedef void (*HyprClientFn)(const HyprClient *client, void *data);
+int hypr_clients(HyprClientFn fn, void *data);
+
+// Keyboards from j/devices; layout is the active keymap ("English (US)")
+typedef struct {
+  const char *name;
+  const char *layout;
+  bool main;
+} HyprKeyboard;
+
+typedef void (*HyprKeyboardFn)(const HyprKeyboard *kb, void *data);
+int hypr_keyboards(HyprKeyboardFn fn, void *data);
+
+#endif
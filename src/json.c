@@ -1,51 +1,571 @@
 #include "json.h"
 
+#include <errno.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 // --- Utility: JSON string escaping ---
-void print_json_str(const char *str) {
-  putchar('"');
+void fprint_json_str(FILE *out, const char *str) {
+  putc('"', out);
   for (const unsigned char *c = (unsigned char *)str; *c; ++c) {
     switch (*c) {
     case '\"':
-      putchar('\\');
-      putchar('\"');
+      putc('\\', out);
+      putc('\"', out);
       break;
     case '\\':
-      putchar('\\');
-      putchar('\\');
+      putc('\\', out);
+      putc('\\', out);
       break;
     case '\b':
-      putchar('\\');
-      putchar('b');
+      putc('\\', out);
+      putc('b', out);
       break;
     case '\f':
-      putchar('\\');
-      putchar('f');
+      putc('\\', out);
+      putc('f', out);
       break;
     case '\n':
-      putchar('\\');
-      putchar('n');
+      putc('\\', out);
+      putc('n', out);
       break;
     case '\r':
-      putchar('\\');
-      putchar('r');
+      putc('\\', out);
+      putc('r', out);
       break;
     case '\t':
-      putchar('\\');
-      putchar('t');
+      putc('\\', out);
+      putc('t', out);
       break;
     case '/':
-      putchar('\\');
-      putchar('/');
+      putc('\\', out);
+      putc('/', out);
       break;
     default:
       if (*c < 0x20) {
-        printf("\\u%04x", *c);
+        fprintf(out, "\\u%04x", *c);
       } else {
-        putchar(*c);
+        putc(*c, out);
       }
     }
   }
-  putchar('"');
+  putc('"', out);
+}
+
+void print_json_str(const char *str) { fprint_json_str(stdout, str); }
+
+// --- JsonWriter ---
+
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <immintrin.h>
+#define JSON_SIMD 1
+#endif
+
+static inline bool json_needs_escape(unsigned char c) {
+  return c < 0x20 || c == '"' || c == '\\' || c == '/';
+}
+
+// Length of the prefix of s[0..n) that can be copied without escaping
+static size_t clean_span_scalar(const unsigned char *s, size_t n) {
+  size_t i = 0;
+  while (i < n && !json_needs_escape(s[i])) {
+    i++;
+  }
+  return i;
+}
+
+#ifdef JSON_SIMD
+static size_t clean_span_sse2(const unsigned char *s, size_t n) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i ctrl = _mm_set1_epi8(0x1f);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+    // min(v, 0x1f) == v  <=>  v <= 0x1f as unsigned bytes
+    __m128i hit = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, slash),
+                     _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)));
+    int mask = _mm_movemask_epi8(hit);
+    if (mask) {
+      return i + (size_t)__builtin_ctz((unsigned)mask);
+    }
+  }
+  return i + clean_span_scalar(s + i, n - i);
+}
+#endif
+
+// SSE2 is part of the x86-64 baseline, so no runtime dispatch is needed
+static size_t clean_span(const unsigned char *s, size_t n) {
+#ifdef JSON_SIMD
+  return clean_span_sse2(s, n);
+#else
+  return clean_span_scalar(s, n);
+#endif
+}
+
+// Same escapes as print_json_str so documents compare byte for byte
+static size_t json_escape_byte(unsigned char c, char *dst) {
+  static const char hex[] = "0123456789abcdef";
+  dst[0] = '\\';
+  switch (c) {
+  case '"':
+  case '\\':
+  case '/':
+    dst[1] = (char)c;
+    return 2;
+  case '\b':
+    dst[1] = 'b';
+    return 2;
+  case '\f':
+    dst[1] = 'f';
+    return 2;
+  case '\n':
+    dst[1] = 'n';
+    return 2;
+  case '\r':
+    dst[1] = 'r';
+    return 2;
+  case '\t':
+    dst[1] = 't';
+    return 2;
+  default:
+    dst[1] = 'u';
+    dst[2] = '0';
+    dst[3] = '0';
+    dst[4] = hex[c >> 4];
+    dst[5] = hex[c & 0xf];
+    return 6;
+  }
+}
+
+static void json_reserve(JsonWriter *w, size_t extra) {
+  if (w->len + extra <= w->cap) {
+    return;
+  }
+  size_t cap = w->cap ? w->cap : 256;
+  while (cap < w->len + extra) {
+    cap *= 2;
+  }
+  char *tmp = realloc(w->buf, cap);
+  if (!tmp) {
+    fprintf(stderr, "realloc failed\n");
+    exit(1);
+  }
+  w->buf = tmp;
+  w->cap = cap;
+}
+
+static void json_put(JsonWriter *w, const void *src, size_t n) {
+  json_reserve(w, n);
+  memcpy(w->buf + w->len, src, n);
+  w->len += n;
+}
+
+static void json_putc(JsonWriter *w, char c) {
+  json_reserve(w, 1);
+  w->buf[w->len++] = c;
+}
+
+// Comma before every element but the first of its container
+static void json_separate(JsonWriter *w) {
+  if (w->after_key) {
+    w->after_key = false;
+    return;
+  }
+  if (w->depth == 0 || w->depth > 64) {
+    return;
+  }
+  uint64_t bit = UINT64_C(1) << (w->depth - 1);
+  if (w->has_items & bit) {
+    json_putc(w, ',');
+  }
+  w->has_items |= bit;
+}
+
+static void json_open(JsonWriter *w, char c) {
+  json_separate(w);
+  json_putc(w, c);
+  w->depth++;
+  if (w->depth <= 64) {
+    w->has_items &= ~(UINT64_C(1) << (w->depth - 1));
+  }
+}
+
+static void json_close(JsonWriter *w, char c) {
+  if (w->depth > 0) {
+    w->depth--;
+  }
+  json_putc(w, c);
+}
+
+void json_writer_init(JsonWriter *w) { memset(w, 0, sizeof(*w)); }
+
+void json_writer_free(JsonWriter *w) {
+  free(w->buf);
+  memset(w, 0, sizeof(*w));
+}
+
+void json_writer_reset(JsonWriter *w) {
+  w->len = 0;
+  w->has_items = 0;
+  w->depth = 0;
+  w->after_key = false;
+}
+
+long json_writer_emit(JsonWriter *w, FILE *out) {
+  json_putc(w, '\n');
+  long ret = (long)w->len;
+  fflush(out);
+  int fd = fileno(out);
+  if (fd >= 0) {
+    size_t done = 0;
+    while (done < w->len) {
+      ssize_t n = write(fd, w->buf + done, w->len - done);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        ret = -1;
+        break;
+      }
+      done += (size_t)n;
+    }
+  } else if (fwrite(w->buf, 1, w->len, out) != w->len || fflush(out) != 0) {
+    // Streams without an fd (newwbar-hub FIFOs) still see one flush
+    ret = -1;
+  }
+  json_writer_reset(w);
+  return ret;
+}
+
+void json_begin_object(JsonWriter *w) { json_open(w, '{'); }
+void json_end_object(JsonWriter *w) { json_close(w, '}'); }
+void json_begin_array(JsonWriter *w) { json_open(w, '['); }
+void json_end_array(JsonWriter *w) { json_close(w, ']'); }
+
+void json_key(JsonWriter *w, const char *key) {
+  json_string(w, key);
+  json_putc(w, ':');
+  w->after_key = true;
+}
+
+// NULL is written as an empty string
+void json_string(JsonWriter *w, const char *str) {
+  json_separate(w);
+  const unsigned char *s = (const unsigned char *)(str ? str : "");
+  size_t n = strlen((const char *)s);
+  json_reserve(w, n + 2);
+  w->buf[w->len++] = '"';
+  size_t i = 0;
+  while (i < n) {
+    size_t clean = clean_span(s + i, n - i);
+    json_put(w, s + i, clean);
+    i += clean;
+    if (i < n) {
+      char esc[6];
+      json_put(w, esc, json_escape_byte(s[i], esc));
+      i++;
+    }
+  }
+  json_putc(w, '"');
+}
+
+void json_int(JsonWriter *w, int64_t value) {
+  json_separate(w);
+  char digits[24];
+  size_t pos = sizeof(digits);
+  uint64_t v = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+  do {
+    digits[--pos] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  if (value < 0) {
+    digits[--pos] = '-';
+  }
+  json_put(w, digits + pos, sizeof(digits) - pos);
+}
+
+void json_double(JsonWriter *w, double value) {
+  json_separate(w);
+  if (!isfinite(value)) {
+    json_put(w, "null", 4);
+    return;
+  }
+  char digits[32];
+  int len = snprintf(digits, sizeof(digits), "%.6g", value);
+  json_put(w, digits, (size_t)len);
+}
+
+void json_bool(JsonWriter *w, bool value) {
+  json_separate(w);
+  if (value) {
+    json_put(w, "true", 4);
+  } else {
+    json_put(w, "false", 5);
+  }
+}
+
+// --- JsonScanner ---
+
+void json_scan_init(JsonScanner *s, const char *buf, size_t len) {
+  memset(s, 0, sizeof(*s));
+  s->p = buf;
+  s->end = buf + len;
+}
+
+static void scan_space(JsonScanner *s) {
+  while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' ||
+                           *s->p == '\r' || *s->p == ',' || *s->p == ':')) {
+    s->p++;
+  }
+}
+
+static bool scan_word(JsonScanner *s, const char *word, size_t len) {
+  if ((size_t)(s->end - s->p) < len || memcmp(s->p, word, len) != 0) {
+    return false;
+  }
+  s->p += len;
+  return true;
+}
+
+JsonToken json_scan_next(JsonScanner *s) {
+  scan_space(s);
+  if (s->p >= s->end || *s->p == '\0') {
+    return JSON_END;
+  }
+  const char *start = s->p;
+  switch (*s->p) {
+  case '{':
+    s->p++;
+    s->depth++;
+    return JSON_OBJECT;
+  case '[':
+    s->p++;
+    s->depth++;
+    return JSON_ARRAY;
+  case '}':
+    s->p++;
+    s->depth--;
+    return JSON_OBJECT_END;
+  case ']':
+    s->p++;
+    s->depth--;
+    return JSON_ARRAY_END;
+  case '"':
+    s->p++;
+    s->text = s->p;
+    while (s->p < s->end && *s->p != '"') {
+      s->p += *s->p == '\\' ? 2 : 1;
+    }
+    if (s->p >= s->end) {
+      return JSON_ERROR;
+    }
+    s->text_len = (size_t)(s->p - s->text);
+    s->p++;
+    // A key is the only string followed by a colon
+    while (s->p < s->end && (*s->p == ' ' || *s->p == '\t' || *s->p == '\n' ||
+                             *s->p == '\r')) {
+      s->p++;
+    }
+    if (s->p < s->end && *s->p == ':') {
+      s->p++;
+      return JSON_KEY;
+    }
+    return JSON_STRING;
+  case 't':
+    return scan_word(s, "true", 4) ? JSON_TRUE : JSON_ERROR;
+  case 'f':
+    return scan_word(s, "false", 5) ? JSON_FALSE : JSON_ERROR;
+  case 'n':
+    return scan_word(s, "null", 4) ? JSON_NULL : JSON_ERROR;
+  default:
+    while (s->p < s->end && (memchr("+-.eE", *s->p, 5) ||
+                             (*s->p >= '0' && *s->p <= '9'))) {
+      s->p++;
+    }
+    if (s->p == start) {
+      return JSON_ERROR;
+    }
+    s->text = start;
+    s->text_len = (size_t)(s->p - start);
+    return JSON_NUMBER;
+  }
+}
+
+// Consumes the rest of the container whose opening token was just read
+static void scan_close(JsonScanner *s) {
+  int depth = s->depth - 1;
+  JsonToken t;
+  while (s->depth > depth && (t = json_scan_next(s)) != JSON_END &&
+         t != JSON_ERROR)
+    ;
+}
+
+void json_scan_skip(JsonScanner *s) {
+  JsonToken t = json_scan_next(s);
+  if (t == JSON_OBJECT || t == JSON_ARRAY) {
+    scan_close(s);
+  }
+}
+
+bool json_scan_key_is(const JsonScanner *s, const char *key) {
+  return strlen(key) == s->text_len && memcmp(s->text, key, s->text_len) == 0;
+}
+
+// Next token if it is a scalar; a container is skipped whole
+static JsonToken scan_scalar(JsonScanner *s) {
+  JsonToken t = json_scan_next(s);
+  if (t == JSON_OBJECT || t == JSON_ARRAY) {
+    scan_close(s);
+    return JSON_NULL;
+  }
+  return t;
+}
+
+bool json_scan_object(JsonScanner *s) {
+  JsonToken t = json_scan_next(s);
+  if (t == JSON_ARRAY) {
+    scan_close(s);
+  }
+  return t == JSON_OBJECT;
+}
+
+bool json_scan_array(JsonScanner *s) {
+  JsonToken t = json_scan_next(s);
+  if (t == JSON_OBJECT) {
+    scan_close(s);
+  }
+  return t == JSON_ARRAY;
+}
+
+bool json_scan_get_int(JsonScanner *s, int64_t *value) {
+  if (scan_scalar(s) != JSON_NUMBER) {
+    return false;
+  }
+  const char *p = s->text, *end = s->text + s->text_len;
+  bool negative = p < end && *p == '-';
+  uint64_t v = 0;
+  for (p += negative; p < end && *p >= '0' && *p <= '9'; p++) {
+    v = v * 10 + (uint64_t)(*p - '0');
+  }
+  *value = negative ? -(int64_t)v : (int64_t)v;
+  return true;
+}
+
+bool json_scan_get_double(JsonScanner *s, double *value) {
+  if (scan_scalar(s) != JSON_NUMBER) {
+    return false;
+  }
+  char number[64];
+  size_t len = s->text_len < sizeof(number) - 1 ? s->text_len
+                                                 : sizeof(number) - 1;
+  memcpy(number, s->text, len);
+  number[len] = '\0';
+  *value = strtod(number, NULL);
+  return true;
+}
+
+bool json_scan_get_bool(JsonScanner *s, bool *value) {
+  JsonToken t = scan_scalar(s);
+  if (t != JSON_TRUE && t != JSON_FALSE) {
+    return false;
+  }
+  *value = t == JSON_TRUE;
+  return true;
+}
+
+// Length of DST[0..LEN) without a multibyte sequence cut off at its end
+static size_t utf8_boundary(const char *dst, size_t len) {
+  size_t lead = len;
+  while (lead > 0 && ((unsigned char)dst[lead - 1] & 0xc0) == 0x80) {
+    lead--;
+  }
+  if (lead == 0) {
+    return len;
+  }
+  unsigned char c = (unsigned char)dst[lead - 1];
+  size_t need = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 1;
+  return len - (lead - 1) < need ? lead - 1 : len;
+}
+
+static size_t utf8_encode(unsigned long cp, char *dst) {
+  if (cp < 0x80) {
+    dst[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    dst[0] = (char)(0xc0 | (cp >> 6));
+    dst[1] = (char)(0x80 | (cp & 0x3f));
+    return 2;
+  }
+  dst[0] = (char)(0xe0 | (cp >> 12));
+  dst[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+  dst[2] = (char)(0x80 | (cp & 0x3f));
+  return 3;
+}
+
+bool json_scan_get_string(JsonScanner *s, char *dst, size_t size) {
+  if (scan_scalar(s) != JSON_STRING || size == 0) {
+    return false;
+  }
+  size_t out = 0;
+  const char *p = s->text, *end = s->text + s->text_len;
+  while (p < end && out + 1 < size) {
+    char c = *p++;
+    if (c != '\\' || p >= end) {
+      dst[out++] = c;
+      continue;
+    }
+    char buf[4];
+    size_t n = 1;
+    switch (c = *p++) {
+    case 'b':
+      buf[0] = '\b';
+      break;
+    case 'f':
+      buf[0] = '\f';
+      break;
+    case 'n':
+      buf[0] = '\n';
+      break;
+    case 'r':
+      buf[0] = '\r';
+      break;
+    case 't':
+      buf[0] = '\t';
+      break;
+    case 'u':
+      if (end - p >= 4) {
+        char hex[5] = {p[0], p[1], p[2], p[3], '\0'};
+        unsigned long cp = strtoul(hex, NULL, 16);
+        p += 4;
+        if (cp >= 0xd800 && cp < 0xe000) {
+          buf[0] = '?'; // surrogate pairs are not joined
+        } else {
+          n = utf8_encode(cp, buf);
+        }
+      } else {
+        buf[0] = '?';
+      }
+      break;
+    default:
+      buf[0] = c;
+    }
+    if (out + n >= size) {
+      break; // the escape stays out whole
+    }
+    memcpy(dst + out, buf, n);
+    out += n;
+  }
+  if (out + 1 >= size) {
+    out = utf8_boundary(dst, out);
+  }
+  dst[out] = '\0';
+  return true;
 }
@@ -1,6 +1,87 @@
 #ifndef JSON_SEEN
 #define JSON_SEEN
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+void fprint_json_str(FILE *out, const char *str);
 void print_json_str(const char *str);
 
+/* JsonWriter: builds one JSON document into a reusable buffer.
+ * Separators are inserted automatically, so callers only describe the
+ * structure. json_writer_emit() appends '\n', hands the whole line to the
+ * stream in a single write, resets the writer for the next document and
+ * returns the number of bytes written, or -1 on error. */
+typedef struct {
+  char *buf;
+  size_t len;
+  size_t cap;
+  uint64_t has_items; // bit n set once depth n+1 holds an element
+  int depth;          // nesting depth, at most 64
+  bool after_key;     // next value belongs to the key just written
+} JsonWriter;
+
+void json_writer_init(JsonWriter *w);
+void json_writer_free(JsonWriter *w);
+void json_writer_reset(JsonWriter *w);
+long json_writer_emit(JsonWriter *w, FILE *out);
+
+void json_begin_object(JsonWriter *w);
+void json_end_object(JsonWriter *w);
+void json_begin_array(JsonWriter *w);
+void json_end_array(JsonWriter *w);
+void json_key(JsonWriter *w, const char *key);
+void json_string(JsonWriter *w, const char *str);
+void json_int(JsonWriter *w, int64_t value);
+// Shortest of up to 6 significant digits; non-finite values become null
+void json_double(JsonWriter *w, double value);
+void json_bool(JsonWriter *w, bool value);
+
+/* JsonScanner: pull tokenizer over a complete reply, for picking a few keys
+ * out of a document without building it in memory. Tokens point into the
+ * buffer; a string followed by ':' comes back as JSON_KEY, commas and
+ * colons are consumed silently. The scanner does not validate: malformed
+ * input ends in JSON_ERROR or JSON_END, never a crash.
+ *
+ * The json_scan_get_*() helpers read the next value; anything of another
+ * type, including a whole object or array, is skipped and they return
+ * false. json_scan_object()/json_scan_array() return true after entering a
+ * container of that kind. */
+typedef enum {
+  JSON_END,
+  JSON_ERROR,
+  JSON_OBJECT,
+  JSON_OBJECT_END,
+  JSON_ARRAY,
+  JSON_ARRAY_END,
+  JSON_KEY,
+  JSON_STRING,
+  JSON_NUMBER,
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL,
+} JsonToken;
+
+typedef struct {
+  const char *p;
+  const char *end;
+  const char *text; // string contents (escapes kept) or number
+  size_t text_len;
+  int depth; // containers open after the current token
+} JsonScanner;
+
+void json_scan_init(JsonScanner *s, const char *buf, size_t len);
+JsonToken json_scan_next(JsonScanner *s);
+void json_scan_skip(JsonScanner *s);
+bool json_scan_key_is(const JsonScanner *s, const char *key);
+bool json_scan_object(JsonScanner *s);
+bool json_scan_array(JsonScanner *s);
+bool json_scan_get_int(JsonScanner *s, int64_t *value);
+bool json_scan_get_double(JsonScanner *s, double *value);
+bool json_scan_get_bool(JsonScanner *s, bool *value);
+// Unescapes into dst, truncating to size - 1 bytes at a UTF-8 boundary
+bool json_scan_get_string(JsonScanner *s, char *dst, size_t size);
+
 #endif
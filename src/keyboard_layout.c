@@ -0,0 +1,324 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "hypr.h"
+#include "json.h"
+#include "stats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Keyboard layout and submap. Every keyboard's active keymap is kept, but
+ * only the one Hyprland calls main is shown (the last one to switch when
+ * none is), so a virtual keyboard announcing its own layout prints
+ * nothing. Lines are only written when what is shown changes. Hyprland
+ * has no -j query for the submap; the bar starts outside one. */
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    printf(fmt "\n", ##__VA_ARGS__);                                           \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+typedef struct {
+  char *name;
+  char *layout;
+  bool main;
+} Keyboard;
+
+// Grows on demand, in the order Hyprland lists them
+static Keyboard *keyboards = NULL;
+static size_t keyboard_count = 0;
+static size_t keyboard_cap = 0;
+static size_t last_switched = 0; // shown when no keyboard is main
+static char submap[HYPR_NAME_LEN] = "";
+static bool stale = false; // configreloaded; ask Hyprland
+static FILE *out;
+static JsonWriter json;
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+enum { KB_LAYOUT, KB_KEYBOARD, KB_SUBMAP };
+static const char *const keyboard_fields[] = {"layout", "keyboard", "submap"};
+static FieldSet fields = FIELD_SET("keyboard_layout", keyboard_fields);
+
+static const Keyboard *shown_keyboard(void) {
+  for (size_t i = 0; i < keyboard_count; i++) {
+    if (keyboards[i].main) {
+      return &keyboards[i];
+    }
+  }
+  return last_switched < keyboard_count ? &keyboards[last_switched] : NULL;
+}
+
+static void publish(void) {
+  const Keyboard *kb = shown_keyboard();
+  const char *layout = kb ? kb->layout : "";
+  const char *name = kb ? kb->name : "";
+
+  // Hash what would be printed before formatting it
+  ChangeHash h;
+  change_hash_init(&h);
+  if (field_on(&fields, KB_LAYOUT)) {
+    change_hash_update(&h, layout, strlen(layout) + 1);
+  }
+  if (field_on(&fields, KB_KEYBOARD)) {
+    change_hash_update(&h, name, strlen(name) + 1);
+  }
+  if (field_on(&fields, KB_SUBMAP)) {
+    change_hash_update(&h, submap, strlen(submap) + 1);
+  }
+  if (!change_check_hash(&changes, change_hash_digest(&h))) {
+    coalesce_suppressed(coalescer);
+    return;
+  }
+
+  json_begin_object(&json);
+  if (field_on(&fields, KB_LAYOUT)) {
+    json_key(&json, keyboard_fields[KB_LAYOUT]);
+    json_string(&json, layout);
+  }
+  if (field_on(&fields, KB_KEYBOARD)) {
+    json_key(&json, keyboard_fields[KB_KEYBOARD]);
+    json_string(&json, name);
+  }
+  if (field_on(&fields, KB_SUBMAP)) {
+    json_key(&json, keyboard_fields[KB_SUBMAP]);
+    json_string(&json, submap);
+  }
+  json_end_object(&json);
+  coalesce_line(coalescer, json.buf, json.len);
+  json_writer_reset(&json);
+}
+
+// --- Keyboard table ---
+
+static Keyboard *find_keyboard(const char *name, size_t len) {
+  for (size_t i = 0; i < keyboard_count; i++) {
+    if (strlen(keyboards[i].name) == len &&
+        memcmp(keyboards[i].name, name, len) == 0) {
+      return &keyboards[i];
+    }
+  }
+  return NULL;
+}
+
+static Keyboard *add_keyboard(const char *name, size_t len) {
+  if (keyboard_count == keyboard_cap) {
+    size_t cap = keyboard_cap ? keyboard_cap * 2 : 4;
+    Keyboard *grown = realloc(keyboards, cap * sizeof(*grown));
+    if (!grown) {
+      return NULL;
+    }
+    keyboards = grown;
+    keyboard_cap = cap;
+  }
+  char *copy = strndup(name, len);
+  char *layout = strdup("");
+  if (!copy || !layout) {
+    free(copy);
+    free(layout);
+    return NULL;
+  }
+  Keyboard *kb = &keyboards[keyboard_count++];
+  kb->name = copy;
+  kb->layout = layout;
+  kb->main = false;
+  return kb;
+}
+
+static void clear_keyboards(void) {
+  for (size_t i = 0; i < keyboard_count; i++) {
+    free(keyboards[i].name);
+    free(keyboards[i].layout);
+  }
+  keyboard_count = 0;
+  last_switched = 0;
+}
+
+static void set_layout(Keyboard *kb, const char *layout, size_t len) {
+  last_switched = (size_t)(kb - keyboards);
+  if (strlen(kb->layout) == len && memcmp(kb->layout, layout, len) == 0) {
+    return;
+  }
+  char *copy = strndup(layout, len);
+  if (copy) {
+    free(kb->layout);
+    kb->layout = copy;
+  }
+}
+
+// --- j/devices ---
+
+// The table is only dropped once the reply is in
+static void take_keyboard(const HyprKeyboard *hk, void *data) {
+  bool *cleared = data;
+  if (!*cleared) {
+    clear_keyboards();
+    *cleared = true;
+  }
+  Keyboard *kb = add_keyboard(hk->name, strlen(hk->name));
+  if (kb) {
+    set_layout(kb, hk->layout, strlen(hk->layout));
+    kb->main = hk->main;
+  }
+}
+
+static void refresh(void) {
+  bool cleared = false;
+  if (hypr_keyboards(take_keyboard, &cleared) < 0) {
+    DEBUG_MSG("devices request failed");
+    stale = true; // keep what we have and ask again after the next event
+    return;
+  }
+  if (!cleared) {
+    clear_keyboards();
+  }
+  stale = false;
+  DEBUG_MSG("refresh: %zu keyboards", keyboard_count);
+}
+
+// --- Events ---
+
+// activelayout>>KEYBOARD,LAYOUT  submap>>NAME (empty when leaving one)
+// Keyboard names are Hyprland's internal ones, which have no commas.
+static void on_event(HyprEvent event, const char *data, size_t len) {
+  DEBUG_MSG("CAUGHT: %.*s", (int)len, data);
+  stats_event(stats);
+  switch (event) {
+  case HYPR_ACTIVELAYOUT: {
+    const char *comma = memchr(data, ',', len);
+    if (!comma) {
+      break;
+    }
+    size_t name_len = (size_t)(comma - data);
+    Keyboard *kb = find_keyboard(data, name_len);
+    if (!kb && !(kb = add_keyboard(data, name_len))) {
+      break;
+    }
+    set_layout(kb, comma + 1, len - name_len - 1);
+    break;
+  }
+  case HYPR_SUBMAP:
+    snprintf(submap, sizeof(submap), "%.*s", (int)len, data);
+    break;
+  default:
+    stale = true; // configreloaded: keymaps may have changed
+    break;
+  }
+}
+
+static void on_done(void) {
+  if (stale) {
+    refresh();
+  }
+  publish();
+}
+
+// A restarted Hyprland starts outside any submap
+static void on_reconnect(void) {
+  submap[0] = '\0';
+  stale = true;
+  on_done();
+}
+
+static const HyprSubscriber subscriber = {
+    "keyboard_layout",
+    HYPR_MASK(HYPR_ACTIVELAYOUT) | HYPR_MASK(HYPR_SUBMAP) |
+        HYPR_MASK(HYPR_CONFIGRELOADED),
+    on_event, on_done, on_reconnect};
+
+// --- Subscribe to the socket2 bus, which must be open already ---
+int keyboard_layout_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return -1;
+  }
+  out = stream;
+  stats = stats_stream("keyboard_layout");
+  coalescer =
+      coalesce_new("keyboard_layout", out, stats, COALESCE_DEFAULT_HZ);
+  if (hypr_bus_subscribe(&subscriber) < 0) {
+    DEBUG_MSG("too many socket2 subscribers");
+    return -1;
+  }
+
+  refresh();
+  publish();
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG("DEBUG enabled.");
+  stats_init("keyboard_layout");
+  int sock = hypr_bus_open();
+  if (sock < 0) {
+    DEBUG_MSG("socket2 connect failed");
+    return 1;
+  }
+  if (keyboard_layout_start(stdout) < 0) {
+    return 1;
+  }
+
+  do {
+    while (coalesce_poll(sock) > 0 && hypr_bus_dispatch(sock) == 0)
+      ;
+    DEBUG_MSG("Socket closed");
+    close(sock);
+    coalesce_flush_all(); // the last state stands while Hyprland is away
+  } while ((sock = hypr_bus_wait()) >= 0);
+  return 0;
+}
+#endif
@@ -0,0 +1,351 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "hypr.h"
+#include "json.h"
+#include "stats.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    printf(fmt "\n", ##__VA_ARGS__);                                           \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+typedef struct {
+  char *name;
+  int id;
+  bool focused;
+  double scale;
+  int activeWorkspace;
+  bool listed; // seen in the last j/monitors reply
+} Monitor;
+
+// Grows on demand, sorted by id
+static Monitor *monitors = NULL;
+static size_t monitor_count = 0;
+static size_t monitor_cap = 0;
+static bool changed = false; // something printed differs from the last line
+static bool stale = false;   // a monitor came or went; ask Hyprland
+static FILE *out;
+static JsonWriter json;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+enum { MON_NAME, MON_ID, MON_FOCUSED, MON_SCALE, MON_ACTIVE };
+static const char *const monitor_fields[] = {"name", "id", "focused", "scale",
+                                             "activeWorkspace"};
+static FieldSet fields = FIELD_SET("monitor_list", monitor_fields);
+
+static void print_json(void) {
+  json_begin_array(&json);
+  for (size_t i = 0; i < monitor_count; i++) {
+    const Monitor *m = &monitors[i];
+    json_begin_object(&json);
+    if (field_on(&fields, MON_NAME)) {
+      json_key(&json, monitor_fields[MON_NAME]);
+      json_string(&json, m->name);
+    }
+    if (field_on(&fields, MON_ID)) {
+      json_key(&json, monitor_fields[MON_ID]);
+      json_int(&json, m->id);
+    }
+    if (field_on(&fields, MON_FOCUSED)) {
+      json_key(&json, monitor_fields[MON_FOCUSED]);
+      json_bool(&json, m->focused);
+    }
+    if (field_on(&fields, MON_SCALE)) {
+      json_key(&json, monitor_fields[MON_SCALE]);
+      json_double(&json, m->scale);
+    }
+    if (field_on(&fields, MON_ACTIVE)) {
+      json_key(&json, monitor_fields[MON_ACTIVE]);
+      json_int(&json, m->activeWorkspace);
+    }
+    json_end_object(&json);
+  }
+  json_end_array(&json);
+  coalesce_line(coalescer, json.buf, json.len);
+  json_writer_reset(&json);
+  changed = false;
+}
+
+// --- Monitor table ---
+
+static Monitor *find_monitor(const char *name, size_t len) {
+  for (size_t i = 0; i < monitor_count; i++) {
+    if (strlen(monitors[i].name) == len &&
+        memcmp(monitors[i].name, name, len) == 0) {
+      return &monitors[i];
+    }
+  }
+  return NULL;
+}
+
+static Monitor *focused_monitor(void) {
+  for (size_t i = 0; i < monitor_count; i++) {
+    if (monitors[i].focused) {
+      return &monitors[i];
+    }
+  }
+  return NULL;
+}
+
+static void set_focused(Monitor *m) {
+  for (size_t i = 0; i < monitor_count; i++) {
+    bool focused = &monitors[i] == m;
+    if (monitors[i].focused != focused) {
+      monitors[i].focused = focused;
+      changed = changed || field_on(&fields, MON_FOCUSED);
+    }
+  }
+}
+
+static void set_active(Monitor *m, int workspace) {
+  if (m && m->activeWorkspace != workspace) {
+    m->activeWorkspace = workspace;
+    changed = changed || field_on(&fields, MON_ACTIVE);
+  }
+}
+
+static void remove_monitor(Monitor *m) {
+  size_t i = (size_t)(m - monitors);
+  free(m->name);
+  memmove(&monitors[i], &monitors[i + 1],
+          (monitor_count - i - 1) * sizeof(*monitors));
+  monitor_count--;
+  changed = true;
+}
+
+static Monitor *add_monitor(const char *name, int id) {
+  if (monitor_count == monitor_cap) {
+    size_t cap = monitor_cap ? monitor_cap * 2 : 4;
+    Monitor *grown = realloc(monitors, cap * sizeof(*grown));
+    if (!grown) {
+      return NULL;
+    }
+    monitors = grown;
+    monitor_cap = cap;
+  }
+  char *copy = strdup(name);
+  if (!copy) {
+    return NULL;
+  }
+  size_t i = monitor_count;
+  while (i > 0 && monitors[i - 1].id > id) {
+    monitors[i] = monitors[i - 1];
+    i--;
+  }
+  memset(&monitors[i], 0, sizeof(*monitors));
+  monitors[i].name = copy;
+  monitors[i].id = id;
+  monitors[i].scale = 1.0;
+  monitor_count++;
+  changed = true;
+  return &monitors[i];
+}
+
+// --- j/monitors, merged so only real differences print ---
+
+static void take_monitor(const HyprMonitor *hm, void *data) {
+  (void)data; // suppress unused paramater warning
+  Monitor *m = find_monitor(hm->name, strlen(hm->name));
+  if (m && m->id != hm->id) {
+    remove_monitor(m); // re-added in id order
+    m = NULL;
+  }
+  if (!m && !(m = add_monitor(hm->name, hm->id))) {
+    return;
+  }
+  m->listed = true;
+  if (hm->focused) {
+    set_focused(m);
+  }
+  if (m->scale != hm->scale) {
+    m->scale = hm->scale;
+    changed = changed || field_on(&fields, MON_SCALE);
+  }
+  set_active(m, hm->active_workspace);
+}
+
+static void refresh(void) {
+  for (size_t i = 0; i < monitor_count; i++) {
+    monitors[i].listed = false;
+  }
+  if (hypr_monitors(take_monitor, NULL) < 0) {
+    DEBUG_MSG("monitors request failed");
+    return; // keep what we have; the next monitor event asks again
+  }
+  for (size_t i = monitor_count; i-- > 0;) {
+    if (!monitors[i].listed) {
+      remove_monitor(&monitors[i]);
+    }
+  }
+  stale = false;
+  DEBUG_MSG("refresh: %zu monitors", monitor_count);
+}
+
+// --- Events ---
+
+// focusedmon>>MONITOR,WORKSPACENAME  focusedmonv2>>MONITOR,WORKSPACEID
+// workspacev2>>ID,NAME  monitorremoved>>MONITOR
+// monitoradded and configreloaded (scale may have changed) are answered by
+// asking Hyprland once the read is done.
+static void on_event(HyprEvent event, const char *data, size_t len) {
+  DEBUG_MSG("CAUGHT: %.*s", (int)len, data);
+  stats_event(stats);
+  switch (event) {
+  case HYPR_FOCUSEDMON:
+  case HYPR_FOCUSEDMONV2: {
+    const char *comma = memchr(data, ',', len);
+    Monitor *m = comma ? find_monitor(data, (size_t)(comma - data)) : NULL;
+    if (!m) {
+      stale = true;
+      break;
+    }
+    set_focused(m);
+    // v1 carries the workspace name, which is the id for numbered ones
+    char *end;
+    long workspace = strtol(comma + 1, &end, 10);
+    if (end != comma + 1 && *end == '\n') {
+      set_active(m, (int)workspace);
+    }
+    break;
+  }
+  case HYPR_WORKSPACEV2: {
+    char *end;
+    long workspace = strtol(data, &end, 10);
+    if (end != data && *end == ',') {
+      set_active(focused_monitor(), (int)workspace);
+    }
+    break;
+  }
+  case HYPR_MONITORREMOVED: {
+    Monitor *m = find_monitor(data, len);
+    if (m) {
+      remove_monitor(m);
+    }
+    break;
+  }
+  default:
+    stale = true;
+    break;
+  }
+}
+
+static void on_done(void) {
+  if (stale) {
+    refresh();
+  }
+  if (changed) {
+    print_json();
+  } else {
+    coalesce_suppressed(coalescer);
+  }
+}
+
+static void on_reconnect(void) {
+  stale = true;
+  on_done();
+}
+
+static const HyprSubscriber subscriber = {
+    "monitor_list",
+    HYPR_MASK(HYPR_FOCUSEDMON) | HYPR_MASK(HYPR_FOCUSEDMONV2) |
+        HYPR_MASK(HYPR_WORKSPACEV2) | HYPR_MASK(HYPR_MONITORADDED) |
+        HYPR_MASK(HYPR_MONITORREMOVED) | HYPR_MASK(HYPR_CONFIGRELOADED),
+    on_event, on_done, on_reconnect};
+
+// --- Subscribe to the socket2 bus, which must be open already ---
+int monitor_list_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return -1;
+  }
+  out = stream;
+  stats = stats_stream("monitor_list");
+  coalescer = coalesce_new("monitor_list", out, stats, COALESCE_DEFAULT_HZ);
+  if (hypr_bus_subscribe(&subscriber) < 0) {
+    DEBUG_MSG("too many socket2 subscribers");
+    return -1;
+  }
+
+  refresh();
+  print_json(); // initialize, even when it matches the snapshot
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG("DEBUG enabled.");
+  stats_init("monitor_list");
+  int sock = hypr_bus_open();
+  if (sock < 0) {
+    DEBUG_MSG("socket2 connect failed");
+    return 1;
+  }
+  if (monitor_list_start(stdout) < 0) {
+    return 1;
+  }
+
+  do {
+    while (coalesce_poll(sock) > 0 && hypr_bus_dispatch(sock) == 0)
+      ;
+    DEBUG_MSG("Socket closed");
+    close(sock);
+    coalesce_flush_all(); // the last state stands while Hyprland is away
+  } while ((sock = hypr_bus_wait()) >= 0);
+  return 0;
+}
+#endif
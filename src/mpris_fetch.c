@@ -38,7 +38,13 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "stats.h"
 #include <dbus/dbus.h>
+#include <glib-unix.h>
 #include <glib.h>
 #include <json-glib/json-glib.h>
 #include <playerctl/playerctl.h>
@@ -114,7 +120,6 @@ typedef struct {
 /* Structure to hold PulseAudio context and data */
 typedef struct {
   pa_context *context;
-  pa_glib_mainloop *mainloop;
   GList **players;
 } PulseData;
 
@@ -125,15 +130,54 @@ typedef struct {
 } ArtUrlWatchData;
 
 /* Store last JSON output for change detection */
-static gchar *last_json_output = NULL;
-static guint debounce_timeout_id = 0;
+static ChangeDetector changes;
+static FILE *out;
+static GList *player_list = NULL;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+/* JSON members of a player, in output order */
+enum {
+  PLAYER_INSTANCE,
+  PLAYER_NAME,
+  PLAYER_MEDIA_NAME,
+  PLAYER_CAN_QUIT,
+  PLAYER_CAN_CONTROL,
+  PLAYER_CAN_GO_NEXT,
+  PLAYER_CAN_GO_PREVIOUS,
+  PLAYER_CAN_PAUSE,
+  PLAYER_CAN_PLAY,
+  PLAYER_CAN_SEEK,
+  PLAYER_PLAYBACK_STATUS,
+  PLAYER_TITLE,
+  PLAYER_ALBUM,
+  PLAYER_ARTIST,
+  PLAYER_ART_URL,
+  PLAYER_POSITION,
+  PLAYER_LENGTH,
+  PLAYER_LENGTH_HMS,
+  PLAYER_SHUFFLE,
+  PLAYER_LOOP,
+  PLAYER_INDEX,
+  PLAYER_SINK_ID,
+  PLAYER_VOLUME,
+  PLAYER_IS_MUTE,
+};
+static const char *const player_fields[] = {
+    "instance",   "name",      "mediaName",      "canQuit",
+    "canControl", "canGoNext", "canGoPrevious",  "canPause",
+    "canPlay",    "canSeek",   "playbackStatus", "title",
+    "album",      "artist",    "artUrl",         "position",
+    "length",     "lengthHMS", "shuffle",        "loop",
+    "index",      "sinkId",    "volume",         "isMute"};
+static FieldSet fields = FIELD_SET("mpris_fetch", player_fields);
 
 /* Forward declarations */
 static void player_data_free(gpointer data);
 static void print_player_list(GList *players, gboolean force_output);
 static void update_metadata(PlayerData *data, PulseData *pulse);
 
-void cleanup_art_url_watch(PlayerData *data) {
+static void cleanup_art_url_watch(PlayerData *data) {
   if (!data || data->art_url_watch_id == 0) {
     return;
   }
@@ -189,7 +233,7 @@ static gboolean on_art_file_created(GIOChannel *source, GIOCondition condition,
   return G_SOURCE_REMOVE;
 }
 
-void setup_art_url_inotify(PlayerData *data, PulseData *pulse) {
+static void setup_art_url_inotify(PlayerData *data, PulseData *pulse) {
   if (!data || !data->art_url) {
     return;
   }
@@ -234,7 +278,7 @@ void setup_art_url_inotify(PlayerData *data, PulseData *pulse) {
 }
 
 // Convert seconds to HMS (MM:SS or H:MM:SS), or "live" for specified max
-void to_hms(int64_t s, int64_t position, char *hms, size_t hms_size) {
+static void to_hms(int64_t s, int64_t position, char *hms, size_t hms_size) {
   /* HTML video players treat "live" playback a few ways:
    * 0 is "live" position unchanging and -n is a decrementing duration;
    * position & duration increment together "live" if position == duration;
@@ -471,6 +515,7 @@ static void subscribe_cb(pa_context *c, pa_subscription_event_type_t t,
     return;
   }
 
+  stats_event(stats);
   if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
     for (GList *l = *pulse->players; l; l = l->next) {
       PlayerData *p = l->data;
@@ -612,7 +657,7 @@ static gsize find_image_offset(const guchar *data, gsize len) {
   return 0;
 }
 
-gboolean base64_art_to_file(const gchar *filename, const gchar *base64) {
+static gboolean base64_art_to_file(const gchar *filename, const gchar *base64) {
   if (!filename || !base64 || !*base64) {
     return FALSE;
   }
@@ -761,9 +806,12 @@ static void update_metadata(PlayerData *data, PulseData *pulse) {
     error = NULL;
   }
 
-  /* Art URL */
-  gchar *raw_art_url = playerctl_player_print_metadata_prop(
-      data->player, "mpris:artUrl", &error);
+  /* Art URL; decoding and watching the cover is skipped when unused */
+  gchar *raw_art_url = NULL;
+  if (field_on(&fields, PLAYER_ART_URL)) {
+    raw_art_url = playerctl_player_print_metadata_prop(data->player,
+                                                       "mpris:artUrl", &error);
+  }
   if (error) {
     DEBUG_MSG("ERROR: Failed to get artUrl for %s: %s", safe_str(data->name),
               error->message);
@@ -847,17 +895,15 @@ static void update_metadata(PlayerData *data, PulseData *pulse) {
   DEBUG_MSG("INFO:  Updated metadata for %s", safe_str(data->instance));
 }
 
-static gboolean print_callback(gpointer user_data) {
-  gchar *json_str = (gchar *)user_data;
-  DEBUG_MSG("StdOut:");
-  g_print("%s\n", json_str);
-  DEBUG_MSG("------");
-  g_free(last_json_output);
-  last_json_output = g_strdup(json_str);
-  g_free(json_str);
-  debounce_timeout_id = 0;
-  return FALSE;
+/* Starts a member unless --fields left it out */
+static gboolean add_member(JsonBuilder *builder, unsigned int field) {
+  if (!field_on(&fields, field)) {
+    return FALSE;
+  }
+  json_builder_set_member_name(builder, player_fields[field]);
+  return TRUE;
 }
+
 /* Helper function to print the list of players as JSON */
 static void print_player_list(GList *players, gboolean force_output) {
   JsonBuilder *builder = json_builder_new();
@@ -867,81 +913,83 @@ static void print_player_list(GList *players, gboolean force_output) {
     PlayerData *data = iter->data;
     json_builder_begin_object(builder);
 
-    json_builder_set_member_name(builder, "instance");
-    json_builder_add_string_value(builder, data->instance);
-
-    json_builder_set_member_name(builder, "name");
-    json_builder_add_string_value(
-        builder, data->display_name ? data->display_name : data->name);
-
-    json_builder_set_member_name(builder, "mediaName");
-    json_builder_add_string_value(builder, data->media_name ? data->media_name
-                                                            : data->name);
-
-    json_builder_set_member_name(builder, "canQuit");
-    json_builder_add_boolean_value(builder, data->can_quit);
-
-    json_builder_set_member_name(builder, "canControl");
-    json_builder_add_boolean_value(builder, data->can_control);
-
-    json_builder_set_member_name(builder, "canGoNext");
-    json_builder_add_boolean_value(builder, data->can_go_next);
-
-    json_builder_set_member_name(builder, "canGoPrevious");
-    json_builder_add_boolean_value(builder, data->can_go_previous);
-
-    json_builder_set_member_name(builder, "canPause");
-    json_builder_add_boolean_value(builder, data->can_pause);
-
-    json_builder_set_member_name(builder, "canPlay");
-    json_builder_add_boolean_value(builder, data->can_play);
-
-    json_builder_set_member_name(builder, "canSeek");
-    json_builder_add_boolean_value(builder, data->can_seek);
-
-    json_builder_set_member_name(builder, "playbackStatus");
-    json_builder_add_int_value(builder, data->playback_status);
-
-    json_builder_set_member_name(builder, "title");
-    json_builder_add_string_value(builder, data->title ? data->title : "");
-
-    json_builder_set_member_name(builder, "album");
-    json_builder_add_string_value(builder, data->album ? data->album : "");
-
-    json_builder_set_member_name(builder, "artist");
-    json_builder_add_string_value(builder, data->artist ? data->artist : "");
-
-    json_builder_set_member_name(builder, "artUrl");
-    json_builder_add_string_value(builder, data->art_url ? data->art_url : "");
-
-    json_builder_set_member_name(builder, "position");
-    json_builder_add_int_value(builder, data->position);
-
-    json_builder_set_member_name(builder, "length");
-    json_builder_add_int_value(builder, data->length);
-
-    json_builder_set_member_name(builder, "lengthHMS");
-    char hms[32] = "";
-    to_hms(data->length, data->position, hms, sizeof(hms));
-    json_builder_add_string_value(builder, hms);
-
-    json_builder_set_member_name(builder, "shuffle");
-    json_builder_add_int_value(builder, data->shuffle);
-
-    json_builder_set_member_name(builder, "loop");
-    json_builder_add_int_value(builder, data->loop_status);
-
-    json_builder_set_member_name(builder, "index");
-    json_builder_add_int_value(builder, data->index);
-
-    json_builder_set_member_name(builder, "sinkId");
-    json_builder_add_int_value(builder, data->sink);
-
-    json_builder_set_member_name(builder, "volume");
-    json_builder_add_int_value(builder, data->volume);
-
-    json_builder_set_member_name(builder, "isMute");
-    json_builder_add_boolean_value(builder, data->mute);
+    if (add_member(builder, PLAYER_INSTANCE)) {
+      json_builder_add_string_value(builder, data->instance);
+    }
+    if (add_member(builder, PLAYER_NAME)) {
+      json_builder_add_string_value(
+          builder, data->display_name ? data->display_name : data->name);
+    }
+    if (add_member(builder, PLAYER_MEDIA_NAME)) {
+      json_builder_add_string_value(
+          builder, data->media_name ? data->media_name : data->name);
+    }
+    if (add_member(builder, PLAYER_CAN_QUIT)) {
+      json_builder_add_boolean_value(builder, data->can_quit);
+    }
+    if (add_member(builder, PLAYER_CAN_CONTROL)) {
+      json_builder_add_boolean_value(builder, data->can_control);
+    }
+    if (add_member(builder, PLAYER_CAN_GO_NEXT)) {
+      json_builder_add_boolean_value(builder, data->can_go_next);
+    }
+    if (add_member(builder, PLAYER_CAN_GO_PREVIOUS)) {
+      json_builder_add_boolean_value(builder, data->can_go_previous);
+    }
+    if (add_member(builder, PLAYER_CAN_PAUSE)) {
+      json_builder_add_boolean_value(builder, data->can_pause);
+    }
+    if (add_member(builder, PLAYER_CAN_PLAY)) {
+      json_builder_add_boolean_value(builder, data->can_play);
+    }
+    if (add_member(builder, PLAYER_CAN_SEEK)) {
+      json_builder_add_boolean_value(builder, data->can_seek);
+    }
+    if (add_member(builder, PLAYER_PLAYBACK_STATUS)) {
+      json_builder_add_int_value(builder, data->playback_status);
+    }
+    if (add_member(builder, PLAYER_TITLE)) {
+      json_builder_add_string_value(builder, data->title ? data->title : "");
+    }
+    if (add_member(builder, PLAYER_ALBUM)) {
+      json_builder_add_string_value(builder, data->album ? data->album : "");
+    }
+    if (add_member(builder, PLAYER_ARTIST)) {
+      json_builder_add_string_value(builder, data->artist ? data->artist : "");
+    }
+    if (add_member(builder, PLAYER_ART_URL)) {
+      json_builder_add_string_value(builder,
+                                    data->art_url ? data->art_url : "");
+    }
+    if (add_member(builder, PLAYER_POSITION)) {
+      json_builder_add_int_value(builder, data->position);
+    }
+    if (add_member(builder, PLAYER_LENGTH)) {
+      json_builder_add_int_value(builder, data->length);
+    }
+    if (add_member(builder, PLAYER_LENGTH_HMS)) {
+      char hms[32] = "";
+      to_hms(data->length, data->position, hms, sizeof(hms));
+      json_builder_add_string_value(builder, hms);
+    }
+    if (add_member(builder, PLAYER_SHUFFLE)) {
+      json_builder_add_int_value(builder, data->shuffle);
+    }
+    if (add_member(builder, PLAYER_LOOP)) {
+      json_builder_add_int_value(builder, data->loop_status);
+    }
+    if (add_member(builder, PLAYER_INDEX)) {
+      json_builder_add_int_value(builder, data->index);
+    }
+    if (add_member(builder, PLAYER_SINK_ID)) {
+      json_builder_add_int_value(builder, data->sink);
+    }
+    if (add_member(builder, PLAYER_VOLUME)) {
+      json_builder_add_int_value(builder, data->volume);
+    }
+    if (add_member(builder, PLAYER_IS_MUTE)) {
+      json_builder_add_boolean_value(builder, data->mute);
+    }
 
     json_builder_end_object(builder);
   }
@@ -955,8 +1003,8 @@ static void print_player_list(GList *players, gboolean force_output) {
   gchar *json_str = json_generator_to_data(generator, NULL);
 
   /* should print? */
-  if (!(force_output || last_json_output == NULL ||
-        strcmp(json_str, last_json_output) != 0)) {
+  if (!change_check(&changes, json_str, strlen(json_str)) && !force_output) {
+    coalesce_suppressed(coalescer);
     g_free(json_str);
     json_node_free(root);
     g_object_unref(generator);
@@ -964,22 +1012,13 @@ static void print_player_list(GList *players, gboolean force_output) {
     return;
   }
 
-  /* Debounce outputs */
-  if (debounce_timeout_id != 0) {
-    g_source_remove(debounce_timeout_id);
-    debounce_timeout_id = 0;
-  }
-
+  /* Rate-limited; a burst collapses into its last document */
   if (force_output) {
     DEBUG_MSG("StdOut: Forced");
-    g_print("%s\n", json_str);
-    DEBUG_MSG("------");
-    g_free(last_json_output);
-    last_json_output = g_strdup(json_str);
+    coalesce_now(coalescer, json_str, strlen(json_str));
   } else {
-    debounce_timeout_id = g_timeout_add(50, print_callback, g_strdup(json_str));
+    coalesce_line(coalescer, json_str, strlen(json_str));
   }
-
   g_free(json_str);
   json_node_free(root);
   g_object_unref(generator);
@@ -1006,6 +1045,7 @@ static void on_playback_status(PlayerctlPlayer *player,
   PulseData *pulse = user_data;
   PlayerData *data = find_player_data(pulse, player);
   if (data) {
+    stats_event(stats);
     data->playback_status = status;
     DEBUG_MSG("Updating playback status for %s", safe_str(data->name));
     print_player_list(*pulse->players, FALSE);
@@ -1019,6 +1059,7 @@ static void on_metadata(PlayerctlPlayer *player, GVariant *metadata,
   PulseData *pulse = user_data;
   PlayerData *data = find_player_data(pulse, player);
   if (data) {
+    stats_event(stats);
     update_metadata(data, pulse);
     DEBUG_MSG("Updating Metadata for %s", safe_str(data->name));
     print_player_list(*pulse->players, FALSE);
@@ -1031,6 +1072,7 @@ static void on_shuffle(PlayerctlPlayer *player, gboolean shuffle,
   PulseData *pulse = user_data;
   PlayerData *data = find_player_data(pulse, player);
   if (data) {
+    stats_event(stats);
     data->shuffle = shuffle;
     DEBUG_MSG("Updating shuffle status for %s: %d", safe_str(data->name),
               shuffle);
@@ -1044,6 +1086,7 @@ static void on_loop_status(PlayerctlPlayer *player, PlayerctlLoopStatus status,
   PulseData *pulse = user_data;
   PlayerData *data = find_player_data(pulse, player);
   if (data) {
+    stats_event(stats);
     data->loop_status = status;
     DEBUG_MSG("Updating loop status for %s: %d", safe_str(data->name), status);
     print_player_list(*pulse->players, FALSE);
@@ -1076,7 +1119,7 @@ static int check_property_exists(const char *instance, const char *property) {
   return result;
 }
 
-dbus_bool_t get_can_quit(const char *interface) {
+static dbus_bool_t get_can_quit(const char *interface) {
   static const char *interface_str = "org.mpris.MediaPlayer2";
   static const char *property_str = "CanQuit";
 
@@ -1162,14 +1205,16 @@ static PlayerData *player_data_new(PlayerctlPlayerName *name, PulseData *pulse,
     *is_new = FALSE;
     g_free(data->instance);
     data->instance = g_strdup(name->instance ? name->instance : "");
-    data->can_quit = get_can_quit(data->instance);
+    data->can_quit =
+        field_on(&fields, PLAYER_CAN_QUIT) && get_can_quit(data->instance);
     data->source = name->source;
     data->busPID = get_pid_for_bus_name(data->instance);
   } else {
     data = g_new0(PlayerData, 1);
     data->name = g_strdup(name->name ? name->name : "Unknown");
     data->instance = g_strdup(name->instance ? name->instance : "");
-    data->can_quit = get_can_quit(data->instance);
+    data->can_quit =
+        field_on(&fields, PLAYER_CAN_QUIT) && get_can_quit(data->instance);
     data->source = name->source;
     data->busPID = get_pid_for_bus_name(data->instance);
     DEBUG_MSG("INFO:  New PlayerData with BusPID: %u", data->busPID);
@@ -1183,14 +1228,16 @@ static PlayerData *player_data_new(PlayerctlPlayerName *name, PulseData *pulse,
   }
   if (data->player) {
     // if (check_can_shuffle(data) == 0) {
-    if (check_property_exists(data->instance, "Shuffle") == 0) {
+    if (field_on(&fields, PLAYER_SHUFFLE) &&
+        check_property_exists(data->instance, "Shuffle") == 0) {
       g_signal_connect(data->player, "shuffle", G_CALLBACK(on_shuffle), pulse);
       g_object_get(data->player, "shuffle", &data->shuffle, NULL);
     } else {
       data->shuffle = -1;
     }
     // if (check_can_loop(data) == 0 ) {
-    if (check_property_exists(data->instance, "LoopStatus") == 0) {
+    if (field_on(&fields, PLAYER_LOOP) &&
+        check_property_exists(data->instance, "LoopStatus") == 0) {
       g_signal_connect(data->player, "loop-status", G_CALLBACK(on_loop_status),
                        pulse);
       g_object_get(data->player, "loop-status", &data->loop_status, NULL);
@@ -1255,6 +1302,7 @@ static void on_name_appeared(PlayerctlPlayerManager *manager,
   }
   DEBUG_MSG("INFO:  Received name-appeared for %s (instance: %s)",
             safe_str(name->name), safe_str(name->instance));
+  stats_event(stats);
   if (find_player_by_instance(*pulse->players, name->instance) == NULL) {
     gboolean is_new;
     PlayerData *data = player_data_new(name, pulse, &is_new);
@@ -1279,6 +1327,7 @@ static void on_name_vanished(PlayerctlPlayerManager *manager,
 
   DEBUG_MSG("INFO:  Received name-vanished for %s (instance: %s)",
             safe_str(name->name), safe_str(name->instance));
+  stats_event(stats);
   GList *node = find_player_by_instance(*pulse->players, name->instance);
   if (node != NULL) {
     PlayerData *data = node->data;
@@ -1304,25 +1353,14 @@ static void pulse_data_free(PulseData *pulse) {
     pa_context_unref(pulse->context);
     pulse->context = NULL;
   }
-  if (pulse->mainloop) {
-    pa_glib_mainloop_free(pulse->mainloop);
-    pulse->mainloop = NULL;
-  }
   g_free(pulse);
 }
 
 /* Initialize PulseAudio */
-static PulseData *pulse_data_new(GList **players) {
+static PulseData *pulse_data_new(GList **players, pa_mainloop_api *api) {
   PulseData *pulse = g_new0(PulseData, 1);
   pulse->players = players;
-  pulse->mainloop = pa_glib_mainloop_new(NULL);
-  if (!pulse->mainloop) {
-    DEBUG_MSG("ERROR: Failed to create PulseAudio GLib mainloop");
-    pulse_data_free(pulse);
-    return NULL;
-  }
-  pulse->context =
-      pa_context_new(pa_glib_mainloop_get_api(pulse->mainloop), "mprisFetch");
+  pulse->context = pa_context_new(api, "mprisFetch");
   if (!pulse->context) {
     DEBUG_MSG("ERROR: Failed to create PulseAudio context");
     pulse_data_free(pulse);
@@ -1338,30 +1376,33 @@ static PulseData *pulse_data_new(GList **players) {
   return pulse;
 }
 
-int main(void) {
-  GError *error = NULL;
+static PlayerctlPlayerManager *player_manager = NULL;
+static PulseData *pulse_data = NULL;
 
-  /* Initialize GLib main loop */
-  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+int mpris_fetch_start(pa_mainloop_api *api, FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("mpris_fetch");
+  /* 20 Hz keeps the 50ms spacing of the old debounce */
+  coalescer = coalesce_new("mpris_fetch", out, stats, 20);
+  GError *error = NULL;
 
   /* Initialize playerctl manager */
-  PlayerctlPlayerManager *manager = playerctl_player_manager_new(&error);
+  player_manager = playerctl_player_manager_new(&error);
   if (error != NULL) {
     DEBUG_MSG("ERROR: Failed to create player manager: %s", error->message);
     g_error_free(error);
-    g_main_loop_unref(loop);
     return 1;
   }
 
-  /* Initialize players list */
-  GList *players = NULL;
-
   /* Initialize PulseAudio */
-  PulseData *pulse = pulse_data_new(&players);
-  if (!pulse) {
+  pulse_data = pulse_data_new(&player_list, api);
+  if (!pulse_data) {
     DEBUG_MSG("ERROR: Failed to initialize PulseAudio");
-    g_object_unref(manager);
-    g_main_loop_unref(loop);
+    g_object_unref(player_manager);
+    player_manager = NULL;
     return 1;
   }
 
@@ -1375,15 +1416,15 @@ int main(void) {
     DEBUG_MSG("INFO:  Found %d initial players",
               g_list_length(current_players));
     if (g_list_length(current_players) == 0) {
-      print_player_list(players, FALSE);
+      print_player_list(player_list, FALSE);
     } else {
       for (GList *iter = current_players; iter != NULL; iter = iter->next) {
         PlayerctlPlayerName *n = (PlayerctlPlayerName *)iter->data;
-        if (find_player_by_instance(players, n->instance) == NULL) {
+        if (find_player_by_instance(player_list, n->instance) == NULL) {
           gboolean is_new;
-          PlayerData *data = player_data_new(n, pulse, &is_new);
+          PlayerData *data = player_data_new(n, pulse_data, &is_new);
           if (data && is_new) {
-            players = g_list_append(players, data);
+            player_list = g_list_append(player_list, data);
           }
         }
       }
@@ -1393,22 +1434,60 @@ int main(void) {
   }
 
   /* Connect playerctl signals */
-  g_signal_connect(manager, "name-appeared", G_CALLBACK(on_name_appeared),
-                   pulse);
-  g_signal_connect(manager, "name-vanished", G_CALLBACK(on_name_vanished),
-                   pulse);
+  g_signal_connect(player_manager, "name-appeared",
+                   G_CALLBACK(on_name_appeared), pulse_data);
+  g_signal_connect(player_manager, "name-vanished",
+                   G_CALLBACK(on_name_vanished), pulse_data);
 
   DEBUG_MSG("INFO:  Listening for player and PulseAudio events...");
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+static gboolean on_coalesce_ready(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  coalesce_dispatch();
+  return G_SOURCE_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  stats_init("mpris_fetch");
+
+  /* Initialize GLib main loop */
+  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+
+  pa_glib_mainloop *pa_loop = pa_glib_mainloop_new(NULL);
+  if (!pa_loop) {
+    DEBUG_MSG("ERROR: Failed to create PulseAudio GLib mainloop");
+    g_main_loop_unref(loop);
+    return 1;
+  }
+
+  if (mpris_fetch_start(pa_glib_mainloop_get_api(pa_loop), stdout) != 0) {
+    pa_glib_mainloop_free(pa_loop);
+    g_main_loop_unref(loop);
+    return 1;
+  }
+
+  g_unix_fd_add(coalesce_fd(), G_IO_IN, on_coalesce_ready, NULL);
 
   /* Run the main loop */
   g_main_loop_run(loop);
 
   /* Cleanup */
-  g_list_free_full(players, player_data_free);
-  g_free(last_json_output);
+  g_list_free_full(player_list, player_data_free);
+  change_reset(&changes);
   g_main_loop_unref(loop);
-  g_object_unref(manager);
-  pulse_data_free(pulse);
+  g_object_unref(player_manager);
+  pulse_data_free(pulse_data);
+  pa_glib_mainloop_free(pa_loop);
 
   return 0;
 }
+#endif
@@ -37,12 +37,16 @@
  * "If we listen to each other's hearts. We'll find we're never too far apart."
  * ____________________________________________________________________________
  */
+#include "hub.h"
+#include <glib-unix.h>
 #include <glib.h>
-#include <inttypes.h>
 #include <playerctl/playerctl.h>
 #include <stdio.h>
 #include <string.h>
+#include "coalesce.h"
+#include "fields.h"
 #include "json.h"
+#include "stats.h"
 
 #ifdef DEBUG
 #define DEBUG_MSG(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
@@ -79,6 +83,16 @@ static void on_playback_status(PlayerctlPlayer *player, PlayerctlPlaybackStatus
 static void on_metadata(PlayerctlPlayer *player, GVariant *metadata, gpointer user_data);
 
 static guint global_position_timeout_id = 0;
+static FILE *out;
+static JsonWriter json;
+static StatsStream *stats;
+static Coalescer *coalescer;
+static GList *player_list = NULL;
+
+// Per player: "<instance>": seconds and "<instance>HMS": "m:ss"
+enum { POSITION_SECONDS, POSITION_HMS };
+static const char *const position_fields[] = {"seconds", "HMS"};
+static FieldSet fields = FIELD_SET("mpris_position", position_fields);
 
 static void update_time_components(PlayerData *data) {
   data->hours = (gint)(data->local_seconds / 3600);
@@ -115,31 +129,26 @@ static void print_hms(PlayerData *data, char *buffer, size_t size) {
 }
 
 static void print_player_list(GList *players) {
-  printf("{");
-  gboolean first = TRUE;
+  json_begin_object(&json);
   for (GList *iter = players; iter; iter = iter->next) {
     PlayerData *data = iter->data;
-    if (!first) {
-      printf(",");
+    if (field_on(&fields, POSITION_SECONDS)) {
+      json_key(&json, data->instance);
+      json_int(&json, data->local_seconds);
+    }
+
+    if (field_on(&fields, POSITION_HMS)) {
+      char hms[32];
+      print_hms(data, hms, sizeof(hms));
+      gchar *key = g_strdup_printf("%sHMS", data->instance);
+      json_key(&json, key);
+      json_string(&json, hms);
+      g_free(key);
     }
-    first = FALSE;
-
-    gchar *key = g_strdup_printf("%s", data->instance);
-    print_json_str(key);
-    printf(":%" PRId64, data->local_seconds);
-    g_free(key);
-
-    printf(",");
-    char hms[32];
-    print_hms(data, hms, sizeof(hms));
-    key = g_strdup_printf("%sHMS", data->instance);
-    print_json_str(key);
-    printf(":");
-    print_json_str(hms);
-    g_free(key);
   }
-  printf("}\n");
-  fflush(stdout);
+  json_end_object(&json);
+  coalesce_line(coalescer, json.buf, json.len);
+  json_writer_reset(&json);
 }
 
 static PlayerData *player_data_new(PlayerctlPlayerName *name, GList **players) {
@@ -199,6 +208,8 @@ static void update_player_position(PlayerData *data, gint64 curr_sec, GList **pl
 
   if (curr_sec != last_sec) {
     print_player_list(*players);
+  } else {
+    coalesce_suppressed(coalescer);
   }
 }
 
@@ -227,6 +238,7 @@ static void on_playback_status(PlayerctlPlayer *player, PlayerctlPlaybackStatus
     return;
   }
 
+  stats_event(stats);
   data->playback_status = status;
   GError *error = NULL;
   gint64 pos_micros = playerctl_player_get_position(data->player, &error);
@@ -249,6 +261,7 @@ static void on_seeked(PlayerctlPlayer *player, gint64 position, gpointer user_da
     return;
   }
 
+  stats_event(stats);
   update_player_position(data, position / 1000000, players);
   DEBUG_MSG("Player %s (instance: %s): Seeked to %ld seconds",
             data->name, data->instance, data->local_seconds);
@@ -263,6 +276,7 @@ static void on_metadata(PlayerctlPlayer *player, GVariant *metadata, gpointer us
     return;
   }
 
+  stats_event(stats);
   GError *error = NULL;
   gint64 micros = playerctl_player_get_position(data->player, &error);
   if (error) {
@@ -279,6 +293,7 @@ static gboolean on_position_check(gpointer user_data) {
   GList **players = user_data;
   global_position_timeout_id = 0;
   gboolean any_changed = FALSE;
+  stats_event(stats);
 
   for (GList *iter = *players; iter; iter = iter->next) {
     PlayerData *data = iter->data;
@@ -319,6 +334,8 @@ static gboolean on_position_check(gpointer user_data) {
 
   if (any_changed) {
     print_player_list(*players);
+  } else {
+    coalesce_suppressed(coalescer);
   }
   adjust_global_timer(players);
   return FALSE;
@@ -330,6 +347,7 @@ static void on_name_appeared(PlayerctlPlayerManager *manager, PlayerctlPlayerNam
   DEBUG_MSG("Received name-appeared for %s (instance: %s)", name->name, name->instance);
 
   if (!find_player_by_instance(*players, name->instance)) {
+    stats_event(stats);
     PlayerData *data = player_data_new(name, players);
     *players = g_list_append(*players, data);
     DEBUG_MSG("Player appeared: %s (instance: %s, source: %d)", name->name, name->instance, name->source);
@@ -347,6 +365,7 @@ static void on_name_vanished(PlayerctlPlayerManager *manager, PlayerctlPlayerNam
 
   GList *node = find_player_by_instance(*players, name->instance);
   if (node) {
+    stats_event(stats);
     PlayerData *data = node->data;
     *players = g_list_delete_link(*players, node);
     DEBUG_MSG("Player vanished: %s (instance: %s, source: %d)", name->name, name->instance, name->source);
@@ -358,8 +377,13 @@ static void on_name_vanished(PlayerctlPlayerManager *manager, PlayerctlPlayerNam
   }
 }
 
-int main(void) {
-  g_usleep(500);
+int mpris_position_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("mpris_position");
+  coalescer = coalesce_new("mpris_position", out, stats, COALESCE_DEFAULT_HZ);
   GError *error = NULL;
   PlayerctlPlayerManager *manager = playerctl_player_manager_new(&error);
   if (error) {
@@ -368,7 +392,6 @@ int main(void) {
     return 1;
   }
 
-  GList *players = NULL;
   GList *current_players = playerctl_list_players(&error);
   if (error) {
     DEBUG_MSG("Failed to list initial players: %s", error->message);
@@ -376,24 +399,47 @@ int main(void) {
   } else {
     DEBUG_MSG("Found %d initial players", g_list_length(current_players));
     for (GList *iter = current_players; iter; iter = iter->next) {
-      PlayerData *data = player_data_new(iter->data, &players);
-      players = g_list_append(players, data);
+      PlayerData *data = player_data_new(iter->data, &player_list);
+      player_list = g_list_append(player_list, data);
     }
     g_list_free_full(current_players, (GDestroyNotify)playerctl_player_name_free);
   }
 
-  print_player_list(players);
-  adjust_global_timer(&players);
-  g_signal_connect(manager, "name-appeared", G_CALLBACK(on_name_appeared), &players);
-  g_signal_connect(manager, "name-vanished", G_CALLBACK(on_name_vanished), &players);
+  print_player_list(player_list);
+  adjust_global_timer(&player_list);
+  g_signal_connect(manager, "name-appeared", G_CALLBACK(on_name_appeared), &player_list);
+  g_signal_connect(manager, "name-vanished", G_CALLBACK(on_name_vanished), &player_list);
   DEBUG_MSG("Listening for player events...");
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+static gboolean on_coalesce_ready(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  coalesce_dispatch();
+  return G_SOURCE_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  stats_init("mpris_position");
+  g_usleep(500);
+  if (mpris_position_start(stdout) != 0) {
+    return 1;
+  }
 
   GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+  g_unix_fd_add(coalesce_fd(), G_IO_IN, on_coalesce_ready, NULL);
   g_main_loop_run(loop);
 
   if (global_position_timeout_id != 0) g_source_remove(global_position_timeout_id);
-  g_list_free_full(players, player_data_free);
+  g_list_free_full(player_list, player_data_free);
   g_main_loop_unref(loop);
-  g_object_unref(manager);
   return 0;
 }
+#endif
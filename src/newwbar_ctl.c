@@ -0,0 +1,101 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+/* One-shot client for the control sockets (control.h):
+ *
+ *   newwbar-ctl dispatch workspace 3        workspace_list, else hyprctl
+ *   newwbar-ctl set-sink-volume SINK 40%    audio_out, else pactl
+ *
+ * joins its arguments into one command and sends it as a single datagram,
+ * without waiting for Hyprland or the sound server. When no listener serves
+ * the socket, or the command is one the listener does not take, it runs
+ * hyprctl or pactl with the same arguments instead, so a click is never
+ * lost. */
+
+#define _GNU_SOURCE
+#include "control.h"
+#include "hypr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "Usage: %s dispatch DISPATCHER [ARGS...]\n"
+            "       %s PACTL-COMMAND [ARGS...]\n",
+            argv[0], argv[0]);
+    return 1;
+  }
+
+  char command[HYPR_CONTROL_MAX];
+  size_t len = 0;
+  for (int i = 1; i < argc; i++) {
+    int n = snprintf(command + len, sizeof(command) - len, "%s%s",
+                     i > 1 ? " " : "", argv[i]);
+    if (n < 0 || (size_t)n >= sizeof(command) - len) {
+      fprintf(stderr, "%s: command too long\n", argv[0]);
+      return 1;
+    }
+    len += (size_t)n;
+  }
+
+  const char *fallback = "pactl";
+  if (strcmp(argv[1], "dispatch") == 0) {
+    fallback = "hyprctl";
+    // A ';' would split the command in a batch, so hyprctl takes those
+    if (argc > 2 && !strchr(command, ';') &&
+        control_send(HYPR_CONTROL_SOCKET, command, len) == 0) {
+      return 0;
+    }
+  } else {
+    AudioCommand audio;
+    if (audio_command_parse(command, len, &audio) == 0 &&
+        control_send(AUDIO_CONTROL_SOCKET, command, len) == 0) {
+      return 0;
+    }
+  }
+
+  argv[0] = (char *)fallback;
+  execvp(fallback, argv);
+  perror(fallback);
+  return 127;
+}
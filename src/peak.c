@@ -0,0 +1,79 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "peak.h"
+
+void peak_init(PeakMeter *m, unsigned int hz, unsigned int steps) {
+  if (hz == 0 || hz > PEAK_RATE) {
+    hz = PEAK_RATE;
+  }
+  m->window = PEAK_RATE / hz;
+  m->seen = 0;
+  m->steps = steps ? steps : 1;
+  m->max = 0;
+  m->level = -1;
+}
+
+bool peak_feed(PeakMeter *m, const float *samples, size_t count) {
+  bool changed = false;
+  for (size_t i = 0; i < count; i++) {
+    float value = samples[i] < 0 ? -samples[i] : samples[i];
+    if (value > m->max) {
+      m->max = value;
+    }
+    if (++m->seen < m->window) {
+      continue;
+    }
+    // Clipped input can exceed 1.0; it still tops out at the last bucket
+    int level = (int)(m->max * (float)m->steps + 0.5f);
+    if (level > (int)m->steps) {
+      level = (int)m->steps;
+    }
+    changed = changed || level != m->level;
+    m->level = level;
+    m->seen = 0;
+    m->max = 0;
+  }
+  return changed;
+}
+
+int peak_percent(const PeakMeter *m) {
+  return m->level > 0 ? m->level * 100 / (int)m->steps : 0;
+}
@@ -0,0 +1,32 @@
+#ifndef PEAK_SEEN
+#define PEAK_SEEN
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Level reduction for the audio_peak meters. A PA_STREAM_PEAK_DETECT record
+ * stream delivers one float per 1/PEAK_RATE s, each the loudest sample of
+ * that slice. A PeakMeter keeps the loudest of every window of those that
+ * spans one update (1/hz s) and quantizes it into steps buckets; only a
+ * window that lands in a different bucket than the last one counts as a
+ * change, so a steady signal prints nothing. */
+
+#define PEAK_RATE 200 // peak samples a second asked of the server
+#define PEAK_DEFAULT_HZ 20
+#define PEAK_DEFAULT_STEPS 20
+
+typedef struct {
+  unsigned int window; // peak samples per update
+  unsigned int seen;   // samples in the current window
+  unsigned int steps;
+  float max;
+  int level; // bucket of the last window, -1 before the first
+} PeakMeter;
+
+void peak_init(PeakMeter *m, unsigned int hz, unsigned int steps);
+// True when a window closed in another bucket than the one before
+bool peak_feed(PeakMeter *m, const float *samples, size_t count);
+// The last bucket as 0-100, 0 before the first window
+int peak_percent(const PeakMeter *m);
+
+#endif
@@ -0,0 +1,122 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "pulse.h"
+
+#include <stdio.h>
+
+#ifdef DEBUG
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+    fprintf(stderr, fmt "\n", ##__VA_ARGS__);                                  \
+  } while (0)
+#else
+#define DEBUG_MSG(fmt, ...)                                                    \
+  do {                                                                         \
+  } while (0)
+#endif
+
+int pulse_connect(PulseConn *conn, pa_mainloop_api *api) {
+  conn->api = api;
+  conn->context = pa_context_new(api, conn->name);
+  if (!conn->context) {
+    fprintf(stderr, "Failed to create PulseAudio context\n");
+    return 1;
+  }
+
+  pa_context_set_state_callback(conn->context, conn->state_cb, conn->userdata);
+  if (pa_context_connect(conn->context, NULL, PA_CONTEXT_NOFLAGS, NULL) < 0) {
+    fprintf(stderr, "PulseAudio connect failed: %s\n",
+            pa_strerror(pa_context_errno(conn->context)));
+    return 1;
+  }
+  return 0;
+}
+
+int pulse_is_ready(const PulseConn *conn) {
+  return conn->context &&
+         pa_context_get_state(conn->context) == PA_CONTEXT_READY;
+}
+
+void pulse_ready(PulseConn *conn) {
+  if (conn->retry_ms) {
+    DEBUG_MSG("%s: PulseAudio reconnected", conn->name);
+  }
+  conn->retry_ms = 0;
+}
+
+void pulse_free(PulseConn *conn) {
+  if (conn->context) {
+    pa_context_set_state_callback(conn->context, NULL, NULL);
+    pa_context_disconnect(conn->context);
+    pa_context_unref(conn->context);
+    conn->context = NULL;
+  }
+}
+
+#ifdef NEWWBAR_HUB
+static void on_retry(pa_mainloop_api *api, pa_time_event *e,
+                     const struct timeval *tv, void *userdata) {
+  (void)tv; // suppress unused paramater warning
+  PulseConn *conn = userdata;
+  api->time_free(e);
+  if (pulse_connect(conn, api) != 0) {
+    pulse_lost(conn);
+  }
+}
+
+// The state callback holds a reference of its own, so the context can be
+// dropped from inside it
+void pulse_lost(PulseConn *conn) {
+  pulse_free(conn);
+  conn->retry_ms = conn->retry_ms ? conn->retry_ms * 2 : PULSE_RETRY_MIN_MS;
+  if (conn->retry_ms > PULSE_RETRY_MAX_MS) {
+    conn->retry_ms = PULSE_RETRY_MAX_MS;
+  }
+  fprintf(stderr, "%s: PulseAudio connection lost, retrying in %dms\n",
+          conn->name, conn->retry_ms);
+  struct timeval tv;
+  pa_timeval_add(pa_gettimeofday(&tv),
+                 (pa_usec_t)conn->retry_ms * PA_USEC_PER_MSEC);
+  conn->api->time_new(conn->api, &tv, on_retry, conn);
+}
+#else
+void pulse_lost(PulseConn *conn) { conn->api->quit(conn->api, 1); }
+#endif
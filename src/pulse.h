@@ -0,0 +1,36 @@
+#ifndef PULSE_SEEN
+#define PULSE_SEEN
+
+#include <pulse/pulseaudio.h>
+
+/* A PulseAudio context that outlives the server. pulse_connect() creates
+ * and connects it with the module's state callback, which hands READY to
+ * pulse_ready() and FAILED/TERMINATED to pulse_lost().
+ *
+ * Built on its own a monitor then quits its mainloop, as it always did.
+ * newwbar-hub cannot quit for one module, so there the context is dropped
+ * and a new one connects after a wait that backs off from
+ * PULSE_RETRY_MIN_MS to PULSE_RETRY_MAX_MS, on a time event of the hub's
+ * GLib mainloop api. The state callback sees READY again once the server is
+ * back (a PulseAudio or PipeWire restart) and sets the module up anew. */
+#define PULSE_RETRY_MIN_MS 100
+#define PULSE_RETRY_MAX_MS 5000
+
+typedef struct {
+  const char *name; // client name the server shows
+  pa_context_notify_cb_t state_cb;
+  void *userdata;
+  pa_mainloop_api *api;
+  pa_context *context; // NULL while waiting to reconnect
+  int retry_ms;        // 0 until an attempt has failed
+} PulseConn;
+
+int pulse_connect(PulseConn *conn, pa_mainloop_api *api);
+// True when the context can take requests
+int pulse_is_ready(const PulseConn *conn);
+void pulse_ready(PulseConn *conn);
+void pulse_lost(PulseConn *conn);
+// Standalone cleanup
+void pulse_free(PulseConn *conn);
+
+#endif
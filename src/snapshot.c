@@ -0,0 +1,140 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "snapshot.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SNAPSHOT_MAX_SIZE (1 << 20)
+
+static int snapshot_path(const char *name, const char *suffix, char *path,
+                         size_t size) {
+  const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+  if (!runtime_dir || !*runtime_dir) {
+    return -1;
+  }
+  int n = snprintf(path, size, "%s/newwbar/%s%s", runtime_dir, name, suffix);
+  return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+char *snapshot_load(const char *name, size_t *len) {
+  char path[512];
+  if (snapshot_path(name, ".json", path, sizeof(path)) < 0) {
+    return NULL;
+  }
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  char *line = NULL;
+  if (fstat(fd, &st) == 0 && st.st_size > 0 && st.st_size < SNAPSHOT_MAX_SIZE) {
+    line = malloc((size_t)st.st_size + 1);
+  }
+  size_t used = 0;
+  while (line && used < (size_t)st.st_size) {
+    ssize_t n = read(fd, line + used, (size_t)st.st_size - used);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    used += (size_t)n;
+  }
+  close(fd);
+  // Anything short or without its trailing newline is not ours
+  if (!line || used != (size_t)st.st_size || line[used - 1] != '\n') {
+    free(line);
+    return NULL;
+  }
+  line[used - 1] = '\0';
+  *len = used - 1;
+  return line;
+}
+
+void snapshot_save(const char *name, const char *line, size_t len) {
+  // Per process: a standalone binary and the hub may save the same name
+  char path[512], tmp_path[540], tmp_suffix[32];
+  snprintf(tmp_suffix, sizeof(tmp_suffix), ".json.%ld.tmp", (long)getpid());
+  if (snapshot_path(name, ".json", path, sizeof(path)) < 0 ||
+      snapshot_path(name, tmp_suffix, tmp_path, sizeof(tmp_path)) < 0) {
+    return;
+  }
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0 && errno == ENOENT) {
+    // First run: the newwbar directory does not exist yet
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/newwbar", getenv("XDG_RUNTIME_DIR"));
+    mkdir(dir, 0700);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  }
+  if (fd < 0) {
+    return;
+  }
+  int failed = 0;
+  const char *parts[2] = {line, "\n"};
+  size_t lens[2] = {len, 1};
+  for (int i = 0; i < 2 && !failed; i++) {
+    size_t done = 0;
+    while (done < lens[i]) {
+      ssize_t n = write(fd, parts[i] + done, lens[i] - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        failed = 1;
+        break;
+      }
+      done += (size_t)n;
+    }
+  }
+  close(fd);
+  if (failed) {
+    unlink(tmp_path);
+  } else {
+    rename(tmp_path, path);
+  }
+}
@@ -0,0 +1,17 @@
+#ifndef SNAPSHOT_SEEN
+#define SNAPSHOT_SEEN
+
+#include <stddef.h>
+
+/* Last-state snapshots for a fast first paint. Each stream's newest line is
+ * kept in $XDG_RUNTIME_DIR/newwbar/<name>.json, replaced atomically (temp
+ * file and rename) so a reader never sees half a document. On start a
+ * monitor prints the snapshot before it has connected to anything, and the
+ * real state follows once enumeration completes. Nothing is stored when
+ * XDG_RUNTIME_DIR is unset. */
+
+// Returns the stored line without its newline (free() it), or NULL
+char *snapshot_load(const char *name, size_t *len);
+void snapshot_save(const char *name, const char *line, size_t len);
+
+#endif
@@ -0,0 +1,369 @@
+/*  _               _        _              _ _          _ _
+ * | |   _   _ _ __| | __   / \   _ __   __| | |    ___ (_) |_ ___ _ __
+ * | |  | | | | '__| |/ /  / _ \ | '_ \ / _` | |   / _ \| | __/ _ \ '__|
+ * | |__| |_| | |  |   <  / ___ \| | | | (_| | |__| (_) | | ||  __/ |
+ * |_____\__,_|_|  |_|\_\/_/   \_\_| |_|\__,_|_____\___/|_|\__\___|_|
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * Copyright 2025 LurkAndLoiter.
+ * ____________________________________________________________________________
+ *  __  __ ___ _____   _     _
+ * |  \/  |_ _|_   _| | |   (_) ___ ___ _ __  ___  ___
+ * | |\/| || |  | |   | |   | |/ __/ _ \ '_ \/ __|/ _ \
+ * | |  | || |  | |   | |___| | (_|  __/ | | \__ \  __/
+ * |_|  |_|___| |_|   |_____|_|\___\___|_| |_|___/\___|
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ * ____________________________________________________________________________
+ * ----------------------------------------------------------------------------
+ * "Zetus Lupetus" "Omelette du fromage" "You're killing me smalls" "Ugh As If"
+ * "Hey. Listen!" "Do a barrel roll!" "Dear Darla, I hate your stinking guts."
+ * "If we listen to each other's hearts. We'll find we're never too far apart."
+ * ____________________________________________________________________________
+ */
+
+#include "stats.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATS_MAX_STREAMS 16
+
+// HDR-style buckets: values below 16 ns are exact, above that each power of
+// two is split into 16 linear sub-buckets (about 6% relative error)
+#define STATS_SUB_BITS 4
+#define STATS_SUB (1 << STATS_SUB_BITS)
+#define STATS_BUCKETS ((64 - STATS_SUB_BITS + 1) * STATS_SUB)
+
+struct StatsStream {
+  const char *name;
+  uint64_t events;
+  uint64_t lines;
+  uint64_t suppressed;
+  uint64_t coalesced;
+  uint64_t bytes;
+  uint64_t first_line_ns; // since stats_init(), i.e. time to first paint
+  uint64_t pending_since; // 0 when no event is waiting for a line
+  uint64_t samples;
+  uint64_t min_ns;
+  uint64_t max_ns;
+  uint32_t buckets[STATS_BUCKETS];
+};
+
+static StatsStream streams[STATS_MAX_STREAMS];
+static int stream_count = 0;
+static const char *stats_program = NULL;
+static uint64_t start_ns = 0;
+static char stats_path[512] = "";
+static char stats_tmp_path[520] = "";
+
+uint64_t stats_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int bucket_index(uint64_t v) {
+  if (v < STATS_SUB) {
+    return (int)v;
+  }
+  int msb = 63 - __builtin_clzll(v);
+  int shift = msb - STATS_SUB_BITS;
+  return (msb - STATS_SUB_BITS + 1) * STATS_SUB +
+         (int)((v >> shift) & (STATS_SUB - 1));
+}
+
+// Largest value that lands in bucket idx
+static uint64_t bucket_upper(int idx) {
+  if (idx < STATS_SUB) {
+    return (uint64_t)idx;
+  }
+  int shift = idx / STATS_SUB - 1;
+  uint64_t low = (uint64_t)(STATS_SUB + idx % STATS_SUB) << shift;
+  return low + ((uint64_t)1 << shift) - 1;
+}
+
+StatsStream *stats_stream(const char *name) {
+  for (int i = 0; i < stream_count; i++) {
+    if (strcmp(streams[i].name, name) == 0) {
+      return &streams[i];
+    }
+  }
+  if (stream_count == STATS_MAX_STREAMS) {
+    return NULL;
+  }
+  StatsStream *s = &streams[stream_count++];
+  s->name = name;
+  return s;
+}
+
+void stats_event(StatsStream *s) {
+  if (!s) {
+    return;
+  }
+  s->events++;
+  if (!s->pending_since) {
+    s->pending_since = stats_now_ns();
+  }
+}
+
+void stats_emit(StatsStream *s, size_t bytes) {
+  if (!s) {
+    return;
+  }
+  if (!s->lines++) {
+    s->first_line_ns = stats_now_ns() - start_ns;
+  }
+  s->bytes += bytes;
+  if (!s->pending_since) {
+    return;
+  }
+  uint64_t latency = stats_now_ns() - s->pending_since;
+  s->pending_since = 0;
+  if (!s->samples || latency < s->min_ns) {
+    s->min_ns = latency;
+  }
+  if (latency > s->max_ns) {
+    s->max_ns = latency;
+  }
+  s->samples++;
+  s->buckets[bucket_index(latency)]++;
+}
+
+void stats_suppressed(StatsStream *s) {
+  if (!s) {
+    return;
+  }
+  s->suppressed++;
+  s->pending_since = 0;
+}
+
+void stats_coalesced(StatsStream *s) {
+  if (!s) {
+    return;
+  }
+  s->coalesced++;
+}
+
+// --- Dump: only async-signal-safe calls below, it runs from SIGUSR1 ---
+
+typedef struct {
+  char buf[4096];
+  size_t len;
+  int fd;
+  int failed;
+} DumpBuf;
+
+static void dump_flush(DumpBuf *d) {
+  size_t done = 0;
+  while (done < d->len) {
+    ssize_t n = write(d->fd, d->buf + done, d->len - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      d->failed = 1;
+      break;
+    }
+    done += (size_t)n;
+  }
+  d->len = 0;
+}
+
+static void dump_str(DumpBuf *d, const char *str) {
+  for (; *str; str++) {
+    if (d->len == sizeof(d->buf)) {
+      dump_flush(d);
+    }
+    d->buf[d->len++] = *str;
+  }
+}
+
+static void dump_u64(DumpBuf *d, uint64_t v) {
+  char digits[21];
+  int pos = sizeof(digits) - 1;
+  digits[pos] = '\0';
+  do {
+    digits[--pos] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+  dump_str(d, digits + pos);
+}
+
+// Nanoseconds as microseconds with one decimal
+static void dump_us(DumpBuf *d, uint64_t ns) {
+  char frac[3] = {'.', (char)('0' + ns / 100 % 10), '\0'};
+  dump_u64(d, ns / 1000);
+  dump_str(d, frac);
+}
+
+static uint64_t percentile(const StatsStream *s, unsigned per_mille) {
+  uint64_t rank = (s->samples * per_mille + 999) / 1000;
+  uint64_t seen = 0;
+  for (int i = 0; i < STATS_BUCKETS; i++) {
+    seen += s->buckets[i];
+    if (seen >= rank && seen) {
+      uint64_t upper = bucket_upper(i);
+      return upper < s->max_ns ? upper : s->max_ns;
+    }
+  }
+  return s->max_ns;
+}
+
+static void dump_stream(DumpBuf *d, const StatsStream *s) {
+  static const struct {
+    const char *label;
+    unsigned per_mille;
+  } points[] = {{" p50 ", 500}, {" p90 ", 900}, {" p99 ", 990},
+                {" p999 ", 999}};
+
+  dump_str(d, "stream ");
+  dump_str(d, s->name);
+  dump_str(d, "\n  events ");
+  dump_u64(d, s->events);
+  dump_str(d, "\n  lines ");
+  dump_u64(d, s->lines);
+  dump_str(d, "\n  suppressed ");
+  dump_u64(d, s->suppressed);
+  dump_str(d, "\n  coalesced ");
+  dump_u64(d, s->coalesced);
+  dump_str(d, "\n  bytes ");
+  dump_u64(d, s->bytes);
+  if (s->lines) {
+    dump_str(d, "\n  first_line_us ");
+    dump_us(d, s->first_line_ns);
+  }
+  dump_str(d, "\n  latency_us count ");
+  dump_u64(d, s->samples);
+  if (s->samples) {
+    dump_str(d, " min ");
+    dump_us(d, s->min_ns);
+    for (size_t i = 0; i < sizeof(points) / sizeof(points[0]); i++) {
+      dump_str(d, points[i].label);
+      dump_us(d, percentile(s, points[i].per_mille));
+    }
+    dump_str(d, " max ");
+    dump_us(d, s->max_ns);
+    // Non-empty buckets as upper_bound_ns:count
+    dump_str(d, "\n  histogram_ns");
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+      if (s->buckets[i]) {
+        dump_str(d, " ");
+        dump_u64(d, bucket_upper(i));
+        dump_str(d, ":");
+        dump_u64(d, s->buckets[i]);
+      }
+    }
+  }
+  dump_str(d, "\n");
+}
+
+int stats_dump(int fd) {
+  DumpBuf d;
+  d.len = 0;
+  d.fd = fd;
+  d.failed = 0;
+  dump_str(&d, "program ");
+  dump_str(&d, stats_program ? stats_program : "?");
+  dump_str(&d, "\npid ");
+  dump_u64(&d, (uint64_t)getpid());
+  dump_str(&d, "\nuptime_s ");
+  dump_u64(&d, (stats_now_ns() - start_ns) / 1000000000u);
+  dump_str(&d, "\n");
+  for (int i = 0; i < stream_count; i++) {
+    dump_stream(&d, &streams[i]);
+  }
+  dump_flush(&d);
+  return d.failed ? -1 : 0;
+}
+
+// Write to a temp file and rename so readers never see a partial dump
+static void stats_write_file(void) {
+  if (!stats_path[0]) {
+    stats_dump(STDERR_FILENO);
+    return;
+  }
+  int fd = open(stats_tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return;
+  }
+  int ret = stats_dump(fd);
+  close(fd);
+  if (ret == 0) {
+    rename(stats_tmp_path, stats_path);
+  } else {
+    unlink(stats_tmp_path);
+  }
+}
+
+static void on_sigusr1(int sig) {
+  (void)sig; // suppress unused paramater warning
+  int saved_errno = errno;
+  stats_write_file();
+  errno = saved_errno;
+}
+
+#ifdef NEWWBAR_PROFILE_GENERATE
+// Instrumented builds (make release) are trained by benches that stop them
+// with SIGTERM; write the profile out before going down
+extern void __gcov_dump(void);
+
+static void on_training_stop(int sig) {
+  __gcov_dump();
+  _exit(128 + sig);
+}
+#endif
+
+void stats_init(const char *program) {
+  if (stats_program) {
+    return;
+  }
+  stats_program = program;
+  start_ns = stats_now_ns();
+
+  const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+  if (runtime_dir && *runtime_dir) {
+    char dir[480];
+    snprintf(dir, sizeof(dir), "%s/newwbar", runtime_dir);
+    if (mkdir(dir, 0700) == 0 || errno == EEXIST) {
+      snprintf(stats_path, sizeof(stats_path), "%s/%s.stats", dir, program);
+      snprintf(stats_tmp_path, sizeof(stats_tmp_path), "%s.tmp", stats_path);
+    }
+  }
+
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_sigusr1;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGUSR1, &sa, NULL);
+#ifdef NEWWBAR_PROFILE_GENERATE
+  sa.sa_handler = on_training_stop;
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+#endif
+  atexit(stats_write_file);
+}
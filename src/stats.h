@@ -0,0 +1,33 @@
+#ifndef STATS_SEEN
+#define STATS_SEEN
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Event-to-output latency accounting shared by every monitor.
+ * Call stats_event() when a source event arrives (Pulse subscription,
+ * D-Bus signal, socket2 line, timer tick) and stats_emit() once the JSON
+ * line it caused has been flushed. A line's latency runs from the oldest
+ * event it has not yet accounted for. stats_suppressed() records a line
+ * that dedup dropped; stats_coalesced() one the rate cap replaced with a
+ * newer line, which leaves the event clock running.
+ *
+ * Counters, the time from stats_init() to each stream's first line and
+ * per-stream latency histograms are written to
+ * $XDG_RUNTIME_DIR/newwbar/<program>.stats on SIGUSR1 and at exit, or to
+ * stderr when XDG_RUNTIME_DIR is unset. */
+
+typedef struct StatsStream StatsStream;
+
+void stats_init(const char *program);
+StatsStream *stats_stream(const char *name);
+
+void stats_event(StatsStream *s);
+void stats_emit(StatsStream *s, size_t bytes);
+void stats_suppressed(StatsStream *s);
+void stats_coalesced(StatsStream *s);
+
+uint64_t stats_now_ns(void);
+int stats_dump(int fd);
+
+#endif
@@ -38,7 +38,14 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "stats.h"
 #include <gio/gio.h>
+#include <glib-unix.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -46,12 +53,19 @@
 #define NM_OBJ_PATH "/org/freedesktop/NetworkManager"
 #define WIRELESS_IFACE "wlan0"
 
+static FILE *out;
 static GDBusConnection *connection = NULL;
 static guint subscription_id = 0;
 static guint strength_subscription_id = 0;
 static char *current_ap_path = NULL;
 static char *device_path = NULL;
-static char last_output[64] = ""; // Buffer for last JSON output
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+enum { WLAN_STATE, WLAN_STRENGTH };
+static const char *const wlan_fields[] = {"state", "strength"};
+static FieldSet fields = FIELD_SET("wlan_monitor", wlan_fields);
 
 static char *get_device_path(void) {
   GError *error = NULL;
@@ -152,17 +166,32 @@ static guint get_state(const char *dev_path) {
 }
 
 static void print_json(guint state, guint8 strength) {
+  // Both values fit in one word, so the key is exact rather than a hash
+  uint64_t key = 0;
+  if (field_on(&fields, WLAN_STATE)) {
+    key |= (uint64_t)state << 8;
+  }
+  if (field_on(&fields, WLAN_STRENGTH)) {
+    key |= strength;
+  }
+  if (!change_check_hash(&changes, key)) {
+    coalesce_suppressed(coalescer);
+    return;
+  }
+
   char new_output[64];
-  snprintf(new_output, sizeof(new_output), "{\"state\": %u, \"strength\": %u}",
-           state, strength);
-
-  // Only print if different from last output
-  if (strcmp(new_output, last_output) != 0) {
-    printf("%s\n", new_output);
-    fflush(stdout);
-    strncpy(last_output, new_output, sizeof(last_output) - 1);
-    last_output[sizeof(last_output) - 1] = '\0'; // Ensure null termination
+  int len = snprintf(new_output, sizeof(new_output), "{");
+  if (field_on(&fields, WLAN_STATE)) {
+    len += snprintf(new_output + len, sizeof(new_output) - len,
+                    "\"state\": %u", state);
+  }
+  if (field_on(&fields, WLAN_STRENGTH)) {
+    len += snprintf(new_output + len, sizeof(new_output) - len,
+                    "%s\"strength\": %u", len > 1 ? ", " : "", strength);
   }
+  snprintf(new_output + len, sizeof(new_output) - len, "}");
+
+  coalesce_line(coalescer, new_output, strlen(new_output));
 }
 
 static void on_strength_changed(GDBusConnection *conn, const gchar *sender_name,
@@ -179,6 +208,7 @@ static void on_strength_changed(GDBusConnection *conn, const gchar *sender_name,
   (void)user_data; // suppress unused paramater warning
   guint state = get_state(device_path);
   if (state == 100) {
+    stats_event(stats);
     guint8 strength = get_strength(current_ap_path);
     print_json(state, strength);
   }
@@ -196,10 +226,12 @@ static void on_state_changed(GDBusConnection *conn, const gchar *sender_name,
   (void)signal_name; // suppress unused paramater warning
   (void)parameters; // suppress unused paramater warning
   (void)user_data; // suppress unused paramater warning
+  stats_event(stats);
   guint state = get_state(device_path);
   guint8 strength = 0;
 
-  if (state == 100) {
+  // Without the strength field the access point is never looked at
+  if (state == 100 && field_on(&fields, WLAN_STRENGTH)) {
     if (current_ap_path) {
       g_free(current_ap_path);
     }
@@ -230,9 +262,14 @@ static void on_state_changed(GDBusConnection *conn, const gchar *sender_name,
   print_json(state, strength);
 }
 
-int main(void) {
+int wlan_monitor_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("wlan_monitor");
+  coalescer = coalesce_new("wlan_monitor", out, stats, COALESCE_DEFAULT_HZ);
   GError *error = NULL;
-  GMainLoop *loop;
 
   connection = g_bus_get_sync(G_BUS_TYPE_SYSTEM, NULL, &error);
   if (error) {
@@ -252,7 +289,7 @@ int main(void) {
   guint state = get_state(device_path);
   guint8 strength = 0;
 
-  if (state == 100) {
+  if (state == 100 && field_on(&fields, WLAN_STRENGTH)) {
     current_ap_path = get_active_access_point(device_path);
     if (current_ap_path) {
       strength = get_strength(current_ap_path);
@@ -274,7 +311,30 @@ int main(void) {
         on_strength_changed, NULL, NULL);
   }
 
-  loop = g_main_loop_new(NULL, FALSE);
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+static gboolean on_coalesce_ready(gint fd, GIOCondition condition,
+                                  gpointer user_data) {
+  (void)fd;        // suppress unused paramater warning
+  (void)condition; // suppress unused paramater warning
+  (void)user_data; // suppress unused paramater warning
+  coalesce_dispatch();
+  return G_SOURCE_CONTINUE;
+}
+
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  stats_init("wlan_monitor");
+  if (wlan_monitor_start(stdout) != 0) {
+    return 1;
+  }
+
+  GMainLoop *loop = g_main_loop_new(NULL, FALSE);
+  g_unix_fd_add(coalesce_fd(), G_IO_IN, on_coalesce_ready, NULL);
   g_main_loop_run(loop);
 
   // Cleanup
@@ -293,3 +353,4 @@ int main(void) {
 
   return 0;
 }
+#endif
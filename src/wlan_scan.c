@@ -38,6 +38,12 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "json.h"
+#include "stats.h"
 #include <dbus/dbus.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,8 +57,21 @@
 #define AP_INTERFACE "org.freedesktop.NetworkManager.AccessPoint"
 #define ACTIVE_CONN_INTERFACE "org.freedesktop.NetworkManager.Connection.Active"
 
+static FILE *out;
+static JsonWriter json;
+static StatsStream *stats;
+static Coalescer *coalescer;
+static char *wlan_device_path = NULL;
+static ChangeDetector changes;
+
+// JSON members of an access point, in output order
+enum { AP_SSID, AP_FREQUENCY, AP_STRENGTH, AP_CONNECTED };
+static const char *const ap_fields[] = {"SSID", "Frequency", "Strength",
+                                        "connected"};
+static FieldSet fields = FIELD_SET("wlan_scan", ap_fields);
+
 // Function to convert DBus byte array to string
-char *byte_array_to_string(DBusMessageIter *iter) {
+static char *byte_array_to_string(DBusMessageIter *iter) {
   DBusMessageIter array_iter;
 
   if (dbus_message_iter_get_arg_type(iter) != DBUS_TYPE_ARRAY ||
@@ -91,7 +110,7 @@ char *byte_array_to_string(DBusMessageIter *iter) {
 }
 
 // Function to get the active connection's SpecificObject
-char *get_active_specific_object(DBusConnection *conn) {
+static char *get_active_specific_object(DBusConnection *conn) {
   DBusMessage *msg;
   DBusPendingCall *pending;
   char *primary_conn_path = NULL;
@@ -164,10 +183,14 @@ char *get_active_specific_object(DBusConnection *conn) {
 }
 
 // Function to get and print access points
-void print_access_points(DBusConnection *conn, const char *device_path) {
+static void print_access_points(DBusConnection *conn,
+                                const char *device_path) {
   DBusMessage *msg;
   DBusPendingCall *pending;
-  char *active_ap_path = get_active_specific_object(conn);
+  // The active connection is only needed for the connected flag
+  char *active_ap_path = field_on(&fields, AP_CONNECTED)
+                             ? get_active_specific_object(conn)
+                             : NULL;
 
   msg = dbus_message_new_method_call(NM_DBUS_SERVICE, device_path,
                                      WIRELESS_INTERFACE, "GetAccessPoints");
@@ -204,8 +227,7 @@ void print_access_points(DBusConnection *conn, const char *device_path) {
       DBusMessageIter array_iter;
       dbus_message_iter_recurse(&args, &array_iter);
 
-      printf("[");
-      int first = 1;
+      json_begin_array(&json);
 
       while (dbus_message_iter_get_arg_type(&array_iter) != DBUS_TYPE_INVALID) {
         char *ap_path;
@@ -229,8 +251,11 @@ void print_access_points(DBusConnection *conn, const char *device_path) {
           DBusMessage *prop_reply = dbus_pending_call_steal_reply(prop_pending);
           dbus_pending_call_unref(prop_pending);
 
+          // The access point may be gone by now; that reply is an error
           DBusMessageIter prop_args;
-          if (dbus_message_iter_init(prop_reply, &prop_args)) {
+          if (dbus_message_get_type(prop_reply) ==
+                  DBUS_MESSAGE_TYPE_METHOD_RETURN &&
+              dbus_message_iter_init(prop_reply, &prop_args)) {
             DBusMessageIter dict_iter;
             dbus_message_iter_recurse(&prop_args, &dict_iter);
 
@@ -248,7 +273,8 @@ void print_access_points(DBusConnection *conn, const char *device_path) {
               dbus_message_iter_next(&entry_iter);
               dbus_message_iter_recurse(&entry_iter, &value_iter);
 
-              if (strcmp(prop_name, "Ssid") == 0) {
+              if (strcmp(prop_name, "Ssid") == 0 &&
+                  field_on(&fields, AP_SSID)) {
                 ssid = byte_array_to_string(&value_iter);
               } else if (strcmp(prop_name, "Frequency") == 0) {
                 dbus_message_iter_get_basic(&value_iter, &freq);
@@ -259,15 +285,24 @@ void print_access_points(DBusConnection *conn, const char *device_path) {
               dbus_message_iter_next(&dict_iter);
             }
 
-            if (!first) {
-              printf(",");
+            json_begin_object(&json);
+            if (field_on(&fields, AP_SSID)) {
+              json_key(&json, ap_fields[AP_SSID]);
+              json_string(&json, ssid);
             }
-            first = 0;
-
-            printf("{\"SSID\": \"%s\", \"Frequency\": %u, \"Strength\": %u, "
-                   "\"connected\": %s}",
-                   ssid ? ssid : "", freq, strength,
-                   is_connected ? "true" : "false");
+            if (field_on(&fields, AP_FREQUENCY)) {
+              json_key(&json, ap_fields[AP_FREQUENCY]);
+              json_int(&json, freq);
+            }
+            if (field_on(&fields, AP_STRENGTH)) {
+              json_key(&json, ap_fields[AP_STRENGTH]);
+              json_int(&json, strength);
+            }
+            if (field_on(&fields, AP_CONNECTED)) {
+              json_key(&json, ap_fields[AP_CONNECTED]);
+              json_bool(&json, is_connected);
+            }
+            json_end_object(&json);
 
             if (ssid) {
               free(ssid);
@@ -278,21 +313,29 @@ void print_access_points(DBusConnection *conn, const char *device_path) {
         dbus_message_unref(prop_msg);
         dbus_message_iter_next(&array_iter);
       }
-      printf("]\n");
-      fflush(stdout);
+      json_end_array(&json);
+      // A change confined to unselected fields leaves the document as it was
+      if (change_check(&changes, json.buf, json.len)) {
+        coalesce_line(coalescer, json.buf, json.len);
+      } else {
+        coalesce_suppressed(coalescer);
+      }
+      json_writer_reset(&json);
     }
   }
   dbus_message_unref(reply);
   free(active_ap_path);
 }
 
-// Signal handler for DBus signals
+// Signal handler for DBus signals; the system bus connection may be shared
+// with other monitors, so never claim the message
 static DBusHandlerResult signal_handler(DBusConnection *conn, DBusMessage *msg,
                                         void *user_data) {
   const char *device_path = (const char *)user_data;
 
   if (dbus_message_is_signal(msg, WIRELESS_INTERFACE, "AccessPointAdded") ||
       dbus_message_is_signal(msg, WIRELESS_INTERFACE, "AccessPointRemoved")) {
+    stats_event(stats);
     print_access_points(conn, device_path);
   } else if (dbus_message_is_signal(msg, "org.freedesktop.DBus.Properties",
                                     "PropertiesChanged")) {
@@ -319,8 +362,10 @@ static DBusHandlerResult signal_handler(DBusConnection *conn, DBusMessage *msg,
             if (dbus_message_iter_get_arg_type(&dict_entry) ==
                 DBUS_TYPE_STRING) {
               dbus_message_iter_get_basic(&dict_entry, &prop_name);
-              // Check if the property is ActiveConnections
-              if (strcmp(prop_name, "Connectivity") == 0) {
+              // Connectivity only moves the connected flag
+              if (strcmp(prop_name, "Connectivity") == 0 &&
+                  field_on(&fields, AP_CONNECTED)) {
+                stats_event(stats);
                 print_access_points(conn, device_path);
                 break;
               }
@@ -332,15 +377,20 @@ static DBusHandlerResult signal_handler(DBusConnection *conn, DBusMessage *msg,
     }
   }
 
-  return DBUS_HANDLER_RESULT_HANDLED;
+  return DBUS_HANDLER_RESULT_NOT_YET_HANDLED;
 }
 
-int main(void) {
+int wlan_scan_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return 1;
+  }
+  out = stream;
+  stats = stats_stream("wlan_scan");
+  coalescer = coalesce_new("wlan_scan", out, stats, COALESCE_DEFAULT_HZ);
   DBusConnection *conn;
   DBusError err;
   DBusMessage *msg;
   DBusPendingCall *pending;
-  char *device_path = NULL;
 
   dbus_error_init(&err);
   conn = dbus_bus_get(DBUS_BUS_SYSTEM, &err);
@@ -371,12 +421,12 @@ int main(void) {
 
   DBusMessageIter args;
   if (dbus_message_iter_init(reply, &args)) {
-    dbus_message_iter_get_basic(&args, &device_path);
-    device_path = strdup(device_path);
+    dbus_message_iter_get_basic(&args, &wlan_device_path);
+    wlan_device_path = strdup(wlan_device_path);
   }
   dbus_message_unref(reply);
 
-  if (!device_path) {
+  if (!wlan_device_path) {
     fprintf(stderr, "Failed to get device path\n");
     return 1;
   }
@@ -385,7 +435,7 @@ int main(void) {
   // Match rule for AccessPointAdded and AccessPointRemoved
   snprintf(match_rule, sizeof(match_rule),
            "type='signal',interface='%s',path='%s'", WIRELESS_INTERFACE,
-           device_path);
+           wlan_device_path);
   dbus_bus_add_match(conn, match_rule, &err);
   if (dbus_error_is_set(&err)) {
     fprintf(stderr, "Match Error: %s\n", err.message);
@@ -405,17 +455,34 @@ int main(void) {
     return 1;
   }
 
-  if (!dbus_connection_add_filter(conn, signal_handler, device_path, NULL)) {
+  if (!dbus_connection_add_filter(conn, signal_handler, wlan_device_path,
+                                  NULL)) {
     fprintf(stderr, "Failed to add filter\n");
     return 1;
   }
 
-  print_access_points(conn, device_path);
+  print_access_points(conn, wlan_device_path);
+  return 0;
+}
 
-  while (dbus_connection_read_write_dispatch(conn, -1))
-    ;
+#ifndef NEWWBAR_HUB
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  stats_init("wlan_scan");
+  if (wlan_scan_start(stdout) != 0) {
+    return 1;
+  }
+
+  DBusConnection *conn = dbus_bus_get(DBUS_BUS_SYSTEM, NULL);
+  while (dbus_connection_read_write_dispatch(conn, coalesce_timeout_ms())) {
+    coalesce_dispatch();
+  }
 
-  free(device_path);
+  free(wlan_device_path);
+  change_reset(&changes);
   dbus_connection_unref(conn);
   return 0;
 }
+#endif
@@ -38,17 +38,18 @@
  * ____________________________________________________________________________
  */
 
+#include "change.h"
+#include "coalesce.h"
+#include "hub.h"
+#include "hypr.h"
+#include "stats.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 #include <unistd.h>
 
-#define BUFFER_SIZE 1024
-
 #ifdef DEBUG
 #define DEBUG_MSG(fmt, ...)                                                    \
   do {                                                                         \
@@ -60,103 +61,82 @@
   } while (0)
 #endif
 
+static FILE *out;
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+static void print_workspace(const char *name, size_t len) {
+  if (change_check(&changes, name, len)) {
+    coalesce_line(coalescer, name, len);
+  } else {
+    coalesce_suppressed(coalescer);
+  }
+}
+
 static void initialRun(void) {
-  FILE *fp = popen(
-      "hyprctl monitors -j | jq '.[] | select(.focused == true ) | .activeWorkspace.id'", "r");
-  if (!fp) {
-    DEBUG_MSG("popen failed");
+  int id;
+  if (hypr_focused_workspace(&id) < 0) {
+    DEBUG_MSG("monitors request failed");
     return;
   }
   char line[16];
-  if (fgets(line, sizeof(line), fp)) {
-    int id = atoi(line);
-    printf("%i\n", id);
+  int len = snprintf(line, sizeof(line), "%i", id);
+  print_workspace(line, (size_t)len);
+}
+
+// focusedmon>>MONITOR,WORKSPACE  workspace>>WORKSPACE
+static void on_event(HyprEvent event, const char *data, size_t len) {
+  if (event == HYPR_FOCUSEDMON) {
+    const char *comma = memchr(data, ',', len);
+    if (!comma) {
+      return;
+    }
+    len -= (size_t)(comma + 1 - data);
+    data = comma + 1;
   }
-  pclose(fp);
+  stats_event(stats);
+  print_workspace(data, len);
 }
 
-int main(void) {
-  DEBUG_MSG("DEBUG enabled.");
-  const char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
-  const char *hyprland_instance = getenv("HYPRLAND_INSTANCE_SIGNATURE");
-  if (!xdg_runtime || !hyprland_instance) {
-    DEBUG_MSG("Required environment variables not set");
-    return 1;
+static const HyprSubscriber subscriber = {
+    "workspace_focus", HYPR_MASK(HYPR_FOCUSEDMON) | HYPR_MASK(HYPR_WORKSPACE),
+    on_event, NULL, initialRun};
+
+// --- Subscribe to the socket2 bus, which must be open already ---
+int workspace_focus_start(FILE *stream) {
+  out = stream;
+  stats = stats_stream("workspace_focus");
+  coalescer = coalesce_new("workspace_focus", out, stats, COALESCE_DEFAULT_HZ);
+  if (hypr_bus_subscribe(&subscriber) < 0) {
+    DEBUG_MSG("too many socket2 subscribers");
+    return -1;
   }
 
-  char socket_path[256];
-  snprintf(socket_path, sizeof(socket_path), "%s/hypr/%s/.socket2.sock",
-           xdg_runtime, hyprland_instance);
+  initialRun();
+  return 0;
+}
 
-  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+#ifndef NEWWBAR_HUB
+int main(void) {
+  DEBUG_MSG("DEBUG enabled.");
+  stats_init("workspace_focus");
+  int sock = hypr_bus_open();
   if (sock < 0) {
-    DEBUG_MSG("socket creation failed");
+    DEBUG_MSG("socket2 connect failed");
     return 1;
   }
-
-  struct sockaddr_un addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sun_family = AF_UNIX;
-  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
-
-  size_t addr_len =
-      offsetof(struct sockaddr_un, sun_path) + strlen(addr.sun_path) + 1;
-  if (connect(sock, (struct sockaddr *)&addr, addr_len) < 0) {
-    DEBUG_MSG("socket connect failed");
-    close(sock);
+  if (workspace_focus_start(stdout) < 0) {
     return 1;
   }
 
-  initialRun();
-
-  while (1) {
-    char buffer[BUFFER_SIZE];
-    size_t buffer_len = 0;
-
-    if (buffer_len >= BUFFER_SIZE - 1) {
-      DEBUG_MSG("Buffer full, discarding old data");
-      buffer_len = 0;
-    }
-
-    ssize_t bytes =
-        read(sock, buffer + buffer_len, BUFFER_SIZE - buffer_len - 1);
-    if (bytes <= 0) {
-      if (bytes == 0) {
-        DEBUG_MSG("Socket closed");
-      }
-      else
-        DEBUG_MSG("socket read failed.");
-      break;
-    }
-    buffer_len += bytes;
-    buffer[buffer_len] = '\0';
-
-    char *line = buffer;
-    char *next_line;
-    while ((next_line = strchr(line, '\n'))) {
-      *next_line = '\0';
-      if (strncmp(line, "workspace>>", 10) == 0 ||
-          strncmp(line, "focusedmon>>", 11) == 0) {
-        char *ptr = strrchr(line, ',');
-        if (!ptr) {
-          ptr = strrchr(line, '>');
-        }
-        if (ptr) {
-          printf("%s\n", ptr + 1);
-          fflush(stdout);
-        }
-      }
-      line = next_line + 1;
-    }
-
-    buffer_len = strlen(line);
-    if (buffer_len > 0) {
-      memmove(buffer, line, buffer_len + 1);
-    } else {
-      buffer_len = 0;
-    }
-  }
-
-  close(sock);
+  do {
+    while (coalesce_poll(sock) > 0 && hypr_bus_dispatch(sock) == 0)
+      ;
+    DEBUG_MSG("Socket closed");
+    close(sock);
+    coalesce_flush_all(); // the last state stands while Hyprland is away
+  } while ((sock = hypr_bus_wait()) >= 0);
   return 0;
 }
+#endif
@@ -38,16 +38,26 @@
  * ____________________________________________________________________________
  */
 
+#define _GNU_SOURCE
+#include "change.h"
+#include "coalesce.h"
+#include "fields.h"
+#include "hub.h"
+#include "hypr.h"
+#include "json.h"
+#include "stats.h"
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 #include <unistd.h>
 
-#define MAX_WORKSPACES 6
-#define BUFFER_SIZE 64
+#define NO_WORKSPACE INT_MIN
+#define NO_MONITOR -1
 
 #ifdef DEBUG
 #define DEBUG_MSG(fmt, ...)                                                    \
@@ -60,129 +70,1146 @@
   } while (0)
 #endif
 
+// Windows of one class on a workspace
+typedef struct {
+  char *name;
+  int count;
+} App;
+
 typedef struct {
   int WorkspaceID;
-  bool hasWindows;
-  bool prevhasWindows;
+  char *name;
+  size_t name_len;
+  int monitor; // Hyprland monitor id, NO_MONITOR until known
+  int windows;
+  int urgent_windows;
+  int fullscreen_windows;
+  App *apps; // sorted by class
+  size_t app_count;
+  size_t app_cap;
+  bool special;
+  bool visible; // a special workspace open on its monitor
+  bool hasWindows; // as last printed
+  bool urgent;     // as last printed
+  bool fullscreen; // as last printed
+  bool dirty;      // counts changed since the last publish()
 } Workspace;
 
-Workspace workspaces[MAX_WORKSPACES] = {0};
+typedef struct {
+  char *name;
+  int id;
+  int special; // id of the special workspace open on it, or NO_WORKSPACE
+} Monitor;
+
+// Open-addressed window address -> workspace id map; address 0 marks a free
+// slot (no window lives there). The class and flags count towards the
+// workspace the window is on and move with it.
+typedef struct {
+  uint64_t address;
+  int workspace;
+  char *app; // class, NULL when it has none
+  bool urgent;
+  bool fullscreen;
+} WindowSlot;
+
+// Open-addressed name -> id index over one of the tables; name NULL marks a
+// free slot. NAME points at the table entry's own copy.
+typedef struct {
+  const char *name;
+  size_t len;
+  uint64_t hash;
+  int id;
+} NameSlot;
+
+typedef struct {
+  NameSlot *slots;
+  size_t cap; // power of two
+  size_t count;
+} NameIndex;
+
+// Both tables grow on demand and stay sorted by id
+static Workspace *workspaces = NULL;
+static size_t workspace_count = 0;
+static size_t workspace_cap = 0;
+static Monitor *monitors = NULL;
+static size_t monitor_count = 0;
+static size_t monitor_cap = 0;
+static int focused_monitor = NO_MONITOR;
+static uint64_t active_address = 0; // 0 when no window has focus
+static bool changed = false; // something printed differs from the last line
+static bool consistent = true; // events since the last done() fit the tables
+static NameIndex workspace_names; // events name workspaces and monitors
+static NameIndex monitor_names;
+
+// Ids of the workspaces whose counts changed, so publish() looks at those
+// alone; dirty_all when one could not be recorded
+static int *dirty = NULL;
+static size_t dirty_count = 0;
+static size_t dirty_cap = 0;
+static bool dirty_all = false;
+
+static Workspace *find_workspace(int id);
 
-void print_json(void) {
-  printf("[");
-  for (int i = 0; i < MAX_WORKSPACES; i++) {
-    if (i) {
-      printf(",");
+static WindowSlot *window_map = NULL;
+static size_t map_cap = 0; // power of two
+static size_t map_count = 0;
+static FILE *out;
+static JsonWriter json;
+static ChangeDetector changes;
+static StatsStream *stats;
+static Coalescer *coalescer;
+
+enum {
+  WS_ID,
+  WS_NAME,
+  WS_HAS_WINDOWS,
+  WS_SPECIAL,
+  WS_URGENT,
+  WS_FULLSCREEN,
+  WS_VISIBLE,
+  WS_APPS
+};
+static const char *const workspace_fields[] = {
+    "WorkspaceID", "name",       "hasWindows", "special",
+    "urgent",      "fullscreen", "visible",    "apps"};
+static FieldSet fields = FIELD_SET("workspace_list", workspace_fields);
+
+// One group per monitor, so a bar only has to look at its own:
+// [{"monitor":"DP-1","monitorID":0,"workspaces":[{"WorkspaceID":1,...}]}]
+static void print_json(void) {
+  json_begin_array(&json);
+  for (size_t m = 0; m < monitor_count; m++) {
+    json_begin_object(&json);
+    json_key(&json, "monitor");
+    json_string(&json, monitors[m].name);
+    json_key(&json, "monitorID");
+    json_int(&json, monitors[m].id);
+    json_key(&json, "workspaces");
+    json_begin_array(&json);
+    for (size_t i = 0; i < workspace_count; i++) {
+      const Workspace *ws = &workspaces[i];
+      if (ws->monitor != monitors[m].id) {
+        continue;
+      }
+      json_begin_object(&json);
+      if (field_on(&fields, WS_ID)) {
+        json_key(&json, workspace_fields[WS_ID]);
+        json_int(&json, ws->WorkspaceID);
+      }
+      if (field_on(&fields, WS_NAME)) {
+        json_key(&json, workspace_fields[WS_NAME]);
+        json_string(&json, ws->name);
+      }
+      if (field_on(&fields, WS_HAS_WINDOWS)) {
+        json_key(&json, workspace_fields[WS_HAS_WINDOWS]);
+        json_bool(&json, ws->hasWindows);
+      }
+      if (field_on(&fields, WS_SPECIAL)) {
+        json_key(&json, workspace_fields[WS_SPECIAL]);
+        json_bool(&json, ws->special);
+      }
+      if (field_on(&fields, WS_URGENT)) {
+        json_key(&json, workspace_fields[WS_URGENT]);
+        json_bool(&json, ws->urgent);
+      }
+      if (field_on(&fields, WS_FULLSCREEN)) {
+        json_key(&json, workspace_fields[WS_FULLSCREEN]);
+        json_bool(&json, ws->fullscreen);
+      }
+      if (field_on(&fields, WS_VISIBLE)) {
+        json_key(&json, workspace_fields[WS_VISIBLE]);
+        json_bool(&json, ws->visible);
+      }
+      if (field_on(&fields, WS_APPS)) {
+        json_key(&json, workspace_fields[WS_APPS]);
+        json_begin_array(&json);
+        for (size_t a = 0; a < ws->app_count; a++) {
+          json_begin_object(&json);
+          json_key(&json, "class");
+          json_string(&json, ws->apps[a].name);
+          json_key(&json, "count");
+          json_int(&json, ws->apps[a].count);
+          json_end_object(&json);
+        }
+        json_end_array(&json);
+      }
+      json_end_object(&json);
     }
-    printf("{\"WorkspaceID\": %i,", workspaces[i].WorkspaceID);
-    printf("\"hasWindows\": %s", (workspaces[i].hasWindows ? "true" : "false"));
-    printf("}");
+    json_end_array(&json);
+    json_end_object(&json);
+  }
+  json_end_array(&json);
+  if (change_check(&changes, json.buf, json.len)) {
+    coalesce_line(coalescer, json.buf, json.len);
+  } else {
+    coalesce_suppressed(coalescer); // a resync that found nothing new
+  }
+  json_writer_reset(&json);
+  changed = false;
+}
+
+// Moves a printed flag to its counted value; true when that flips a
+// printed field
+static bool flip(bool *shown, int count, int field) {
+  if (*shown == (count > 0)) {
+    return false;
   }
-  printf("]\n");
-  fflush(stdout);
+  *shown = count > 0;
+  return field_on(&fields, field);
 }
 
-static void update_workspaces(void) {
-  // Execute hyprctl command and capture output
-  FILE *fp = popen("hyprctl workspaces -j | jq '.[] | .id, .windows'", "r");
-  if (!fp) {
-    DEBUG_MSG("popen failed");
+static void flip_flags(Workspace *ws) {
+  changed = flip(&ws->hasWindows, ws->windows, WS_HAS_WINDOWS) || changed;
+  changed = flip(&ws->urgent, ws->urgent_windows, WS_URGENT) || changed;
+  changed = flip(&ws->fullscreen, ws->fullscreen_windows, WS_FULLSCREEN) ||
+            changed;
+  ws->dirty = false;
+  DEBUG_MSG("ID: %i, monitor: %i, windows: %i", ws->WorkspaceID,
+            ws->monitor, ws->windows);
+}
+
+// Prints when the table changed or a workspace gained its first or lost its
+// last window, urgent window or fullscreen window
+static void publish(void) {
+  if (dirty_all) {
+    for (size_t i = 0; i < workspace_count; i++) {
+      flip_flags(&workspaces[i]);
+    }
+  } else {
+    for (size_t i = 0; i < dirty_count; i++) {
+      Workspace *ws = find_workspace(dirty[i]); // gone since, or re-added
+      if (ws && ws->dirty) {
+        flip_flags(ws);
+      }
+    }
+  }
+  dirty_count = 0;
+  dirty_all = false;
+
+  if (changed) {
+    print_json();
+  } else {
+    coalesce_suppressed(coalescer);
+  }
+}
+
+// --- Name indexes ---
+
+static NameSlot *name_find(const NameIndex *index, const char *name,
+                           size_t len) {
+  if (index->count == 0) {
+    return NULL;
+  }
+  uint64_t hash = change_hash(name, len);
+  for (size_t i = hash & (index->cap - 1);; i = (i + 1) & (index->cap - 1)) {
+    NameSlot *slot = &index->slots[i];
+    if (!slot->name) {
+      return NULL;
+    }
+    if (slot->hash == hash && slot->len == len &&
+        memcmp(slot->name, name, len) == 0) {
+      return slot;
+    }
+  }
+}
+
+static void name_insert(NameIndex *index, NameSlot entry) {
+  size_t i = entry.hash & (index->cap - 1);
+  while (index->slots[i].name) {
+    i = (i + 1) & (index->cap - 1);
+  }
+  index->slots[i] = entry;
+}
+
+static bool name_grow(NameIndex *index) {
+  size_t old_cap = index->cap;
+  NameSlot *old = index->slots;
+  size_t cap = old_cap ? old_cap * 2 : 16;
+  NameSlot *grown = calloc(cap, sizeof(*grown));
+  if (!grown) {
+    return false;
+  }
+  index->slots = grown;
+  index->cap = cap;
+  for (size_t i = 0; i < old_cap; i++) {
+    if (old[i].name) {
+      name_insert(index, old[i]);
+    }
+  }
+  free(old);
+  return true;
+}
+
+// A name already indexed is taken over by ID
+static void name_put(NameIndex *index, const char *name, size_t len, int id) {
+  NameSlot *slot = name_find(index, name, len);
+  if (slot) {
+    *slot = (NameSlot){name, len, slot->hash, id};
     return;
   }
+  if ((index->count + 1) * 4 > index->cap * 3 && !name_grow(index)) {
+    DEBUG_MSG("name index allocation failed");
+    return; // lookups miss it, which resyncs
+  }
+  name_insert(index, (NameSlot){name, len, change_hash(name, len), id});
+  index->count++;
+}
 
-  for (int i = 0; i < MAX_WORKSPACES; i++) {
-    workspaces[i].prevhasWindows = workspaces[i].hasWindows;
-    workspaces[i].hasWindows = false;
+// Only while NAME still belongs to ID
+static void name_remove(NameIndex *index, const char *name, size_t len,
+                        int id) {
+  NameSlot *slot = name_find(index, name, len);
+  if (!slot || slot->id != id) {
+    return;
   }
+  index->count--;
 
-  char line[16];
-  int id;
-  while (fgets(line, 16, fp)) {
-    id = atoi(line);
-    DEBUG_MSG("%s:%i\n", line, id);
-    if (fgets(line, 16, fp)) {
-      int windows = atoi(line);
-      DEBUG_MSG("%s:%i\n", line, windows);
-      if (id >= 1 && id <= MAX_WORKSPACES) {
-        workspaces[id - 1].hasWindows = (windows > 0);
-      }
+  // Backward shift, as in the window map
+  size_t mask = index->cap - 1;
+  size_t hole = (size_t)(slot - index->slots);
+  for (size_t i = (hole + 1) & mask; index->slots[i].name;
+       i = (i + 1) & mask) {
+    size_t home = index->slots[i].hash & mask;
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      index->slots[hole] = index->slots[i];
+      hole = i;
     }
   }
+  index->slots[hole] = (NameSlot){0};
+}
 
-  pclose(fp);
+static void name_clear(NameIndex *index) {
+  if (index->slots) {
+    memset(index->slots, 0, index->cap * sizeof(*index->slots));
+  }
+  index->count = 0;
+}
 
-  bool outputFlag = false;
-  for (int i = 0; i < MAX_WORKSPACES; i++) {
-    DEBUG_MSG("ID: %i, hasWindows: %i\n", workspaces[i].WorkspaceID,
-              workspaces[i].hasWindows);
-    if (workspaces[i].hasWindows != workspaces[i].prevhasWindows) {
-      outputFlag = true;
+// --- Monitor table ---
+
+static Monitor *monitor_named(const char *name, size_t len) {
+  const NameSlot *slot = name_find(&monitor_names, name, len);
+  if (!slot) {
+    return NULL;
+  }
+  size_t lo = 0, hi = monitor_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (monitors[mid].id < slot->id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
     }
   }
+  return lo < monitor_count && monitors[lo].id == slot->id ? &monitors[lo]
+                                                           : NULL;
+}
 
-  if (outputFlag) {
-    print_json();
+static int find_monitor(const char *name, size_t len) {
+  Monitor *mon = monitor_named(name, len);
+  return mon ? mon->id : NO_MONITOR;
+}
+
+static void add_monitor(const char *name, int id) {
+  if (find_monitor(name, strlen(name)) != NO_MONITOR) {
+    return;
   }
+  if (monitor_count == monitor_cap) {
+    size_t cap = monitor_cap ? monitor_cap * 2 : 4;
+    Monitor *grown = realloc(monitors, cap * sizeof(*grown));
+    if (!grown) {
+      return;
+    }
+    monitors = grown;
+    monitor_cap = cap;
+  }
+  char *copy = strdup(name);
+  if (!copy) {
+    return;
+  }
+  size_t i = monitor_count;
+  while (i > 0 && monitors[i - 1].id > id) {
+    monitors[i] = monitors[i - 1];
+    i--;
+  }
+  monitors[i].name = copy;
+  monitors[i].id = id;
+  monitors[i].special = NO_WORKSPACE;
+  monitor_count++;
+  name_put(&monitor_names, copy, strlen(copy), id);
+  changed = true;
 }
 
-int main(void) {
-  DEBUG_MSG("DEBUG enabled.");
-  char *xdg_runtime = getenv("XDG_RUNTIME_DIR");
-  char *hyprland_instance = getenv("HYPRLAND_INSTANCE_SIGNATURE");
-  if (!xdg_runtime || !hyprland_instance) {
-    DEBUG_MSG("Required environment variables not set");
-    return 1;
+// --- Workspace table ---
+
+static Workspace *find_workspace(int id) {
+  size_t lo = 0, hi = workspace_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (workspaces[mid].WorkspaceID < id) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
   }
+  return lo < workspace_count && workspaces[lo].WorkspaceID == id
+             ? &workspaces[lo]
+             : NULL;
+}
 
-  char socket_path[256];
-  snprintf(socket_path, sizeof(socket_path), "%s/hypr/%s/.socket2.sock",
-           xdg_runtime, hyprland_instance);
+static Workspace *find_named(const char *name, size_t len) {
+  const NameSlot *slot = name_find(&workspace_names, name, len);
+  return slot ? find_workspace(slot->id) : NULL;
+}
 
-  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
-  if (sock < 0) {
-    DEBUG_MSG("socket creation failed");
-    return 1;
+static void set_name(Workspace *ws, const char *name, size_t len) {
+  if (ws->name && ws->name_len == len && memcmp(ws->name, name, len) == 0) {
+    return;
   }
+  char *copy = strndup(name, len);
+  if (!copy) {
+    return;
+  }
+  if (ws->name) {
+    name_remove(&workspace_names, ws->name, ws->name_len, ws->WorkspaceID);
+  }
+  free(ws->name);
+  ws->name = copy;
+  ws->name_len = len;
+  name_put(&workspace_names, copy, len, ws->WorkspaceID);
+  bool special = strncmp(copy, "special", 7) == 0;
+  changed = changed || field_on(&fields, WS_NAME) ||
+            (special != ws->special && field_on(&fields, WS_SPECIAL));
+  ws->special = special;
+}
 
-  struct sockaddr_un addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sun_family = AF_UNIX;
-  strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+static void set_monitor(Workspace *ws, int monitor) {
+  if (ws->monitor != monitor) {
+    ws->monitor = monitor;
+    changed = true;
+  }
+}
 
-  if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-    DEBUG_MSG("socket connect failed");
-    close(sock);
-    return 1;
+static Workspace *add_workspace(int id, const char *name, size_t len,
+                                int monitor) {
+  Workspace *ws = find_workspace(id);
+  if (ws) {
+    set_name(ws, name, len);
+    set_monitor(ws, monitor);
+    return ws;
+  }
+  if (workspace_count == workspace_cap) {
+    size_t cap = workspace_cap ? workspace_cap * 2 : 16;
+    Workspace *grown = realloc(workspaces, cap * sizeof(*grown));
+    if (!grown) {
+      DEBUG_MSG("workspace table allocation failed");
+      return NULL;
+    }
+    workspaces = grown;
+    workspace_cap = cap;
+  }
+  size_t i = workspace_count;
+  while (i > 0 && workspaces[i - 1].WorkspaceID > id) {
+    i--;
+  }
+  memmove(&workspaces[i + 1], &workspaces[i],
+          (workspace_count - i) * sizeof(*workspaces));
+  workspace_count++;
+  ws = &workspaces[i];
+  memset(ws, 0, sizeof(*ws));
+  ws->WorkspaceID = id;
+  ws->monitor = monitor;
+  set_name(ws, name, len);
+  changed = true;
+  return ws;
+}
+
+static void free_apps(Workspace *ws) {
+  for (size_t a = 0; a < ws->app_count; a++) {
+    free(ws->apps[a].name);
+  }
+  free(ws->apps);
+  ws->apps = NULL;
+  ws->app_count = ws->app_cap = 0;
+}
+
+static void remove_workspace(Workspace *ws) {
+  size_t i = (size_t)(ws - workspaces);
+  for (size_t m = 0; ws->visible && m < monitor_count; m++) {
+    if (monitors[m].special == ws->WorkspaceID) {
+      monitors[m].special = NO_WORKSPACE;
+    }
+  }
+  if (ws->name) {
+    name_remove(&workspace_names, ws->name, ws->name_len, ws->WorkspaceID);
+  }
+  free(ws->name);
+  free_apps(ws);
+  memmove(&workspaces[i], &workspaces[i + 1],
+          (workspace_count - i - 1) * sizeof(*workspaces));
+  workspace_count--;
+  changed = true;
+}
+
+static void set_visible(Workspace *ws, bool visible) {
+  if (ws->visible != visible) {
+    ws->visible = visible;
+    changed = changed || field_on(&fields, WS_VISIBLE);
   }
+}
 
-  for (int i = 0; i < MAX_WORKSPACES; i++) {
-    workspaces[i].WorkspaceID = i + 1;
-    workspaces[i].hasWindows = false;
-    workspaces[i].prevhasWindows = false;
+// One special workspace per monitor; WS NULL closes the open one
+static void show_special(Monitor *mon, Workspace *ws) {
+  Workspace *open = find_workspace(mon->special);
+  if (open && open != ws) {
+    set_visible(open, false);
+  }
+  mon->special = NO_WORKSPACE;
+  if (!ws) {
+    return;
+  }
+  for (size_t i = 0; i < monitor_count; i++) {
+    if (monitors[i].special == ws->WorkspaceID) {
+      monitors[i].special = NO_WORKSPACE; // moved over from there
+    }
   }
+  mon->special = ws->WorkspaceID;
+  set_monitor(ws, mon->id);
+  set_visible(ws, true);
+}
 
-  update_workspaces(); // initialize
+// A workspace holds a handful of classes, so a sorted array beats a hash
+static void count_app(Workspace *ws, const char *name, int delta) {
+  size_t lo = 0, hi = ws->app_count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (strcmp(ws->apps[mid].name, name) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  App *app = lo < ws->app_count && strcmp(ws->apps[lo].name, name) == 0
+                 ? &ws->apps[lo]
+                 : NULL;
+  if (app) {
+    changed = changed || field_on(&fields, WS_APPS);
+    app->count += delta;
+    if (app->count <= 0) {
+      free(app->name);
+      memmove(app, app + 1, (ws->app_count - lo - 1) * sizeof(*app));
+      ws->app_count--;
+    }
+    return;
+  }
+  if (delta <= 0) {
+    return;
+  }
+  if (ws->app_count == ws->app_cap) {
+    size_t cap = ws->app_cap ? ws->app_cap * 2 : 4;
+    App *grown = realloc(ws->apps, cap * sizeof(*grown));
+    if (!grown) {
+      return;
+    }
+    ws->apps = grown;
+    ws->app_cap = cap;
+  }
+  char *copy = strdup(name);
+  if (!copy) {
+    return;
+  }
+  memmove(&ws->apps[lo + 1], &ws->apps[lo],
+          (ws->app_count - lo) * sizeof(*ws->apps));
+  ws->apps[lo] = (App){copy, delta};
+  ws->app_count++;
+  changed = changed || field_on(&fields, WS_APPS);
+}
 
-  char buffer[BUFFER_SIZE];
-  while (1) {
-    ssize_t bytes = read(sock, buffer, BUFFER_SIZE - 1);
-    if (bytes <= 0) {
-      if (bytes == 0) {
-        DEBUG_MSG("Socket closed");
-      } else {
-        DEBUG_MSG("socket read failed");
+static void mark_dirty(Workspace *ws) {
+  if (ws->dirty || dirty_all) {
+    return;
+  }
+  if (dirty_count == dirty_cap) {
+    size_t cap = dirty_cap ? dirty_cap * 2 : 16;
+    int *grown = realloc(dirty, cap * sizeof(*grown));
+    if (!grown) {
+      dirty_all = true;
+      return;
+    }
+    dirty = grown;
+    dirty_cap = cap;
+  }
+  dirty[dirty_count++] = ws->WorkspaceID;
+  ws->dirty = true;
+}
+
+static void count_flags(const WindowSlot *slot, int delta) {
+  Workspace *ws = find_workspace(slot->workspace);
+  if (ws) {
+    mark_dirty(ws);
+    ws->windows += delta;
+    ws->urgent_windows += slot->urgent ? delta : 0;
+    ws->fullscreen_windows += slot->fullscreen ? delta : 0;
+  }
+}
+
+static void count_window(const WindowSlot *slot, int delta) {
+  count_flags(slot, delta);
+  Workspace *ws = slot->app ? find_workspace(slot->workspace) : NULL;
+  if (ws) {
+    count_app(ws, slot->app, delta);
+  }
+}
+
+// --- Window map ---
+
+static size_t map_slot(uint64_t address) {
+  return (size_t)((address * 0x9E3779B97F4A7C15ull) >> 32) & (map_cap - 1);
+}
+
+static WindowSlot *map_find(uint64_t address) {
+  if (map_count == 0) {
+    return NULL;
+  }
+  for (size_t i = map_slot(address);; i = (i + 1) & (map_cap - 1)) {
+    if (window_map[i].address == address) {
+      return &window_map[i];
+    }
+    if (window_map[i].address == 0) {
+      return NULL;
+    }
+  }
+}
+
+static bool map_grow(void) {
+  size_t old_cap = map_cap;
+  WindowSlot *old = window_map;
+  size_t cap = old_cap ? old_cap * 2 : 64;
+  WindowSlot *grown = calloc(cap, sizeof(*grown));
+  if (!grown) {
+    return false;
+  }
+  window_map = grown;
+  map_cap = cap;
+  for (size_t i = 0; i < old_cap; i++) {
+    if (old[i].address) {
+      size_t j = map_slot(old[i].address);
+      while (window_map[j].address) {
+        j = (j + 1) & (map_cap - 1);
+      }
+      window_map[j] = old[i];
+    }
+  }
+  free(old);
+  return true;
+}
+
+// Places a window on a workspace, keeping the counts in step
+static WindowSlot *map_set(uint64_t address, int workspace) {
+  WindowSlot *slot = map_find(address);
+  if (slot) {
+    count_window(slot, -1);
+    slot->workspace = workspace;
+    count_window(slot, 1);
+    return slot;
+  }
+  if ((map_count + 1) * 4 > map_cap * 3 && !map_grow()) {
+    DEBUG_MSG("window map allocation failed");
+    return NULL;
+  }
+  size_t i = map_slot(address);
+  while (window_map[i].address) {
+    i = (i + 1) & (map_cap - 1);
+  }
+  slot = &window_map[i];
+  *slot = (WindowSlot){address, workspace, NULL, false, false};
+  map_count++;
+  count_window(slot, 1);
+  return slot;
+}
+
+// Sets one of a window's flags, keeping its workspace's count in step
+static void set_flag(WindowSlot *slot, bool *flag, bool value) {
+  if (*flag != value) {
+    count_flags(slot, -1);
+    *flag = value;
+    count_flags(slot, 1);
+  }
+}
+
+// Classes do not change, so only a window the map got without one takes it
+static void set_app(WindowSlot *slot, const char *name, size_t len) {
+  if (slot->app || len == 0) {
+    return;
+  }
+  char *copy = strndup(name, len);
+  if (!copy) {
+    return;
+  }
+  count_window(slot, -1);
+  slot->app = copy;
+  count_window(slot, 1);
+}
+
+// Returns the workspace the window was on, NO_WORKSPACE if unknown
+static int map_remove(uint64_t address) {
+  WindowSlot *slot = map_find(address);
+  if (!slot) {
+    return NO_WORKSPACE;
+  }
+  int workspace = slot->workspace;
+  count_window(slot, -1);
+  free(slot->app);
+  map_count--;
+
+  // Backward-shift the rest of the probe run so lookups never need
+  // tombstones
+  size_t hole = (size_t)(slot - window_map);
+  for (size_t i = (hole + 1) & (map_cap - 1); window_map[i].address;
+       i = (i + 1) & (map_cap - 1)) {
+    size_t home = map_slot(window_map[i].address);
+    if (((i - home) & (map_cap - 1)) >= ((i - hole) & (map_cap - 1))) {
+      window_map[hole] = window_map[i];
+      hole = i;
+    }
+  }
+  window_map[hole] = (WindowSlot){0};
+  return workspace;
+}
+
+static void map_clear(void) {
+  for (size_t i = 0; i < map_cap; i++) {
+    free(window_map[i].app);
+  }
+  if (window_map) {
+    memset(window_map, 0, map_cap * sizeof(*window_map));
+  }
+  map_count = 0;
+  for (size_t i = 0; i < workspace_count; i++) {
+    workspaces[i].windows = 0;
+    workspaces[i].urgent_windows = 0;
+    workspaces[i].fullscreen_windows = 0;
+    mark_dirty(&workspaces[i]);
+    if (workspaces[i].app_count) {
+      free_apps(&workspaces[i]);
+      changed = changed || field_on(&fields, WS_APPS);
+    }
+  }
+}
+
+// --- Full resync from the request socket ---
+
+static void clear_tables(void) {
+  map_clear();
+  for (size_t i = 0; i < workspace_count; i++) {
+    free(workspaces[i].name);
+    free_apps(&workspaces[i]);
+  }
+  workspace_count = 0;
+  name_clear(&workspace_names);
+  for (size_t i = 0; i < monitor_count; i++) {
+    free(monitors[i].name);
+  }
+  monitor_count = 0;
+  name_clear(&monitor_names);
+  focused_monitor = NO_MONITOR;
+}
+
+// The tables are only dropped once the reply is in
+static void take_workspace(const HyprWorkspace *hw, void *data) {
+  bool *cleared = data;
+  if (!*cleared) {
+    clear_tables();
+    *cleared = true;
+  }
+  if (*hw->monitor) {
+    add_monitor(hw->monitor, hw->monitor_id);
+  }
+  add_workspace(hw->id, hw->name, strlen(hw->name),
+                *hw->monitor ? hw->monitor_id : NO_MONITOR);
+}
+
+static void add_client(const HyprClient *client, void *data) {
+  (void)data; // suppress unused paramater warning
+  WindowSlot *slot = client->address
+                         ? map_set(client->address, client->workspace)
+                         : NULL;
+  if (slot) {
+    set_app(slot, client->class_name, strlen(client->class_name));
+    set_flag(slot, &slot->fullscreen, client->fullscreen);
+  }
+}
+
+// Neither urgency nor an open special workspace shows in the replies; both
+// are carried over from the tables a resync replaces
+typedef struct {
+  uint64_t *urgent; // window addresses
+  size_t urgent_count;
+  int *visible; // workspace ids
+  size_t visible_count;
+} Carried;
+
+static Carried carry_flags(void) {
+  Carried carried = {NULL, 0, NULL, 0};
+  size_t urgent = 0, visible = 0;
+  for (size_t i = 0; i < workspace_count; i++) {
+    urgent += (size_t)workspaces[i].urgent_windows;
+    visible += workspaces[i].visible;
+  }
+  if (urgent && (carried.urgent = malloc(urgent * sizeof(uint64_t)))) {
+    for (size_t i = 0; i < map_cap && carried.urgent_count < urgent; i++) {
+      if (window_map[i].address && window_map[i].urgent) {
+        carried.urgent[carried.urgent_count++] = window_map[i].address;
       }
-      break;
     }
-    buffer[bytes] = '\0';
-    if (strncmp(buffer, "closewindow>>", 13) == 0 ||
-        strncmp(buffer, "openwindow>>", 12) == 0 ||
-        strncmp(buffer, "movewindow>>", 12) == 0) {
-      DEBUG_MSG("CAUGHT:windows %s\n", buffer);
-      update_workspaces();
+  }
+  if (visible && (carried.visible = malloc(visible * sizeof(int)))) {
+    for (size_t i = 0; i < workspace_count; i++) {
+      if (workspaces[i].visible) {
+        carried.visible[carried.visible_count++] = workspaces[i].WorkspaceID;
+      }
+    }
+  }
+  return carried;
+}
+
+static void restore_flags(Carried *carried) {
+  for (size_t i = 0; i < carried->urgent_count; i++) {
+    WindowSlot *slot = map_find(carried->urgent[i]);
+    if (slot) {
+      set_flag(slot, &slot->urgent, true);
+    }
+  }
+  for (size_t i = 0; i < carried->visible_count; i++) {
+    Workspace *ws = find_workspace(carried->visible[i]);
+    for (size_t m = 0; ws && m < monitor_count; m++) {
+      if (monitors[m].id == ws->monitor) {
+        show_special(&monitors[m], ws);
+      }
+    }
+  }
+  free(carried->urgent);
+  free(carried->visible);
+}
+
+// False when Hyprland could not be asked: the tables are kept when the
+// first request fails, but are incomplete when a later one does (a dying
+// compositor), so they are not printed until a resync gets through
+static bool query_tables(void) {
+  bool cleared = false;
+  if (hypr_workspaces(take_workspace, &cleared) < 0) {
+    DEBUG_MSG("workspaces request failed");
+    return false;
+  }
+  if (!cleared) {
+    clear_tables();
+  }
+  int active;
+  if (hypr_focused_workspace(&active) >= 0) {
+    Workspace *ws = find_workspace(active);
+    focused_monitor = ws ? ws->monitor : NO_MONITOR;
+  }
+  if (hypr_clients(add_client, NULL) < 0) {
+    DEBUG_MSG("clients request failed");
+    return false;
+  }
+  changed = true;
+  DEBUG_MSG("resync: %zu workspaces, %zu monitors, %zu windows",
+            workspace_count, monitor_count, map_count);
+  return true;
+}
+
+static bool resync(void) {
+  Carried carried = carry_flags();
+  bool ok = query_tables();
+  restore_flags(&carried);
+  return ok;
+}
+
+// --- Events ---
+
+// openwindow>>ADDRESS,WORKSPACENAME,CLASS,TITLE
+// movewindowv2>>ADDRESS,WORKSPACEID,NAME  closewindow>>ADDRESS
+// Hyprland sends movewindow along with every movewindowv2; only the one
+// carrying the id is taken. DATA ends at the line's '\n'. Returns false
+// when the event names a window or workspace the tables have never seen.
+static bool apply_window(HyprEvent event, const char *data) {
+  char *end;
+  uint64_t address = strtoull(data, &end, 16);
+  if (end == data) {
+    return true;
+  }
+
+  if (event == HYPR_CLOSEWINDOW) {
+    return map_remove(address) != NO_WORKSPACE;
+  }
+  if (*end != ',') {
+    return true;
+  }
+  const char *field = end + 1;
+  if (event == HYPR_MOVEWINDOWV2) {
+    Workspace *ws = find_workspace((int)strtol(field, NULL, 10));
+    if (!ws) {
+      return false;
+    }
+    bool known = map_find(address) != NULL;
+    map_set(address, ws->WorkspaceID);
+    return known;
+  }
+  size_t name_len = strcspn(field, ",\n");
+  Workspace *ws = find_named(field, name_len);
+  if (!ws) {
+    return false;
+  }
+  WindowSlot *slot = map_set(address, ws->WorkspaceID);
+  const char *app = field + name_len;
+  if (slot && *app == ',') {
+    app++;
+    set_app(slot, app, strcspn(app, ",\n"));
+  }
+  return true;
+}
+
+// createworkspacev2>>ID,NAME  destroyworkspacev2>>ID,NAME
+// moveworkspacev2>>ID,NAME,MONITOR  renameworkspace>>ID,NAME
+// workspacev2>>ID,NAME  focusedmon>>MONITOR,WORKSPACENAME
+// New workspaces start on the focused monitor, which is where Hyprland
+// creates them; moveworkspacev2 corrects the rest. Returns false when the
+// event names a monitor or workspace the tables have never seen.
+static bool apply_workspace(HyprEvent event, const char *data, size_t len) {
+  const char *end = data + len;
+  if (event == HYPR_FOCUSEDMON) {
+    const char *comma = memchr(data, ',', len);
+    if (!comma) {
+      return true;
+    }
+    focused_monitor = find_monitor(data, (size_t)(comma - data));
+    Workspace *ws = find_named(comma + 1, (size_t)(end - comma - 1));
+    if (focused_monitor == NO_MONITOR || !ws) {
+      return false;
+    }
+    set_monitor(ws, focused_monitor);
+    return true;
+  }
+
+  char *name;
+  int id = (int)strtol(data, &name, 10);
+  if (name == data || *name != ',') {
+    return true;
+  }
+  name++;
+  size_t name_len = (size_t)(end - name);
+  Workspace *ws = find_workspace(id);
+  switch (event) {
+  case HYPR_CREATEWORKSPACEV2:
+    add_workspace(id, name, name_len, focused_monitor);
+    return true;
+  case HYPR_DESTROYWORKSPACEV2:
+    if (!ws) {
+      return true;
+    }
+    // Hyprland only destroys empty workspaces; windows still counted here
+    // mean the map missed their moves
+    bool empty = ws->windows == 0;
+    remove_workspace(ws);
+    return empty;
+  case HYPR_MOVEWORKSPACEV2: {
+    const char *comma = memrchr(name, ',', name_len);
+    int monitor = comma ? find_monitor(comma + 1, (size_t)(end - comma - 1))
+                        : NO_MONITOR;
+    if (!ws || monitor == NO_MONITOR) {
+      return false;
+    }
+    set_monitor(ws, monitor);
+    return true;
+  }
+  case HYPR_RENAMEWORKSPACE:
+    if (!ws) {
+      return false;
+    }
+    set_name(ws, name, name_len);
+    return true;
+  default: // workspacev2: the focused monitor shows it now
+    if (!ws) {
+      return false;
+    }
+    set_monitor(ws, focused_monitor);
+    return true;
+  }
+}
+
+// activewindowv2>>ADDRESS  urgent>>ADDRESS  fullscreen>>0|1
+// activespecial>>NAME,MONITOR (NAME empty when the monitor closes it)
+// Focus clears a window's urgency; fullscreen applies to the focused window.
+// Windows the map has not seen are left to the next openwindow or resync.
+static bool apply_flag(HyprEvent event, const char *data, size_t len) {
+  const char *end = data + len;
+  if (event == HYPR_ACTIVESPECIAL) {
+    const char *comma = memrchr(data, ',', len);
+    if (!comma) {
+      return true;
+    }
+    Monitor *mon = monitor_named(comma + 1, (size_t)(end - comma - 1));
+    if (!mon) {
+      return false;
+    }
+    Workspace *ws = comma > data ? find_named(data, (size_t)(comma - data))
+                                 : NULL;
+    show_special(mon, ws);
+    return comma == data || ws != NULL;
+  }
+  if (event == HYPR_FULLSCREEN) {
+    WindowSlot *slot = active_address ? map_find(active_address) : NULL;
+    if (slot) {
+      set_flag(slot, &slot->fullscreen, *data == '1');
+    }
+    return true;
+  }
+
+  uint64_t address = strtoull(data, NULL, 16);
+  if (event == HYPR_ACTIVEWINDOWV2) {
+    active_address = address;
+  }
+  WindowSlot *slot = address ? map_find(address) : NULL;
+  if (slot) {
+    set_flag(slot, &slot->urgent, event == HYPR_URGENT);
+  }
+  return true;
+}
+
+static void on_event(HyprEvent event, const char *data, size_t len) {
+  DEBUG_MSG("CAUGHT: %.*s", (int)len, data);
+  stats_event(stats);
+  switch (event) {
+  case HYPR_OPENWINDOW:
+  case HYPR_CLOSEWINDOW:
+  case HYPR_MOVEWINDOWV2:
+    consistent = apply_window(event, data) && consistent;
+    break;
+  case HYPR_MONITORADDED:
+  case HYPR_MONITORREMOVED:
+    consistent = false; // Hyprland reshuffles workspaces; ask it
+    break;
+  case HYPR_ACTIVEWINDOWV2:
+  case HYPR_URGENT:
+  case HYPR_FULLSCREEN:
+  case HYPR_ACTIVESPECIAL:
+    consistent = apply_flag(event, data, len) && consistent;
+    break;
+  default:
+    consistent = apply_workspace(event, data, len) && consistent;
+    break;
+  }
+}
+
+static void on_done(void) {
+  if (!consistent) {
+    DEBUG_MSG("tables out of step, resyncing");
+    consistent = resync(); // failing that, the next event asks again
+  }
+  if (consistent) {
+    publish();
+  }
+}
+
+// A new Hyprland starts with no urgent window and no special workspace open
+static void on_reconnect(void) {
+  map_clear();
+  for (size_t i = 0; i < monitor_count; i++) {
+    show_special(&monitors[i], NULL);
+  }
+  active_address = 0;
+  consistent = false;
+  on_done();
+}
+
+static const HyprSubscriber subscriber = {
+    "workspace_list",
+    HYPR_MASK(HYPR_OPENWINDOW) | HYPR_MASK(HYPR_CLOSEWINDOW) |
+        HYPR_MASK(HYPR_MOVEWINDOWV2) | HYPR_MASK(HYPR_CREATEWORKSPACEV2) |
+        HYPR_MASK(HYPR_DESTROYWORKSPACEV2) |
+        HYPR_MASK(HYPR_MOVEWORKSPACEV2) | HYPR_MASK(HYPR_RENAMEWORKSPACE) |
+        HYPR_MASK(HYPR_WORKSPACEV2) | HYPR_MASK(HYPR_FOCUSEDMON) |
+        HYPR_MASK(HYPR_MONITORADDED) | HYPR_MASK(HYPR_MONITORREMOVED) |
+        HYPR_MASK(HYPR_ACTIVEWINDOWV2) | HYPR_MASK(HYPR_URGENT) |
+        HYPR_MASK(HYPR_FULLSCREEN) | HYPR_MASK(HYPR_ACTIVESPECIAL),
+    on_event, on_done, on_reconnect};
+
+// --- Subscribe to the socket2 bus, which must be open already ---
+int workspace_list_start(FILE *stream) {
+  if (fields_init(&fields) < 0) {
+    return -1;
+  }
+  out = stream;
+  stats = stats_stream("workspace_list");
+  coalescer = coalesce_new("workspace_list", out, stats, COALESCE_DEFAULT_HZ);
+  if (hypr_bus_subscribe(&subscriber) < 0) {
+    DEBUG_MSG("too many socket2 subscribers");
+    return -1;
+  }
+  // The workspace buttons' clicks come in here (newwbar-ctl)
+  if (hypr_control_open() < 0) {
+    DEBUG_MSG("dispatch control socket unavailable");
+  }
+
+  // The bus connected first, so events racing the queries only repeat
+  // what they already saw; the tables absorb them
+  resync();
+  for (size_t i = 0; i < workspace_count; i++) {
+    workspaces[i].hasWindows = workspaces[i].windows > 0;
+    workspaces[i].fullscreen = workspaces[i].fullscreen_windows > 0;
+  }
+  print_json();
+  return 0;
+}
+
+#ifndef NEWWBAR_HUB
+// coalesce_poll() that also forwards dispatch commands; 1 once socket2 is
+// readable, -1 on error
+static int poll_bus(int sock) {
+  int control = hypr_control_fd();
+  struct pollfd pfd[2] = {{.fd = sock, .events = POLLIN},
+                          {.fd = control, .events = POLLIN}};
+  for (;;) {
+    int ready = poll(pfd, control >= 0 ? 2 : 1, coalesce_timeout_ms());
+    if (ready < 0 && errno == EINTR) {
+      continue;
+    }
+    coalesce_dispatch();
+    if (ready < 0) {
+      return -1;
+    }
+    if (control >= 0 && pfd[1].revents) {
+      hypr_control_read(control);
+    }
+    if (pfd[0].revents) {
+      return 1;
     }
   }
+}
 
-  close(sock);
+int main(int argc, char **argv) {
+  if (fields_args(argc, argv) < 0) {
+    return 1;
+  }
+  DEBUG_MSG("DEBUG enabled.");
+  stats_init("workspace_list");
+  int sock = hypr_bus_open();
+  if (sock < 0) {
+    DEBUG_MSG("socket2 connect failed");
+    return 1;
+  }
+  if (workspace_list_start(stdout) < 0) {
+    return 1;
+  }
+
+  do {
+    while (poll_bus(sock) > 0 && hypr_bus_dispatch(sock) == 0)
+      ;
+    DEBUG_MSG("Socket closed");
+    close(sock);
+    coalesce_flush_all(); // the last state stands while Hyprland is away
+  } while ((sock = hypr_bus_wait()) >= 0);
   return 0;
 }
+#endif